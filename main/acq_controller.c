@@ -0,0 +1,190 @@
+/**
+ * @file acq_controller.c
+ * @brief Adaptive acquisition controller (host-testable)
+ */
+
+#include "acq_controller.h"
+#include <string.h>
+#include <math.h>
+
+/** @brief Smoothing factor for per-sensor and bus estimates */
+#define ACQ_ALPHA 0.3f
+
+static float ewma(float prev, float sample)
+{
+    return prev + ACQ_ALPHA * (sample - prev);
+}
+
+void acq_config_defaults(acq_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->enabled = false;
+    cfg->min_interval_ms = ACQ_DEFAULT_MIN_INTERVAL_MS;
+    cfg->max_interval_ms = ACQ_DEFAULT_MAX_INTERVAL_MS;
+    cfg->min_resolution = ACQ_DEFAULT_MIN_RESOLUTION;
+    cfg->max_resolution = ACQ_DEFAULT_MAX_RESOLUTION;
+    cfg->quiet_rate = ACQ_DEFAULT_QUIET_RATE;
+    cfg->active_rate = ACQ_DEFAULT_ACTIVE_RATE;
+}
+
+bool acq_config_valid(const acq_config_t *cfg)
+{
+    if (cfg == NULL) {
+        return false;
+    }
+    if (cfg->min_interval_ms < 1000 || cfg->max_interval_ms > 300000 ||
+        cfg->min_interval_ms > cfg->max_interval_ms) {
+        return false;
+    }
+    if (cfg->min_resolution < 9 || cfg->max_resolution > 12 ||
+        cfg->min_resolution > cfg->max_resolution) {
+        return false;
+    }
+    if (cfg->quiet_rate < 0 || cfg->active_rate <= cfg->quiet_rate) {
+        return false;
+    }
+    return true;
+}
+
+float acq_resolution_step(int bits)
+{
+    if (bits < 9) bits = 9;
+    if (bits > 12) bits = 12;
+    return 0.5f / (float)(1 << (bits - 9));
+}
+
+void acq_init(acq_controller_t *ctrl, const acq_config_t *cfg,
+              acq_sensor_state_t *sensors, int count)
+{
+    memset(ctrl, 0, sizeof(*ctrl));
+    ctrl->cfg = *cfg;
+    ctrl->sensors = sensors;
+    ctrl->sensor_count = count;
+    if (sensors != NULL && count > 0) {
+        memset(sensors, 0, sizeof(*sensors) * count);
+    }
+
+    /* Start fast and precise until the signals have been learned */
+    ctrl->interval_ms = cfg->min_interval_ms;
+    ctrl->resolution = cfg->max_resolution;
+    ctrl->activity = 1.0f;
+}
+
+void acq_observe(acq_controller_t *ctrl, int index, bool valid, float temp, int64_t now_ms)
+{
+    if (index < 0 || index >= ctrl->sensor_count || !valid) {
+        return;
+    }
+
+    acq_sensor_state_t *s = &ctrl->sensors[index];
+    if (s->has_last && now_ms > s->last_ms) {
+        float dt_min = (float)(now_ms - s->last_ms) / 60000.0f;
+        float delta = temp - s->last_temp;
+
+        /* A single quantization step is not movement */
+        float step = acq_resolution_step(ctrl->resolution);
+        float moved = fabsf(delta) > step ? delta - copysignf(step, delta) : 0.0f;
+        float slope = moved / dt_min;
+
+        if (!s->has_estimate) {
+            s->slope = slope;
+            s->rate = fabsf(slope);
+            s->noise = 0.0f;
+            s->last_residual = 0.0f;
+            s->has_estimate = true;
+        } else {
+            /* Residual against the previous interval's slope. Taking the
+             * smaller of two consecutive residuals ignores a single kink
+             * (a ramp starting or stopping) but not sustained jitter. */
+            float residual = fabsf(delta - s->inst_slope * dt_min);
+            float sample = residual < s->last_residual ? residual : s->last_residual;
+            s->last_residual = residual;
+            s->noise = ewma(s->noise, sample);
+            s->slope = ewma(s->slope, slope);
+            s->rate = ewma(s->rate, fabsf(slope));
+        }
+        s->inst_slope = delta / dt_min;
+    }
+    s->last_temp = temp;
+    s->last_ms = now_ms;
+    s->has_last = true;
+}
+
+void acq_record_cycle(acq_controller_t *ctrl, uint32_t busy_ms, uint32_t period_ms, int samples)
+{
+    if (period_ms == 0) {
+        return;
+    }
+    float util = (float)busy_ms / (float)period_ms;
+    if (util > 1.0f) util = 1.0f;
+    float rate = (float)samples * 1000.0f / (float)period_ms;
+
+    if (ctrl->utilization == 0 && ctrl->sample_rate == 0) {
+        ctrl->utilization = util;
+        ctrl->sample_rate = rate;
+    } else {
+        ctrl->utilization = ewma(ctrl->utilization, util);
+        ctrl->sample_rate = ewma(ctrl->sample_rate, rate);
+    }
+}
+
+void acq_decide(acq_controller_t *ctrl)
+{
+    const acq_config_t *cfg = &ctrl->cfg;
+
+    /* The most active sensor sets the pace for the whole bus */
+    const acq_sensor_state_t *lead = NULL;
+    for (int i = 0; i < ctrl->sensor_count; i++) {
+        const acq_sensor_state_t *s = &ctrl->sensors[i];
+        if (s->has_estimate && (lead == NULL || s->rate > lead->rate)) {
+            lead = s;
+        }
+    }
+    if (lead == NULL) {
+        return;     /* Nothing learned yet - keep the current settings */
+    }
+
+    float a = (lead->rate - cfg->quiet_rate) / (cfg->active_rate - cfg->quiet_rate);
+    if (a < 0.0f) a = 0.0f;
+    if (a > 1.0f) a = 1.0f;
+    ctrl->activity = a;
+
+    uint32_t span = cfg->max_interval_ms - cfg->min_interval_ms;
+    uint32_t target_interval = cfg->max_interval_ms - (uint32_t)(a * (float)span);
+
+    int res_span = cfg->max_resolution - cfg->min_resolution;
+    int target_res = cfg->min_resolution + (int)ceilf(a * (float)res_span);
+    /* Bits below the noise floor carry no information */
+    while (target_res > cfg->min_resolution && acq_resolution_step(target_res) * 2.0f < lead->noise) {
+        target_res--;
+    }
+
+    bool faster = target_interval < ctrl->interval_ms || target_res > ctrl->resolution;
+    bool slower = target_interval > ctrl->interval_ms || target_res < ctrl->resolution;
+
+    if (target_interval < ctrl->interval_ms) {
+        ctrl->interval_ms = target_interval;
+    }
+    if (target_res > ctrl->resolution) {
+        ctrl->resolution = (uint8_t)target_res;
+    }
+
+    if (faster || !slower) {
+        ctrl->relax_count = 0;
+        return;
+    }
+
+    if (++ctrl->relax_count < ACQ_RELAX_CYCLES) {
+        return;
+    }
+    ctrl->relax_count = ACQ_RELAX_CYCLES;
+
+    /* Back off gradually so a brief lull doesn't miss the next step */
+    if (target_interval > ctrl->interval_ms) {
+        uint32_t next = ctrl->interval_ms + ctrl->interval_ms / 2;
+        ctrl->interval_ms = next < target_interval ? next : target_interval;
+    }
+    if (target_res < ctrl->resolution) {
+        ctrl->resolution--;
+    }
+}
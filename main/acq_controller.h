@@ -0,0 +1,121 @@
+/**
+ * @file acq_controller.h
+ * @brief Adaptive acquisition controller: tunes read interval and resolution
+ *        to how fast and how noisily sensors are changing (host-testable)
+ *
+ * All sensors on the bus convert together (skip ROM), so interval and
+ * resolution are bus-wide. The most active sensor sets the pace: when every
+ * signal is quiet the bus slows down and drops resolution; as soon as one
+ * starts moving, interval and resolution step up within the configured bounds.
+ */
+
+#ifndef ACQ_CONTROLLER_H
+#define ACQ_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Default bounds used until configured */
+#define ACQ_DEFAULT_MIN_INTERVAL_MS 2000
+#define ACQ_DEFAULT_MAX_INTERVAL_MS 60000
+#define ACQ_DEFAULT_MIN_RESOLUTION  9
+#define ACQ_DEFAULT_MAX_RESOLUTION  12
+#define ACQ_DEFAULT_QUIET_RATE      0.05f   /**< °C/min */
+#define ACQ_DEFAULT_ACTIVE_RATE     1.0f    /**< °C/min */
+
+/** @brief Consecutive decisions required before slowing down */
+#define ACQ_RELAX_CYCLES 5
+
+/**
+ * @brief Controller configuration (stored in NVS)
+ */
+typedef struct {
+    bool enabled;               /**< Adaptive mode on/off */
+    uint32_t min_interval_ms;   /**< Fastest read interval */
+    uint32_t max_interval_ms;   /**< Slowest read interval */
+    uint8_t min_resolution;     /**< Lowest resolution (9-12 bits) */
+    uint8_t max_resolution;     /**< Highest resolution (9-12 bits) */
+    float quiet_rate;           /**< At or below this (°C/min) a sensor is quiet */
+    float active_rate;          /**< At or above this (°C/min) a sensor is fully active */
+} acq_config_t;
+
+/**
+ * @brief Per-sensor signal estimate
+ */
+typedef struct {
+    float slope;                /**< Smoothed signed slope (°C/min) */
+    float rate;                 /**< Smoothed |slope| (°C/min) */
+    float noise;                /**< Smoothed prediction residual (°C) */
+    float inst_slope;           /**< Slope of the last interval (°C/min) */
+    float last_residual;        /**< Previous raw residual (°C) */
+    float last_temp;            /**< Previous valid reading */
+    int64_t last_ms;            /**< Time of previous valid reading */
+    bool has_last;              /**< last_temp/last_ms are set */
+    bool has_estimate;          /**< slope/rate/noise are initialized */
+} acq_sensor_state_t;
+
+/**
+ * @brief Controller state
+ */
+typedef struct {
+    acq_config_t cfg;
+    acq_sensor_state_t *sensors;    /**< Caller-owned array */
+    int sensor_count;
+
+    uint32_t interval_ms;       /**< Current read interval */
+    uint8_t resolution;         /**< Current resolution */
+    float activity;             /**< Last activity score (0 = quiet, 1 = active) */
+    int relax_count;            /**< Decisions in a row that wanted to slow down */
+
+    float utilization;          /**< Smoothed bus busy fraction (0-1) */
+    float sample_rate;          /**< Smoothed readings per second */
+} acq_controller_t;
+
+/**
+ * @brief Fill a configuration with defaults (disabled)
+ */
+void acq_config_defaults(acq_config_t *cfg);
+
+/**
+ * @brief Check configuration bounds
+ * @return true if valid
+ */
+bool acq_config_valid(const acq_config_t *cfg);
+
+/**
+ * @brief Initialize the controller
+ * @param ctrl Controller
+ * @param cfg Configuration (copied)
+ * @param sensors Per-sensor state array (cleared)
+ * @param count Number of sensors
+ */
+void acq_init(acq_controller_t *ctrl, const acq_config_t *cfg,
+              acq_sensor_state_t *sensors, int count);
+
+/**
+ * @brief Feed one reading into a sensor's estimate
+ */
+void acq_observe(acq_controller_t *ctrl, int index, bool valid, float temp, int64_t now_ms);
+
+/**
+ * @brief Record bus time for one cycle
+ * @param busy_ms Time the bus was busy (convert + reads)
+ * @param period_ms Time since the previous cycle started
+ * @param samples Readings taken in the cycle
+ */
+void acq_record_cycle(acq_controller_t *ctrl, uint32_t busy_ms, uint32_t period_ms, int samples);
+
+/**
+ * @brief Choose interval and resolution for the next cycle
+ *
+ * Speeds up immediately when activity rises; slows down only after
+ * ACQ_RELAX_CYCLES quiet decisions in a row, and then gradually.
+ */
+void acq_decide(acq_controller_t *ctrl);
+
+/**
+ * @brief Temperature step of a resolution (0.5 °C at 9 bits ... 0.0625 °C at 12)
+ */
+float acq_resolution_step(int bits);
+
+#endif /* ACQ_CONTROLLER_H */
@@ -0,0 +1,201 @@
+/**
+ * @file acq_watchdog.c
+ * @brief Acquisition stall detection and staged bus recovery
+ */
+
+#include "acq_watchdog.h"
+#include "bus_task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_attr.h"
+#include "esp_task_wdt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "acq_wdt";
+
+#define RTC_STATE_MAGIC 0x52435652  /* "RCVR" */
+
+/* Longest sleep between task watchdog feeds */
+#ifdef CONFIG_ESP_TASK_WDT_TIMEOUT_S
+#define FEED_INTERVAL_MS (CONFIG_ESP_TASK_WDT_TIMEOUT_S * 1000 / 2)
+#else
+#define FEED_INTERVAL_MS 2500
+#endif
+
+/**
+ * @brief Recovery state kept in RTC memory over a warm reset
+ */
+typedef struct {
+    uint32_t magic;
+    int64_t uptime_ms;          /**< Last progress before the reset, to rebase times on */
+    recovery_policy_t policy;
+} rtc_state_t;
+
+static RTC_NOINIT_ATTR rtc_state_t s_rtc;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_last_progress_ms = 0;
+static bool s_attached = false;
+static bool s_subscribed = false;  /* To the task watchdog */
+static bool s_stall_reported = false;
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+esp_err_t acq_watchdog_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool warm = reason == ESP_RST_SW || reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+                reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+
+    if (warm && s_rtc.magic == RTC_STATE_MAGIC && recovery_is_valid(&s_rtc.policy)) {
+        recovery_rebase(&s_rtc.policy, s_rtc.uptime_ms);
+        s_rtc.policy.threshold = CONFIG_ACQ_RECOVERY_BAD_CYCLES;
+        s_rtc.policy.bad_cycles = 0;
+        if (s_rtc.policy.in_incident) {
+            ESP_LOGW(TAG, "Resuming acquisition recovery after reboot (stage %s)",
+                     recovery_stage_name(s_rtc.policy.stage));
+        }
+    } else {
+        recovery_init(&s_rtc.policy, CONFIG_ACQ_RECOVERY_BAD_CYCLES);
+        s_rtc.magic = RTC_STATE_MAGIC;
+    }
+    s_rtc.uptime_ms = 0;
+    return ESP_OK;
+}
+
+void acq_watchdog_attach(void)
+{
+    esp_err_t err = esp_task_wdt_add(NULL);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Task watchdog subscription failed: %s", esp_err_to_name(err));
+    }
+    s_subscribed = err == ESP_OK;
+    acq_watchdog_feed();
+    s_attached = true;
+}
+
+void acq_watchdog_feed(void)
+{
+    int64_t now = now_ms();
+    if (s_subscribed) {
+        esp_task_wdt_reset();
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_last_progress_ms = now;
+    s_rtc.uptime_ms = now;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void acq_watchdog_sleep(uint32_t ms)
+{
+    while (ms > 0) {
+        uint32_t slice_ms = ms < FEED_INTERVAL_MS ? ms : FEED_INTERVAL_MS;
+        vTaskDelay(pdMS_TO_TICKS(slice_ms));
+        acq_watchdog_feed();
+        ms -= slice_ms;
+    }
+}
+
+static void reboot(void)
+{
+    ESP_LOGE(TAG, "Acquisition did not recover, rebooting");
+    portENTER_CRITICAL(&s_mux);
+    s_rtc.uptime_ms = now_ms();
+    portEXIT_CRITICAL(&s_mux);
+    vTaskDelay(pdMS_TO_TICKS(100));     /* Let the log drain */
+    esp_restart();
+}
+
+static void run_stage(recovery_stage_t stage)
+{
+    esp_err_t err = ESP_OK;
+
+    ESP_LOGW(TAG, "Acquisition failing, recovery stage: %s", recovery_stage_name(stage));
+    switch (stage) {
+    case RECOVERY_BUS_RESET:
+        err = bus_task_recover(false);
+        break;
+    case RECOVERY_BUS_RECREATE:
+        err = bus_task_recover(true);
+        break;
+    case RECOVERY_RESCAN:
+        err = sensor_manager_rescan();
+        break;
+    case RECOVERY_REBOOT:
+        reboot();
+        break;
+    default:
+        break;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Recovery stage %s: %s", recovery_stage_name(stage), esp_err_to_name(err));
+    }
+}
+
+uint32_t acq_watchdog_report(sensor_cycle_result_t result)
+{
+    acq_watchdog_feed();
+    if (result == SENSOR_CYCLE_IDLE) {
+        return 0;
+    }
+
+    int64_t now = now_ms();
+    recovery_stage_t stage = RECOVERY_NONE;
+    recovery_event_t ev;
+    bool closed = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (result == SENSOR_CYCLE_OK) {
+        closed = recovery_on_good(&s_rtc.policy, now) && recovery_get_event(&s_rtc.policy, 0, &ev);
+    } else {
+        stage = recovery_on_bad(&s_rtc.policy, now, result == SENSOR_CYCLE_FAILED ?
+                                RECOVERY_CAUSE_FAILED : RECOVERY_CAUSE_OVERRUN);
+    }
+    uint32_t retry_ms = recovery_retry_ms(&s_rtc.policy);
+    portEXIT_CRITICAL(&s_mux);
+
+    if (closed) {
+        ESP_LOGW(TAG, "Acquisition recovered after %lu ms (%s, last stage %s)",
+                 (unsigned long)ev.duration_ms, recovery_cause_name(ev.cause),
+                 recovery_stage_name(ev.stage));
+    }
+    if (stage != RECOVERY_NONE) {
+        run_stage(stage);
+    }
+    return result == SENSOR_CYCLE_FAILED ? retry_ms : 0;
+}
+
+void acq_watchdog_check(void)
+{
+    if (!s_attached) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    int64_t since = s_last_progress_ms;
+    bool stalled = now_ms() - since >= (int64_t)CONFIG_ACQ_STALL_TIMEOUT_S * 1000;
+    recovery_stage_t stage = stalled ? recovery_on_stall(&s_rtc.policy, since) : RECOVERY_NONE;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (!stalled) {
+        s_stall_reported = false;
+    } else if (stage == RECOVERY_REBOOT) {
+        ESP_LOGE(TAG, "Acquisition task stalled for %lld s", (now_ms() - since) / 1000);
+        reboot();
+    } else if (!s_stall_reported) {
+        /* Rebooting again would only loop; stay up so the API can tell */
+        ESP_LOGE(TAG, "Acquisition task stalled again after a recovery reboot");
+        s_stall_reported = true;
+    }
+}
+
+void acq_watchdog_get_state(recovery_policy_t *out)
+{
+    portENTER_CRITICAL(&s_mux);
+    *out = s_rtc.policy;
+    portEXIT_CRITICAL(&s_mux);
+}
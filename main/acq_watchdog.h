@@ -0,0 +1,65 @@
+/**
+ * @file acq_watchdog.h
+ * @brief Acquisition stall detection and staged bus recovery
+ *
+ * The acquisition task is subscribed to the task watchdog and reports each
+ * read cycle here. Runs of failed or overrun cycles escalate through the
+ * stages of recovery_policy.h: bus reset and driver re-creation on the bus
+ * task, then a rescan, then a controlled reboot. A task stuck on the bus
+ * stops feeding the task watchdog, which logs where it is stuck; once it
+ * has made no progress for CONFIG_ACQ_STALL_TIMEOUT_S the system monitor
+ * reboots.
+ *
+ * The recovery state lives in RTC memory that survives a warm reset, so an
+ * incident a reboot was meant to fix is still closed and timed after it.
+ */
+
+#ifndef ACQ_WATCHDOG_H
+#define ACQ_WATCHDOG_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "recovery_policy.h"
+#include "sensor_manager.h"
+
+/**
+ * @brief Restore the recovery state kept over a warm reset, or start fresh
+ */
+esp_err_t acq_watchdog_init(void);
+
+/**
+ * @brief Subscribe the calling task (the acquisition task) to the task watchdog
+ */
+void acq_watchdog_attach(void);
+
+/**
+ * @brief Feed the task watchdog and record progress
+ *
+ * The acquisition task calls this at least every half task watchdog period,
+ * including while it sleeps between cycles.
+ */
+void acq_watchdog_feed(void);
+
+/**
+ * @brief Sleep, waking to feed the task watchdog
+ */
+void acq_watchdog_sleep(uint32_t ms);
+
+/**
+ * @brief Report a read cycle and run any recovery stage it triggers
+ * @return Delay before retrying a failed cycle in ms, 0 to keep the
+ *         normal schedule
+ */
+uint32_t acq_watchdog_report(sensor_cycle_result_t result);
+
+/**
+ * @brief Reboot if the acquisition task has stalled (from the system monitor)
+ */
+void acq_watchdog_check(void);
+
+/**
+ * @brief Copy the recovery state (history, MTTR)
+ */
+void acq_watchdog_get_state(recovery_policy_t *out);
+
+#endif /* ACQ_WATCHDOG_H */
@@ -0,0 +1,105 @@
+/**
+ * @file alert_rules.c
+ * @brief Per-sensor alert rules compiled to a compact evaluation table (host-testable)
+ */
+
+#include "alert_rules.h"
+#include <string.h>
+#include <math.h>
+
+bool alert_rule_compile(const alert_rule_config_t *cfg, alert_rule_t *rule)
+{
+    if (cfg == NULL || rule == NULL) {
+        return false;
+    }
+    if (cfg->hysteresis < 0 || cfg->max_rate < 0) {
+        return false;
+    }
+    /* Overlapping bands would make HIGH and LOW chatter against each other */
+    if (cfg->high_enabled && cfg->low_enabled && cfg->low + cfg->hysteresis >= cfg->high) {
+        return false;
+    }
+
+    memset(rule, 0, sizeof(*rule));
+
+    if (cfg->high_enabled) {
+        rule->enabled |= ALERT_HIGH;
+        rule->high_set = cfg->high;
+        rule->high_clear = cfg->high - cfg->hysteresis;
+    }
+    if (cfg->low_enabled) {
+        rule->enabled |= ALERT_LOW;
+        rule->low_set = cfg->low;
+        rule->low_clear = cfg->low + cfg->hysteresis;
+    }
+    if (cfg->max_rate > 0) {
+        rule->enabled |= ALERT_RATE;
+        rule->max_rate_per_ms = cfg->max_rate / 60000.0f;
+    }
+    if (cfg->stale_ms > 0) {
+        rule->enabled |= ALERT_STALE;
+        rule->stale_ms = cfg->stale_ms;
+    }
+    return true;
+}
+
+void alert_rule_reset(alert_rule_t *rule, int64_t now_ms)
+{
+    rule->active = 0;
+    rule->has_last = false;
+    rule->last_ms = now_ms;
+}
+
+bool alert_rule_eval(alert_rule_t *rule, bool valid, float temp, int64_t now_ms,
+                     uint8_t *raised, uint8_t *cleared)
+{
+    uint8_t active = rule->active;
+
+    if (valid) {
+        if (rule->enabled & ALERT_HIGH) {
+            if (temp > rule->high_set) {
+                active |= ALERT_HIGH;
+            } else if (temp <= rule->high_clear) {
+                active &= ~ALERT_HIGH;
+            }
+        }
+        if (rule->enabled & ALERT_LOW) {
+            if (temp < rule->low_set) {
+                active |= ALERT_LOW;
+            } else if (temp >= rule->low_clear) {
+                active &= ~ALERT_LOW;
+            }
+        }
+        if ((rule->enabled & ALERT_RATE) && rule->has_last && now_ms > rule->last_ms) {
+            float rate = fabsf(temp - rule->last_temp) / (float)(now_ms - rule->last_ms);
+            if (rate > rule->max_rate_per_ms) {
+                active |= ALERT_RATE;
+            } else {
+                active &= ~ALERT_RATE;
+            }
+        }
+        active &= ~ALERT_STALE;
+
+        rule->last_temp = temp;
+        rule->last_ms = now_ms;
+        rule->has_last = true;
+    } else if ((rule->enabled & ALERT_STALE) && now_ms - rule->last_ms > (int64_t)rule->stale_ms) {
+        active |= ALERT_STALE;
+    }
+
+    *raised = active & ~rule->active;
+    *cleared = rule->active & ~active;
+    rule->active = active;
+    return (*raised | *cleared) != 0;
+}
+
+const char *alert_type_name(uint8_t type)
+{
+    switch (type) {
+    case ALERT_HIGH:  return "high";
+    case ALERT_LOW:   return "low";
+    case ALERT_RATE:  return "rate";
+    case ALERT_STALE: return "stale";
+    default:          return "unknown";
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file alert_rules.h
+ * @brief Per-sensor alert rules compiled to a compact evaluation table (host-testable)
+ */
+
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Alert types (bit flags) */
+#define ALERT_HIGH  0x01    /**< Temperature above high threshold */
+#define ALERT_LOW   0x02    /**< Temperature below low threshold */
+#define ALERT_RATE  0x04    /**< Rate of change above limit */
+#define ALERT_STALE 0x08    /**< No valid reading for too long */
+
+/**
+ * @brief Alert rule as configured by the user (stored in NVS)
+ */
+typedef struct {
+    bool high_enabled;      /**< Enable high threshold */
+    float high;             /**< High threshold (°C) */
+    bool low_enabled;       /**< Enable low threshold */
+    float low;              /**< Low threshold (°C) */
+    float hysteresis;       /**< Clear margin for thresholds (°C) */
+    float max_rate;         /**< Rate limit in °C/min (0 = disabled) */
+    uint32_t stale_ms;      /**< Stale timeout in ms (0 = disabled) */
+} alert_rule_config_t;
+
+/**
+ * @brief Compiled rule and its runtime state
+ *
+ * Thresholds are pre-shifted by the hysteresis so evaluation is a handful
+ * of compares per reading.
+ */
+typedef struct {
+    uint8_t enabled;        /**< Enabled alert types (ALERT_* mask) */
+    uint8_t active;         /**< Currently active alerts (ALERT_* mask) */
+    bool has_last;          /**< last_temp/last_ms hold a previous reading */
+    float high_set;         /**< Raise HIGH above this */
+    float high_clear;       /**< Clear HIGH at or below this */
+    float low_set;          /**< Raise LOW below this */
+    float low_clear;        /**< Clear LOW at or above this */
+    float max_rate_per_ms;  /**< Rate limit in °C/ms */
+    uint32_t stale_ms;      /**< Stale timeout */
+    float last_temp;        /**< Previous valid temperature */
+    int64_t last_ms;        /**< Time of previous valid reading */
+} alert_rule_t;
+
+/**
+ * @brief Validate a rule configuration and compile it
+ * @param cfg Rule configuration
+ * @param rule Output: compiled rule (runtime state cleared)
+ * @return true on success, false if the configuration is invalid
+ */
+bool alert_rule_compile(const alert_rule_config_t *cfg, alert_rule_t *rule);
+
+/**
+ * @brief Start stale tracking from a known time (e.g. after boot or rescan)
+ */
+void alert_rule_reset(alert_rule_t *rule, int64_t now_ms);
+
+/**
+ * @brief Evaluate a rule against one reading
+ * @param rule Compiled rule (state is updated)
+ * @param valid Whether the reading is valid
+ * @param temp Temperature (ignored if !valid)
+ * @param now_ms Current time in ms
+ * @param raised Output: alerts that became active
+ * @param cleared Output: alerts that became inactive
+ * @return true if any alert changed state
+ */
+bool alert_rule_eval(alert_rule_t *rule, bool valid, float temp, int64_t now_ms,
+                     uint8_t *raised, uint8_t *cleared);
+
+/**
+ * @brief Get the name of a single alert type ("high", "low", "rate", "stale")
+ */
+const char *alert_type_name(uint8_t type);
+
+#endif /* ALERT_RULES_H */
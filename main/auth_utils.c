@@ -0,0 +1,217 @@
+/**
+ * @file auth_utils.c
+ * @brief Session token table and constant-time auth helpers (host-testable)
+ */
+
+#include "auth_utils.h"
+#include <string.h>
+
+#define SLOT_EMPTY   0
+#define SLOT_USED    1
+#define SLOT_DELETED 2
+
+bool auth_ct_equal(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+bool auth_ct_str_equal(const char *given, size_t given_len, const char *expected)
+{
+    if (given == NULL || expected == NULL) {
+        return false;
+    }
+
+    size_t expected_len = strlen(expected);
+    uint8_t diff = (given_len != expected_len) ? 1 : 0;
+
+    /* Always walk the full secret; read given only within its bounds */
+    for (size_t i = 0; i < expected_len; i++) {
+        uint8_t g = (i < given_len) ? (uint8_t)given[i] : 0;
+        diff |= g ^ (uint8_t)expected[i];
+    }
+    return diff == 0;
+}
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool auth_hex_to_bytes(const char *hex, size_t hex_len, uint8_t *out, size_t out_len)
+{
+    if (hex == NULL || out == NULL || hex_len != out_len * 2) {
+        return false;
+    }
+
+    for (size_t i = 0; i < out_len; i++) {
+        int hi = hex_nibble(hex[i * 2]);
+        int lo = hex_nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+void auth_bytes_to_hex(const uint8_t *bytes, size_t len, char *out)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = digits[bytes[i] >> 4];
+        out[i * 2 + 1] = digits[bytes[i] & 0x0F];
+    }
+    out[len * 2] = '\0';
+}
+
+bool auth_cookie_find(const char *cookie, const char *name, const char **value, size_t *value_len)
+{
+    if (cookie == NULL || name == NULL || value == NULL || value_len == NULL) {
+        return false;
+    }
+
+    size_t name_len = strlen(name);
+    const char *p = cookie;
+
+    while (*p) {
+        /* Skip separators and whitespace between cookie pairs */
+        while (*p == ' ' || *p == ';') {
+            p++;
+        }
+        if (strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+            const char *start = p + name_len + 1;
+            const char *end = start;
+            while (*end && *end != ';') {
+                end++;
+            }
+            *value = start;
+            *value_len = (size_t)(end - start);
+            return true;
+        }
+        /* Advance to the next pair */
+        while (*p && *p != ';') {
+            p++;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Home slot for a token (tokens are random, so leading bytes suffice)
+ */
+static int home_slot(const uint8_t *token)
+{
+    uint32_t h = (uint32_t)token[0] | ((uint32_t)token[1] << 8) |
+                 ((uint32_t)token[2] << 16) | ((uint32_t)token[3] << 24);
+    return (int)(h & (AUTH_SESSION_SLOTS - 1));
+}
+
+/**
+ * @brief Find the slot holding a token, or -1
+ */
+static int find_slot(const auth_session_table_t *table, const uint8_t *token)
+{
+    int slot = home_slot(token);
+    for (int probe = 0; probe < AUTH_SESSION_SLOTS; probe++) {
+        const auth_session_t *s = &table->slots[slot];
+        if (s->state == SLOT_EMPTY) {
+            return -1;
+        }
+        if (s->state == SLOT_USED && auth_ct_equal(s->token, token, AUTH_TOKEN_LEN)) {
+            return slot;
+        }
+        slot = (slot + 1) & (AUTH_SESSION_SLOTS - 1);
+    }
+    return -1;
+}
+
+static void remove_slot(auth_session_table_t *table, int slot)
+{
+    memset(&table->slots[slot], 0, sizeof(auth_session_t));
+    table->slots[slot].state = SLOT_DELETED;
+    table->count--;
+
+    /* Drop tombstones once the table empties so probe chains stay short */
+    if (table->count == 0) {
+        memset(table->slots, 0, sizeof(table->slots));
+    }
+}
+
+void auth_sessions_init(auth_session_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+bool auth_sessions_add(auth_session_table_t *table, const uint8_t *token, int64_t expiry, int64_t now)
+{
+    bool evicted = false;
+
+    if (table->count >= AUTH_MAX_SESSIONS) {
+        /* Purge expired sessions first */
+        for (int i = 0; i < AUTH_SESSION_SLOTS; i++) {
+            if (table->slots[i].state == SLOT_USED && now > table->slots[i].expiry) {
+                remove_slot(table, i);
+            }
+        }
+    }
+
+    if (table->count >= AUTH_MAX_SESSIONS) {
+        /* Still full - evict the session closest to expiry */
+        int oldest = -1;
+        for (int i = 0; i < AUTH_SESSION_SLOTS; i++) {
+            if (table->slots[i].state == SLOT_USED &&
+                (oldest < 0 || table->slots[i].expiry < table->slots[oldest].expiry)) {
+                oldest = i;
+            }
+        }
+        if (oldest >= 0) {
+            remove_slot(table, oldest);
+            evicted = true;
+        }
+    }
+
+    int slot = home_slot(token);
+    for (int probe = 0; probe < AUTH_SESSION_SLOTS; probe++) {
+        if (table->slots[slot].state != SLOT_USED) {
+            break;
+        }
+        slot = (slot + 1) & (AUTH_SESSION_SLOTS - 1);
+    }
+
+    memcpy(table->slots[slot].token, token, AUTH_TOKEN_LEN);
+    table->slots[slot].expiry = expiry;
+    table->slots[slot].state = SLOT_USED;
+    table->count++;
+
+    return evicted;
+}
+
+bool auth_sessions_check(auth_session_table_t *table, const uint8_t *token, int64_t now)
+{
+    int slot = find_slot(table, token);
+    if (slot < 0) {
+        return false;
+    }
+    if (now > table->slots[slot].expiry) {
+        remove_slot(table, slot);
+        return false;
+    }
+    return true;
+}
+
+bool auth_sessions_remove(auth_session_table_t *table, const uint8_t *token)
+{
+    int slot = find_slot(table, token);
+    if (slot < 0) {
+        return false;
+    }
+    remove_slot(table, slot);
+    return true;
+}
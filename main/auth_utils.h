@@ -0,0 +1,121 @@
+/**
+ * @file auth_utils.h
+ * @brief Session token table and constant-time auth helpers (host-testable)
+ */
+
+#ifndef AUTH_UTILS_H
+#define AUTH_UTILS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Session token size in bytes (128-bit) */
+#define AUTH_TOKEN_LEN 16
+
+/** @brief Session token as lowercase hex string (excluding null) */
+#define AUTH_TOKEN_HEX_LEN (AUTH_TOKEN_LEN * 2)
+
+/** @brief Hash table slots (power of two) */
+#define AUTH_SESSION_SLOTS 64
+
+/** @brief Maximum live sessions (keeps load factor at 75%) */
+#define AUTH_MAX_SESSIONS 48
+
+/**
+ * @brief Session table entry
+ */
+typedef struct {
+    uint8_t token[AUTH_TOKEN_LEN];  /**< Binary session token */
+    int64_t expiry;                 /**< Expiry time (ms since boot) */
+    uint8_t state;                  /**< Slot state (empty/used/deleted) */
+} auth_session_t;
+
+/**
+ * @brief Open-addressed session table (linear probing)
+ */
+typedef struct {
+    auth_session_t slots[AUTH_SESSION_SLOTS];
+    int count;                      /**< Number of live sessions */
+} auth_session_table_t;
+
+/**
+ * @brief Compare two buffers in constant time
+ * @return true if equal
+ */
+bool auth_ct_equal(const uint8_t *a, const uint8_t *b, size_t len);
+
+/**
+ * @brief Compare two strings in constant time with respect to content
+ *
+ * Running time depends only on the length of @p expected, never on where
+ * the first mismatching character is.
+ *
+ * @param given String supplied by the client (may be NULL)
+ * @param given_len Length of @p given
+ * @param expected Secret to compare against
+ * @return true if equal
+ */
+bool auth_ct_str_equal(const char *given, size_t given_len, const char *expected);
+
+/**
+ * @brief Parse hex string into bytes
+ * @param hex Input hex characters (not necessarily null-terminated)
+ * @param hex_len Number of hex characters (must be 2 * out_len)
+ * @param out Output buffer
+ * @param out_len Number of bytes to produce
+ * @return true on success, false on bad length or non-hex character
+ */
+bool auth_hex_to_bytes(const char *hex, size_t hex_len, uint8_t *out, size_t out_len);
+
+/**
+ * @brief Format bytes as lowercase hex
+ * @param bytes Input bytes
+ * @param len Number of bytes
+ * @param out Output buffer (must be at least 2 * len + 1 bytes)
+ */
+void auth_bytes_to_hex(const uint8_t *bytes, size_t len, char *out);
+
+/**
+ * @brief Locate a cookie value in a Cookie header without copying
+ * @param cookie Cookie header value
+ * @param name Cookie name (e.g. "session")
+ * @param value Output: start of value within @p cookie
+ * @param value_len Output: length of value
+ * @return true if found
+ */
+bool auth_cookie_find(const char *cookie, const char *name, const char **value, size_t *value_len);
+
+/**
+ * @brief Clear all sessions
+ */
+void auth_sessions_init(auth_session_table_t *table);
+
+/**
+ * @brief Add a session
+ *
+ * Expired sessions are purged if the table is full. If it is still full,
+ * the session closest to expiry is evicted.
+ *
+ * @param table Session table
+ * @param token Token to add (caller generates it)
+ * @param expiry Expiry time (ms since boot)
+ * @param now Current time (ms since boot)
+ * @return true if an older live session had to be evicted
+ */
+bool auth_sessions_add(auth_session_table_t *table, const uint8_t *token, int64_t expiry, int64_t now);
+
+/**
+ * @brief Check whether a token belongs to a live session
+ *
+ * An expired matching session is removed.
+ */
+bool auth_sessions_check(auth_session_table_t *table, const uint8_t *token, int64_t now);
+
+/**
+ * @brief Remove a session
+ * @return true if the token was found
+ */
+bool auth_sessions_remove(auth_session_table_t *table, const uint8_t *token);
+
+#endif /* AUTH_UTILS_H */
@@ -0,0 +1,284 @@
+/**
+ * @file burst_capture.c
+ * @brief High-rate burst capture of a sensor subset into a RAM ring
+ *
+ * The ring is a static array sized by CONFIG_BURST_CAPTURE_SAMPLES, so a
+ * capture allocates nothing. The burst task holds the bus resolution for
+ * the length of the capture; skip-ROM converts every sensor, so periodic
+ * reads run at the burst resolution too until it ends.
+ */
+
+#include "burst_capture.h"
+#include "bus_task.h"
+#include "sensor_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "burst";
+
+#define BURST_TASK_STACK_SIZE 3072
+#define BURST_TASK_PRIORITY   4     /* Below temp_task; it mostly waits on the bus */
+#define BURST_EXPORT_CHUNK    64    /* Records copied per write */
+
+static burst_record_t s_records[CONFIG_BURST_CAPTURE_SAMPLES];
+static burst_ring_t s_ring = {
+    .records = s_records,
+    .capacity = CONFIG_BURST_CAPTURE_SAMPLES,
+};
+
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buf;
+static TaskHandle_t s_task = NULL;
+
+/**
+ * @brief Sensors of a capture and where they sit on the bus
+ */
+typedef struct {
+    uint32_t generation;                                /* Device list the indices belong to */
+    int bus_count;
+    bool selected[CONFIG_MAX_SENSORS];
+    uint8_t table_index[CONFIG_MAX_SENSORS];            /* Bus index -> table index */
+    uint8_t table[CONFIG_MAX_SENSORS][ONEWIRE_ROM_SIZE];
+    int table_count;
+} burst_sensors_t;
+
+/* Setup of the current/last capture, fixed while the task runs */
+static burst_sensors_t s_sensors;
+static int s_resolution = 0;
+static onewire_sensor_t s_hw[CONFIG_MAX_SENSORS];
+
+static void burst_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Capture started: %d sensors at %d bits", s_sensors.table_count, s_resolution);
+
+    while (1) {
+        int64_t convert_us = 0;
+        for (int i = 0; i < s_sensors.bus_count; i++) {
+            s_hw[i].valid = false;
+            s_hw[i].total_reads = 0;
+        }
+
+        esp_err_t err = bus_task_read_burst(s_hw, s_sensors.bus_count, s_sensors.selected, s_sensors.generation, &convert_us);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        bool attempted = false;
+        for (int i = 0; i < s_sensors.bus_count; i++) {
+            attempted |= s_sensors.selected[i] && s_hw[i].total_reads > 0;
+        }
+        if (err == ESP_ERR_INVALID_STATE || !attempted) {
+            /* Sensor list replaced, or the bus failed before any scratchpad read */
+            ESP_LOGW(TAG, "Capture aborted: %s", esp_err_to_name(err));
+            burst_ring_stop(&s_ring, BURST_STOP_ERROR, now);
+        } else {
+            for (int i = 0; i < s_sensors.bus_count; i++) {
+                if (s_sensors.selected[i]) {
+                    burst_ring_add(&s_ring, convert_us, s_sensors.table_index[i], s_hw[i].valid,
+                                   s_hw[i].temperature);
+                }
+            }
+            burst_ring_check_time(&s_ring, now);
+        }
+        bool running = s_ring.state == BURST_RUNNING;
+        xSemaphoreGive(s_lock);
+
+        if (!running) {
+            break;
+        }
+    }
+
+    bus_task_hold_resolution(0);
+    ESP_LOGI(TAG, "Capture finished (%s): %lu records, %lu taken",
+             burst_stop_name(s_ring.reason), (unsigned long)s_ring.count, (unsigned long)s_ring.total);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_task = NULL;
+    xSemaphoreGive(s_lock);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Resolve the requested sensors against the bus
+ */
+static esp_err_t build_table(const burst_request_t *req, burst_sensors_t *out, burst_config_t *cfg)
+{
+    uint8_t addresses[CONFIG_MAX_SENSORS][ONEWIRE_ROM_SIZE];
+    char address_str[17];
+
+    out->bus_count = sensor_manager_get_bus_snapshot(addresses, CONFIG_MAX_SENSORS, &out->generation);
+    out->table_count = 0;
+    cfg->trigger_enabled = false;
+
+    for (int i = 0; i < out->bus_count; i++) {
+        onewire_address_to_string(addresses[i], address_str);
+        out->selected[i] = req->sensor_count == 0;
+        for (int j = 0; j < req->sensor_count && !out->selected[i]; j++) {
+            out->selected[i] = strcmp(req->sensors[j], address_str) == 0;
+        }
+        if (!out->selected[i]) {
+            continue;
+        }
+        out->table_index[i] = (uint8_t)out->table_count;
+        memcpy(out->table[out->table_count], addresses[i], ONEWIRE_ROM_SIZE);
+        if (req->trigger_sensor != NULL && strcmp(req->trigger_sensor, address_str) == 0) {
+            cfg->trigger_enabled = true;
+            cfg->trigger_sensor = (uint8_t)out->table_count;
+        }
+        out->table_count++;
+    }
+
+    if (out->table_count == 0 || (req->sensor_count > 0 && out->table_count != req->sensor_count)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    /* The trigger sensor has to be one of the captured ones */
+    if (req->trigger_sensor != NULL && !cfg->trigger_enabled) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t burst_capture_init(void)
+{
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    return s_lock != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t burst_capture_start(const burst_request_t *req)
+{
+    if (req->resolution < 9 || req->resolution > 12 || req->sensor_count > CONFIG_MAX_SENSORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Built aside so a rejected request leaves the last capture exportable */
+    static burst_sensors_t sensors;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_task != NULL) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    burst_config_t cfg = {
+        .max_samples = req->max_samples,
+        .duration_ms = req->duration_ms,
+        .trigger_above = req->trigger_above,
+        .trigger_level = req->trigger_level,
+        .post_samples = req->post_samples,
+    };
+    esp_err_t err = build_table(req, &sensors, &cfg);
+    if (err == ESP_OK && !burst_config_valid(&s_ring, &cfg)) {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        return err;
+    }
+
+    /* Switch resolution first so the first record is already a fast one */
+    err = bus_task_hold_resolution(req->resolution);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        return err;
+    }
+    s_sensors = sensors;
+    s_resolution = req->resolution;
+    burst_ring_start(&s_ring, &cfg, esp_timer_get_time());
+
+    if (xTaskCreate(burst_task, "burst_task", BURST_TASK_STACK_SIZE, NULL, BURST_TASK_PRIORITY,
+                    &s_task) != pdPASS) {
+        s_task = NULL;
+        burst_ring_stop(&s_ring, BURST_STOP_ERROR, esp_timer_get_time());
+        xSemaphoreGive(s_lock);
+        bus_task_hold_resolution(0);
+        ESP_LOGE(TAG, "Failed to create burst task");
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t burst_capture_stop(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool running = s_ring.state == BURST_RUNNING;
+    /* The task notices at the end of its current conversion and exits */
+    burst_ring_stop(&s_ring, BURST_STOP_REQUEST, esp_timer_get_time());
+    xSemaphoreGive(s_lock);
+    return running ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+void burst_capture_get_status(burst_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    status->state = s_ring.state;
+    status->reason = s_ring.reason;
+    status->resolution = s_resolution;
+    status->sensor_count = s_sensors.table_count;
+    memcpy(status->addresses, s_sensors.table, sizeof(s_sensors.table));
+    status->capacity = s_ring.capacity;
+    status->window = s_ring.window;
+    status->count = s_ring.count;
+    status->total = s_ring.total;
+    status->triggered = s_ring.triggered;
+    if (s_ring.state != BURST_IDLE) {
+        int64_t end = s_ring.state == BURST_RUNNING ? esp_timer_get_time() : s_ring.end_us;
+        status->elapsed_ms = (uint32_t)((end - s_ring.start_us) / 1000);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+size_t burst_capture_export_size(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t size = BURST_EXPORT_HEADER_SIZE + (size_t)s_sensors.table_count * ONEWIRE_ROM_SIZE +
+                  (size_t)s_ring.count * sizeof(burst_record_t);
+    xSemaphoreGive(s_lock);
+    return size;
+}
+
+esp_err_t burst_capture_export(burst_write_fn_t write, void *ctx)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_ring.state != BURST_DONE) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t header[BURST_EXPORT_HEADER_SIZE] = {0};
+    memcpy(header, BURST_EXPORT_MAGIC, 4);
+    header[4] = BURST_EXPORT_VERSION;
+    header[5] = sizeof(burst_record_t);
+    header[6] = (uint8_t)s_sensors.table_count;
+    header[7] = (uint8_t)s_ring.reason;
+    header[8] = (uint8_t)(s_ring.count & 0xFF);
+    header[9] = (uint8_t)((s_ring.count >> 8) & 0xFF);
+    header[10] = (uint8_t)((s_ring.count >> 16) & 0xFF);
+    header[11] = (uint8_t)((s_ring.count >> 24) & 0xFF);
+    header[12] = (uint8_t)s_resolution;
+    header[13] = s_ring.triggered ? 1 : 0;
+
+    /* Held throughout so a new capture cannot start under the download */
+    esp_err_t err = write(ctx, header, sizeof(header));
+    if (err == ESP_OK) {
+        err = write(ctx, s_sensors.table, (size_t)s_sensors.table_count * ONEWIRE_ROM_SIZE);
+    }
+
+    burst_record_t chunk[BURST_EXPORT_CHUNK];
+    uint32_t first = 0;
+    while (err == ESP_OK) {
+        uint32_t n = burst_ring_read(&s_ring, first, chunk, BURST_EXPORT_CHUNK);
+        if (n == 0) {
+            break;
+        }
+        err = write(ctx, chunk, n * sizeof(burst_record_t));
+        first += n;
+    }
+
+    xSemaphoreGive(s_lock);
+    return err;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file burst_capture.h
+ * @brief High-rate burst capture of a sensor subset into a RAM ring
+ *
+ * A burst runs its own task that converts back-to-back at a low resolution
+ * (9 bits: ~100 ms per conversion) and records every reading of the chosen
+ * sensors with its conversion start time. Nothing is published or stored in
+ * flash while it runs; the capture is downloaded afterwards as one binary
+ * blob. Burst cycles are queued like periodic cycles, so the normal read
+ * and publish schedule keeps running alongside.
+ */
+
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "onewire_temp.h"
+#include "burst_ring.h"
+
+/** @brief Export format identification */
+#define BURST_EXPORT_MAGIC      "TMXB"
+#define BURST_EXPORT_VERSION    1
+#define BURST_EXPORT_HEADER_SIZE 16
+
+/**
+ * @brief What to capture
+ */
+typedef struct {
+    const char *sensors[CONFIG_MAX_SENSORS];    /**< Addresses, bus order not required */
+    int sensor_count;                           /**< 0 = all sensors */
+    int resolution;                             /**< 9-12 bits */
+    uint32_t max_samples;                       /**< 0 = whole ring */
+    uint32_t duration_ms;                       /**< 0 = BURST_MAX_DURATION_MS */
+    const char *trigger_sensor;                 /**< NULL = no trigger */
+    bool trigger_above;
+    float trigger_level;
+    uint32_t post_samples;
+} burst_request_t;
+
+/**
+ * @brief Capture state for the status endpoint
+ */
+typedef struct {
+    burst_state_t state;
+    burst_stop_t reason;
+    int resolution;
+    int sensor_count;
+    uint8_t addresses[CONFIG_MAX_SENSORS][ONEWIRE_ROM_SIZE];   /**< Sensor table */
+    uint32_t capacity;      /**< Ring size (CONFIG_BURST_CAPTURE_SAMPLES) */
+    uint32_t window;        /**< Window of the current/last capture */
+    uint32_t count;         /**< Records held */
+    uint32_t total;         /**< Records taken */
+    uint32_t elapsed_ms;    /**< Capture length so far */
+    bool triggered;
+} burst_status_t;
+
+/**
+ * @brief Receives export data in order
+ */
+typedef esp_err_t (*burst_write_fn_t)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Create the capture lock (after sensor_manager_init)
+ */
+esp_err_t burst_capture_init(void);
+
+/**
+ * @brief Start a capture
+ * @return ESP_ERR_INVALID_STATE if one is running, ESP_ERR_NOT_FOUND for an
+ *         unknown sensor, ESP_ERR_INVALID_ARG for bad limits
+ */
+esp_err_t burst_capture_start(const burst_request_t *req);
+
+/**
+ * @brief Stop a running capture (the samples taken so far are kept)
+ * @return ESP_ERR_INVALID_STATE if none is running
+ */
+esp_err_t burst_capture_stop(void);
+
+/**
+ * @brief Get the capture state
+ */
+void burst_capture_get_status(burst_status_t *status);
+
+/**
+ * @brief Write the finished capture
+ *
+ * Layout (little-endian): a BURST_EXPORT_HEADER_SIZE-byte header, the
+ * sensor table (8-byte ROM addresses), then the records oldest first. The
+ * header holds the magic, version, record size, sensor count, stop reason,
+ * record count, resolution and a triggered flag.
+ *
+ * @return ESP_ERR_INVALID_STATE while running or before the first capture
+ */
+esp_err_t burst_capture_export(burst_write_fn_t write, void *ctx);
+
+/**
+ * @brief Size of the export for the current capture, in bytes
+ */
+size_t burst_capture_export_size(void);
+
+#endif /* BURST_CAPTURE_H */
@@ -0,0 +1,135 @@
+/**
+ * @file burst_ring.c
+ * @brief Burst capture sample ring (host-testable)
+ */
+
+#include "burst_ring.h"
+#include <string.h>
+#include <math.h>
+
+static const char *s_stop_names[] = {
+    "none", "size", "time", "trigger", "request", "error"
+};
+
+void burst_ring_init(burst_ring_t *r, burst_record_t *records, uint32_t capacity)
+{
+    memset(r, 0, sizeof(*r));
+    r->records = records;
+    r->capacity = capacity;
+}
+
+bool burst_config_valid(const burst_ring_t *r, const burst_config_t *cfg)
+{
+    if (cfg->max_samples > r->capacity || cfg->duration_ms > BURST_MAX_DURATION_MS) {
+        return false;
+    }
+    uint32_t window = cfg->max_samples ? cfg->max_samples : r->capacity;
+    if (window == 0) {
+        return false;
+    }
+    /* The post-trigger part must leave room for some history */
+    if (cfg->trigger_enabled && cfg->post_samples >= window) {
+        return false;
+    }
+    return true;
+}
+
+bool burst_ring_start(burst_ring_t *r, const burst_config_t *cfg, int64_t now_us)
+{
+    if (!burst_config_valid(r, cfg)) {
+        return false;
+    }
+    r->cfg = *cfg;
+    if (r->cfg.duration_ms == 0) {
+        r->cfg.duration_ms = BURST_MAX_DURATION_MS;
+    }
+    r->window = cfg->max_samples ? cfg->max_samples : r->capacity;
+    r->head = 0;
+    r->count = 0;
+    r->total = 0;
+    r->start_us = now_us;
+    r->end_us = 0;
+    r->triggered = false;
+    r->post_remaining = 0;
+    r->reason = BURST_STOP_NONE;
+    r->state = BURST_RUNNING;
+    return true;
+}
+
+void burst_ring_stop(burst_ring_t *r, burst_stop_t reason, int64_t now_us)
+{
+    if (r->state != BURST_RUNNING) {
+        return;
+    }
+    r->state = BURST_DONE;
+    r->reason = reason;
+    r->end_us = now_us;
+}
+
+bool burst_ring_add(burst_ring_t *r, int64_t t_us, uint8_t sensor, bool valid, float temp)
+{
+    if (r->state != BURST_RUNNING) {
+        return false;
+    }
+
+    burst_record_t *rec = &r->records[r->head];
+    rec->t_us = (uint32_t)(t_us - r->start_us);
+    rec->sensor = sensor;
+    rec->flags = valid ? BURST_FLAG_VALID : 0;
+    rec->temp_16 = valid ? (int16_t)lroundf(temp * 16.0f) : 0;
+
+    r->head = (r->head + 1) % r->window;
+    if (r->count < r->window) {
+        r->count++;
+    }
+    r->total++;
+
+    if (r->triggered) {
+        if (--r->post_remaining == 0) {
+            burst_ring_stop(r, BURST_STOP_TRIGGER, t_us);
+        }
+    } else if (r->cfg.trigger_enabled) {
+        if (valid && sensor == r->cfg.trigger_sensor &&
+            (r->cfg.trigger_above ? temp >= r->cfg.trigger_level : temp <= r->cfg.trigger_level)) {
+            r->triggered = true;
+            r->post_remaining = r->cfg.post_samples;
+            if (r->post_remaining == 0) {
+                burst_ring_stop(r, BURST_STOP_TRIGGER, t_us);
+            }
+        }
+    } else if (r->count == r->window) {
+        burst_ring_stop(r, BURST_STOP_SIZE, t_us);
+    }
+
+    return r->state == BURST_RUNNING;
+}
+
+bool burst_ring_check_time(burst_ring_t *r, int64_t now_us)
+{
+    if (r->state == BURST_RUNNING && now_us - r->start_us >= (int64_t)r->cfg.duration_ms * 1000) {
+        burst_ring_stop(r, BURST_STOP_TIME, now_us);
+    }
+    return r->state == BURST_RUNNING;
+}
+
+uint32_t burst_ring_read(const burst_ring_t *r, uint32_t first, burst_record_t *out, uint32_t max)
+{
+    if (first >= r->count) {
+        return 0;
+    }
+    /* Oldest record sits at head once the window has wrapped */
+    uint32_t oldest = r->count < r->window ? 0 : r->head;
+    uint32_t n = r->count - first;
+    if (n > max) {
+        n = max;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = r->records[(oldest + first + i) % r->window];
+    }
+    return n;
+}
+
+const char *burst_stop_name(burst_stop_t reason)
+{
+    return reason <= BURST_STOP_ERROR ? s_stop_names[reason] : "unknown";
+}
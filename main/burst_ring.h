@@ -0,0 +1,129 @@
+/**
+ * @file burst_ring.h
+ * @brief Preallocated sample ring and stop logic for burst capture
+ *        (host-testable)
+ *
+ * Without a trigger the capture fills the window and stops. With a trigger
+ * the window wraps, keeping the most recent samples, and the capture stops a
+ * set number of samples after the trigger fires, so the saved window shows
+ * what led up to the event and what followed. A duration limit applies in
+ * both cases.
+ */
+
+#ifndef BURST_RING_H
+#define BURST_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Longest capture; record timestamps are 32-bit microseconds */
+#define BURST_MAX_DURATION_MS 3600000
+
+/** @brief Record flag: reading passed CRC */
+#define BURST_FLAG_VALID 0x01
+
+/**
+ * @brief One sample (8 bytes, little-endian on the wire)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t t_us;          /**< Conversion start, µs since capture start */
+    uint8_t sensor;         /**< Index into the capture's sensor table */
+    uint8_t flags;          /**< BURST_FLAG_* */
+    int16_t temp_16;        /**< Temperature in 1/16 °C (DS18B20 native) */
+} burst_record_t;
+
+typedef enum {
+    BURST_IDLE = 0,
+    BURST_RUNNING,
+    BURST_DONE
+} burst_state_t;
+
+typedef enum {
+    BURST_STOP_NONE = 0,
+    BURST_STOP_SIZE,        /**< Window full */
+    BURST_STOP_TIME,        /**< Duration reached */
+    BURST_STOP_TRIGGER,     /**< Post-trigger samples taken */
+    BURST_STOP_REQUEST,     /**< Stopped through the API */
+    BURST_STOP_ERROR        /**< Bus error or sensor list changed */
+} burst_stop_t;
+
+/**
+ * @brief Capture limits and trigger
+ */
+typedef struct {
+    uint32_t max_samples;   /**< Window size, 0 = whole ring */
+    uint32_t duration_ms;   /**< Time limit, 0 = BURST_MAX_DURATION_MS */
+    bool trigger_enabled;
+    uint8_t trigger_sensor; /**< Sensor table index */
+    bool trigger_above;     /**< Fire at or above the level (else at or below) */
+    float trigger_level;    /**< °C */
+    uint32_t post_samples;  /**< Samples kept after the trigger */
+} burst_config_t;
+
+/**
+ * @brief Capture state
+ */
+typedef struct {
+    burst_record_t *records;    /**< Caller-owned storage */
+    uint32_t capacity;
+    burst_config_t cfg;
+    uint32_t window;            /**< Effective window size */
+    uint32_t head;              /**< Next write position */
+    uint32_t count;             /**< Records held */
+    uint32_t total;             /**< Records taken, including overwritten ones */
+    int64_t start_us;
+    int64_t end_us;
+    burst_state_t state;
+    burst_stop_t reason;
+    bool triggered;
+    uint32_t post_remaining;
+} burst_ring_t;
+
+/**
+ * @brief Attach storage; the ring starts idle
+ */
+void burst_ring_init(burst_ring_t *r, burst_record_t *records, uint32_t capacity);
+
+/**
+ * @brief Check limits against a ring (window fits, duration in range)
+ */
+bool burst_config_valid(const burst_ring_t *r, const burst_config_t *cfg);
+
+/**
+ * @brief Clear the ring and start a capture
+ * @return false if the configuration is invalid
+ */
+bool burst_ring_start(burst_ring_t *r, const burst_config_t *cfg, int64_t now_us);
+
+/**
+ * @brief Add one sample and apply the size and trigger conditions
+ * @return true while the capture is still running
+ */
+bool burst_ring_add(burst_ring_t *r, int64_t t_us, uint8_t sensor, bool valid, float temp);
+
+/**
+ * @brief Apply the duration limit
+ * @return true while the capture is still running
+ */
+bool burst_ring_check_time(burst_ring_t *r, int64_t now_us);
+
+/**
+ * @brief End a running capture
+ */
+void burst_ring_stop(burst_ring_t *r, burst_stop_t reason, int64_t now_us);
+
+/**
+ * @brief Copy records in capture order
+ * @param first Index of the first record (0 = oldest held)
+ * @param out Output records
+ * @param max Capacity of @p out
+ * @return Number of records copied
+ */
+uint32_t burst_ring_read(const burst_ring_t *r, uint32_t first, burst_record_t *out, uint32_t max);
+
+/**
+ * @brief Short name of a stop reason ("size", "time", ...)
+ */
+const char *burst_stop_name(burst_stop_t reason);
+
+#endif /* BURST_RING_H */
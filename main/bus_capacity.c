@@ -0,0 +1,108 @@
+/**
+ * @file bus_capacity.c
+ * @brief 1-Wire bus timing model (host-testable)
+ */
+
+#include "bus_capacity.h"
+#include <stddef.h>
+#include <math.h>
+
+/* Same waits as onewire_temp_get_conversion_ms() (datasheet maximum, rounded up) */
+static const uint32_t s_conversion_ms[] = {100, 200, 400, 800};
+
+uint32_t bus_capacity_conversion_ms(int bits)
+{
+    if (bits < 9) bits = 9;
+    if (bits > 12) bits = 12;
+    return s_conversion_ms[bits - 9];
+}
+
+static uint32_t target(const bus_capacity_input_t *in, int index)
+{
+    uint32_t interval = in->interval_ms != NULL ? in->interval_ms[index] : 0;
+    return interval > 0 ? interval : in->default_interval_ms;
+}
+
+void bus_capacity_compute(const bus_capacity_input_t *in, bus_capacity_t *out)
+{
+    int n = in->sensor_count;
+    int bits = in->bus_resolution;
+    for (int i = 0; i < n && in->resolution != NULL; i++) {
+        if (in->resolution[i] > bits) {
+            bits = in->resolution[i];
+        }
+    }
+
+    float read_ms = in->scratchpad_us * (1.0f + in->retry_rate) / 1000.0f;
+    float conversion_cost_ms = in->overhead_us / 1000.0f + bus_capacity_conversion_ms(bits);
+
+    out->conversion_ms = bus_capacity_conversion_ms(bits);
+    out->cycle_ms = n > 0 ? conversion_cost_ms + n * read_ms : 0.0f;
+    out->min_interval_ms = (uint32_t)ceilf(out->cycle_ms);
+
+    /* One conversion per distinct interval; every sensor read once per its own */
+    out->conversions_per_s = 0.0f;
+    out->reads_per_s = 0.0f;
+    for (int i = 0; i < n; i++) {
+        uint32_t t = target(in, i);
+        if (t == 0) {
+            continue;
+        }
+        out->reads_per_s += 1000.0f / t;
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = target(in, j) == t;
+        }
+        if (!seen) {
+            out->conversions_per_s += 1000.0f / t;
+        }
+    }
+    out->utilization = (out->conversions_per_s * conversion_cost_ms + out->reads_per_s * read_ms) / 1000.0f;
+
+    /* The sensors with their own interval leave the rest of the bus time to
+     * the group following the default, which needs one conversion and its
+     * reads per default interval */
+    int following = 0;
+    float fixed_conversions = 0.0f, fixed_reads = 0.0f;
+    for (int i = 0; i < n; i++) {
+        uint32_t t = in->interval_ms != NULL ? in->interval_ms[i] : 0;
+        if (t == 0) {
+            following++;
+            continue;
+        }
+        fixed_reads += 1000.0f / t;
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = in->interval_ms[j] == t;
+        }
+        if (!seen) {
+            fixed_conversions += 1000.0f / t;
+        }
+    }
+    float spare = 1.0f - (fixed_conversions * conversion_cost_ms + fixed_reads * read_ms) / 1000.0f;
+    if (following == 0) {
+        out->min_default_interval_ms = 0;
+    } else if (spare <= 0.0f) {
+        out->min_default_interval_ms = UINT32_MAX;
+    } else {
+        out->min_default_interval_ms = (uint32_t)ceilf((conversion_cost_ms + following * read_ms) / spare);
+    }
+
+    if (out->utilization > 1.0f) {
+        out->verdict = BUS_CAPACITY_OVERLOAD;
+    } else if (out->utilization > BUS_CAPACITY_WARN_UTILIZATION) {
+        out->verdict = BUS_CAPACITY_WARN;
+    } else {
+        out->verdict = BUS_CAPACITY_OK;
+    }
+}
+
+const char *bus_capacity_verdict_name(bus_capacity_verdict_t verdict)
+{
+    switch (verdict) {
+    case BUS_CAPACITY_OK:       return "ok";
+    case BUS_CAPACITY_WARN:     return "warn";
+    case BUS_CAPACITY_OVERLOAD: return "overload";
+    default:                    return "unknown";
+    }
+}
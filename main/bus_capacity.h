@@ -0,0 +1,82 @@
+/**
+ * @file bus_capacity.h
+ * @brief 1-Wire bus timing model: utilization and the fastest feasible read
+ *        interval for a sensor configuration (host-testable)
+ *
+ * A read cycle occupies the bus for a reset and Skip ROM + Convert, the
+ * conversion wait (nothing else can use the bus meanwhile), and one
+ * addressed scratchpad read per sensor. Sensors with the same target
+ * interval share a conversion, so conversions per second are counted per
+ * distinct interval; this is an upper bound, since the scheduler also merges
+ * groups whose deadlines happen to coincide. A retry budget reserves bus
+ * time for repeated scratchpad reads.
+ */
+
+#ifndef BUS_CAPACITY_H
+#define BUS_CAPACITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Costs used until measured: reset + 2 bytes, and reset + 19 bytes at ~70 µs/bit */
+#define BUS_CAPACITY_DEFAULT_OVERHEAD_US    2100
+#define BUS_CAPACITY_DEFAULT_SCRATCHPAD_US  11600
+
+/** @brief Fraction of scratchpad reads reserved for retries */
+#define BUS_CAPACITY_RETRY_BUDGET           0.05f
+
+/** @brief Above this utilization on-demand reads and rescans start to queue */
+#define BUS_CAPACITY_WARN_UTILIZATION       0.8f
+
+typedef enum {
+    BUS_CAPACITY_OK = 0,
+    BUS_CAPACITY_WARN,          /**< Feasible, but little headroom */
+    BUS_CAPACITY_OVERLOAD       /**< Cycles cannot keep up with the intervals */
+} bus_capacity_verdict_t;
+
+/**
+ * @brief Model inputs
+ */
+typedef struct {
+    int sensor_count;
+    const uint8_t *resolution;      /**< Bits per sensor, NULL = bus_resolution for all */
+    uint8_t bus_resolution;         /**< 9-12 */
+    const uint32_t *interval_ms;    /**< Per-sensor target, 0 = default; NULL = all default */
+    uint32_t default_interval_ms;
+    uint32_t overhead_us;           /**< Reset + Skip ROM + Convert */
+    uint32_t scratchpad_us;         /**< One addressed scratchpad read */
+    float retry_rate;               /**< Fraction of reads retried */
+} bus_capacity_input_t;
+
+/**
+ * @brief Model results
+ */
+typedef struct {
+    uint32_t conversion_ms;         /**< Conversion wait (slowest resolution present) */
+    float cycle_ms;                 /**< Bus time of one cycle reading every sensor */
+    uint32_t min_interval_ms;       /**< Fastest default interval with every sensor following it */
+    uint32_t min_default_interval_ms;   /**< Fastest default interval with the per-sensor
+                                             intervals kept; 0 if no sensor follows the default,
+                                             UINT32_MAX if those intervals alone overload */
+    float conversions_per_s;
+    float reads_per_s;
+    float utilization;              /**< Fraction of bus time in use at the given intervals */
+    bus_capacity_verdict_t verdict;
+} bus_capacity_t;
+
+/**
+ * @brief Conversion wait used by the driver for a resolution (9-12 bits)
+ */
+uint32_t bus_capacity_conversion_ms(int bits);
+
+/**
+ * @brief Evaluate a configuration
+ */
+void bus_capacity_compute(const bus_capacity_input_t *in, bus_capacity_t *out);
+
+/**
+ * @brief Verdict name ("ok", "warn", "overload")
+ */
+const char *bus_capacity_verdict_name(bus_capacity_verdict_t verdict);
+
+#endif /* BUS_CAPACITY_H */
@@ -0,0 +1,83 @@
+/**
+ * @file bus_queue.c
+ * @brief Fixed-size priority queue of 1-Wire bus commands (host-testable)
+ */
+
+#include "bus_queue.h"
+#include <string.h>
+
+static const char *s_cmd_names[BUS_CMD_COUNT] = {
+    "read", "resolution", "cycle", "alarm_search", "rescan", "recover"
+};
+
+void bus_queue_init(bus_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+bool bus_queue_push(bus_queue_t *q, bus_cmd_type_t type, void *ctx)
+{
+    if (q->count >= BUS_QUEUE_CAPACITY || type >= BUS_CMD_COUNT) {
+        return false;
+    }
+    bus_queue_entry_t *e = &q->entries[q->count++];
+    e->type = type;
+    e->seq = q->next_seq++;
+    e->ctx = ctx;
+    return true;
+}
+
+/**
+ * @brief Index of the most urgent entry, -1 if empty
+ *
+ * A linear scan is cheaper than a heap at this size and keeps FIFO order
+ * within a priority without extra bookkeeping.
+ */
+static int find_first(const bus_queue_t *q)
+{
+    int best = -1;
+    for (int i = 0; i < q->count; i++) {
+        const bus_queue_entry_t *e = &q->entries[i];
+        if (best < 0 || e->type < q->entries[best].type ||
+            (e->type == q->entries[best].type && (int32_t)(e->seq - q->entries[best].seq) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void remove_at(bus_queue_t *q, int index, bus_queue_entry_t *out)
+{
+    *out = q->entries[index];
+    q->entries[index] = q->entries[--q->count];
+}
+
+bool bus_queue_pop(bus_queue_t *q, bus_queue_entry_t *out)
+{
+    int index = find_first(q);
+    if (index < 0) {
+        return false;
+    }
+    remove_at(q, index, out);
+    return true;
+}
+
+bool bus_queue_pop_preempting(bus_queue_t *q, bus_cmd_type_t than, bus_queue_entry_t *out)
+{
+    int index = find_first(q);
+    if (index < 0 || q->entries[index].type >= than) {
+        return false;
+    }
+    remove_at(q, index, out);
+    return true;
+}
+
+int bus_queue_count(const bus_queue_t *q)
+{
+    return q->count;
+}
+
+const char *bus_cmd_name(bus_cmd_type_t type)
+{
+    return type < BUS_CMD_COUNT ? s_cmd_names[type] : "unknown";
+}
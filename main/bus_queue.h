@@ -0,0 +1,88 @@
+/**
+ * @file bus_queue.h
+ * @brief Fixed-size priority queue of 1-Wire bus commands (host-testable)
+ *
+ * Commands are served most urgent first and in submission order within the
+ * same priority. The queue holds opaque pointers; the bus task owns the
+ * request structures they point to.
+ */
+
+#ifndef BUS_QUEUE_H
+#define BUS_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Maximum queued commands */
+#define BUS_QUEUE_CAPACITY 8
+
+/**
+ * @brief Bus command types, most urgent first
+ */
+typedef enum {
+    BUS_CMD_READ = 0,       /**< On-demand read */
+    BUS_CMD_RESOLUTION,     /**< Resolution change */
+    BUS_CMD_CYCLE,          /**< Periodic convert + read of all sensors */
+    BUS_CMD_ALARM_SEARCH,   /**< Alarm search (0xEC) */
+    BUS_CMD_RESCAN,         /**< Device discovery */
+    BUS_CMD_RECOVER,        /**< Bus reset or driver re-creation, never inside a rescan */
+    BUS_CMD_COUNT
+} bus_cmd_type_t;
+
+/**
+ * @brief Queue entry
+ */
+typedef struct {
+    bus_cmd_type_t type;
+    uint32_t seq;           /**< Submission order */
+    void *ctx;              /**< Caller's request */
+} bus_queue_entry_t;
+
+/**
+ * @brief Priority queue
+ */
+typedef struct {
+    bus_queue_entry_t entries[BUS_QUEUE_CAPACITY];
+    int count;
+    uint32_t next_seq;
+} bus_queue_t;
+
+/**
+ * @brief Initialize an empty queue
+ */
+void bus_queue_init(bus_queue_t *q);
+
+/**
+ * @brief Add a command
+ * @return false if the queue is full or the type is invalid
+ */
+bool bus_queue_push(bus_queue_t *q, bus_cmd_type_t type, void *ctx);
+
+/**
+ * @brief Remove the most urgent command
+ * @param out Receives the entry
+ * @return false if the queue is empty
+ */
+bool bus_queue_pop(bus_queue_t *q, bus_queue_entry_t *out);
+
+/**
+ * @brief Remove the most urgent command only if it is more urgent than a type
+ *
+ * Used at transaction boundaries of a long command to let urgent work
+ * run first without starting anything of equal or lower priority.
+ *
+ * @return false if nothing more urgent than @p than is queued
+ */
+bool bus_queue_pop_preempting(bus_queue_t *q, bus_cmd_type_t than, bus_queue_entry_t *out);
+
+/**
+ * @brief Number of queued commands
+ */
+int bus_queue_count(const bus_queue_t *q);
+
+/**
+ * @brief Short name of a command type ("read", "cycle", ...)
+ */
+const char *bus_cmd_name(bus_cmd_type_t type);
+
+#endif /* BUS_QUEUE_H */
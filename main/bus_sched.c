@@ -0,0 +1,133 @@
+/**
+ * @file bus_sched.c
+ * @brief Earliest-deadline-first read scheduler (host-testable)
+ */
+
+#include "bus_sched.h"
+#include <string.h>
+
+/** @brief Smoothing factor for the achieved interval */
+#define BUS_SCHED_ALPHA 0.3f
+
+void bus_sched_init(bus_sched_t *s, bus_sched_entry_t *entries, int count,
+                    uint32_t default_interval_ms)
+{
+    s->entries = entries;
+    s->count = count;
+    s->default_interval_ms = default_interval_ms;
+    memset(entries, 0, sizeof(*entries) * count);
+}
+
+bool bus_sched_interval_valid(uint32_t interval_ms)
+{
+    return interval_ms == 0 ||
+           (interval_ms >= BUS_SCHED_MIN_INTERVAL_MS && interval_ms <= BUS_SCHED_MAX_INTERVAL_MS);
+}
+
+uint32_t bus_sched_target(const bus_sched_t *s, int index)
+{
+    uint32_t interval = s->entries[index].interval_ms;
+    return interval > 0 ? interval : s->default_interval_ms;
+}
+
+/**
+ * @brief Put a sensor's deadline one target interval after its last read
+ */
+static void reschedule(bus_sched_t *s, int index)
+{
+    bus_sched_entry_t *e = &s->entries[index];
+    if (e->last_ms > 0) {
+        e->due_ms = e->last_ms + bus_sched_target(s, index);
+    }
+}
+
+void bus_sched_set_interval(bus_sched_t *s, int index, uint32_t interval_ms)
+{
+    if (index < 0 || index >= s->count) {
+        return;
+    }
+    s->entries[index].interval_ms = interval_ms;
+    reschedule(s, index);
+}
+
+void bus_sched_set_default_interval(bus_sched_t *s, uint32_t interval_ms)
+{
+    if (interval_ms == s->default_interval_ms) {
+        return;
+    }
+    s->default_interval_ms = interval_ms;
+    for (int i = 0; i < s->count; i++) {
+        if (s->entries[i].interval_ms == 0) {
+            reschedule(s, i);
+        }
+    }
+}
+
+int bus_sched_select(const bus_sched_t *s, int64_t now_ms, uint32_t window_ms,
+                     int max_batch, bool *selected)
+{
+    int64_t horizon = now_ms + window_ms;
+    int chosen = 0;
+
+    memset(selected, 0, sizeof(*selected) * s->count);
+
+    /* Repeated minimum: a bus holds few enough sensors that this beats
+     * sorting, and it stops as soon as the batch is full */
+    while (chosen < max_batch) {
+        int best = -1;
+        for (int i = 0; i < s->count; i++) {
+            if (selected[i] || s->entries[i].due_ms > horizon) {
+                continue;
+            }
+            if (best < 0 || s->entries[i].due_ms < s->entries[best].due_ms) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        selected[best] = true;
+        chosen++;
+    }
+    return chosen;
+}
+
+void bus_sched_complete(bus_sched_t *s, int index, int64_t start_ms)
+{
+    if (index < 0 || index >= s->count) {
+        return;
+    }
+    bus_sched_entry_t *e = &s->entries[index];
+    uint32_t target = bus_sched_target(s, index);
+
+    if (e->last_ms > 0) {
+        float achieved = (float)(start_ms - e->last_ms);
+        e->achieved_ms = e->achieved_ms > 0 ?
+                         e->achieved_ms + BUS_SCHED_ALPHA * (achieved - e->achieved_ms) : achieved;
+        if (start_ms - e->due_ms > (int64_t)(target / 10)) {
+            e->late++;
+        }
+    }
+    bool first = e->last_ms == 0;
+    e->reads++;
+    e->last_ms = start_ms;
+
+    e->due_ms += target;
+    if (first || e->due_ms <= start_ms) {
+        e->due_ms = start_ms + target;
+    }
+}
+
+uint32_t bus_sched_delay_ms(const bus_sched_t *s, int64_t now_ms)
+{
+    if (s->count == 0) {
+        return s->default_interval_ms;
+    }
+    int64_t earliest = s->entries[0].due_ms;
+    for (int i = 1; i < s->count; i++) {
+        if (s->entries[i].due_ms < earliest) {
+            earliest = s->entries[i].due_ms;
+        }
+    }
+    return earliest > now_ms ? (uint32_t)(earliest - now_ms) : 0;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file bus_sched.h
+ * @brief Earliest-deadline-first read scheduler for per-sensor intervals
+ *        (host-testable)
+ *
+ * Each sensor has a target interval (or follows the bus-wide default) and a
+ * next deadline. A cycle picks the sensors that are due, plus any whose
+ * deadline falls within one conversion time, in deadline order. They share
+ * one skip-ROM conversion and only their scratchpads are read. Deadlines
+ * advance on a fixed grid, so sensors with the same interval stay grouped.
+ */
+
+#ifndef BUS_SCHED_H
+#define BUS_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Bounds for a per-sensor interval (0 = follow the bus default) */
+#define BUS_SCHED_MIN_INTERVAL_MS 1000
+#define BUS_SCHED_MAX_INTERVAL_MS 300000
+
+/**
+ * @brief Per-sensor schedule
+ */
+typedef struct {
+    uint32_t interval_ms;       /**< Target interval, 0 = bus default */
+    int64_t due_ms;             /**< Next deadline */
+    int64_t last_ms;            /**< Start of the last read cycle (0 = never read) */
+    float achieved_ms;          /**< Smoothed interval actually achieved */
+    uint32_t reads;             /**< Reads scheduled */
+    uint32_t late;              /**< Reads started more than 10% of an interval late */
+} bus_sched_entry_t;
+
+/**
+ * @brief Scheduler state
+ */
+typedef struct {
+    bus_sched_entry_t *entries;     /**< Caller-owned array */
+    int count;
+    uint32_t default_interval_ms;   /**< Interval for entries without their own */
+} bus_sched_t;
+
+/**
+ * @brief Initialize; every sensor is due immediately and follows the default
+ */
+void bus_sched_init(bus_sched_t *s, bus_sched_entry_t *entries, int count,
+                    uint32_t default_interval_ms);
+
+/**
+ * @brief Check a per-sensor interval (0 or within the bounds above)
+ */
+bool bus_sched_interval_valid(uint32_t interval_ms);
+
+/**
+ * @brief Effective target interval of a sensor
+ */
+uint32_t bus_sched_target(const bus_sched_t *s, int index);
+
+/**
+ * @brief Change a sensor's interval, rescheduling it from its last read
+ */
+void bus_sched_set_interval(bus_sched_t *s, int index, uint32_t interval_ms);
+
+/**
+ * @brief Change the bus default, rescheduling sensors that follow it
+ */
+void bus_sched_set_default_interval(bus_sched_t *s, uint32_t interval_ms);
+
+/**
+ * @brief Pick the sensors for the next cycle
+ *
+ * Sensors due by @p now_ms + @p window_ms are chosen in deadline order, up
+ * to @p max_batch. Pass the conversion time as the window: a sensor due
+ * within it would otherwise need a conversion of its own right after this
+ * one.
+ *
+ * @param selected Output: true for each chosen sensor (count entries)
+ * @return Number of sensors chosen
+ */
+int bus_sched_select(const bus_sched_t *s, int64_t now_ms, uint32_t window_ms,
+                     int max_batch, bool *selected);
+
+/**
+ * @brief Record that a sensor was read in the cycle started at @p start_ms
+ *
+ * Advances its deadline by one interval; the first read anchors the grid.
+ * If it has fallen more than an interval behind, the grid restarts from now
+ * instead of bursting to catch up.
+ */
+void bus_sched_complete(bus_sched_t *s, int index, int64_t start_ms);
+
+/**
+ * @brief Time until the earliest deadline (0 if one has passed)
+ */
+uint32_t bus_sched_delay_ms(const bus_sched_t *s, int64_t now_ms);
+
+#endif /* BUS_SCHED_H */
@@ -0,0 +1,325 @@
+/**
+ * @file bus_task.c
+ * @brief Single owner task for the 1-Wire bus
+ *
+ * Requests live on the caller's stack together with a static binary
+ * semaphore, so submitting a command allocates nothing. The queue itself is
+ * guarded by a spinlock; the onewire_temp driver is only ever called from
+ * the bus task.
+ */
+
+#include "bus_task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "bus_task";
+
+#define BUS_TASK_STACK_SIZE 4096
+#define BUS_TASK_PRIORITY   6       /* Above temp_task so queued work starts promptly */
+
+/**
+ * @brief A command waiting for (or being run by) the bus task
+ */
+typedef struct {
+    bus_cmd_type_t type;
+    union {
+        struct {
+            onewire_sensor_t *sensors;
+            int count;
+            const bool *selected;   /**< Sensors to read, NULL for all */
+            uint32_t generation;
+            int64_t *convert_us;    /**< Output: conversion start (may be NULL) */
+        } read;
+        struct {
+            onewire_sensor_t *sensors;
+            int max;
+            int *found;
+            uint32_t *generation;
+        } scan;
+        struct {
+            uint8_t (*addresses)[ONEWIRE_ROM_SIZE];
+            int max;
+            int *found;
+        } alarm;
+        struct {
+            int bits;
+            bool hold;
+        } resolution;
+        struct {
+            bool recreate;          /**< Re-create the driver instead of a reset pulse */
+        } recover;
+    } arg;
+    esp_err_t result;
+    int64_t submitted_us;
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+} bus_request_t;
+
+static TaskHandle_t s_task = NULL;
+static bus_queue_t s_queue;
+static portMUX_TYPE s_queue_mux = portMUX_INITIALIZER_UNLOCKED;
+static bus_task_stats_t s_stats;
+
+/* Resolution pinned by a burst capture (0 = none), and the last one asked
+ * for by everyone else, applied when the hold is released */
+static int s_held_resolution = 0;
+static int s_requested_resolution = 0;
+
+static void execute(bus_request_t *req);
+
+/**
+ * @brief Run commands more urgent than a rescan between its search passes
+ */
+static void scan_yield(void *ctx)
+{
+    (void)ctx;
+    bus_queue_entry_t entry;
+    while (true) {
+        portENTER_CRITICAL(&s_queue_mux);
+        bool found = bus_queue_pop_preempting(&s_queue, BUS_CMD_RESCAN, &entry);
+        portEXIT_CRITICAL(&s_queue_mux);
+        if (!found) {
+            break;
+        }
+        s_stats.preempted++;
+        execute(entry.ctx);
+    }
+}
+
+/**
+ * @brief Apply a resolution change, deferring it while a hold is in place
+ */
+static esp_err_t set_resolution(int bits, bool hold)
+{
+    if (hold) {
+        if (s_requested_resolution == 0) {
+            s_requested_resolution = onewire_temp_get_resolution();
+        }
+        s_held_resolution = bits;
+        return onewire_temp_set_resolution(bits ? bits : s_requested_resolution);
+    }
+    if (bits < 9 || bits > 12) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_requested_resolution = bits;
+    return s_held_resolution ? ESP_OK : onewire_temp_set_resolution(bits);
+}
+
+static void execute(bus_request_t *req)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t wait_ms = (uint32_t)((now - req->submitted_us) / 1000);
+    if (wait_ms > s_stats.max_wait_ms) {
+        s_stats.max_wait_ms = wait_ms;
+    }
+
+    switch (req->type) {
+    case BUS_CMD_READ:
+    case BUS_CMD_CYCLE:
+        if (req->arg.read.generation != onewire_temp_get_generation()) {
+            /* Indices were built from a device list a rescan has replaced */
+            req->result = ESP_ERR_INVALID_STATE;
+            portENTER_CRITICAL(&s_queue_mux);
+            s_stats.rejected++;
+            portEXIT_CRITICAL(&s_queue_mux);
+        } else {
+            req->result = onewire_temp_read_selected(req->arg.read.sensors, req->arg.read.count,
+                                                     req->arg.read.selected);
+            if (req->arg.read.convert_us != NULL) {
+                *req->arg.read.convert_us = onewire_temp_get_convert_time();
+            }
+        }
+        break;
+    case BUS_CMD_RESOLUTION:
+        req->result = set_resolution(req->arg.resolution.bits, req->arg.resolution.hold);
+        break;
+    case BUS_CMD_ALARM_SEARCH:
+        req->result = onewire_temp_alarm_search(req->arg.alarm.addresses, req->arg.alarm.max,
+                                                req->arg.alarm.found);
+        break;
+    case BUS_CMD_RESCAN:
+        req->result = onewire_temp_scan(req->arg.scan.sensors, req->arg.scan.max,
+                                        req->arg.scan.found, scan_yield, NULL);
+        if (req->arg.scan.generation != NULL) {
+            *req->arg.scan.generation = onewire_temp_get_generation();
+        }
+        break;
+    case BUS_CMD_RECOVER:
+        req->result = req->arg.recover.recreate ? onewire_temp_recreate_bus() : onewire_temp_bus_reset();
+        break;
+    default:
+        req->result = ESP_ERR_INVALID_ARG;
+        break;
+    }
+
+    s_stats.executed[req->type < BUS_CMD_COUNT ? req->type : 0]++;
+    xSemaphoreGive(req->done);
+}
+
+static void bus_task(void *pvParameters)
+{
+    ESP_LOGD(TAG, "Bus task started");
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bus_queue_entry_t entry;
+        while (true) {
+            portENTER_CRITICAL(&s_queue_mux);
+            bool found = bus_queue_pop(&s_queue, &entry);
+            portEXIT_CRITICAL(&s_queue_mux);
+            if (!found) {
+                break;
+            }
+            execute(entry.ctx);
+        }
+    }
+}
+
+/**
+ * @brief Queue a request and wait for it to complete
+ */
+static esp_err_t submit(bus_request_t *req)
+{
+    if (s_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    req->result = ESP_FAIL;
+    req->submitted_us = esp_timer_get_time();
+    req->done = xSemaphoreCreateBinaryStatic(&req->done_buf);
+
+    if (xTaskGetCurrentTaskHandle() == s_task) {
+        /* Already on the bus task - waiting on ourselves would deadlock */
+        execute(req);
+        vSemaphoreDelete(req->done);
+        return req->result;
+    }
+
+    portENTER_CRITICAL(&s_queue_mux);
+    bool queued = bus_queue_push(&s_queue, req->type, req);
+    if (!queued) {
+        s_stats.rejected++;
+    }
+    portEXIT_CRITICAL(&s_queue_mux);
+    if (!queued) {
+        vSemaphoreDelete(req->done);
+        ESP_LOGW(TAG, "Bus queue full, dropping %s", bus_cmd_name(req->type));
+        return ESP_ERR_NO_MEM;
+    }
+
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(req->done, portMAX_DELAY);
+    vSemaphoreDelete(req->done);
+    return req->result;
+}
+
+esp_err_t bus_task_start(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+    bus_queue_init(&s_queue);
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    if (xTaskCreate(bus_task, "bus_task", BUS_TASK_STACK_SIZE, NULL, BUS_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bus task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t bus_task_read_cycle(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                              uint32_t generation)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_CYCLE,
+        .arg.read = { .sensors = sensors, .count = sensor_count, .selected = selected,
+                      .generation = generation },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_read_now(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                            uint32_t generation)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_READ,
+        .arg.read = { .sensors = sensors, .count = sensor_count, .selected = selected,
+                      .generation = generation },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_read_burst(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                              uint32_t generation, int64_t *convert_us)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_CYCLE,
+        .arg.read = { .sensors = sensors, .count = sensor_count, .selected = selected,
+                      .generation = generation, .convert_us = convert_us },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count,
+                        uint32_t *generation)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_RESCAN,
+        .arg.scan = { .sensors = sensors, .max = max_sensors, .found = found_count,
+                      .generation = generation },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_set_resolution(int bits)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_RESOLUTION,
+        .arg.resolution = { .bits = bits },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_hold_resolution(int bits)
+{
+    if (bits != 0 && (bits < 9 || bits > 12)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bus_request_t req = {
+        .type = BUS_CMD_RESOLUTION,
+        .arg.resolution = { .bits = bits, .hold = true },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_alarm_search(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max_found, int *found_count)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_ALARM_SEARCH,
+        .arg.alarm = { .addresses = addresses, .max = max_found, .found = found_count },
+    };
+    return submit(&req);
+}
+
+esp_err_t bus_task_recover(bool recreate)
+{
+    bus_request_t req = {
+        .type = BUS_CMD_RECOVER,
+        .arg.recover = { .recreate = recreate },
+    };
+    return submit(&req);
+}
+
+void bus_task_get_stats(bus_task_stats_t *stats)
+{
+    *stats = s_stats;
+    portENTER_CRITICAL(&s_queue_mux);
+    stats->pending = bus_queue_count(&s_queue);
+    portEXIT_CRITICAL(&s_queue_mux);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file bus_task.h
+ * @brief Single owner task for the 1-Wire bus
+ *
+ * All bus access goes through one task fed by a priority queue (see
+ * bus_queue.h). Callers block until their command has run. A rescan checks
+ * the queue between search passes, so an on-demand read or a periodic cycle
+ * submitted during discovery runs at the next transaction boundary instead
+ * of waiting for the whole scan.
+ */
+
+#ifndef BUS_TASK_H
+#define BUS_TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "onewire_temp.h"
+#include "bus_queue.h"
+
+/**
+ * @brief Bus task statistics
+ */
+typedef struct {
+    uint32_t executed[BUS_CMD_COUNT];   /**< Commands run, by type */
+    uint32_t preempted;                 /**< Commands run in the middle of a rescan */
+    uint32_t rejected;                  /**< Commands refused (queue full, stale list) */
+    uint32_t max_wait_ms;               /**< Longest time a command waited to start */
+    int pending;                        /**< Commands currently queued */
+} bus_task_stats_t;
+
+/**
+ * @brief Start the bus task (after onewire_temp_init)
+ */
+esp_err_t bus_task_start(void);
+
+/**
+ * @brief Convert all sensors and read the selected ones (periodic cycle)
+ * @param sensors Sensors to update, in bus order
+ * @param sensor_count Number of sensors
+ * @param selected Sensors to read, NULL for all
+ * @param generation Device list generation the array was built from
+ * @return ESP_ERR_INVALID_STATE if a rescan replaced the device list since
+ */
+esp_err_t bus_task_read_cycle(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                              uint32_t generation);
+
+/**
+ * @brief Same as bus_task_read_cycle, but ahead of all other queued work
+ *        (on-demand reads)
+ */
+esp_err_t bus_task_read_now(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                            uint32_t generation);
+
+/**
+ * @brief Same as bus_task_read_cycle, also reporting when the conversion
+ *        started (burst capture)
+ *
+ * Queued like a periodic cycle, so periodic cycles and a burst loop take
+ * turns on the bus.
+ *
+ * @param convert_us Output: esp_timer time of the convert command
+ */
+esp_err_t bus_task_read_burst(onewire_sensor_t *sensors, int sensor_count, const bool *selected,
+                              uint32_t generation, int64_t *convert_us);
+
+/**
+ * @brief Rediscover devices
+ * @param sensors Output array
+ * @param max_sensors Capacity of @p sensors
+ * @param found_count Output: devices found
+ * @param generation Output: generation of the new device list (may be NULL)
+ */
+esp_err_t bus_task_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count,
+                        uint32_t *generation);
+
+/**
+ * @brief Change resolution of all sensors (9-12 bits)
+ */
+esp_err_t bus_task_set_resolution(int bits);
+
+/**
+ * @brief Pin the resolution (9-12 bits), or release it with 0
+ *
+ * While pinned, bus_task_set_resolution() only records the value asked
+ * for; releasing the hold applies the last one recorded.
+ */
+esp_err_t bus_task_hold_resolution(int bits);
+
+/**
+ * @brief Find sensors with their alarm flag set
+ * @see onewire_temp_alarm_search
+ */
+esp_err_t bus_task_alarm_search(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max_found, int *found_count);
+
+/**
+ * @brief Reset the bus, or delete and re-create its driver (recovery)
+ *
+ * Queued behind all other work, so it never runs in the middle of a rescan.
+ *
+ * @see onewire_temp_bus_reset, onewire_temp_recreate_bus
+ */
+esp_err_t bus_task_recover(bool recreate);
+
+/**
+ * @brief Get bus task statistics
+ */
+void bus_task_get_stats(bus_task_stats_t *stats);
+
+#endif /* BUS_TASK_H */
@@ -8,6 +8,9 @@
  * - MDC: GPIO23
  * - PHY Address: 0
  * - PHY Reset/Power: GPIO12
+ *
+ * With CONFIG_ETH_USE_OPENETH (the QEMU build) the emulated OpenCores MAC
+ * is used instead.
  */
 
 #include "ethernet_manager.h"
@@ -84,6 +87,21 @@ static void got_ip_event_handler(void *arg, esp_event_base_t event_base,
 
 esp_err_t ethernet_manager_init(void)
 {
+    /* Create default event loop if not already created */
+    esp_netif_config_t netif_cfg = ESP_NETIF_DEFAULT_ETH();
+    s_eth_netif = esp_netif_new(&netif_cfg);
+
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+
+#if CONFIG_ETH_USE_OPENETH
+    ESP_LOGW(TAG, "Initializing emulated OpenCores Ethernet (QEMU)");
+
+    /* The emulated PHY has no reset line or clock, and links at once */
+    phy_config.autonego_timeout_ms = 100;
+    esp_eth_mac_t *mac = esp_eth_mac_new_openeth(&mac_config);
+    esp_eth_phy_t *phy = esp_eth_phy_new_dp83848(&phy_config);
+#else
     ESP_LOGD(TAG, "Initializing Ethernet for ESP32-POE-ISO");
 
     /* Enable PHY power (GPIO12 on POE-ISO) */
@@ -92,12 +110,7 @@ esp_err_t ethernet_manager_init(void)
     gpio_set_level(ETH_PHY_RST_GPIO, 1);
     vTaskDelay(pdMS_TO_TICKS(10));
 
-    /* Create default event loop if not already created */
-    esp_netif_config_t netif_cfg = ESP_NETIF_DEFAULT_ETH();
-    s_eth_netif = esp_netif_new(&netif_cfg);
-
     /* Configure Ethernet MAC */
-    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
     eth_esp32_emac_config_t esp32_emac_config = ETH_ESP32_EMAC_DEFAULT_CONFIG();
     
     /* Configure RMII clock output on GPIO17 (matches ESPHome CLK_OUT mode) */
@@ -109,11 +122,11 @@ esp_err_t ethernet_manager_init(void)
     esp_eth_mac_t *mac = esp_eth_mac_new_esp32(&esp32_emac_config, &mac_config);
 
     /* Configure LAN8720 PHY */
-    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
     phy_config.phy_addr = ETH_PHY_ADDR;
     phy_config.reset_gpio_num = -1;  /* We handle reset manually above */
     
     esp_eth_phy_t *phy = esp_eth_phy_new_lan87xx(&phy_config);
+#endif
 
     /* Install Ethernet driver */
     esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
@@ -161,3 +174,23 @@ const char* ethernet_manager_get_ip(void)
 {
     return s_ip_addr;
 }
+
+esp_err_t ethernet_manager_get_link(int *speed_mbps, bool *full_duplex)
+{
+    if (s_eth_handle == NULL || !s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    eth_speed_t speed;
+    eth_duplex_t duplex;
+    esp_err_t err = esp_eth_ioctl(s_eth_handle, ETH_CMD_G_SPEED, &speed);
+    if (err == ESP_OK) {
+        err = esp_eth_ioctl(s_eth_handle, ETH_CMD_G_DUPLEX_MODE, &duplex);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    *speed_mbps = speed == ETH_SPEED_100M ? 100 : 10;
+    *full_duplex = duplex == ETH_DUPLEX_FULL;
+    return ESP_OK;
+}
@@ -36,4 +36,10 @@ bool ethernet_manager_is_connected(void);
  */
 const char* ethernet_manager_get_ip(void);
 
+/**
+ * @brief Negotiated link speed and duplex
+ * @return ESP_ERR_INVALID_STATE if the link is down
+ */
+esp_err_t ethernet_manager_get_link(int *speed_mbps, bool *full_duplex);
+
 #endif /* ETHERNET_MANAGER_H */
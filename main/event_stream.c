@@ -0,0 +1,128 @@
+/**
+ * @file event_stream.c
+ * @brief Server-Sent Events (SSE) push channel for the web server
+ *
+ * Subscribers are plain HTTP sockets that received a chunked
+ * text/event-stream response and were never finished. Each event is written
+ * as one HTTP chunk. The client list is only touched on the HTTP server task
+ * (URI handlers, queued work and the close callback run there), so no lock
+ * is needed.
+ */
+
+#include "event_stream.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "event_stream";
+
+static httpd_handle_t s_server = NULL;
+static int s_clients[EVENT_STREAM_MAX_CLIENTS];
+static volatile int s_client_count = 0;
+
+void event_stream_init(httpd_handle_t server)
+{
+    s_server = server;
+    for (int i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        s_clients[i] = -1;
+    }
+    s_client_count = 0;
+}
+
+static void remove_client(int slot)
+{
+    s_clients[slot] = -1;
+    s_client_count--;
+}
+
+esp_err_t event_stream_subscribe(httpd_req_t *req)
+{
+    int slot = -1;
+    for (int i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        if (s_clients[i] < 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Too many event stream clients");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    /* First chunk sends the headers; the response is intentionally left open */
+    esp_err_t err = httpd_resp_send_chunk(req, ": connected\n\n", HTTPD_RESP_USE_STRLEN);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_clients[slot] = httpd_req_to_sockfd(req);
+    s_client_count++;
+    ESP_LOGI(TAG, "Event stream client connected (%d active)", s_client_count);
+    return ESP_OK;
+}
+
+void event_stream_on_close(int sockfd)
+{
+    for (int i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        if (s_clients[i] == sockfd) {
+            remove_client(i);
+            ESP_LOGI(TAG, "Event stream client disconnected (%d active)", s_client_count);
+        }
+    }
+}
+
+/**
+ * @brief Send a pre-framed chunk to every subscriber (runs on server task)
+ */
+static void broadcast_work(void *arg)
+{
+    char *chunk = arg;
+    size_t len = strlen(chunk);
+
+    for (int i = 0; i < EVENT_STREAM_MAX_CLIENTS; i++) {
+        if (s_clients[i] < 0) {
+            continue;
+        }
+        int sent = httpd_socket_send(s_server, s_clients[i], chunk, len, 0);
+        if (sent != (int)len) {
+            /* Let the server close it; the close callback removes the slot */
+            ESP_LOGD(TAG, "Dropping event stream client fd=%d", s_clients[i]);
+            httpd_sess_trigger_close(s_server, s_clients[i]);
+            remove_client(i);
+        }
+    }
+    free(chunk);
+}
+
+esp_err_t event_stream_broadcast(const char *event, const char *data)
+{
+    if (s_server == NULL || s_client_count == 0) {
+        return ESP_OK;
+    }
+
+    /* SSE frame wrapped in an HTTP chunk: "<hex len>\r\n<frame>\r\n" */
+    int frame_len = snprintf(NULL, 0, "event: %s\ndata: %s\n\n", event, data);
+    size_t size = frame_len + 16;
+    char *chunk = malloc(size);
+    if (chunk == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int hdr = snprintf(chunk, size, "%x\r\n", frame_len);
+    snprintf(chunk + hdr, size - hdr, "event: %s\ndata: %s\n\n\r\n", event, data);
+
+    esp_err_t err = httpd_queue_work(s_server, broadcast_work, chunk);
+    if (err != ESP_OK) {
+        free(chunk);
+    }
+    return err;
+}
+
+int event_stream_client_count(void)
+{
+    return s_client_count;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file event_stream.h
+ * @brief Server-Sent Events (SSE) push channel for the web server
+ */
+
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+/** @brief Maximum concurrent SSE clients (each holds one HTTP socket) */
+#define EVENT_STREAM_MAX_CLIENTS 3
+
+/**
+ * @brief Initialize the event stream for a running server
+ * @param server HTTP server handle
+ */
+void event_stream_init(httpd_handle_t server);
+
+/**
+ * @brief Turn a request into an event stream subscription
+ *
+ * Sends the SSE response headers and keeps the socket open; events are
+ * pushed to it by event_stream_broadcast(). Call from a URI handler.
+ */
+esp_err_t event_stream_subscribe(httpd_req_t *req);
+
+/**
+ * @brief Forget a socket that the server is closing
+ *
+ * Must be called from the server's close callback so a reused socket
+ * number is never mistaken for a subscriber.
+ */
+void event_stream_on_close(int sockfd);
+
+/**
+ * @brief Send an event to all subscribers
+ *
+ * Safe to call from any task; the send happens on the HTTP server task.
+ *
+ * @param event Event name (SSE "event:" field)
+ * @param data Event payload (single line, typically JSON)
+ * @return ESP_OK if queued (or no subscribers)
+ */
+esp_err_t event_stream_broadcast(const char *event, const char *data);
+
+/**
+ * @brief Get number of connected subscribers
+ */
+int event_stream_client_count(void);
+
+#endif /* EVENT_STREAM_H */
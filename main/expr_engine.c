@@ -0,0 +1,440 @@
+/**
+ * @file expr_engine.c
+ * @brief Expressions over sensor readings compiled to stack bytecode
+ *        (host-testable)
+ */
+
+#include "expr_engine.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+
+enum {
+    OP_CONST = 1,       /* index */
+    OP_INPUT,           /* input index */
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG,
+    OP_ABS,
+    OP_MIN,             /* argument count */
+    OP_MAX,             /* argument count */
+    OP_AVG,             /* argument count */
+    OP_DEADBAND,        /* state slot */
+};
+
+typedef struct {
+    const char *src;
+    const char *p;
+    expr_resolve_fn_t resolve;
+    void *ctx;
+    expr_program_t *prog;
+    int depth;
+    int nesting;                /* parse_unary() calls on the C stack */
+    expr_error_t *err;
+    bool failed;
+} parser_t;
+
+static void parse_expr(parser_t *ps);
+
+static void fail(parser_t *ps, const char *msg)
+{
+    if (ps->failed) {
+        return;
+    }
+    ps->failed = true;
+    if (ps->err != NULL) {
+        ps->err->pos = (int)(ps->p - ps->src);
+        ps->err->msg = msg;
+    }
+}
+
+static void skip_space(parser_t *ps)
+{
+    while (isspace((unsigned char)*ps->p)) {
+        ps->p++;
+    }
+}
+
+static bool accept(parser_t *ps, char c)
+{
+    skip_space(ps);
+    if (*ps->p == c) {
+        ps->p++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Append an instruction; @p stack_delta tracks the depth it leaves
+ */
+static void emit(parser_t *ps, uint8_t op, int operand, int stack_delta)
+{
+    expr_program_t *prog = ps->prog;
+    int size = operand >= 0 ? 2 : 1;
+    if (ps->failed) {
+        return;
+    }
+    if (prog->code_len + size > EXPR_MAX_CODE) {
+        fail(ps, "Expression too long");
+        return;
+    }
+    prog->code[prog->code_len++] = op;
+    if (operand >= 0) {
+        prog->code[prog->code_len++] = (uint8_t)operand;
+    }
+    ps->depth += stack_delta;
+    if (ps->depth > EXPR_MAX_STACK) {
+        fail(ps, "Expression nested too deeply");
+    }
+}
+
+static void parse_number(parser_t *ps)
+{
+    char *end;
+    float value = strtof(ps->p, &end);
+    if (end == ps->p || !isfinite(value)) {
+        fail(ps, "Invalid number");
+        return;
+    }
+    ps->p = end;
+
+    expr_program_t *prog = ps->prog;
+    int index = -1;
+    for (int i = 0; i < prog->const_count; i++) {
+        if (prog->consts[i] == value) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        if (prog->const_count >= EXPR_MAX_CONSTS) {
+            fail(ps, "Too many constants");
+            return;
+        }
+        index = prog->const_count++;
+        prog->consts[index] = value;
+    }
+    emit(ps, OP_CONST, index, 1);
+}
+
+static void parse_sensor(parser_t *ps)
+{
+    const char *name = ps->p;
+    const char *end = strchr(name, '}');
+    if (end == NULL) {
+        fail(ps, "Missing '}'");
+        return;
+    }
+    int input = ps->resolve(name, (size_t)(end - name), ps->ctx);
+    if (input < 0 || input > 254) {
+        fail(ps, "Unknown sensor");
+        return;
+    }
+    ps->p = end + 1;
+
+    expr_program_t *prog = ps->prog;
+    bool seen = false;
+    for (int i = 0; i < prog->input_count; i++) {
+        seen |= prog->inputs[i] == input;
+    }
+    if (!seen) {
+        if (prog->input_count >= EXPR_MAX_INPUTS) {
+            fail(ps, "Too many sensors");
+            return;
+        }
+        prog->inputs[prog->input_count++] = (uint8_t)input;
+    }
+    emit(ps, OP_INPUT, input, 1);
+}
+
+static void parse_call(parser_t *ps, const char *name, size_t len)
+{
+    static const struct {
+        const char *name;
+        uint8_t op;
+        int min_args;
+        int max_args;
+    } funcs[] = {
+        { "min", OP_MIN, 1, EXPR_MAX_STACK },
+        { "max", OP_MAX, 1, EXPR_MAX_STACK },
+        { "avg", OP_AVG, 1, EXPR_MAX_STACK },
+        { "abs", OP_ABS, 1, 1 },
+        { "deadband", OP_DEADBAND, 2, 2 },
+    };
+
+    int f = -1;
+    for (int i = 0; i < (int)(sizeof(funcs) / sizeof(funcs[0])); i++) {
+        if (strlen(funcs[i].name) == len && strncmp(funcs[i].name, name, len) == 0) {
+            f = i;
+        }
+    }
+    if (f < 0) {
+        ps->p = name;
+        fail(ps, "Unknown function");
+        return;
+    }
+    if (!accept(ps, '(')) {
+        fail(ps, "Expected '('");
+        return;
+    }
+
+    int args = 0;
+    do {
+        parse_expr(ps);
+        args++;
+    } while (!ps->failed && accept(ps, ','));
+    if (ps->failed) {
+        return;
+    }
+    if (!accept(ps, ')')) {
+        fail(ps, "Expected ')'");
+        return;
+    }
+    if (args < funcs[f].min_args || args > funcs[f].max_args) {
+        fail(ps, "Wrong number of arguments");
+        return;
+    }
+
+    switch (funcs[f].op) {
+    case OP_ABS:
+        emit(ps, OP_ABS, -1, 0);
+        break;
+    case OP_DEADBAND:
+        if (ps->prog->state_count >= EXPR_MAX_STATE) {
+            fail(ps, "Too many deadband() calls");
+            return;
+        }
+        emit(ps, OP_DEADBAND, ps->prog->state_count++, -1);
+        break;
+    default:
+        emit(ps, funcs[f].op, args, 1 - args);
+        break;
+    }
+}
+
+static void parse_primary(parser_t *ps)
+{
+    skip_space(ps);
+    char c = *ps->p;
+
+    if (c == '(') {
+        ps->p++;
+        parse_expr(ps);
+        if (!ps->failed && !accept(ps, ')')) {
+            fail(ps, "Expected ')'");
+        }
+    } else if (c == '{') {
+        ps->p++;
+        parse_sensor(ps);
+    } else if (isdigit((unsigned char)c) || c == '.') {
+        parse_number(ps);
+    } else if (isalpha((unsigned char)c)) {
+        const char *name = ps->p;
+        while (isalnum((unsigned char)*ps->p) || *ps->p == '_') {
+            ps->p++;
+        }
+        parse_call(ps, name, (size_t)(ps->p - name));
+    } else {
+        fail(ps, c == '\0' ? "Unexpected end of expression" : "Unexpected character");
+    }
+}
+
+static void parse_unary(parser_t *ps)
+{
+    /* Every level of recursion passes through here; depth alone misses
+     * "((((1))))" and "----1", which nest without stacking values */
+    if (++ps->nesting > EXPR_MAX_NESTING) {
+        fail(ps, "Expression nested too deeply");
+    } else if (accept(ps, '-')) {
+        parse_unary(ps);
+        emit(ps, OP_NEG, -1, 0);
+    } else {
+        parse_primary(ps);
+    }
+    ps->nesting--;
+}
+
+static void parse_term(parser_t *ps)
+{
+    parse_unary(ps);
+    while (!ps->failed) {
+        if (accept(ps, '*')) {
+            parse_unary(ps);
+            emit(ps, OP_MUL, -1, -1);
+        } else if (accept(ps, '/')) {
+            parse_unary(ps);
+            emit(ps, OP_DIV, -1, -1);
+        } else {
+            break;
+        }
+    }
+}
+
+static void parse_expr(parser_t *ps)
+{
+    parse_term(ps);
+    while (!ps->failed) {
+        if (accept(ps, '+')) {
+            parse_term(ps);
+            emit(ps, OP_ADD, -1, -1);
+        } else if (accept(ps, '-')) {
+            parse_term(ps);
+            emit(ps, OP_SUB, -1, -1);
+        } else {
+            break;
+        }
+    }
+}
+
+bool expr_compile(const char *src, expr_resolve_fn_t resolve, void *ctx,
+                  expr_program_t *prog, expr_error_t *err)
+{
+    parser_t ps = {
+        .src = src,
+        .p = src,
+        .resolve = resolve,
+        .ctx = ctx,
+        .prog = prog,
+        .err = err,
+    };
+
+    memset(prog, 0, sizeof(*prog));
+    if (strlen(src) >= EXPR_MAX_SOURCE) {
+        fail(&ps, "Expression too long");
+        return false;
+    }
+
+    parse_expr(&ps);
+    skip_space(&ps);
+    if (!ps.failed && *ps.p != '\0') {
+        fail(&ps, "Unexpected character");
+    }
+    expr_reset_state(prog);
+    return !ps.failed;
+}
+
+/**
+ * @brief min/max/avg over the valid values of a stack slice
+ */
+static float reduce(uint8_t op, const float *args, int n)
+{
+    float result = NAN;
+    int valid = 0;
+    for (int i = 0; i < n; i++) {
+        float v = args[i];
+        if (isnan(v)) {
+            continue;
+        }
+        if (valid++ == 0) {
+            result = v;
+        } else if (op == OP_MIN) {
+            result = v < result ? v : result;
+        } else if (op == OP_MAX) {
+            result = v > result ? v : result;
+        } else {
+            result += v;
+        }
+    }
+    if (op == OP_AVG && valid > 0) {
+        result /= (float)valid;
+    }
+    return result;
+}
+
+float expr_eval(expr_program_t *prog, const float *values, int value_count)
+{
+    float stack[EXPR_MAX_STACK];
+    int sp = 0;
+    int pc = 0;
+
+    /* The compiler checked operands and stack depth */
+    while (pc < prog->code_len) {
+        uint8_t op = prog->code[pc++];
+        switch (op) {
+        case OP_CONST:
+            stack[sp++] = prog->consts[prog->code[pc++]];
+            break;
+        case OP_INPUT: {
+            uint8_t input = prog->code[pc++];
+            stack[sp++] = input < value_count ? values[input] : NAN;
+            break;
+        }
+        case OP_ADD:
+            sp--;
+            stack[sp - 1] += stack[sp];
+            break;
+        case OP_SUB:
+            sp--;
+            stack[sp - 1] -= stack[sp];
+            break;
+        case OP_MUL:
+            sp--;
+            stack[sp - 1] *= stack[sp];
+            break;
+        case OP_DIV:
+            sp--;
+            stack[sp - 1] = stack[sp] != 0.0f ? stack[sp - 1] / stack[sp] : NAN;
+            break;
+        case OP_NEG:
+            stack[sp - 1] = -stack[sp - 1];
+            break;
+        case OP_ABS:
+            stack[sp - 1] = fabsf(stack[sp - 1]);
+            break;
+        case OP_MIN:
+        case OP_MAX:
+        case OP_AVG: {
+            int n = prog->code[pc++];
+            sp -= n;
+            stack[sp] = reduce(op, &stack[sp], n);
+            sp++;
+            break;
+        }
+        case OP_DEADBAND: {
+            float *held = &prog->state[prog->code[pc++]];
+            float band = stack[--sp];
+            float x = stack[sp - 1];
+            if (isnan(x) || isnan(band)) {
+                stack[sp - 1] = NAN;
+            } else {
+                if (isnan(*held) || fabsf(x - *held) > band) {
+                    *held = x;
+                }
+                stack[sp - 1] = *held;
+            }
+            break;
+        }
+        default:
+            return NAN;
+        }
+    }
+
+    if (sp != 1 || !isfinite(stack[0])) {
+        return NAN;
+    }
+    return stack[0];
+}
+
+void expr_reset_state(expr_program_t *prog)
+{
+    for (int i = 0; i < EXPR_MAX_STATE; i++) {
+        prog->state[i] = NAN;
+    }
+}
+
+bool expr_id_valid(const char *id)
+{
+    size_t len = strlen(id);
+    if (len == 0 || len >= EXPR_ID_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!islower((unsigned char)id[i]) && !isdigit((unsigned char)id[i]) && id[i] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file expr_engine.h
+ * @brief Expressions over sensor readings compiled to stack bytecode
+ *        (host-testable)
+ *
+ * Grammar:
+ *
+ *     expr    := term (('+' | '-') term)*
+ *     term    := unary (('*' | '/') unary)*
+ *     unary   := '-' unary | primary
+ *     primary := number | '{' sensor '}' | func '(' expr (',' expr)* ')' | '(' expr ')'
+ *     func    := min | max | avg | abs | deadband
+ *
+ * A sensor is named by address or friendly name inside braces and resolved
+ * to an input index once, at compile time. Invalid inputs are NaN; they
+ * make arithmetic NaN, while min/max/avg skip them and only fail when
+ * every argument is invalid. deadband(x, band) holds its output until x
+ * moves more than band away from it, which keeps a derived value from
+ * republishing sensor noise.
+ */
+
+#ifndef EXPR_ENGINE_H
+#define EXPR_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Program limits */
+#define EXPR_MAX_SOURCE 128     /**< Expression text, including the terminator */
+#define EXPR_MAX_CODE   96      /**< Bytecode bytes */
+#define EXPR_MAX_CONSTS 8
+#define EXPR_MAX_STACK  16
+#define EXPR_MAX_NESTING 16     /**< Parentheses, calls and unary minus, bounds parser recursion */
+#define EXPR_MAX_INPUTS 16      /**< Distinct sensors referenced */
+#define EXPR_MAX_STATE  4       /**< deadband() calls */
+
+/** @brief Virtual sensor identifier and name lengths, including the terminator */
+#define EXPR_ID_LEN     24
+#define EXPR_NAME_LEN   32
+
+/**
+ * @brief A virtual sensor as configured by the user (stored in NVS)
+ */
+typedef struct {
+    char id[EXPR_ID_LEN];               /**< [a-z0-9_], used in MQTT topics */
+    char name[EXPR_NAME_LEN];           /**< Display name, empty = id */
+    char expression[EXPR_MAX_SOURCE];
+} virtual_sensor_config_t;
+
+/**
+ * @brief Compiled expression and its deadband state
+ */
+typedef struct {
+    uint8_t code[EXPR_MAX_CODE];
+    uint8_t code_len;
+    float consts[EXPR_MAX_CONSTS];
+    uint8_t const_count;
+    uint8_t inputs[EXPR_MAX_INPUTS];    /**< Input indices referenced, in first-use order */
+    uint8_t input_count;
+    float state[EXPR_MAX_STATE];        /**< Held deadband outputs, NaN = none yet */
+    uint8_t state_count;
+} expr_program_t;
+
+/**
+ * @brief Where and why compilation failed
+ */
+typedef struct {
+    int pos;                /**< Offset into the source */
+    const char *msg;        /**< Static string */
+} expr_error_t;
+
+/**
+ * @brief Map a sensor reference to an input index
+ * @param name Text between the braces (not terminated)
+ * @param len Length of @p name
+ * @return Input index 0-254, or -1 if unknown
+ */
+typedef int (*expr_resolve_fn_t)(const char *name, size_t len, void *ctx);
+
+/**
+ * @brief Compile an expression
+ * @param src Expression text
+ * @param resolve Sensor reference resolver
+ * @param ctx Passed to @p resolve
+ * @param prog Output: program
+ * @param err Output: failure position and reason (may be NULL)
+ * @return false on a syntax error, unknown sensor or exceeded limit
+ */
+bool expr_compile(const char *src, expr_resolve_fn_t resolve, void *ctx,
+                  expr_program_t *prog, expr_error_t *err);
+
+/**
+ * @brief Evaluate a program
+ * @param prog Program (deadband state is updated)
+ * @param values Readings by input index, NaN if invalid
+ * @param value_count Length of @p values; indices past it read as NaN
+ * @return Result, NaN if invalid
+ */
+float expr_eval(expr_program_t *prog, const float *values, int value_count);
+
+/**
+ * @brief Forget held deadband outputs
+ */
+void expr_reset_state(expr_program_t *prog);
+
+/**
+ * @brief Check a virtual sensor identifier: 1-23 of [a-z0-9_]
+ */
+bool expr_id_valid(const char *id);
+
+#endif /* EXPR_ENGINE_H */
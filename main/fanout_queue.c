@@ -0,0 +1,125 @@
+/**
+ * @file fanout_queue.c
+ * @brief Per-cycle payloads shared across broker targets (host-testable)
+ */
+
+#include "fanout_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* "{"seq":4294967295,"time":-9223372036854775808,"readings":{" + "}}" */
+#define JSON_OVERHEAD 72
+/* ""<id>":-1234.56," */
+#define JSON_PER_READING (FANOUT_ID_LEN + FANOUT_VALUE_LEN + 4)
+
+fanout_batch_t *fanout_batch_create(uint32_t seq, int64_t time_ms, int64_t sample_time,
+                                    const fanout_input_t *inputs, int count)
+{
+    size_t json_size = JSON_OVERHEAD + (size_t)count * JSON_PER_READING;
+    fanout_batch_t *b = malloc(sizeof(fanout_batch_t) + count * sizeof(fanout_reading_t) + json_size);
+    if (b == NULL) {
+        return NULL;
+    }
+    b->seq = seq;
+    b->time_ms = time_ms;
+    b->sample_time = sample_time;
+    b->refs = 1;
+    b->count = 0;
+    b->readings = (fanout_reading_t *)(b + 1);
+    b->json = (char *)(b->readings + count);
+
+    size_t len = (size_t)snprintf(b->json, json_size, "{\"seq\":%lu,", (unsigned long)seq);
+    if (sample_time != 0) {
+        len += (size_t)snprintf(b->json + len, json_size - len, "\"time\":%lld,", (long long)sample_time);
+    }
+    len += (size_t)snprintf(b->json + len, json_size - len, "\"readings\":{");
+    for (int i = 0; i < count; i++) {
+        fanout_reading_t *r = &b->readings[b->count];
+        if ((size_t)snprintf(r->id, sizeof(r->id), "%s", inputs[i].id) >= sizeof(r->id)) {
+            continue;
+        }
+        if (inputs[i].valid) {
+            snprintf(r->value, sizeof(r->value), "%.2f", inputs[i].value);
+        } else {
+            r->value[0] = '\0';
+        }
+        len += (size_t)snprintf(b->json + len, json_size - len, "%s\"%s\":%s", b->count > 0 ? "," : "",
+                                r->id, r->value[0] ? r->value : "null");
+        b->count++;
+    }
+    len += (size_t)snprintf(b->json + len, json_size - len, "}}");
+    b->json_len = len;
+    return b;
+}
+
+void fanout_batch_ref(fanout_batch_t *b)
+{
+    b->refs++;
+}
+
+void fanout_batch_release(fanout_batch_t *b)
+{
+    if (b != NULL && --b->refs == 0) {
+        free(b);
+    }
+}
+
+size_t fanout_batch_size(const fanout_batch_t *b)
+{
+    return sizeof(fanout_batch_t) + b->count * sizeof(fanout_reading_t) + b->json_len;
+}
+
+void fanout_queue_init(fanout_queue_t *q, size_t budget)
+{
+    memset(q, 0, sizeof(*q));
+    q->budget = budget;
+}
+
+int fanout_queue_push(fanout_queue_t *q, fanout_batch_t *b)
+{
+    size_t size = fanout_batch_size(b);
+    int dropped = 0;
+    while (q->count > 0 && (q->count == FANOUT_QUEUE_LEN || q->bytes + size > q->budget)) {
+        fanout_queue_pop(q);
+        dropped++;
+    }
+    q->dropped += dropped;
+
+    fanout_batch_ref(b);
+    q->items[(q->head + q->count) % FANOUT_QUEUE_LEN] = b;
+    q->count++;
+    q->bytes += size;
+    return dropped;
+}
+
+fanout_batch_t *fanout_queue_peek(const fanout_queue_t *q)
+{
+    return q->count > 0 ? q->items[q->head] : NULL;
+}
+
+void fanout_queue_pop(fanout_queue_t *q)
+{
+    if (q->count == 0) {
+        return;
+    }
+    fanout_batch_t *b = q->items[q->head];
+    q->items[q->head] = NULL;
+    q->head = (q->head + 1) % FANOUT_QUEUE_LEN;
+    q->count--;
+    q->bytes -= fanout_batch_size(b);
+    fanout_batch_release(b);
+}
+
+void fanout_queue_clear(fanout_queue_t *q)
+{
+    while (q->count > 0) {
+        fanout_queue_pop(q);
+    }
+}
+
+int64_t fanout_queue_lag_ms(const fanout_queue_t *q, int64_t now_ms)
+{
+    const fanout_batch_t *b = fanout_queue_peek(q);
+    return b != NULL ? now_ms - b->time_ms : 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file fanout_queue.h
+ * @brief Per-cycle payloads shared across broker targets (host-testable)
+ *
+ * Each publish cycle is serialized once into a batch: one JSON document
+ * with every reading, plus the formatted value of each reading for targets
+ * that publish a topic per sensor. Every broker target holds a reference
+ * in its own queue and drops the batch when it has been handed to the MQTT
+ * client; the last reference frees it.
+ *
+ * A queue is bounded by a byte budget. A target that falls behind (slow or
+ * unreachable broker) loses its oldest batches rather than holding up the
+ * others, and reports how many it lost and how old its oldest batch is.
+ *
+ * Not thread-safe: callers serialize access to batches and queues.
+ */
+
+#ifndef FANOUT_QUEUE_H
+#define FANOUT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "expr_engine.h"
+
+/** @brief Most batches a queue holds, whatever the budget */
+#define FANOUT_QUEUE_LEN 16
+
+/** @brief Sensor address or "v_" plus a virtual sensor id, with the NUL */
+#define FANOUT_ID_LEN    (EXPR_ID_LEN + 2)
+#define FANOUT_VALUE_LEN 12
+
+/**
+ * @brief A reading to serialize
+ */
+typedef struct {
+    const char *id;             /**< Sensor address or virtual sensor id */
+    float value;
+    bool valid;
+} fanout_input_t;
+
+/**
+ * @brief One reading as serialized
+ */
+typedef struct {
+    char id[FANOUT_ID_LEN];
+    char value[FANOUT_VALUE_LEN];   /**< "21.50", empty if not valid */
+} fanout_reading_t;
+
+/**
+ * @brief One cycle's payload, shared by reference
+ */
+typedef struct {
+    uint32_t seq;
+    int64_t time_ms;            /**< When the cycle was serialized */
+    int64_t sample_time;        /**< Epoch ms of the newest reading's conversion, 0 if unknown */
+    int refs;
+    int count;
+    fanout_reading_t *readings;
+    char *json;                 /**< {"seq":N,"time":T,"readings":{"<id>":21.5,"<id>":null}} */
+    size_t json_len;
+} fanout_batch_t;
+
+/**
+ * @brief Serialize a cycle (one allocation) with one reference held
+ *
+ * Inputs whose id does not fit FANOUT_ID_LEN are left out rather than
+ * published under a truncated id.
+ *
+ * @param sample_time Epoch ms for "time", 0 to leave it out
+ * @return Batch, or NULL if out of memory
+ */
+fanout_batch_t *fanout_batch_create(uint32_t seq, int64_t time_ms, int64_t sample_time,
+                                    const fanout_input_t *inputs, int count);
+
+void fanout_batch_ref(fanout_batch_t *b);
+
+/**
+ * @brief Drop a reference, freeing the batch with the last one
+ */
+void fanout_batch_release(fanout_batch_t *b);
+
+/**
+ * @brief Bytes a batch accounts for in a queue budget
+ */
+size_t fanout_batch_size(const fanout_batch_t *b);
+
+/**
+ * @brief A target's queue of batches, oldest first
+ */
+typedef struct {
+    fanout_batch_t *items[FANOUT_QUEUE_LEN];
+    int head;
+    int count;
+    size_t bytes;
+    size_t budget;
+    uint32_t dropped;           /**< Batches lost to the budget since init */
+} fanout_queue_t;
+
+void fanout_queue_init(fanout_queue_t *q, size_t budget);
+
+/**
+ * @brief Queue a reference to @p b, dropping the oldest batches to stay in budget
+ *
+ * The new batch is always queued, even if it alone exceeds the budget.
+ *
+ * @return Batches dropped
+ */
+int fanout_queue_push(fanout_queue_t *q, fanout_batch_t *b);
+
+/**
+ * @brief Oldest batch, or NULL if empty (the queue keeps its reference)
+ */
+fanout_batch_t *fanout_queue_peek(const fanout_queue_t *q);
+
+/**
+ * @brief Remove the oldest batch and release its reference
+ */
+void fanout_queue_pop(fanout_queue_t *q);
+
+/**
+ * @brief Release every queued batch
+ */
+void fanout_queue_clear(fanout_queue_t *q);
+
+/**
+ * @brief Age of the oldest queued batch, 0 if empty
+ */
+int64_t fanout_queue_lag_ms(const fanout_queue_t *q, int64_t now_ms);
+
+#endif /* FANOUT_QUEUE_H */
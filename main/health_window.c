@@ -0,0 +1,162 @@
+/**
+ * @file health_window.c
+ * @brief Sliding-window read error rates and bus fault localization
+ *        (host-testable)
+ */
+
+#include "health_window.h"
+#include <string.h>
+
+static const struct {
+    uint32_t bucket_ms;
+    int count;
+    int offset;
+} s_spans[HEALTH_SPAN_COUNT] = {
+    { 10000,   HEALTH_BUCKETS_1M,  0 },
+    { 300000,  HEALTH_BUCKETS_1H,  HEALTH_BUCKETS_1M },
+    { 3600000, HEALTH_BUCKETS_24H, HEALTH_BUCKETS_1M + HEALTH_BUCKETS_1H },
+};
+
+static const char *s_span_names[] = { "1m", "1h", "24h" };
+
+static const char *s_fault_names[] = {
+    "none", "sensor", "segment", "bus", "scattered"
+};
+
+void health_window_init(health_window_t *w)
+{
+    memset(w->buckets, 0, sizeof(w->buckets));
+    for (int s = 0; s < HEALTH_SPAN_COUNT; s++) {
+        w->newest[s] = -1;
+    }
+}
+
+static uint16_t add_sat(uint16_t a, uint32_t b)
+{
+    uint32_t sum = a + b;
+    return sum > UINT16_MAX ? UINT16_MAX : (uint16_t)sum;
+}
+
+void health_window_add(health_window_t *w, int64_t now_ms, uint32_t reads, uint32_t failed)
+{
+    for (int s = 0; s < HEALTH_SPAN_COUNT; s++) {
+        health_bucket_t *ring = &w->buckets[s_spans[s].offset];
+        int count = s_spans[s].count;
+        int64_t n = now_ms / s_spans[s].bucket_ms;
+
+        if (w->newest[s] < 0 || n - w->newest[s] >= count) {
+            memset(ring, 0, count * sizeof(health_bucket_t));
+            w->newest[s] = n;
+        } else {
+            /* Clear the buckets skipped since the last add */
+            for (int64_t k = w->newest[s] + 1; k <= n; k++) {
+                ring[k % count].reads = 0;
+                ring[k % count].failed = 0;
+            }
+            if (n > w->newest[s]) {
+                w->newest[s] = n;
+            }
+        }
+
+        health_bucket_t *b = &ring[w->newest[s] % count];
+        b->reads = add_sat(b->reads, reads);
+        b->failed = add_sat(b->failed, failed);
+    }
+}
+
+void health_window_counts(const health_window_t *w, int64_t now_ms, health_counts_t *out)
+{
+    for (int s = 0; s < HEALTH_SPAN_COUNT; s++) {
+        const health_bucket_t *ring = &w->buckets[s_spans[s].offset];
+        int count = s_spans[s].count;
+        int64_t n = now_ms / s_spans[s].bucket_ms;
+
+        out->reads[s] = 0;
+        out->failed[s] = 0;
+        /* Only buckets newer than count buckets before now are in the window */
+        for (int k = 0; k < count && w->newest[s] >= 0; k++) {
+            int64_t num = w->newest[s] - k;
+            if (num < 0 || num <= n - count) {
+                break;
+            }
+            out->reads[s] += ring[num % count].reads;
+            out->failed[s] += ring[num % count].failed;
+        }
+    }
+}
+
+float health_error_percent(uint32_t reads, uint32_t failed)
+{
+    if (reads == 0) {
+        return 0.0f;
+    }
+    if (failed > reads) {
+        failed = reads;
+    }
+    return (float)failed * 100.0f / (float)reads;
+}
+
+void health_localize(const health_sensor_input_t *sensors, int count, float threshold_percent,
+                     health_fault_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->kind = HEALTH_FAULT_NONE;
+    out->sensor = -1;
+    out->upstream = -1;
+
+    bool positioned = true;
+    int first_failing = -1;     /* Failing sensor closest to the master */
+    int last_healthy = -1;      /* Healthy sensor furthest from the master */
+    int any_failing = -1;
+
+    for (int i = 0; i < count; i++) {
+        const health_sensor_input_t *s = &sensors[i];
+        if (s->reads < HEALTH_MIN_READS) {
+            continue;
+        }
+        out->considered++;
+        positioned &= s->position > 0;
+
+        if (health_error_percent(s->reads, s->failed) > threshold_percent) {
+            out->failing++;
+            any_failing = i;
+            if (first_failing < 0 || s->position < sensors[first_failing].position) {
+                first_failing = i;
+            }
+        } else if (last_healthy < 0 || s->position > sensors[last_healthy].position) {
+            last_healthy = i;
+        }
+    }
+
+    if (out->failing == 0) {
+        return;
+    }
+    if (out->failing == 1) {
+        out->kind = HEALTH_FAULT_SENSOR;
+        out->sensor = any_failing;
+        return;
+    }
+    if (out->failing == out->considered) {
+        out->kind = HEALTH_FAULT_BUS;
+        return;
+    }
+    /* Failing sensors form the far end of the cable: all of them sit
+     * strictly behind every healthy one */
+    if (positioned && sensors[first_failing].position > sensors[last_healthy].position) {
+        out->kind = HEALTH_FAULT_SEGMENT;
+        out->sensor = first_failing;
+        out->upstream = last_healthy;
+        return;
+    }
+    out->kind = HEALTH_FAULT_SCATTERED;
+}
+
+const char *health_span_name(health_span_t span)
+{
+    return span < HEALTH_SPAN_COUNT ? s_span_names[span] : "unknown";
+}
+
+const char *health_fault_name(health_fault_kind_t kind)
+{
+    return kind <= HEALTH_FAULT_SCATTERED ? s_fault_names[kind] : "unknown";
+}
@@ -0,0 +1,131 @@
+/**
+ * @file health_window.h
+ * @brief Sliding-window read error rates and bus fault localization
+ *        (host-testable)
+ *
+ * Reads and failures are counted in ring buckets at three scales: 6 x 10 s
+ * for the last minute, 12 x 5 min for the last hour and 24 x 1 h for the
+ * last day. A window sums the buckets that overlap it, so it can reach back
+ * up to one bucket further than its nominal length. Bucket counts saturate
+ * at 65535.
+ *
+ * Localization assumes a daisy-chained bus. A broken or marginal cable
+ * segment hurts every sensor behind it, so when the failing sensors are
+ * exactly those from one cable position onward, the segment in front of
+ * the first of them is the likely fault. ROM search order says nothing
+ * about where a sensor sits on the cable; without configured positions the
+ * heuristic can only tell a single bad sensor from a bus-wide problem.
+ */
+
+#ifndef HEALTH_WINDOW_H
+#define HEALTH_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    HEALTH_SPAN_1M = 0,
+    HEALTH_SPAN_1H,
+    HEALTH_SPAN_24H,
+    HEALTH_SPAN_COUNT
+} health_span_t;
+
+/** @brief Buckets per span and in total */
+#define HEALTH_BUCKETS_1M   6
+#define HEALTH_BUCKETS_1H   12
+#define HEALTH_BUCKETS_24H  24
+#define HEALTH_BUCKETS      (HEALTH_BUCKETS_1M + HEALTH_BUCKETS_1H + HEALTH_BUCKETS_24H)
+
+/** @brief Reads a sensor needs in the window before its rate is trusted */
+#define HEALTH_MIN_READS    10
+
+typedef struct {
+    uint16_t reads;
+    uint16_t failed;
+} health_bucket_t;
+
+/**
+ * @brief Bucket rings of one sensor or of the whole bus
+ */
+typedef struct {
+    health_bucket_t buckets[HEALTH_BUCKETS];
+    int64_t newest[HEALTH_SPAN_COUNT];      /**< Bucket number last written, -1 = none */
+} health_window_t;
+
+/**
+ * @brief Totals over each span
+ */
+typedef struct {
+    uint32_t reads[HEALTH_SPAN_COUNT];
+    uint32_t failed[HEALTH_SPAN_COUNT];
+} health_counts_t;
+
+typedef enum {
+    HEALTH_FAULT_NONE = 0,
+    HEALTH_FAULT_SENSOR,        /**< One sensor (or its stub) failing */
+    HEALTH_FAULT_SEGMENT,       /**< Every sensor past one cable position failing */
+    HEALTH_FAULT_BUS,           /**< Every sensor failing: trunk, pull-up or supply */
+    HEALTH_FAULT_SCATTERED      /**< No pattern: marginal pull-up, noise, long stubs */
+} health_fault_kind_t;
+
+/**
+ * @brief One sensor's counts for localization
+ */
+typedef struct {
+    uint32_t reads;
+    uint32_t failed;
+    uint8_t position;       /**< Place on the cable from the master, 1-255, 0 = unknown */
+} health_sensor_input_t;
+
+/**
+ * @brief Localization result (indices into the input array)
+ */
+typedef struct {
+    health_fault_kind_t kind;
+    int sensor;             /**< SENSOR: the failing one; SEGMENT: first one behind the fault */
+    int upstream;           /**< SEGMENT: last healthy sensor in front of it, else -1 */
+    int failing;            /**< Sensors above the threshold */
+    int considered;         /**< Sensors with at least HEALTH_MIN_READS reads */
+} health_fault_t;
+
+/**
+ * @brief Clear all buckets
+ */
+void health_window_init(health_window_t *w);
+
+/**
+ * @brief Count reads and failures at a time
+ *
+ * Times must not go backwards; an older time is counted in the newest
+ * bucket.
+ */
+void health_window_add(health_window_t *w, int64_t now_ms, uint32_t reads, uint32_t failed);
+
+/**
+ * @brief Sum each span as seen at a time
+ */
+void health_window_counts(const health_window_t *w, int64_t now_ms, health_counts_t *out);
+
+/**
+ * @brief Failed reads as a percentage of reads (0 without reads)
+ */
+float health_error_percent(uint32_t reads, uint32_t failed);
+
+/**
+ * @brief Find the likely fault from per-sensor counts
+ * @param threshold_percent Error rate above which a sensor counts as failing
+ */
+void health_localize(const health_sensor_input_t *sensors, int count, float threshold_percent,
+                     health_fault_t *out);
+
+/**
+ * @brief Short span name ("1m", "1h", "24h")
+ */
+const char *health_span_name(health_span_t span);
+
+/**
+ * @brief Short fault name ("none", "sensor", "segment", ...)
+ */
+const char *health_fault_name(health_fault_kind_t kind);
+
+#endif /* HEALTH_WINDOW_H */
@@ -14,6 +14,7 @@
 #include "freertos/event_groups.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_event.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
@@ -23,11 +24,21 @@
 #include "ethernet_manager.h"
 #include "wifi_manager.h"
 #include "onewire_temp.h"
+#include "bus_task.h"
+#include "burst_capture.h"
+#include "virtual_sensor.h"
+#include "acq_watchdog.h"
 #include "sensor_manager.h"
 #include "mqtt_client_ha.h"
+#include "mqtt_fanout.h"
+#include "mqtt_tls.h"
 #include "web_server.h"
 #include "ota_updater.h"
+#include "ota_session.h"
 #include "log_buffer.h"
+#include "power_manager.h"
+#include "time_sync.h"
+#include "net_selftest.h"
 
 static const char *TAG = "main";
 
@@ -116,12 +127,31 @@ static void network_event_handler(void *arg, esp_event_base_t event_base,
 static void temperature_task(void *pvParameters)
 {
     ESP_LOGD(TAG, "Temperature task started");
+    acq_watchdog_attach();
     
     while (1) {
-        /* Read all connected sensors */
-        sensor_manager_read_all();
+        /* Adaptive acquisition may shorten or stretch the configured interval;
+         * it applies to every sensor without an interval of its own */
+        uint32_t interval_ms = sensor_manager_get_read_interval(s_read_interval_ms);
+        sensor_cycle_result_t result;
+        sensor_manager_read_due(interval_ms, &result);
+        uint32_t retry_ms = acq_watchdog_report(result);
+        bool converted = result != SENSOR_CYCLE_IDLE && result != SENSOR_CYCLE_FAILED;
+        time_sync_cycle_done(converted ? onewire_temp_get_convert_time() : 0);
         
-        vTaskDelay(pdMS_TO_TICKS(s_read_interval_ms));
+        /* Sleep until the earliest sensor deadline. Sensors of a failed
+         * cycle stay due: retry them soon while recovery has stages left,
+         * otherwise after a full interval. */
+        uint32_t delay_ms = sensor_manager_get_read_delay();
+        if (result == SENSOR_CYCLE_FAILED) {
+            delay_ms = retry_ms > 0 ? retry_ms : interval_ms;
+        } else {
+            /* Wall-clock aligned: start on the next period boundary instead */
+            delay_ms = time_sync_align_delay(delay_ms, onewire_temp_get_conversion_ms() / 2);
+        }
+        int64_t due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+        acq_watchdog_sleep(delay_ms);
+        power_manager_check_deadline(due_us);
     }
 }
 
@@ -137,8 +167,12 @@ static void mqtt_publish_task(void *pvParameters)
     
     while (1) {
         if (mqtt_ha_is_connected()) {
+            power_manager_acquire(PM_ACTIVITY_NET);
             sensor_manager_publish_all();
+            power_manager_release(PM_ACTIVITY_NET);
         }
+        /* Queued per target, so a target that is down catches up when back */
+        mqtt_fanout_publish_cycle();
         
         vTaskDelay(pdMS_TO_TICKS(s_publish_interval_ms));
     }
@@ -168,13 +202,20 @@ static void ota_check_task(void *pvParameters)
  */
 static void watchdog_task(void *pvParameters)
 {
+    uint32_t seconds = 0;
+
     while (1) {
+        /* Reboots if the temperature task is stuck on the bus */
+        acq_watchdog_check();
+
         /* Log heap status periodically (debug level - not shown by default) */
-        ESP_LOGD(TAG, "Free heap: %lu bytes, minimum: %lu bytes",
-                 esp_get_free_heap_size(),
-                 esp_get_minimum_free_heap_size());
+        if (seconds++ % 60 == 0) {
+            ESP_LOGD(TAG, "Free heap: %lu bytes, minimum: %lu bytes",
+                     esp_get_free_heap_size(),
+                     esp_get_minimum_free_heap_size());
+        }
         
-        vTaskDelay(pdMS_TO_TICKS(60000)); /* Every minute */
+        vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
@@ -236,6 +277,12 @@ void app_main(void)
     /* Initialize NVS storage for our app data */
     ESP_ERROR_CHECK(nvs_storage_init());
 
+    /* Pick up an acquisition recovery that was cut short by a reboot */
+    ESP_ERROR_CHECK(acq_watchdog_init());
+
+    /* Frequency scaling and light sleep between acquisition cycles */
+    ESP_ERROR_CHECK(power_manager_init());
+
     /* Load sensor settings from NVS (or use defaults) */
     {
         uint32_t read_ms, publish_ms;
@@ -254,19 +301,24 @@ void app_main(void)
     /* Initialize 1-Wire bus and discover sensors */
     ESP_ERROR_CHECK(onewire_temp_init(CONFIG_ONEWIRE_GPIO));
 
+    /* From here on all bus access goes through the bus task */
+    ESP_ERROR_CHECK(bus_task_start());
+
     /* Apply saved resolution setting */
     {
         uint32_t read_ms, publish_ms;
         uint8_t resolution;
         if (nvs_storage_load_sensor_settings(&read_ms, &publish_ms, &resolution) == ESP_OK) {
             if (resolution >= 9 && resolution <= 12) {
-                onewire_temp_set_resolution(resolution);
+                bus_task_set_resolution(resolution);
             }
         }
     }
     
     /* Initialize sensor manager */
     ESP_ERROR_CHECK(sensor_manager_init());
+    ESP_ERROR_CHECK(burst_capture_init());
+    ESP_ERROR_CHECK(virtual_sensor_init());
 
 #if CONFIG_USE_ETHERNET
     /* Initialize Ethernet (primary connection for POE) */
@@ -293,8 +345,21 @@ void app_main(void)
     /* Initialize mDNS */
     init_mdns();
 
+    /* Set the clock for reading timestamps */
+    time_sync_init();
+
     /* Initialize MQTT client */
+    ESP_ERROR_CHECK(mqtt_tls_init());
     ESP_ERROR_CHECK(mqtt_ha_init());
+    ESP_ERROR_CHECK(mqtt_fanout_init());
+
+#if CONFIG_SELFTEST_ENABLED
+    /* Network self-test (served under /api/selftest) */
+    ESP_ERROR_CHECK(net_selftest_init());
+#endif
+
+    /* Resumable firmware uploads (served under /api/ota/session) */
+    ESP_ERROR_CHECK(ota_session_init());
 
     /* Start web server */
     ESP_ERROR_CHECK(web_server_start());
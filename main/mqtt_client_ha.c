@@ -6,23 +6,527 @@
 #include "mqtt_client_ha.h"
 #include "mqtt_client.h"
 #include "sensor_manager.h"
+#include "virtual_sensor.h"
 #include "onewire_temp.h"
 #include "nvs_storage.h"
 #include "ethernet_manager.h"
 #include "wifi_manager.h"
+#include "topic_alias.h"
+#include "sparkplug.h"
+#include "mqtt_tls.h"
+#include "mqtt_payload.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/time.h>
 
 static const char *TAG = "mqtt_ha";
 
+/* How long a new connection may take before a switch is abandoned */
+#define SWITCH_CONNECT_TIMEOUT_MS 15000
+/* How long the old connection gets to deliver its outbox */
+#define SWITCH_DRAIN_TIMEOUT_MS   3000
+#define SWITCH_POLL_MS            50
+#define SWITCH_TASK_STACK_SIZE    6144
+#define SESSION_TASK_STACK_SIZE   6144
+
+#define PENDING_CONNECTED_BIT BIT0
+#define SESSION_UP_BIT        BIT1
+#define REBIRTH_BIT           BIT2
+
+/* CONNACK codes of a broker that does not speak MQTT 5 */
+#define REFUSED_PROTOCOL_V311 0x01  /* 3.1.1: unacceptable protocol version */
+#define REFUSED_PROTOCOL_V5   0x84  /* 5: unsupported protocol version */
+
+/**
+ * @brief Broker settings a client was created with
+ */
+typedef struct {
+    char uri[128];
+    char username[64];
+    char password[64];
+} mqtt_settings_t;
+
+/**
+ * @brief Strings referenced by a client configuration
+ */
+typedef struct {
+    char lwt_topic[128];
+    char client_id[64];
+    uint8_t death[48];          /* Sparkplug NDEATH payload */
+} client_strings_t;
+
+/*
+ * Two client slots. The active client carries all traffic; during a
+ * reconfiguration the other slot holds the pending client until it has
+ * connected. Publishes hold s_publish_lock, so once the active client has
+ * been swapped under it nothing is using the old one. The event handler
+ * runs on the client's task and must never take that lock: a publisher
+ * holding it may be waiting for the client's task.
+ */
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
+static esp_mqtt_client_handle_t s_pending_client = NULL;
+static int s_active_slot = 0;
+static SemaphoreHandle_t s_publish_lock = NULL;
+static portMUX_TYPE s_client_mux = portMUX_INITIALIZER_UNLOCKED;
 static bool s_connected = false;
+static uint32_t s_session = 0;          /* Bumped for every new active connection */
+static bool s_v5[2] = {false, false};   /* Slot is connected with MQTT 5 */
+
+static mqtt_settings_t s_active;
+static mqtt_settings_t s_pending;
+static char s_discovery_uri[128] = "";  /* Broker the retained discovery was sent to */
+static EventGroupHandle_t s_events = NULL;
+static volatile mqtt_switch_state_t s_switch_state = MQTT_SWITCH_IDLE;
+
+#if CONFIG_MQTT_USE_V5
+static bool s_v311_only[2] = {false, false};   /* Slot's broker refused MQTT 5 */
+static bool s_fallback_due[2] = {false, false};
+static topic_alias_entry_t s_alias_entries[CONFIG_MQTT5_TOPIC_ALIAS_MAX];
+static topic_alias_table_t s_aliases;
+static uint32_t s_alias_session = UINT32_MAX;
+static uint16_t s_alias_limit = CONFIG_MQTT5_TOPIC_ALIAS_MAX;  /* Learned broker maximum */
+#endif
+
+#if CONFIG_SPARKPLUG_ENABLED
+/* Metric aliases; a birth lists them with their names */
+#define SPB_ALIAS_REBIRTH       1
+#define SPB_ALIAS_SENSORS       100     /* + sensor index */
+#define SPB_ALIAS_SENSOR_NAMES  200
+#define SPB_ALIAS_VIRTUAL       300     /* + virtual sensor slot */
+#define SPB_ALIAS_VIRTUAL_NAMES 400
+#define SPB_METRIC_NAME_LEN     48
+#define SPB_METRICS_MAX         (2 + 2 * (CONFIG_MAX_SENSORS + CONFIG_VIRTUAL_SENSORS_MAX))
+
+/* All guarded by s_publish_lock */
+static uint8_t s_bdseq[2];              /* Birth/death sequence each slot connected with */
+static uint8_t s_bdseq_next = 0;
+static uint8_t s_spb_seq = 0;
+static uint32_t s_spb_birth_session = UINT32_MAX;
+static uint32_t s_spb_birth_hash = 0;   /* Sensor set and names the last birth listed */
+static sparkplug_rbe_t s_spb_rbe[CONFIG_MAX_SENSORS + CONFIG_VIRTUAL_SENSORS_MAX];
+static char s_spb_ncmd_topic[128];
+#endif
 
 /* Forward declaration */
 extern const char *APP_VERSION;
 
+/**
+ * @brief Naming of this node's Home Assistant entities
+ */
+static mqtt_node_t ha_node(void)
+{
+    mqtt_node_t node = {
+#if CONFIG_HA_DISCOVERY_ENABLED
+        .discovery_prefix = CONFIG_HA_DISCOVERY_PREFIX,
+#endif
+        .base_topic = CONFIG_MQTT_BASE_TOPIC,
+        .sw_version = APP_VERSION,
+    };
+    return node;
+}
+static cJSON* create_device_info(void);
+
+/**
+ * @brief Publish on @p client; s_publish_lock must be held
+ *
+ * With MQTT 5 the publish properties stick to the client, so they are set
+ * before every publish. Sensor values then get a topic alias and a message
+ * expiry and go out at QoS 0: a reading is superseded by the next one, and
+ * a packet that only carries an alias must never be retransmitted on a
+ * later connection, where the alias means nothing.
+ */
+static int publish_locked(esp_mqtt_client_handle_t client, bool v5, const char *topic,
+                          const char *data, int len, int qos, int retain, bool value)
+{
+#if CONFIG_MQTT_USE_V5
+    if (v5) {
+        esp_mqtt5_publish_property_config_t prop = {0};
+        if (!value) {
+            if (esp_mqtt5_client_set_publish_property(client, &prop) != ESP_OK) {
+                return -1;
+            }
+            return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+        }
+
+        portENTER_CRITICAL(&s_client_mux);
+        uint32_t session = s_session;
+        portEXIT_CRITICAL(&s_client_mux);
+        if (session != s_alias_session) {
+            topic_alias_reset(&s_aliases, s_alias_limit);
+            s_alias_session = session;
+        }
+
+        bool send_topic;
+        uint16_t alias = topic_alias_get(&s_aliases, topic, &send_topic);
+        prop.topic_alias = alias;
+        prop.message_expiry_interval = CONFIG_MQTT5_STATE_EXPIRY_S;
+        if (alias != 0 && esp_mqtt5_client_set_publish_property(client, &prop) != ESP_OK) {
+            /* Above the broker's Topic Alias Maximum: send the full topic instead */
+            ESP_LOGI(TAG, "Broker refused topic alias %u, using %u", alias, alias - 1);
+            topic_alias_limit(&s_aliases, alias);
+            s_alias_limit = s_aliases.limit;
+            alias = 0;
+            send_topic = true;
+            prop.topic_alias = 0;
+        }
+        if (alias == 0 && esp_mqtt5_client_set_publish_property(client, &prop) != ESP_OK) {
+            return -1;
+        }
+        int msg_id = esp_mqtt_client_publish(client, send_topic ? topic : "", data, len, 0, retain);
+        if (msg_id < 0 && alias != 0) {
+            /* Not sent (outbox full, disconnected): announce the alias next time */
+            topic_alias_unsent(&s_aliases, alias);
+        }
+        return msg_id;
+    }
+#endif
+    return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+}
+
+/**
+ * @brief esp_mqtt_client_publish() on whichever client is active
+ */
+static int client_publish(const char *topic, const char *data, int len, int qos, int retain)
+{
+    if (s_publish_lock == NULL) {
+        return -1;
+    }
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    int msg_id = -1;
+    if (s_mqtt_client != NULL) {
+        msg_id = publish_locked(s_mqtt_client, s_v5[s_active_slot], topic, data, len, qos, retain, false);
+    }
+    xSemaphoreGive(s_publish_lock);
+    return msg_id;
+}
+
+/**
+ * @brief Publish a sensor value (QoS 1, or aliased and expiring with MQTT 5)
+ */
+static int client_publish_value(const char *topic, const char *data)
+{
+    if (s_publish_lock == NULL) {
+        return -1;
+    }
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    int msg_id = -1;
+    if (s_mqtt_client != NULL) {
+        msg_id = publish_locked(s_mqtt_client, s_v5[s_active_slot], topic, data, 0, 1, 0, true);
+    }
+    xSemaphoreGive(s_publish_lock);
+    return msg_id;
+}
+
+/**
+ * @brief esp_mqtt_client_enqueue() on whichever client is active
+ */
+static int client_enqueue(const char *topic, const char *data, int len, int qos, int retain, bool store)
+{
+    if (s_publish_lock == NULL) {
+        return -1;
+    }
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    int msg_id = -1;
+    if (s_mqtt_client != NULL) {
+#if CONFIG_MQTT_USE_V5
+        if (s_v5[s_active_slot]) {
+            esp_mqtt5_publish_property_config_t prop = {0};
+            esp_mqtt5_client_set_publish_property(s_mqtt_client, &prop);
+        }
+#endif
+        msg_id = esp_mqtt_client_enqueue(s_mqtt_client, topic, data, len, qos, retain, store);
+    }
+    xSemaphoreGive(s_publish_lock);
+    return msg_id;
+}
+
+#if CONFIG_SPARKPLUG_ENABLED
+/**
+ * @brief Build spBv1.0/<group>/<type>/<edge node>; the edge node is the base topic
+ */
+static void spb_topic(char *buf, size_t len, const char *type)
+{
+    snprintf(buf, len, "%s/%s/%s/%s", SPARKPLUG_NAMESPACE, CONFIG_SPARKPLUG_GROUP_ID, type,
+             CONFIG_MQTT_BASE_TOPIC);
+}
+
+static uint64_t spb_now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/**
+ * @brief Encode the death certificate for a birth/death sequence number
+ */
+static size_t spb_encode_death(uint8_t *buf, size_t size, uint8_t bdseq)
+{
+    sparkplug_metric_t m = { .name = "bdSeq", .datatype = SPARKPLUG_UINT64, .value.u = bdseq };
+    return sparkplug_encode(buf, size, spb_now_ms(), -1, &m, 1);
+}
+
+static uint32_t hash_str(uint32_t h, const char *s)
+{
+    /* FNV-1a, including the terminator so "ab","c" differs from "a","bc" */
+    do {
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    } while (*s++ != '\0');
+    return h;
+}
+
+/**
+ * @brief Fingerprint of what a birth lists, to notice when a new one is due
+ */
+static uint32_t spb_birth_hash(const managed_sensor_t *sensors, int count)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < count; i++) {
+        h = hash_str(h, sensors[i].address_str);
+        h = hash_str(h, sensors[i].has_friendly_name ? sensors[i].friendly_name : "");
+    }
+    for (int slot = 0; slot < CONFIG_VIRTUAL_SENSORS_MAX; slot++) {
+        virtual_sensor_t vs;
+        if (virtual_sensor_get(slot, &vs)) {
+            h = hash_str(h, vs.cfg.id);
+            h = hash_str(h, vs.cfg.name);
+        } else {
+            h = hash_str(h, "");
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Copy the sensor table for a birth or data message
+ *
+ * Called before taking s_publish_lock: alerts are enqueued from code that
+ * holds the sensor table lock, so the two locks are never taken the other
+ * way round.
+ */
+static managed_sensor_t *spb_copy_sensors(int *count)
+{
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    *count = sensors != NULL ? sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS) : 0;
+    return sensors;
+}
+
+/**
+ * @brief Publish a birth certificate; s_publish_lock must be held
+ *
+ * Lists every metric with name, alias and datatype, with current values,
+ * and restarts the sequence numbers and report-by-exception state.
+ *
+ * @param sensors Sensor table copy from spb_copy_sensors()
+ */
+static int spb_publish_birth_locked(const managed_sensor_t *sensors, int count)
+{
+    sparkplug_metric_t *metrics = calloc(SPB_METRICS_MAX, sizeof(sparkplug_metric_t));
+    char (*names)[SPB_METRIC_NAME_LEN] = calloc(SPB_METRICS_MAX, SPB_METRIC_NAME_LEN);
+    if (metrics == NULL || names == NULL) {
+        free(metrics);
+        free(names);
+        return -1;
+    }
+
+    int n = 0;
+    metrics[n++] = (sparkplug_metric_t){ .name = "bdSeq", .datatype = SPARKPLUG_UINT64,
+                                         .value.u = s_bdseq[s_active_slot] };
+    metrics[n++] = (sparkplug_metric_t){ .name = SPARKPLUG_REBIRTH_METRIC, .alias = SPB_ALIAS_REBIRTH,
+                                         .datatype = SPARKPLUG_BOOLEAN, .value.b = false };
+    memset(s_spb_rbe, 0, sizeof(s_spb_rbe));
+
+    for (int i = 0; i < count; i++) {
+        const managed_sensor_t *ms = &sensors[i];
+        bool valid = ms->hw_sensor.valid;
+        sparkplug_rbe_update(&s_spb_rbe[i], valid, ms->hw_sensor.temperature, 0.0f);
+
+        snprintf(names[n], SPB_METRIC_NAME_LEN, "Sensors/%s", ms->address_str);
+        metrics[n] = (sparkplug_metric_t){ .name = names[n], .alias = SPB_ALIAS_SENSORS + i,
+                                           .datatype = SPARKPLUG_FLOAT, .is_null = !valid,
+                                           .value.f = ms->hw_sensor.temperature };
+        n++;
+        snprintf(names[n], SPB_METRIC_NAME_LEN, "Sensors/%s/Name", ms->address_str);
+        metrics[n] = (sparkplug_metric_t){ .name = names[n], .alias = SPB_ALIAS_SENSOR_NAMES + i,
+                                           .datatype = SPARKPLUG_STRING,
+                                           .value.s = ms->has_friendly_name ? ms->friendly_name : ms->address_str };
+        n++;
+    }
+
+    /* Virtual sensor names live in the copies, so keep those until encoded */
+    static virtual_sensor_t vs[CONFIG_VIRTUAL_SENSORS_MAX];
+    for (int slot = 0; slot < CONFIG_VIRTUAL_SENSORS_MAX; slot++) {
+        if (!virtual_sensor_get(slot, &vs[slot])) {
+            continue;
+        }
+        sparkplug_rbe_update(&s_spb_rbe[CONFIG_MAX_SENSORS + slot], vs[slot].valid, vs[slot].value, 0.0f);
+
+        snprintf(names[n], SPB_METRIC_NAME_LEN, "Virtual/%s", vs[slot].cfg.id);
+        metrics[n] = (sparkplug_metric_t){ .name = names[n], .alias = SPB_ALIAS_VIRTUAL + slot,
+                                           .datatype = SPARKPLUG_FLOAT, .is_null = !vs[slot].valid,
+                                           .value.f = vs[slot].value };
+        n++;
+        snprintf(names[n], SPB_METRIC_NAME_LEN, "Virtual/%s/Name", vs[slot].cfg.id);
+        metrics[n] = (sparkplug_metric_t){ .name = names[n], .alias = SPB_ALIAS_VIRTUAL_NAMES + slot,
+                                           .datatype = SPARKPLUG_STRING,
+                                           .value.s = vs[slot].cfg.name[0] ? vs[slot].cfg.name : vs[slot].cfg.id };
+        n++;
+    }
+
+    int msg_id = -1;
+    uint64_t now = spb_now_ms();
+    size_t size = sparkplug_encode(NULL, 0, now, 0, metrics, n);
+    uint8_t *payload = malloc(size);
+    if (payload != NULL) {
+        sparkplug_encode(payload, size, now, 0, metrics, n);
+        char topic[128];
+        spb_topic(topic, sizeof(topic), "NBIRTH");
+        esp_mqtt_client_subscribe(s_mqtt_client, s_spb_ncmd_topic, 1);
+        msg_id = publish_locked(s_mqtt_client, s_v5[s_active_slot], topic, (const char *)payload,
+                                (int)size, 0, 0, false);
+        free(payload);
+    }
+    free(metrics);
+    free(names);
+
+    if (msg_id >= 0) {
+        s_spb_seq = 0;
+        s_spb_birth_hash = spb_birth_hash(sensors, count);
+        portENTER_CRITICAL(&s_client_mux);
+        s_spb_birth_session = s_session;
+        portEXIT_CRITICAL(&s_client_mux);
+        ESP_LOGI(TAG, "Published Sparkplug NBIRTH (%d metrics, %u bytes, bdSeq %u)", n,
+                 (unsigned)size, s_bdseq[s_active_slot]);
+    }
+    return msg_id;
+}
+
+esp_err_t mqtt_ha_publish_sparkplug_data(void)
+{
+    int count;
+    managed_sensor_t *sensors = spb_copy_sensors(&count);
+    if (sensors == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    if (s_mqtt_client == NULL) {
+        xSemaphoreGive(s_publish_lock);
+        free(sensors);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_client_mux);
+    bool born = s_spb_birth_session == s_session;
+    portEXIT_CRITICAL(&s_client_mux);
+    if (!born || spb_birth_hash(sensors, count) != s_spb_birth_hash) {
+        int msg_id = spb_publish_birth_locked(sensors, count);
+        xSemaphoreGive(s_publish_lock);
+        free(sensors);
+        return msg_id < 0 ? ESP_FAIL : ESP_OK;
+    }
+
+    static sparkplug_metric_t metrics[CONFIG_MAX_SENSORS + CONFIG_VIRTUAL_SENSORS_MAX];
+    const float deadband = CONFIG_SPARKPLUG_DEADBAND_CENTI / 100.0f;
+    int n = 0;
+
+    for (int i = 0; i < count; i++) {
+        const onewire_sensor_t *hw = &sensors[i].hw_sensor;
+        if (sparkplug_rbe_update(&s_spb_rbe[i], hw->valid, hw->temperature, deadband)) {
+            metrics[n++] = (sparkplug_metric_t){ .alias = SPB_ALIAS_SENSORS + i, .is_null = !hw->valid,
+                                                 .value.f = hw->temperature };
+        }
+    }
+    for (int slot = 0; slot < CONFIG_VIRTUAL_SENSORS_MAX; slot++) {
+        virtual_sensor_t vs;
+        if (virtual_sensor_get(slot, &vs) &&
+            sparkplug_rbe_update(&s_spb_rbe[CONFIG_MAX_SENSORS + slot], vs.valid, vs.value, deadband)) {
+            metrics[n++] = (sparkplug_metric_t){ .alias = SPB_ALIAS_VIRTUAL + slot, .is_null = !vs.valid,
+                                                 .value.f = vs.value };
+        }
+    }
+
+    esp_err_t err = ESP_OK;
+    if (n > 0) {
+        /* By alias: at most 18 bytes per metric */
+        uint8_t payload[16 + 20 * (CONFIG_MAX_SENSORS + CONFIG_VIRTUAL_SENSORS_MAX)];
+        s_spb_seq = (uint8_t)(s_spb_seq + 1);
+        size_t len = sparkplug_encode(payload, sizeof(payload), spb_now_ms(), s_spb_seq, metrics, n);
+        char topic[128];
+        spb_topic(topic, sizeof(topic), "NDATA");
+        if (len == 0 || publish_locked(s_mqtt_client, s_v5[s_active_slot], topic, (const char *)payload,
+                                       (int)len, 0, 0, false) < 0) {
+            err = ESP_FAIL;
+        } else {
+            ESP_LOGD(TAG, "Published Sparkplug NDATA (%d metrics, %u bytes)", n, (unsigned)len);
+        }
+    }
+    xSemaphoreGive(s_publish_lock);
+    free(sensors);
+    return err;
+}
+#else
+esp_err_t mqtt_ha_publish_sparkplug_data(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif
+
+/**
+ * @brief Fill a client configuration for a slot
+ *
+ * Each slot has its own client id, so while two clients are connected to
+ * the same broker neither takes over the other's session.
+ */
+static void fill_config(esp_mqtt_client_config_t *cfg, client_strings_t *str,
+                        const mqtt_settings_t *settings, int slot)
+{
+    /* Build last will topic */
+    snprintf(str->lwt_topic, sizeof(str->lwt_topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(str->client_id, sizeof(str->client_id), "%s-%02x%02x%02x-%d", CONFIG_MQTT_BASE_TOPIC,
+             mac[3], mac[4], mac[5], slot);
+
+    *cfg = (esp_mqtt_client_config_t){
+        .broker.address.uri = settings->uri,
+        .credentials.username = strlen(settings->username) > 0 ? settings->username : NULL,
+        .credentials.client_id = str->client_id,
+        .credentials.authentication.password = strlen(settings->password) > 0 ? settings->password : NULL,
+        .session.last_will.topic = str->lwt_topic,
+        .session.last_will.msg = "offline",
+        .session.last_will.msg_len = 7,
+        .session.last_will.qos = 1,
+        .session.last_will.retain = 1,
+    };
+    mqtt_tls_configure(cfg);
+
+#if CONFIG_SPARKPLUG_ENABLED
+    /* The death certificate is the last will */
+    spb_topic(str->lwt_topic, sizeof(str->lwt_topic), "NDEATH");
+    cfg->session.last_will.msg = (const char *)str->death;
+    cfg->session.last_will.msg_len = (int)spb_encode_death(str->death, sizeof(str->death), s_bdseq[slot]);
+    cfg->session.last_will.retain = 0;
+#endif
+
+#if CONFIG_MQTT_USE_V5
+    bool v5 = !s_v311_only[slot];
+    cfg->session.protocol_ver = v5 ? MQTT_PROTOCOL_V_5 : MQTT_PROTOCOL_V_3_1_1;
+    /* Resume the session after a short outage; a 3.1.1 session would never expire */
+    cfg->session.disable_clean_session = v5 && CONFIG_MQTT5_SESSION_EXPIRY_S > 0;
+#endif
+}
+
 /**
  * @brief MQTT event handler
  */
@@ -30,19 +534,77 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                                int32_t event_id, void *event_data)
 {
     esp_mqtt_event_handle_t event = event_data;
+    int slot = (int)(intptr_t)handler_args;
+
+    portENTER_CRITICAL(&s_client_mux);
+    bool active = event->client == s_mqtt_client;
+    bool pending = event->client == s_pending_client;
+    portEXIT_CRITICAL(&s_client_mux);
+
+    if (!active && !pending) {
+        /* The client being retired */
+        return;
+    }
+
+#if CONFIG_MQTT_USE_V5
+    if (event_id == MQTT_EVENT_ERROR &&
+        event->error_handle->error_type == MQTT_ERROR_TYPE_CONNECTION_REFUSED &&
+        (event->error_handle->connect_return_code == REFUSED_PROTOCOL_V311 ||
+         event->error_handle->connect_return_code == REFUSED_PROTOCOL_V5) &&
+        !s_v311_only[slot]) {
+        ESP_LOGW(TAG, "Broker does not accept MQTT 5, falling back to 3.1.1");
+        s_v311_only[slot] = true;
+        s_fallback_due[slot] = true;
+        return;
+    }
+#endif
+
+    if (event_id == MQTT_EVENT_BEFORE_CONNECT) {
+        bool update = false;
+#if CONFIG_MQTT_USE_V5
+        update = s_fallback_due[slot];
+        s_fallback_due[slot] = false;
+#endif
+#if CONFIG_SPARKPLUG_ENABLED
+        /* Every connect gets a new bdSeq, in its death certificate and birth */
+        s_bdseq[slot] = s_bdseq_next++;
+        update = true;
+#endif
+        if (update) {
+            esp_mqtt_client_config_t cfg;
+            client_strings_t str;
+            fill_config(&cfg, &str, pending ? &s_pending : &s_active, slot);
+            esp_mqtt_set_config(event->client, &cfg);
+        }
+        return;
+    }
+
+    if (event_id == MQTT_EVENT_CONNECTED) {
+        s_v5[slot] = event->protocol_ver == MQTT_PROTOCOL_V_5;
+    }
+
+    if (pending) {
+        /* The switch task takes over once the new connection is up */
+        if (event_id == MQTT_EVENT_CONNECTED) {
+            xEventGroupSetBits(s_events, PENDING_CONNECTED_BIT);
+        } else if (event_id == MQTT_EVENT_DISCONNECTED) {
+            xEventGroupClearBits(s_events, PENDING_CONNECTED_BIT);
+        } else if (event_id == MQTT_EVENT_ERROR) {
+            ESP_LOGW(TAG, "New MQTT connection failed, still on the old broker");
+        }
+        return;
+    }
     
     switch ((esp_mqtt_event_id_t)event_id) {
     case MQTT_EVENT_CONNECTED:
-        ESP_LOGI(TAG, "MQTT Connected to broker");
+        ESP_LOGI(TAG, "MQTT Connected to broker (MQTT %s)", s_v5[slot] ? "5" : "3.1.1");
+        portENTER_CRITICAL(&s_client_mux);
+        s_session++;
+        portEXIT_CRITICAL(&s_client_mux);
         s_connected = true;
         
-        /* Publish online status */
-        mqtt_ha_publish_status(true);
-        
-        /* Register all sensors with Home Assistant */
-#if CONFIG_HA_DISCOVERY_ENABLED
-        mqtt_ha_publish_discovery_all();
-#endif
+        /* Online status and discovery are published by the session task */
+        xEventGroupSetBits(s_events, SESSION_UP_BIT);
         break;
         
     case MQTT_EVENT_DISCONNECTED:
@@ -60,6 +622,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     case MQTT_EVENT_DATA:
         ESP_LOGD(TAG, "MQTT Data received on topic %.*s", 
                  event->topic_len, event->topic);
+#if CONFIG_SPARKPLUG_ENABLED
+        if (event->topic_len == (int)strlen(s_spb_ncmd_topic) &&
+            strncmp(event->topic, s_spb_ncmd_topic, event->topic_len) == 0 &&
+            event->data_len == event->total_data_len &&
+            sparkplug_is_rebirth((const uint8_t *)event->data, event->data_len, SPB_ALIAS_REBIRTH)) {
+            ESP_LOGI(TAG, "Sparkplug rebirth requested");
+            xEventGroupSetBits(s_events, REBIRTH_BIT);
+        }
+#endif
         break;
         
     default:
@@ -67,50 +638,281 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
     }
 }
 
+/**
+ * @brief Publish online status (a birth with Sparkplug) and discovery for
+ *        every new connection, and a birth when a host asks for one
+ */
+static void session_task(void *arg)
+{
+    for (;;) {
+        EventBits_t bits = xEventGroupWaitBits(s_events, SESSION_UP_BIT | REBIRTH_BIT, pdTRUE, pdFALSE,
+                                               portMAX_DELAY);
+
+        /* Publish online status */
+        mqtt_ha_publish_status(true);
+        if (!(bits & SESSION_UP_BIT)) {
+            continue;
+        }
+
+        /* Register all sensors with Home Assistant */
+#if CONFIG_HA_DISCOVERY_ENABLED
+        mqtt_ha_publish_discovery_all();
+        snprintf(s_discovery_uri, sizeof(s_discovery_uri), "%s", s_active.uri);
+#endif
+    }
+}
+
+/**
+ * @brief Load the broker settings from NVS, falling back to menuconfig defaults
+ */
+static void load_settings(mqtt_settings_t *settings)
+{
+    memset(settings, 0, sizeof(*settings));
+    esp_err_t err = nvs_storage_load_mqtt_config(settings->uri, sizeof(settings->uri),
+                                                  settings->username, sizeof(settings->username),
+                                                  settings->password, sizeof(settings->password));
+    if (err != ESP_OK || strlen(settings->uri) == 0) {
+        strncpy(settings->uri, CONFIG_MQTT_BROKER_URI, sizeof(settings->uri) - 1);
+        strncpy(settings->username, CONFIG_MQTT_USERNAME, sizeof(settings->username) - 1);
+        strncpy(settings->password, CONFIG_MQTT_PASSWORD, sizeof(settings->password) - 1);
+    }
+}
+
+static bool settings_equal(const mqtt_settings_t *a, const mqtt_settings_t *b)
+{
+    return strcmp(a->uri, b->uri) == 0 && strcmp(a->username, b->username) == 0 &&
+           strcmp(a->password, b->password) == 0;
+}
+
+/**
+ * @brief Create (not start) a client for a slot
+ */
+static esp_mqtt_client_handle_t create_client(const mqtt_settings_t *settings, int slot)
+{
+#if CONFIG_MQTT_USE_V5
+    /* A new broker gets another chance at MQTT 5 */
+    s_v311_only[slot] = false;
+    s_fallback_due[slot] = false;
+#endif
+    s_v5[slot] = false;
+
+    esp_mqtt_client_config_t mqtt_cfg;
+    client_strings_t str;
+    fill_config(&mqtt_cfg, &str, settings, slot);
+    /* Set only here: the client destroys it, and set_config keeps it */
+    mqtt_cfg.network.transport = mqtt_tls_create_transport(settings->uri);
+
+    esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+    if (client == NULL) {
+        ESP_LOGE(TAG, "Failed to create MQTT client");
+        return NULL;
+    }
+
+#if CONFIG_MQTT_USE_V5
+    esp_mqtt5_connection_property_config_t conn_prop = {
+        .session_expiry_interval = CONFIG_MQTT5_SESSION_EXPIRY_S,
+    };
+    esp_mqtt5_client_set_connect_property(client, &conn_prop);
+#endif
+
+    esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, 
+                                   mqtt_event_handler, (void *)(intptr_t)slot);
+    return client;
+}
+
 esp_err_t mqtt_ha_init(void)
 {
     ESP_LOGD(TAG, "Initializing MQTT client");
 
+    if (s_mqtt_client != NULL) {
+        return ESP_OK;
+    }
+    if (s_events == NULL) {
+        s_events = xEventGroupCreate();
+        s_publish_lock = xSemaphoreCreateMutex();
+        if (s_events == NULL || s_publish_lock == NULL ||
+            xTaskCreate(session_task, "mqtt_session", SESSION_TASK_STACK_SIZE, NULL, 4, NULL) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+#if CONFIG_MQTT_USE_V5
+        topic_alias_init(&s_aliases, s_alias_entries, CONFIG_MQTT5_TOPIC_ALIAS_MAX);
+#endif
+#if CONFIG_SPARKPLUG_ENABLED
+        spb_topic(s_spb_ncmd_topic, sizeof(s_spb_ncmd_topic), "NCMD");
+#endif
+    }
+
     /* Try to load config from NVS, fall back to menuconfig defaults */
-    char broker_uri[128] = {0};
-    char username[64] = {0};
-    char password[64] = {0};
-    
-    esp_err_t err = nvs_storage_load_mqtt_config(broker_uri, sizeof(broker_uri),
-                                                  username, sizeof(username),
-                                                  password, sizeof(password));
-    if (err != ESP_OK || strlen(broker_uri) == 0) {
-        strncpy(broker_uri, CONFIG_MQTT_BROKER_URI, sizeof(broker_uri) - 1);
-        strncpy(username, CONFIG_MQTT_USERNAME, sizeof(username) - 1);
-        strncpy(password, CONFIG_MQTT_PASSWORD, sizeof(password) - 1);
+    mqtt_settings_t settings;
+    load_settings(&settings);
+
+    s_active = settings;
+    esp_mqtt_client_handle_t client = create_client(&settings, s_active_slot);
+    if (client == NULL) {
+        return ESP_FAIL;
     }
+    portENTER_CRITICAL(&s_client_mux);
+    s_mqtt_client = client;
+    portEXIT_CRITICAL(&s_client_mux);
 
-    /* Build last will topic */
-    char lwt_topic[128];
-    snprintf(lwt_topic, sizeof(lwt_topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+    ESP_LOGD(TAG, "Starting MQTT client, broker: %s", settings.uri);
+    return esp_mqtt_client_start(client);
+}
 
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = broker_uri,
-        .credentials.username = strlen(username) > 0 ? username : NULL,
-        .credentials.authentication.password = strlen(password) > 0 ? password : NULL,
-        .session.last_will.topic = lwt_topic,
-        .session.last_will.msg = "offline",
-        .session.last_will.msg_len = 7,
-        .session.last_will.qos = 1,
-        .session.last_will.retain = 1,
-    };
+/**
+ * @brief Make-before-break switch to the pending settings
+ *
+ * The old client keeps publishing until the new one has connected; the
+ * switch then happens in one step, the old client gets a moment to deliver
+ * what it still holds and is destroyed with a clean disconnect, so its last
+ * will is not sent.
+ */
+static void switch_task(void *arg)
+{
+    int new_slot = 1 - s_active_slot;
+
+    xEventGroupClearBits(s_events, PENDING_CONNECTED_BIT);
+    esp_mqtt_client_handle_t client = create_client(&s_pending, new_slot);
+    if (client != NULL) {
+        portENTER_CRITICAL(&s_client_mux);
+        s_pending_client = client;
+        portEXIT_CRITICAL(&s_client_mux);
+    }
+
+    EventBits_t bits = 0;
+    if (client != NULL && esp_mqtt_client_start(client) == ESP_OK) {
+        bits = xEventGroupWaitBits(s_events, PENDING_CONNECTED_BIT, pdFALSE, pdTRUE,
+                                   pdMS_TO_TICKS(SWITCH_CONNECT_TIMEOUT_MS));
+    }
+
+    if (!(bits & PENDING_CONNECTED_BIT)) {
+        ESP_LOGW(TAG, "Could not connect to %s, keeping the current broker", s_pending.uri);
+        portENTER_CRITICAL(&s_client_mux);
+        s_pending_client = NULL;
+        portEXIT_CRITICAL(&s_client_mux);
+        if (client != NULL) {
+            esp_mqtt_client_destroy(client);
+        }
+        s_switch_state = MQTT_SWITCH_FAILED;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    /* Switch over: publishers from here on only see the new client */
+    bool old_connected = s_connected;
+    bool same_broker = strcmp(s_pending.uri, s_active.uri) == 0;
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    portENTER_CRITICAL(&s_client_mux);
+    esp_mqtt_client_handle_t old_client = s_mqtt_client;
+    int old_slot = s_active_slot;
+    s_mqtt_client = client;
+    s_active_slot = new_slot;
+    s_pending_client = NULL;
+    s_connected = true;
+    s_session++;
+    portEXIT_CRITICAL(&s_client_mux);
+#if CONFIG_MQTT_USE_V5
+    if (!same_broker) {
+        s_alias_limit = CONFIG_MQTT5_TOPIC_ALIAS_MAX;
+    }
+#endif
+    xSemaphoreGive(s_publish_lock);
+    s_active = s_pending;
+    ESP_LOGI(TAG, "MQTT switched to %s (MQTT %s)", s_active.uri, s_v5[new_slot] ? "5" : "3.1.1");
+
+    mqtt_ha_publish_status(true);
+#if CONFIG_HA_DISCOVERY_ENABLED
+    /* Discovery is retained, so a broker that already has it needs no repeat */
+    if (strcmp(s_discovery_uri, s_active.uri) != 0) {
+        mqtt_ha_publish_discovery_all();
+        snprintf(s_discovery_uri, sizeof(s_discovery_uri), "%s", s_active.uri);
+    }
+#endif
+    /* Current state, so subscribers of a new broker have no gap */
+    sensor_manager_publish_all();
+
+    if (old_client != NULL) {
+        if (old_connected && !same_broker) {
+            /* The old broker would otherwise keep showing the device online */
+            xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+#if CONFIG_SPARKPLUG_ENABLED
+            char topic[128];
+            uint8_t death[48];
+            spb_topic(topic, sizeof(topic), "NDEATH");
+            size_t len = spb_encode_death(death, sizeof(death), s_bdseq[old_slot]);
+            publish_locked(old_client, s_v5[old_slot], topic, (const char *)death, (int)len, 1, 0, false);
+#else
+            char topic[128];
+            snprintf(topic, sizeof(topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+            publish_locked(old_client, s_v5[old_slot], topic, "offline", 0, 1, 1, false);
+#endif
+            xSemaphoreGive(s_publish_lock);
+        }
 
-    s_mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
+        int waited_ms = 0;
+        while (old_connected && waited_ms < SWITCH_DRAIN_TIMEOUT_MS &&
+               esp_mqtt_client_get_outbox_size(old_client) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(SWITCH_POLL_MS));
+            waited_ms += SWITCH_POLL_MS;
+        }
+        /* Stops with a DISCONNECT, so the broker drops the last will */
+        esp_mqtt_client_destroy(old_client);
+    }
+
+    s_switch_state = MQTT_SWITCH_IDLE;
+    vTaskDelete(NULL);
+}
+
+esp_err_t mqtt_ha_reconfigure(bool *changed)
+{
+    *changed = false;
     if (s_mqtt_client == NULL) {
-        ESP_LOGE(TAG, "Failed to create MQTT client");
-        return ESP_FAIL;
+        return mqtt_ha_init();
+    }
+    if (s_switch_state == MQTT_SWITCH_PENDING) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    esp_mqtt_client_register_event(s_mqtt_client, ESP_EVENT_ANY_ID, 
-                                   mqtt_event_handler, NULL);
+    mqtt_settings_t settings;
+    load_settings(&settings);
+    if (settings_equal(&settings, &s_active)) {
+        s_switch_state = MQTT_SWITCH_IDLE;
+        if (!s_connected) {
+            /* Same settings: just retry now instead of at the next backoff */
+            return esp_mqtt_client_reconnect(s_mqtt_client);
+        }
+        return ESP_OK;
+    }
 
-    ESP_LOGD(TAG, "Starting MQTT client, broker: %s", broker_uri);
-    return esp_mqtt_client_start(s_mqtt_client);
+    *changed = true;
+    s_pending = settings;
+    s_switch_state = MQTT_SWITCH_PENDING;
+    if (xTaskCreate(switch_task, "mqtt_switch", SWITCH_TASK_STACK_SIZE, NULL, 4, NULL) != pdPASS) {
+        s_switch_state = MQTT_SWITCH_FAILED;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Switching MQTT broker to %s", settings.uri);
+    return ESP_OK;
+}
+
+mqtt_switch_state_t mqtt_ha_get_switch_state(void)
+{
+    return s_switch_state;
+}
+
+const char *mqtt_ha_switch_state_name(mqtt_switch_state_t state)
+{
+    switch (state) {
+    case MQTT_SWITCH_IDLE:    return "idle";
+    case MQTT_SWITCH_PENDING: return "switching";
+    case MQTT_SWITCH_FAILED:  return "failed";
+    default:                  return "unknown";
+    }
+}
+
+const char *mqtt_ha_get_protocol(void)
+{
+    return s_v5[s_active_slot] ? "5" : "3.1.1";
 }
 
 esp_err_t mqtt_ha_start(void)
@@ -141,15 +943,15 @@ esp_err_t mqtt_ha_publish_temperature(const char *sensor_id, const char *friendl
         return ESP_ERR_INVALID_STATE;
     }
 
-    char topic[128];
+    char topic[MQTT_TOPIC_LEN];
     char payload[32];
+    mqtt_node_t node = ha_node();
 
     /* State topic: base_topic/sensor/sensor_id/state */
-    snprintf(topic, sizeof(topic), "%s/sensor/%s/state", 
-             CONFIG_MQTT_BASE_TOPIC, sensor_id);
-    snprintf(payload, sizeof(payload), "%.2f", temperature);
+    mqtt_state_topic(topic, sizeof(topic), &node, sensor_id, "state");
+    mqtt_state_payload(payload, sizeof(payload), temperature, 2);
 
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, payload, 0, 1, 0);
+    int msg_id = client_publish_value(topic, payload);
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish temperature for %s", sensor_id);
         return ESP_FAIL;
@@ -159,7 +961,98 @@ esp_err_t mqtt_ha_publish_temperature(const char *sensor_id, const char *friendl
     return ESP_OK;
 }
 
-esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_name)
+esp_err_t mqtt_ha_publish_alert(const char *payload)
+{
+    if (s_mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    char topic[128];
+    snprintf(topic, sizeof(topic), "%s/alert", CONFIG_MQTT_BASE_TOPIC);
+
+    /* Enqueue rather than publish so the read loop never blocks on the socket.
+     * Also while disconnected: the outbox keeps the alert and sends it on
+     * reconnect. */
+    int msg_id = client_enqueue(topic, payload, 0, 1, 0, true);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to publish alert");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Published alert: %s", payload);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_ha_publish_trend(const char *sensor_id, float slope_per_min, float predicted)
+{
+    if (!s_connected || s_mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    char topic[MQTT_TOPIC_LEN];
+    char payload[32];
+    mqtt_node_t node = ha_node();
+
+    mqtt_state_topic(topic, sizeof(topic), &node, sensor_id, "trend");
+    mqtt_state_payload(payload, sizeof(payload), slope_per_min, 3);
+    int msg_id = client_publish_value(topic, payload);
+
+    mqtt_state_topic(topic, sizeof(topic), &node, sensor_id, "forecast");
+    mqtt_state_payload(payload, sizeof(payload), predicted, 2);
+    if (msg_id < 0 || client_publish_value(topic, payload) < 0) {
+        ESP_LOGE(TAG, "Failed to publish trend for %s", sensor_id);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_HA_DISCOVERY_ENABLED && CONFIG_HA_TREND_ENTITIES
+/**
+ * @brief Register the trend (°C/min) and forecast (°C) entities of a sensor
+ */
+static void register_trend_entities(const char *sensor_id, const char *friendly_name)
+{
+    static const struct {
+        const char *suffix;
+        const char *label;
+        const char *unit;
+        const char *device_class;   /* NULL = none */
+    } entities[] = {
+        { "trend", "trend", "°C/min", NULL },
+        { "forecast", "forecast", "°C", "temperature" },
+    };
+
+    mqtt_node_t node = ha_node();
+    for (int i = 0; i < 2; i++) {
+        char discovery_topic[MQTT_DISCOVERY_TOPIC_LEN];
+        mqtt_discovery_topic(discovery_topic, sizeof(discovery_topic), &node, sensor_id,
+                             entities[i].suffix);
+
+        char name[96];
+        snprintf(name, sizeof(name), "%s %s", friendly_name, entities[i].label);
+        mqtt_entity_t entity = {
+            .sensor_id = sensor_id,
+            .name = name,
+            .suffix = entities[i].suffix,
+            .unit = entities[i].unit,
+            .device_class = entities[i].device_class,
+            .icon = "mdi:chart-line-variant",
+        };
+
+        char *payload = malloc(MQTT_DISCOVERY_PAYLOAD_LEN);
+        if (payload != NULL &&
+            mqtt_discovery_payload(payload, MQTT_DISCOVERY_PAYLOAD_LEN, &node, &entity) > 0) {
+            client_publish(discovery_topic, payload, 0, 1, 1);
+        }
+        free(payload);
+    }
+}
+#endif
+
+/**
+ * @brief Announce a temperature entity, physical or virtual
+ */
+static esp_err_t register_temperature_sensor(const char *sensor_id, const char *friendly_name, bool with_trend)
 {
 #if CONFIG_HA_DISCOVERY_ENABLED
     if (!s_connected || s_mqtt_client == NULL) {
@@ -167,61 +1060,26 @@ esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_na
     }
 
     /* Discovery topic: homeassistant/sensor/esp32-poe-temp_sensor_id/config */
-    char discovery_topic[256];
-    snprintf(discovery_topic, sizeof(discovery_topic), 
-             "%s/sensor/%s_%s/config",
-             CONFIG_HA_DISCOVERY_PREFIX, CONFIG_MQTT_BASE_TOPIC, sensor_id);
+    mqtt_node_t node = ha_node();
+    char discovery_topic[MQTT_DISCOVERY_TOPIC_LEN];
+    mqtt_discovery_topic(discovery_topic, sizeof(discovery_topic), &node, sensor_id, NULL);
 
-    /* Build discovery payload using cJSON */
-    cJSON *root = cJSON_CreateObject();
-    
-    /* Basic info */
-    cJSON_AddStringToObject(root, "name", friendly_name);
-    
-    /* Unique ID */
-    char unique_id[64];
-    snprintf(unique_id, sizeof(unique_id), "%s_%s", CONFIG_MQTT_BASE_TOPIC, sensor_id);
-    cJSON_AddStringToObject(root, "unique_id", unique_id);
-    
-    /* State topic */
-    char state_topic[128];
-    snprintf(state_topic, sizeof(state_topic), "%s/sensor/%s/state", 
-             CONFIG_MQTT_BASE_TOPIC, sensor_id);
-    cJSON_AddStringToObject(root, "state_topic", state_topic);
-    
-    /* Availability */
-    char availability_topic[128];
-    snprintf(availability_topic, sizeof(availability_topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
-    cJSON_AddStringToObject(root, "availability_topic", availability_topic);
-    
-    /* Device class and unit */
-    cJSON_AddStringToObject(root, "device_class", "temperature");
-    cJSON_AddStringToObject(root, "unit_of_measurement", "°C");
-    cJSON_AddStringToObject(root, "state_class", "measurement");
-    
-    /* Device info (groups all sensors under one device) */
-    cJSON *device = cJSON_CreateObject();
-    cJSON_AddStringToObject(device, "name", "Thermux");
-    cJSON_AddStringToObject(device, "manufacturer", "Custom");
-    cJSON_AddStringToObject(device, "model", "ESP32-POE-ISO");
-    cJSON_AddStringToObject(device, "sw_version", APP_VERSION);
-    
-    cJSON *identifiers = cJSON_CreateArray();
-    cJSON_AddItemToArray(identifiers, cJSON_CreateString(CONFIG_MQTT_BASE_TOPIC));
-    cJSON_AddItemToObject(device, "identifiers", identifiers);
-    
-    cJSON_AddItemToObject(root, "device", device);
-
-    char *payload = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    if (payload == NULL) {
+    /* Grouped under one device with all the node's sensors */
+    mqtt_entity_t entity = {
+        .sensor_id = sensor_id,
+        .name = friendly_name,
+        .unit = "°C",
+        .device_class = "temperature",
+    };
+    char *payload = malloc(MQTT_DISCOVERY_PAYLOAD_LEN);
+    if (payload == NULL ||
+        mqtt_discovery_payload(payload, MQTT_DISCOVERY_PAYLOAD_LEN, &node, &entity) < 0) {
+        free(payload);
         ESP_LOGE(TAG, "Failed to create discovery payload");
         return ESP_ERR_NO_MEM;
     }
 
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, discovery_topic, 
-                                          payload, 0, 1, 1);
+    int msg_id = client_publish(discovery_topic, payload, 0, 1, 1);
     free(payload);
 
     if (msg_id < 0) {
@@ -229,6 +1087,12 @@ esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_na
         return ESP_FAIL;
     }
 
+#if CONFIG_HA_TREND_ENTITIES
+    if (with_trend) {
+        register_trend_entities(sensor_id, friendly_name);
+    }
+#endif
+
     ESP_LOGD(TAG, "Registered sensor with HA: %s (%s)", friendly_name, sensor_id);
     return ESP_OK;
 #else
@@ -236,18 +1100,79 @@ esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_na
 #endif
 }
 
+esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_name)
+{
+    return register_temperature_sensor(sensor_id, friendly_name, true);
+}
+
+esp_err_t mqtt_ha_register_virtual_sensor(const char *sensor_id, const char *friendly_name)
+{
+    /* Trends are only tracked for physical sensors */
+    return register_temperature_sensor(sensor_id, friendly_name, false);
+}
+
+esp_err_t mqtt_ha_unregister_sensor(const char *sensor_id)
+{
+#if CONFIG_HA_DISCOVERY_ENABLED
+    if (!s_connected || s_mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* An empty retained config removes the entity */
+    mqtt_node_t node = ha_node();
+    char discovery_topic[MQTT_DISCOVERY_TOPIC_LEN];
+    mqtt_discovery_topic(discovery_topic, sizeof(discovery_topic), &node, sensor_id, NULL);
+    if (client_publish(discovery_topic, "", 0, 1, 1) < 0) {
+        ESP_LOGE(TAG, "Failed to remove discovery for %s", sensor_id);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGD(TAG, "Removed sensor from HA: %s", sensor_id);
+    return ESP_OK;
+#else
+    return ESP_OK;
+#endif
+}
+
 esp_err_t mqtt_ha_publish_status(bool online)
 {
     if (s_mqtt_client == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    char topic[128];
-    snprintf(topic, sizeof(topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+#if CONFIG_SPARKPLUG_ENABLED
+    /* Online is a birth certificate, offline a death certificate */
+    int count = 0;
+    managed_sensor_t *sensors = NULL;
+    if (online) {
+        sensors = spb_copy_sensors(&count);
+        if (sensors == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    int spb_msg_id = -1;
+    if (online) {
+        spb_msg_id = spb_publish_birth_locked(sensors, count);
+    } else {
+        char spb_topic_buf[128];
+        uint8_t death[48];
+        spb_topic(spb_topic_buf, sizeof(spb_topic_buf), "NDEATH");
+        size_t len = spb_encode_death(death, sizeof(death), s_bdseq[s_active_slot]);
+        spb_msg_id = publish_locked(s_mqtt_client, s_v5[s_active_slot], spb_topic_buf,
+                                    (const char *)death, (int)len, 1, 0, false);
+    }
+    xSemaphoreGive(s_publish_lock);
+    free(sensors);
+    return spb_msg_id < 0 ? ESP_FAIL : ESP_OK;
+#else
+    char topic[MQTT_TOPIC_LEN];
+    mqtt_node_t node = ha_node();
+    mqtt_status_topic(topic, sizeof(topic), &node);
 
     const char *payload = online ? "online" : "offline";
     
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, payload, 0, 1, 1);
+    int msg_id = client_publish(topic, payload, 0, 1, 1);
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish status");
         return ESP_FAIL;
@@ -255,19 +1180,26 @@ esp_err_t mqtt_ha_publish_status(bool online)
 
     ESP_LOGD(TAG, "Published status: %s", payload);
     return ESP_OK;
+#endif
 }
 
 esp_err_t mqtt_ha_publish_discovery_all(void)
 {
 #if CONFIG_HA_DISCOVERY_ENABLED
-    int count;
-    const managed_sensor_t *sensors = sensor_manager_get_sensors(&count);
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
     
     for (int i = 0; i < count; i++) {
         const char *name = sensors[i].has_friendly_name ? 
                            sensors[i].friendly_name : sensors[i].address_str;
         mqtt_ha_register_sensor(sensors[i].address_str, name);
     }
+    free(sensors);
+
+    virtual_sensor_register_all();
     
     /* Register diagnostic entities */
     mqtt_ha_register_diagnostic_entities();
@@ -337,7 +1269,7 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: Ethernet status");
         }
@@ -376,7 +1308,7 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: WiFi status");
         }
@@ -413,7 +1345,7 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: IP Address");
         }
@@ -452,7 +1384,7 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: Bus Error Rate");
         }
@@ -490,7 +1422,7 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: Bus Total Reads");
         }
@@ -528,18 +1460,136 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void)
         cJSON_Delete(root);
         
         if (payload) {
-            esp_mqtt_client_publish(s_mqtt_client, discovery_topic, payload, 0, 1, 1);
+            client_publish(discovery_topic, payload, 0, 1, 1);
             free(payload);
             ESP_LOGD(TAG, "Registered diagnostic: Bus Failed Reads");
         }
     }
 
+    /* Register windowed Bus Error Rate sensors */
+    static const char *span_labels[HEALTH_SPAN_COUNT] = { "1 min", "1 h", "24 h" };
+    for (int span = 0; span < HEALTH_SPAN_COUNT; span++) {
+        char discovery_topic[256];
+        snprintf(discovery_topic, sizeof(discovery_topic),
+                 "%s/sensor/%s_bus_error_rate_%s/config",
+                 CONFIG_HA_DISCOVERY_PREFIX, CONFIG_MQTT_BASE_TOPIC, health_span_name(span));
+
+        cJSON *root = cJSON_CreateObject();
+        char name[48];
+        snprintf(name, sizeof(name), "Bus Error Rate (%s)", span_labels[span]);
+        cJSON_AddStringToObject(root, "name", name);
+
+        char unique_id[64];
+        snprintf(unique_id, sizeof(unique_id), "%s_bus_error_rate_%s", CONFIG_MQTT_BASE_TOPIC, health_span_name(span));
+        cJSON_AddStringToObject(root, "unique_id", unique_id);
+
+        char state_topic[128];
+        snprintf(state_topic, sizeof(state_topic), "%s/diagnostic/bus_error_rate_%s",
+                 CONFIG_MQTT_BASE_TOPIC, health_span_name(span));
+        cJSON_AddStringToObject(root, "state_topic", state_topic);
+
+        char availability_topic[128];
+        snprintf(availability_topic, sizeof(availability_topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+        cJSON_AddStringToObject(root, "availability_topic", availability_topic);
+
+        cJSON_AddStringToObject(root, "icon", "mdi:alert-circle-outline");
+        cJSON_AddStringToObject(root, "entity_category", "diagnostic");
+        cJSON_AddStringToObject(root, "unit_of_measurement", "%");
+        cJSON_AddStringToObject(root, "state_class", "measurement");
+
+        cJSON_AddItemToObject(root, "device", create_device_info());
+
+        char *payload = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+
+        if (payload) {
+            client_publish(discovery_topic, payload, 0, 1, 1);
+            free(payload);
+            ESP_LOGD(TAG, "Registered diagnostic: %s", name);
+        }
+    }
+
+    /* Register Bus Fault sensor */
+    {
+        char discovery_topic[256];
+        snprintf(discovery_topic, sizeof(discovery_topic),
+                 "%s/sensor/%s_bus_fault/config",
+                 CONFIG_HA_DISCOVERY_PREFIX, CONFIG_MQTT_BASE_TOPIC);
+
+        cJSON *root = cJSON_CreateObject();
+        cJSON_AddStringToObject(root, "name", "Bus Fault");
+
+        char unique_id[64];
+        snprintf(unique_id, sizeof(unique_id), "%s_bus_fault", CONFIG_MQTT_BASE_TOPIC);
+        cJSON_AddStringToObject(root, "unique_id", unique_id);
+
+        char state_topic[128];
+        snprintf(state_topic, sizeof(state_topic), "%s/diagnostic/bus_fault", CONFIG_MQTT_BASE_TOPIC);
+        cJSON_AddStringToObject(root, "state_topic", state_topic);
+
+        char availability_topic[128];
+        snprintf(availability_topic, sizeof(availability_topic), "%s/status", CONFIG_MQTT_BASE_TOPIC);
+        cJSON_AddStringToObject(root, "availability_topic", availability_topic);
+
+        cJSON_AddStringToObject(root, "icon", "mdi:map-marker-alert");
+        cJSON_AddStringToObject(root, "entity_category", "diagnostic");
+
+        cJSON_AddItemToObject(root, "device", create_device_info());
+
+        char *payload = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+
+        if (payload) {
+            client_publish(discovery_topic, payload, 0, 1, 1);
+            free(payload);
+            ESP_LOGD(TAG, "Registered diagnostic: Bus Fault");
+        }
+    }
+
     return ESP_OK;
 #else
     return ESP_OK;
 #endif
 }
 
+/**
+ * @brief Describe a localization result for the Bus Fault entity
+ */
+static void describe_fault(const health_fault_t *fault, bool degraded, char *buf, size_t len)
+{
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    int count = sensors != NULL ? sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS) : 0;
+    const char *name = "";
+    const char *upstream = "the controller";
+    if (fault->sensor >= 0 && fault->sensor < count) {
+        const managed_sensor_t *s = &sensors[fault->sensor];
+        name = s->has_friendly_name ? s->friendly_name : s->address_str;
+    }
+    if (fault->upstream >= 0 && fault->upstream < count) {
+        const managed_sensor_t *s = &sensors[fault->upstream];
+        upstream = s->has_friendly_name ? s->friendly_name : s->address_str;
+    }
+
+    switch (fault->kind) {
+    case HEALTH_FAULT_SENSOR:
+        snprintf(buf, len, "Sensor %s", name);
+        break;
+    case HEALTH_FAULT_SEGMENT:
+        snprintf(buf, len, "Cable between %s and %s", upstream, name);
+        break;
+    case HEALTH_FAULT_BUS:
+        snprintf(buf, len, "Whole bus");
+        break;
+    case HEALTH_FAULT_SCATTERED:
+        snprintf(buf, len, "Scattered");
+        break;
+    default:
+        snprintf(buf, len, degraded ? "Unknown" : "OK");
+        break;
+    }
+    free(sensors);
+}
+
 esp_err_t mqtt_ha_publish_diagnostics(void)
 {
     if (!s_connected || s_mqtt_client == NULL) {
@@ -551,12 +1601,12 @@ esp_err_t mqtt_ha_publish_diagnostics(void)
     /* Publish Ethernet status */
     bool eth_connected = ethernet_manager_is_connected();
     snprintf(topic, sizeof(topic), "%s/diagnostic/ethernet", CONFIG_MQTT_BASE_TOPIC);
-    esp_mqtt_client_publish(s_mqtt_client, topic, eth_connected ? "ON" : "OFF", 0, 1, 0);
+    client_publish(topic, eth_connected ? "ON" : "OFF", 0, 1, 0);
     
     /* Publish WiFi status */
     bool wifi_connected = wifi_manager_is_connected();
     snprintf(topic, sizeof(topic), "%s/diagnostic/wifi", CONFIG_MQTT_BASE_TOPIC);
-    esp_mqtt_client_publish(s_mqtt_client, topic, wifi_connected ? "ON" : "OFF", 0, 1, 0);
+    client_publish(topic, wifi_connected ? "ON" : "OFF", 0, 1, 0);
     
     /* Publish IP Address (prefer Ethernet, fallback to WiFi) */
     const char *ip = "";
@@ -566,7 +1616,7 @@ esp_err_t mqtt_ha_publish_diagnostics(void)
         ip = wifi_manager_get_ip();
     }
     snprintf(topic, sizeof(topic), "%s/diagnostic/ip", CONFIG_MQTT_BASE_TOPIC);
-    esp_mqtt_client_publish(s_mqtt_client, topic, ip, 0, 1, 0);
+    client_publish(topic, ip, 0, 1, 0);
     
     ESP_LOGD(TAG, "Published diagnostics: eth=%d, wifi=%d, ip=%s", eth_connected, wifi_connected, ip);
 
@@ -577,19 +1627,35 @@ esp_err_t mqtt_ha_publish_diagnostics(void)
     char value_buf[32];
     snprintf(topic, sizeof(topic), "%s/diagnostic/bus_error_rate", CONFIG_MQTT_BASE_TOPIC);
     snprintf(value_buf, sizeof(value_buf), "%.2f", total_reads > 0 ? (double)failed_reads / total_reads * 100.0 : 0.0);
-    esp_mqtt_client_publish(s_mqtt_client, topic, value_buf, 0, 1, 0);
+    client_publish(topic, value_buf, 0, 1, 0);
     
     snprintf(topic, sizeof(topic), "%s/diagnostic/bus_total_reads", CONFIG_MQTT_BASE_TOPIC);
     snprintf(value_buf, sizeof(value_buf), "%lu", (unsigned long)total_reads);
-    esp_mqtt_client_publish(s_mqtt_client, topic, value_buf, 0, 1, 0);
+    client_publish(topic, value_buf, 0, 1, 0);
     
     snprintf(topic, sizeof(topic), "%s/diagnostic/bus_failed_reads", CONFIG_MQTT_BASE_TOPIC);
     snprintf(value_buf, sizeof(value_buf), "%lu", (unsigned long)failed_reads);
-    esp_mqtt_client_publish(s_mqtt_client, topic, value_buf, 0, 1, 0);
+    client_publish(topic, value_buf, 0, 1, 0);
     
     ESP_LOGD(TAG, "Published bus stats: total=%lu, failed=%lu, rate=%.2f%%", 
              (unsigned long)total_reads, (unsigned long)failed_reads,
              total_reads > 0 ? (double)failed_reads / total_reads * 100.0 : 0.0);
 
+    /* Publish windowed error rates and the likely fault location */
+    health_counts_t bus;
+    health_fault_t fault;
+    bool degraded = sensor_manager_get_health(&bus, NULL, &fault);
+    for (int span = 0; span < HEALTH_SPAN_COUNT; span++) {
+        snprintf(topic, sizeof(topic), "%s/diagnostic/bus_error_rate_%s", CONFIG_MQTT_BASE_TOPIC,
+                 health_span_name(span));
+        snprintf(value_buf, sizeof(value_buf), "%.2f", health_error_percent(bus.reads[span], bus.failed[span]));
+        client_publish(topic, value_buf, 0, 1, 0);
+    }
+
+    char fault_buf[96];
+    describe_fault(&fault, degraded, fault_buf, sizeof(fault_buf));
+    snprintf(topic, sizeof(topic), "%s/diagnostic/bus_fault", CONFIG_MQTT_BASE_TOPIC);
+    client_publish(topic, fault_buf, 0, 1, 0);
+
     return ESP_OK;
 }
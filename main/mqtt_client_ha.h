@@ -10,10 +10,40 @@
 #include <stdbool.h>
 
 /**
- * @brief Initialize MQTT client
+ * @brief State of a broker switch started by mqtt_ha_reconfigure()
+ */
+typedef enum {
+    MQTT_SWITCH_IDLE = 0,       /**< No switch, or the last one completed */
+    MQTT_SWITCH_PENDING,        /**< New connection being brought up */
+    MQTT_SWITCH_FAILED,         /**< New broker unreachable, old connection kept */
+} mqtt_switch_state_t;
+
+/**
+ * @brief Initialize and start the MQTT client
  */
 esp_err_t mqtt_ha_init(void);
 
+/**
+ * @brief Apply the stored broker settings without a gap in publishing
+ *
+ * Unchanged settings are a no-op (a disconnected client only retries at
+ * once). Otherwise a second client connects with the new settings in the
+ * background; the switch happens only once it is connected, then the old
+ * client delivers its outbox and is destroyed. If the new broker cannot be
+ * reached, the old connection stays in use.
+ *
+ * @param changed Set to true if a switch was started
+ * @return ESP_ERR_INVALID_STATE if a switch is already in progress
+ */
+esp_err_t mqtt_ha_reconfigure(bool *changed);
+
+/**
+ * @brief Get the state of the last broker switch
+ */
+mqtt_switch_state_t mqtt_ha_get_switch_state(void);
+
+const char *mqtt_ha_switch_state_name(mqtt_switch_state_t state);
+
 /**
  * @brief Start MQTT client connection
  */
@@ -24,6 +54,14 @@ esp_err_t mqtt_ha_start(void);
  */
 esp_err_t mqtt_ha_stop(void);
 
+/**
+ * @brief Protocol of the active connection ("5" or "3.1.1")
+ *
+ * With CONFIG_MQTT_USE_V5 the client asks for MQTT 5 and falls back to
+ * 3.1.1 if the broker refuses it.
+ */
+const char *mqtt_ha_get_protocol(void);
+
 /**
  * @brief Check if MQTT is connected
  */
@@ -37,6 +75,24 @@ bool mqtt_ha_is_connected(void);
  */
 esp_err_t mqtt_ha_publish_temperature(const char *sensor_id, const char *friendly_name, float temperature);
 
+/**
+ * @brief Publish an alert transition
+ *
+ * Sent immediately on <base>/alert with QoS 1 (not retained), independent of
+ * the periodic publish interval. While the broker is unreachable the alert
+ * waits in the client's outbox (until the outbox expiry) and goes out on
+ * reconnect.
+ *
+ * @param payload JSON alert payload
+ */
+esp_err_t mqtt_ha_publish_alert(const char *payload);
+
+/**
+ * @brief Publish a sensor's trend (<base>/sensor/<id>/trend, °C/min) and
+ *        forecast (<base>/sensor/<id>/forecast, °C)
+ */
+esp_err_t mqtt_ha_publish_trend(const char *sensor_id, float slope_per_min, float predicted);
+
 /**
  * @brief Register sensor with Home Assistant discovery
  * @param sensor_id Unique sensor ID (address string)
@@ -44,6 +100,18 @@ esp_err_t mqtt_ha_publish_temperature(const char *sensor_id, const char *friendl
  */
 esp_err_t mqtt_ha_register_sensor(const char *sensor_id, const char *friendly_name);
 
+/**
+ * @brief Register a virtual sensor with Home Assistant discovery
+ *
+ * Same temperature entity as a physical sensor, without trend entities.
+ */
+esp_err_t mqtt_ha_register_virtual_sensor(const char *sensor_id, const char *friendly_name);
+
+/**
+ * @brief Remove a sensor's Home Assistant entity (empty retained config)
+ */
+esp_err_t mqtt_ha_unregister_sensor(const char *sensor_id);
+
 /**
  * @brief Publish device status
  * @param online True if device is online
@@ -66,4 +134,14 @@ esp_err_t mqtt_ha_register_diagnostic_entities(void);
  */
 esp_err_t mqtt_ha_publish_diagnostics(void);
 
+/**
+ * @brief Publish Sparkplug B NDATA with the metrics that changed
+ *
+ * Sends a new NBIRTH instead when the connection has not had one yet or
+ * sensors were added, removed or renamed since the last one.
+ *
+ * @return ESP_ERR_NOT_SUPPORTED unless CONFIG_SPARKPLUG_ENABLED
+ */
+esp_err_t mqtt_ha_publish_sparkplug_data(void);
+
 #endif /* MQTT_CLIENT_HA_H */
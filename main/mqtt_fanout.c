@@ -0,0 +1,445 @@
+/**
+ * @file mqtt_fanout.c
+ * @brief Publish readings to additional MQTT brokers
+ */
+
+#include "mqtt_fanout.h"
+#include "fanout_queue.h"
+#include "mqtt_tls.h"
+#include "mqtt_client.h"
+#include "sensor_manager.h"
+#include "virtual_sensor.h"
+#include "nvs_storage.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "mqtt_fanout";
+
+#define TARGET_TASK_STACK_SIZE 3072
+#define TARGET_POLL_MS         1000     /* Outbox re-check while over budget */
+
+#if CONFIG_MQTT_FANOUT_TARGETS > 0
+
+/**
+ * @brief A target's settings, client and health
+ *
+ * The target's task owns the client: it creates, uses and destroys it.
+ * Other tasks only change the settings and notify it.
+ */
+typedef struct {
+    int index;
+    mqtt_target_config_t cfg;
+    mqtt_target_config_t active;    /* What the client runs with; task only */
+    bool configured;
+    bool restart;               /* Settings changed, recreate the client */
+    TaskHandle_t task;
+    esp_mqtt_client_handle_t client;
+    fanout_queue_t queue;
+    char client_id[64];
+    char status_topic[96];
+    uint32_t resume_seq;        /* Batch partly handed to the client; task only */
+    int resume_at;              /* Its first reading not handed over */
+
+    volatile bool connected;
+    volatile uint32_t session;  /* Bumped by every connect */
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t published;
+    uint32_t failed;
+    int outbox_bytes;           /* As last seen by the task */
+    int64_t last_publish_ms;
+} target_t;
+
+/* Guards every target's settings, queue, counters and the batch references */
+static SemaphoreHandle_t s_lock = NULL;
+static target_t s_targets[CONFIG_MQTT_FANOUT_TARGETS];
+static uint32_t s_seq = 0;
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static const char *prefix_of(const mqtt_target_config_t *cfg)
+{
+    return cfg->prefix[0] ? cfg->prefix : CONFIG_MQTT_BASE_TOPIC;
+}
+
+static void target_event_handler(void *handler_args, esp_event_base_t base,
+                                 int32_t event_id, void *event_data)
+{
+    target_t *t = handler_args;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "Target %d connected", t->index);
+        t->connected = true;
+        t->session++;
+        t->connects++;
+        xTaskNotifyGive(t->task);
+        break;
+
+    case MQTT_EVENT_DISCONNECTED:
+        if (t->connected) {
+            ESP_LOGW(TAG, "Target %d disconnected", t->index);
+            t->disconnects++;
+        }
+        t->connected = false;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief (Re)create the client from the current settings; target task only
+ */
+static void target_connect(target_t *t)
+{
+    if (t->client != NULL) {
+        /* Stops with a DISCONNECT, so the broker drops the last will */
+        esp_mqtt_client_destroy(t->client);
+        t->client = NULL;
+        t->connected = false;
+        t->resume_seq = 0;      /* Its outbox went with it */
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    t->restart = false;
+    bool configured = t->configured;
+    t->active = t->cfg;
+    if (!configured) {
+        fanout_queue_clear(&t->queue);
+    } else {
+        t->queue.budget = t->active.budget;
+    }
+    xSemaphoreGive(s_lock);
+    const mqtt_target_config_t *cfg = &t->active;
+    if (!configured) {
+        return;
+    }
+
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(t->client_id, sizeof(t->client_id), "%s-%02x%02x%02x-t%d", CONFIG_MQTT_BASE_TOPIC,
+             mac[3], mac[4], mac[5], t->index);
+    snprintf(t->status_topic, sizeof(t->status_topic), "%s/status", prefix_of(cfg));
+
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.uri = cfg->uri,
+        .credentials.username = cfg->username[0] ? cfg->username : NULL,
+        .credentials.client_id = t->client_id,
+        .credentials.authentication.password = cfg->password[0] ? cfg->password : NULL,
+        .session.last_will.topic = t->status_topic,
+        .session.last_will.msg = "offline",
+        .session.last_will.msg_len = 7,
+        .session.last_will.qos = 1,
+        .session.last_will.retain = 1,
+        .network.transport = mqtt_tls_create_transport(cfg->uri),
+    };
+    mqtt_tls_configure(&mqtt_cfg);
+    t->client = esp_mqtt_client_init(&mqtt_cfg);
+    if (t->client == NULL) {
+        ESP_LOGE(TAG, "Failed to create client for target %d", t->index);
+        return;
+    }
+    esp_mqtt_client_register_event(t->client, ESP_EVENT_ANY_ID, target_event_handler, t);
+    esp_mqtt_client_start(t->client);
+    ESP_LOGI(TAG, "Target %d: %s (%s, QoS %u)", t->index, cfg->uri,
+             mqtt_fanout_scheme_name(cfg->scheme), cfg->qos);
+}
+
+/**
+ * @brief Hand one cycle to the client; never blocks on the socket
+ *
+ * Per-sensor readings go out one message each. If the client refuses one,
+ * the retry of the batch starts there, so readings already handed over are
+ * not sent twice.
+ */
+static bool target_publish(target_t *t, const fanout_batch_t *b)
+{
+    char topic[160];
+    int qos = t->active.qos;
+
+    if (t->active.scheme == MQTT_TARGET_SCHEME_SENSOR) {
+        int start = t->resume_seq == b->seq ? t->resume_at : 0;
+        for (int i = start; i < b->count; i++) {
+            const fanout_reading_t *r = &b->readings[i];
+            if (r->value[0] == '\0') {
+                continue;
+            }
+            snprintf(topic, sizeof(topic), "%s/sensor/%s/state", prefix_of(&t->active), r->id);
+            if (esp_mqtt_client_enqueue(t->client, topic, r->value, 0, qos, 0, true) < 0) {
+                t->resume_seq = b->seq;
+                t->resume_at = i;
+                return false;
+            }
+        }
+        t->resume_seq = 0;
+        return true;
+    }
+
+    snprintf(topic, sizeof(topic), "%s/readings", prefix_of(&t->active));
+    return esp_mqtt_client_enqueue(t->client, topic, b->json, (int)b->json_len, qos, 0, true) >= 0;
+}
+
+/**
+ * @brief Drain the target's queue while its broker keeps up
+ */
+static void target_task(void *arg)
+{
+    target_t *t = arg;
+    uint32_t announced = 0;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TARGET_POLL_MS));
+        if (t->restart) {
+            target_connect(t);
+            announced = t->session;
+        }
+        if (t->client == NULL || !t->connected) {
+            t->outbox_bytes = 0;
+            continue;
+        }
+        if (announced != t->session) {
+            esp_mqtt_client_enqueue(t->client, t->status_topic, "online", 0, 1, 1, true);
+            announced = t->session;
+        }
+
+        while (t->connected && !t->restart) {
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            fanout_batch_t *b = fanout_queue_peek(&t->queue);
+            if (b != NULL) {
+                fanout_batch_ref(b);
+            }
+            size_t budget = t->queue.budget;
+            xSemaphoreGive(s_lock);
+            if (b == NULL) {
+                break;
+            }
+
+            /* Leave it queued until the broker has caught up */
+            int outbox = esp_mqtt_client_get_outbox_size(t->client);
+            t->outbox_bytes = outbox;
+            bool fits = outbox == 0 || (size_t)outbox + b->json_len <= budget;
+            bool ok = fits && target_publish(t, b);
+
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            if (ok) {
+                /* Unless the budget dropped it meanwhile */
+                if (fanout_queue_peek(&t->queue) == b) {
+                    fanout_queue_pop(&t->queue);
+                }
+                t->published++;
+                t->last_publish_ms = now_ms();
+            } else if (fits) {
+                t->failed++;
+            }
+            fanout_batch_release(b);
+            xSemaphoreGive(s_lock);
+            if (!ok) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Apply new settings; the target's task reconnects
+ */
+static esp_err_t target_apply(target_t *t, const mqtt_target_config_t *cfg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    t->configured = cfg != NULL;
+    if (cfg != NULL) {
+        t->cfg = *cfg;
+    }
+    t->restart = true;
+    xSemaphoreGive(s_lock);
+
+    if (t->task == NULL) {
+        if (cfg == NULL) {
+            return ESP_OK;
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "mqtt_tgt%d", t->index);
+        if (xTaskCreate(target_task, name, TARGET_TASK_STACK_SIZE, t, 3, &t->task) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xTaskNotifyGive(t->task);
+    return ESP_OK;
+}
+
+esp_err_t mqtt_fanout_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < CONFIG_MQTT_FANOUT_TARGETS; i++) {
+        target_t *t = &s_targets[i];
+        t->index = i;
+        t->last_publish_ms = -1;
+        fanout_queue_init(&t->queue, 0);
+
+        mqtt_target_config_t cfg;
+        if (nvs_storage_load_mqtt_target(i, &cfg) == ESP_OK && cfg.uri[0]) {
+            esp_err_t err = target_apply(t, &cfg);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+void mqtt_fanout_publish_cycle(void)
+{
+    if (s_lock == NULL) {
+        return;
+    }
+
+    bool any = false;
+    for (int i = 0; i < CONFIG_MQTT_FANOUT_TARGETS; i++) {
+        any |= s_targets[i].configured;
+    }
+    if (!any) {
+        return;
+    }
+
+    /* Only the publish task calls this, so the ids may be static */
+    static managed_sensor_t sensors[CONFIG_MAX_SENSORS];
+    static fanout_input_t inputs[CONFIG_MAX_SENSORS + CONFIG_VIRTUAL_SENSORS_MAX];
+    static char virtual_ids[CONFIG_VIRTUAL_SENSORS_MAX][FANOUT_ID_LEN];
+    int n = 0;
+    int64_t sample_time = 0;
+
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+    for (int i = 0; i < count && i < CONFIG_MAX_SENSORS; i++) {
+        inputs[n++] = (fanout_input_t){ .id = sensors[i].address_str,
+                                        .value = sensors[i].hw_sensor.temperature,
+                                        .valid = sensors[i].hw_sensor.valid };
+        if (sensors[i].hw_sensor.sample_time > sample_time) {
+            sample_time = sensors[i].hw_sensor.sample_time;
+        }
+    }
+    for (int slot = 0; slot < CONFIG_VIRTUAL_SENSORS_MAX; slot++) {
+        virtual_sensor_t vs;
+        if (!virtual_sensor_get(slot, &vs)) {
+            continue;
+        }
+        if (snprintf(virtual_ids[slot], FANOUT_ID_LEN, "%s%s", VIRTUAL_SENSOR_ID_PREFIX,
+                     vs.cfg.id) >= FANOUT_ID_LEN) {
+            ESP_LOGW(TAG, "Virtual sensor id %s too long, not published", vs.cfg.id);
+            continue;
+        }
+        inputs[n++] = (fanout_input_t){ .id = virtual_ids[slot], .value = vs.value, .valid = vs.valid };
+    }
+
+    fanout_batch_t *b = fanout_batch_create(++s_seq, now_ms(), sample_time, inputs, n);
+    if (b == NULL) {
+        ESP_LOGW(TAG, "No memory for cycle %lu", (unsigned long)s_seq);
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_MQTT_FANOUT_TARGETS; i++) {
+        target_t *t = &s_targets[i];
+        if (t->configured && fanout_queue_push(&t->queue, b) > 0) {
+            ESP_LOGD(TAG, "Target %d over budget, dropped its oldest cycle", i);
+        }
+    }
+    fanout_batch_release(b);
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; i < CONFIG_MQTT_FANOUT_TARGETS; i++) {
+        if (s_targets[i].task != NULL) {
+            xTaskNotifyGive(s_targets[i].task);
+        }
+    }
+}
+
+esp_err_t mqtt_fanout_set_target(int index, const mqtt_target_config_t *cfg)
+{
+    if (index < 0 || index >= CONFIG_MQTT_FANOUT_TARGETS || s_lock == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = cfg != NULL ? nvs_storage_save_mqtt_target(index, cfg)
+                                : nvs_storage_delete_mqtt_target(index);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return target_apply(&s_targets[index], cfg);
+}
+
+esp_err_t mqtt_fanout_get_target(int index, mqtt_target_config_t *cfg, mqtt_target_status_t *status)
+{
+    if (index < 0 || index >= CONFIG_MQTT_FANOUT_TARGETS || s_lock == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    target_t *t = &s_targets[index];
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool configured = t->configured;
+    *cfg = t->cfg;
+    if (status != NULL) {
+        *status = (mqtt_target_status_t){
+            .connected = t->connected,
+            .connects = t->connects,
+            .disconnects = t->disconnects,
+            .published = t->published,
+            .dropped = t->queue.dropped,
+            .failed = t->failed,
+            .queued = t->queue.count,
+            .queued_bytes = t->queue.bytes,
+            .outbox_bytes = t->outbox_bytes,
+            .lag_ms = fanout_queue_lag_ms(&t->queue, now_ms()),
+            .last_publish_ms = t->last_publish_ms,
+        };
+    }
+    xSemaphoreGive(s_lock);
+
+    return configured ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+#else
+
+esp_err_t mqtt_fanout_init(void)
+{
+    return ESP_OK;
+}
+
+void mqtt_fanout_publish_cycle(void)
+{
+}
+
+esp_err_t mqtt_fanout_set_target(int index, const mqtt_target_config_t *cfg)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t mqtt_fanout_get_target(int index, mqtt_target_config_t *cfg, mqtt_target_status_t *status)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+#endif
+
+const char *mqtt_fanout_scheme_name(mqtt_target_scheme_t scheme)
+{
+    switch (scheme) {
+    case MQTT_TARGET_SCHEME_BATCH:  return "batch";
+    case MQTT_TARGET_SCHEME_SENSOR: return "sensor";
+    default:                        return "unknown";
+    }
+}
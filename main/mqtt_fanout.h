@@ -0,0 +1,88 @@
+/**
+ * @file mqtt_fanout.h
+ * @brief Publish readings to additional MQTT brokers
+ *
+ * Besides the Home Assistant broker of mqtt_client_ha.h, up to
+ * CONFIG_MQTT_FANOUT_TARGETS further brokers can receive the readings,
+ * each with its own topic prefix and scheme, QoS and memory budget. Every
+ * publish cycle is serialized once (fanout_queue.h) and queued by
+ * reference for each target. Each target has its own client and task, so
+ * a slow or unreachable broker only delays itself: its queue drops the
+ * oldest cycles once over budget, and its lag shows in the status.
+ */
+
+#ifndef MQTT_FANOUT_H
+#define MQTT_FANOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief What a target publishes each cycle
+ */
+typedef enum {
+    MQTT_TARGET_SCHEME_BATCH = 0,   /**< One JSON document on <prefix>/readings */
+    MQTT_TARGET_SCHEME_SENSOR,      /**< <prefix>/sensor/<id>/state per reading */
+} mqtt_target_scheme_t;
+
+/**
+ * @brief A broker target as stored in NVS
+ */
+typedef struct {
+    char uri[128];
+    char username[64];
+    char password[64];
+    char prefix[64];            /**< Topic prefix, empty = CONFIG_MQTT_BASE_TOPIC */
+    uint8_t scheme;             /**< mqtt_target_scheme_t */
+    uint8_t qos;                /**< 0 or 1 */
+    uint32_t budget;            /**< Bytes queued, and bytes in the client's outbox */
+} mqtt_target_config_t;
+
+/**
+ * @brief Health of a target
+ */
+typedef struct {
+    bool connected;
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t published;         /**< Cycles handed to the client */
+    uint32_t dropped;           /**< Cycles lost to the budget */
+    uint32_t failed;            /**< Publishes the client refused */
+    int queued;                 /**< Cycles waiting */
+    size_t queued_bytes;
+    int outbox_bytes;           /**< Sent but not yet acknowledged, or not yet sent */
+    int64_t lag_ms;             /**< Age of the oldest waiting cycle */
+    int64_t last_publish_ms;    /**< Uptime of the last publish, -1 if none */
+} mqtt_target_status_t;
+
+/**
+ * @brief Load the targets from NVS and connect them
+ */
+esp_err_t mqtt_fanout_init(void);
+
+/**
+ * @brief Serialize the current readings once and queue them for every target
+ *
+ * Never waits for a broker.
+ */
+void mqtt_fanout_publish_cycle(void);
+
+/**
+ * @brief Save a target and reconnect it with the new settings
+ * @param cfg Settings, or NULL to remove the target
+ * @return ESP_ERR_INVALID_ARG if @p index is out of range
+ */
+esp_err_t mqtt_fanout_set_target(int index, const mqtt_target_config_t *cfg);
+
+/**
+ * @brief Get a target's settings and health
+ * @param status Output, may be NULL
+ * @return ESP_ERR_NOT_FOUND if the target is not configured
+ */
+esp_err_t mqtt_fanout_get_target(int index, mqtt_target_config_t *cfg, mqtt_target_status_t *status);
+
+const char *mqtt_fanout_scheme_name(mqtt_target_scheme_t scheme);
+
+#endif /* MQTT_FANOUT_H */
@@ -0,0 +1,153 @@
+/**
+ * @file mqtt_payload.c
+ * @brief Home Assistant topics and payloads of a node (host-testable)
+ */
+
+#include "mqtt_payload.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * @brief Bounded output; overflow sticks so only the end result is checked
+ */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+} writer_t;
+
+static void put_raw(writer_t *w, const char *s, size_t n)
+{
+    if (w->overflow || w->pos + n >= w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->pos, s, n);
+    w->pos += n;
+    w->buf[w->pos] = '\0';
+}
+
+static void put(writer_t *w, const char *s)
+{
+    put_raw(w, s, strlen(s));
+}
+
+/**
+ * @brief Quoted JSON string, escaped as cJSON does (UTF-8 passes through)
+ */
+static void put_string(writer_t *w, const char *s)
+{
+    put(w, "\"");
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        char esc[8];
+        switch (*p) {
+        case '"':  put(w, "\\\""); break;
+        case '\\': put(w, "\\\\"); break;
+        case '\b': put(w, "\\b"); break;
+        case '\f': put(w, "\\f"); break;
+        case '\n': put(w, "\\n"); break;
+        case '\r': put(w, "\\r"); break;
+        case '\t': put(w, "\\t"); break;
+        default:
+            if (*p < 0x20) {
+                snprintf(esc, sizeof(esc), "\\u%04x", *p);
+                put(w, esc);
+            } else {
+                put_raw(w, (const char *)p, 1);
+            }
+            break;
+        }
+    }
+    put(w, "\"");
+}
+
+static void put_member(writer_t *w, const char *key, const char *value)
+{
+    if (w->overflow) {
+        return;
+    }
+    put(w, w->buf[w->pos - 1] == '{' ? "\"" : ",\"");
+    put(w, key);
+    put(w, "\":");
+    put_string(w, value);
+}
+
+static int finish(int written, size_t len)
+{
+    return written < 0 || (size_t)written >= len ? -1 : written;
+}
+
+int mqtt_state_topic(char *buf, size_t len, const mqtt_node_t *node,
+                     const char *sensor_id, const char *kind)
+{
+    return finish(snprintf(buf, len, "%s/sensor/%s/%s", node->base_topic, sensor_id, kind), len);
+}
+
+int mqtt_state_payload(char *buf, size_t len, float value, int decimals)
+{
+    return finish(snprintf(buf, len, "%.*f", decimals, value), len);
+}
+
+int mqtt_status_topic(char *buf, size_t len, const mqtt_node_t *node)
+{
+    return finish(snprintf(buf, len, "%s/status", node->base_topic), len);
+}
+
+int mqtt_discovery_topic(char *buf, size_t len, const mqtt_node_t *node,
+                         const char *sensor_id, const char *suffix)
+{
+    if (suffix != NULL) {
+        return finish(snprintf(buf, len, "%s/sensor/%s_%s_%s/config", node->discovery_prefix,
+                               node->base_topic, sensor_id, suffix), len);
+    }
+    return finish(snprintf(buf, len, "%s/sensor/%s_%s/config", node->discovery_prefix,
+                           node->base_topic, sensor_id), len);
+}
+
+int mqtt_discovery_payload(char *buf, size_t len, const mqtt_node_t *node,
+                           const mqtt_entity_t *entity)
+{
+    writer_t w = { .buf = buf, .len = len };
+    char field[MQTT_TOPIC_LEN];
+
+    if (len == 0) {
+        return -1;
+    }
+    put(&w, "{");
+    put_member(&w, "name", entity->name);
+
+    if (entity->suffix != NULL) {
+        snprintf(field, sizeof(field), "%s_%s_%s", node->base_topic, entity->sensor_id, entity->suffix);
+    } else {
+        snprintf(field, sizeof(field), "%s_%s", node->base_topic, entity->sensor_id);
+    }
+    put_member(&w, "unique_id", field);
+
+    mqtt_state_topic(field, sizeof(field), node, entity->sensor_id,
+                     entity->suffix != NULL ? entity->suffix : "state");
+    put_member(&w, "state_topic", field);
+
+    mqtt_status_topic(field, sizeof(field), node);
+    put_member(&w, "availability_topic", field);
+
+    if (entity->device_class != NULL) {
+        put_member(&w, "device_class", entity->device_class);
+    } else {
+        put_member(&w, "icon", entity->icon);
+    }
+    put_member(&w, "unit_of_measurement", entity->unit);
+    put_member(&w, "state_class", "measurement");
+
+    put(&w, ",\"device\":{");
+    put_member(&w, "name", "Thermux");
+    put_member(&w, "manufacturer", "Custom");
+    put_member(&w, "model", "ESP32-POE-ISO");
+    put_member(&w, "sw_version", node->sw_version);
+    put(&w, ",\"identifiers\":[");
+    put_string(&w, node->base_topic);
+    put(&w, "]}}");
+
+    return w.overflow ? -1 : (int)w.pos;
+}
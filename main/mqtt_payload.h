@@ -0,0 +1,71 @@
+/**
+ * @file mqtt_payload.h
+ * @brief Home Assistant topics and payloads of a node (host-testable)
+ *
+ * Builds the state and discovery messages of the temperature entities
+ * without cJSON, so the host fleet simulator (tools/fleet_sim) sends
+ * byte-for-byte what the firmware does. Discovery payloads keep the key
+ * order and string escaping cJSON_PrintUnformatted() produced.
+ *
+ * All builders return the length written, or -1 if @p len is too small.
+ */
+
+#ifndef MQTT_PAYLOAD_H
+#define MQTT_PAYLOAD_H
+
+#include <stddef.h>
+
+#define MQTT_TOPIC_LEN              128
+#define MQTT_DISCOVERY_TOPIC_LEN    256
+#define MQTT_DISCOVERY_PAYLOAD_LEN  768
+
+/**
+ * @brief Naming shared by every entity of a node
+ */
+typedef struct {
+    const char *discovery_prefix;   /**< "homeassistant" */
+    const char *base_topic;         /**< Also the device identifier */
+    const char *sw_version;
+} mqtt_node_t;
+
+/**
+ * @brief One entity to announce
+ */
+typedef struct {
+    const char *sensor_id;
+    const char *name;
+    const char *suffix;         /**< NULL for the temperature, else "trend" or "forecast" */
+    const char *unit;
+    const char *device_class;   /**< NULL to show @p icon instead */
+    const char *icon;
+} mqtt_entity_t;
+
+/**
+ * @brief <base>/sensor/<id>/<kind>, kind "state", "trend" or "forecast"
+ */
+int mqtt_state_topic(char *buf, size_t len, const mqtt_node_t *node,
+                     const char *sensor_id, const char *kind);
+
+/**
+ * @brief A value as published: plain number with @p decimals places
+ */
+int mqtt_state_payload(char *buf, size_t len, float value, int decimals);
+
+/**
+ * @brief <base>/status (retained "online"/"offline")
+ */
+int mqtt_status_topic(char *buf, size_t len, const mqtt_node_t *node);
+
+/**
+ * @brief <prefix>/sensor/<base>_<id>[_<suffix>]/config
+ */
+int mqtt_discovery_topic(char *buf, size_t len, const mqtt_node_t *node,
+                         const char *sensor_id, const char *suffix);
+
+/**
+ * @brief Discovery config of an entity, grouped under the node's device
+ */
+int mqtt_discovery_payload(char *buf, size_t len, const mqtt_node_t *node,
+                           const mqtt_entity_t *entity);
+
+#endif /* MQTT_PAYLOAD_H */
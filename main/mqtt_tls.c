@@ -0,0 +1,528 @@
+/**
+ * @file mqtt_tls.c
+ * @brief TLS for the MQTT clients: CA, session resumption, cipher order
+ */
+
+#include "mqtt_tls.h"
+#include "nvs_storage.h"
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "mbedtls/ssl_ciphersuites.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "mqtt_tls";
+
+#define MQTTS_DEFAULT_PORT 8883
+/* Brokers whose last session is kept: the main broker across a switch, and the targets */
+#define SESSION_CACHE_LEN  (2 + CONFIG_MQTT_FANOUT_TARGETS)
+
+/**
+ * @brief A CA bundle, shared by the connections using it
+ *
+ * esp-mqtt keeps the pointer it is given for wss:// for the client's
+ * lifetime, so a bundle handed to it is pinned and never freed; that
+ * costs one bundle per CA change, and only while a wss:// broker is used.
+ */
+typedef struct {
+    int refs;
+    bool pinned;
+    int certs;
+    size_t len;                 /**< Without the terminating NUL */
+    char pem[];
+} ca_bundle_t;
+
+typedef struct {
+    char host[64];
+    int port;
+    esp_tls_client_session_t *session;
+    uint32_t used;              /**< For least-recently-used replacement */
+} session_entry_t;
+
+typedef struct {
+    esp_tls_t *tls;
+} tls_transport_t;
+
+static SemaphoreHandle_t s_lock = NULL;
+static ca_bundle_t *s_ca = NULL;                /* NULL = built-in bundle */
+static tls_metrics_t s_metrics;
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+static session_entry_t s_sessions[SESSION_CACHE_LEN];
+static uint32_t s_session_tick;
+#endif
+
+#if CONFIG_MQTT_TLS_PREFER_ECDSA
+/*
+ * ECDSA first: a P-256 signature is far cheaper to check than an RSA one,
+ * and its certificates are smaller. Suites mbedTLS was built without are
+ * skipped, so the list can name more than the build supports.
+ */
+static const int s_ciphersuites[] = {
+#ifdef CONFIG_MBEDTLS_SSL_PROTO_TLS1_3
+    MBEDTLS_TLS1_3_AES_128_GCM_SHA256,
+    MBEDTLS_TLS1_3_AES_256_GCM_SHA384,
+#endif
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA256,
+    0
+};
+#define CIPHERSUITES s_ciphersuites
+#else
+#define CIPHERSUITES NULL
+#endif
+
+static ca_bundle_t *ca_create(const char *pem, size_t len, int certs)
+{
+    ca_bundle_t *ca = malloc(sizeof(*ca) + len + 1);
+    if (ca == NULL) {
+        return NULL;
+    }
+    ca->refs = 1;
+    ca->pinned = false;
+    ca->certs = certs;
+    ca->len = len;
+    memcpy(ca->pem, pem, len);
+    ca->pem[len] = '\0';
+    return ca;
+}
+
+/**
+ * @brief Take a reference to the current bundle, NULL for the built-in one
+ */
+static ca_bundle_t *ca_get(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    ca_bundle_t *ca = s_ca;
+    if (ca != NULL) {
+        ca->refs++;
+    }
+    xSemaphoreGive(s_lock);
+    return ca;
+}
+
+static void ca_put(ca_bundle_t *ca)
+{
+    if (ca == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool last = --ca->refs == 0 && !ca->pinned;
+    xSemaphoreGive(s_lock);
+    if (last) {
+        free(ca);
+    }
+}
+
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+static session_entry_t *session_find(const char *host, int port)
+{
+    for (int i = 0; i < SESSION_CACHE_LEN; i++) {
+        if (s_sessions[i].port == port && strcmp(s_sessions[i].host, host) == 0) {
+            return &s_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Take the cached session for a broker out of the cache
+ *
+ * The connection owns it until its handshake is over, so another client
+ * connecting to the same broker meanwhile does a full handshake rather
+ * than sharing it.
+ */
+static esp_tls_client_session_t *session_take(const char *host, int port)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    session_entry_t *e = session_find(host, port);
+    esp_tls_client_session_t *session = NULL;
+    if (e != NULL) {
+        session = e->session;
+        e->session = NULL;
+    }
+    xSemaphoreGive(s_lock);
+    return session;
+}
+
+static void session_store(const char *host, int port, esp_tls_client_session_t *session)
+{
+    esp_tls_client_session_t *old = NULL;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    session_entry_t *e = session_find(host, port);
+    if (e == NULL) {
+        e = &s_sessions[0];
+        for (int i = 1; i < SESSION_CACHE_LEN; i++) {
+            if (s_sessions[i].used < e->used) {
+                e = &s_sessions[i];
+            }
+        }
+        snprintf(e->host, sizeof(e->host), "%s", host);
+        e->port = port;
+    }
+    old = e->session;
+    e->session = session;
+    e->used = ++s_session_tick;
+    xSemaphoreGive(s_lock);
+
+    if (old != NULL) {
+        esp_tls_free_client_session(old);
+    }
+}
+#endif
+
+static int tls_poll(tls_transport_t *ctx, int timeout_ms, bool write)
+{
+    int sock;
+    if (ctx->tls == NULL || esp_tls_get_conn_sockfd(ctx->tls, &sock) != ESP_OK) {
+        return -1;
+    }
+    if (!write && esp_tls_get_bytes_avail(ctx->tls) > 0) {
+        return 1;
+    }
+
+    fd_set fds, errs;
+    FD_ZERO(&fds);
+    FD_ZERO(&errs);
+    FD_SET(sock, &fds);
+    FD_SET(sock, &errs);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(sock + 1, write ? NULL : &fds, write ? &fds : NULL, &errs,
+                     timeout_ms < 0 ? NULL : &tv);
+    if (ret > 0 && FD_ISSET(sock, &errs)) {
+        return -1;
+    }
+    return ret;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    return tls_poll(esp_transport_get_context_data(t), timeout_ms, false);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    return tls_poll(esp_transport_get_context_data(t), timeout_ms, true);
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    tls_transport_t *ctx = esp_transport_get_context_data(t);
+    ca_bundle_t *ca = ca_get();
+
+    esp_tls_cfg_t cfg = {
+        .timeout_ms = timeout_ms,
+        .ciphersuites_list = CIPHERSUITES,
+    };
+    if (ca != NULL) {
+        cfg.cacert_buf = (const unsigned char *)ca->pem;
+        cfg.cacert_bytes = ca->len + 1;
+    } else {
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        cfg.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    }
+
+    esp_tls_client_session_t *session = NULL;
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+    session = session_take(host, port);
+    cfg.client_session = session;
+#endif
+
+    /* The global low-water mark never recovers, so watch this handshake's own */
+    bool monitored = heap_caps_monitor_local_minimum_free_size_start() == ESP_OK;
+    tls_handshake_t h = {
+        .session_offered = session != NULL,
+        .free_before = esp_get_free_heap_size(),
+    };
+    int64_t start = esp_timer_get_time();
+
+    ctx->tls = esp_tls_init();
+    h.ok = ctx->tls != NULL &&
+           esp_tls_conn_new_sync(host, (int)strlen(host), port, &cfg, ctx->tls) == 1;
+
+    h.duration_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    h.free_after = esp_get_free_heap_size();
+    h.min_free_during = h.free_after;
+    if (monitored) {
+        h.min_free_during = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+        heap_caps_monitor_local_minimum_free_size_stop();
+    }
+    ca_put(ca);
+
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+    if (session != NULL) {
+        esp_tls_free_client_session(session);
+    }
+    /* TLS 1.2 sends the ticket within the handshake; a failure drops the session */
+    if (h.ok) {
+        session_store(host, port, esp_tls_get_client_session(ctx->tls));
+    }
+#endif
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    tls_metrics_record(&s_metrics, &h);
+    uint32_t peak = s_metrics.last_heap_peak;
+    xSemaphoreGive(s_lock);
+
+    if (!h.ok) {
+        ESP_LOGW(TAG, "TLS handshake with %s:%d failed after %lu ms", host, port,
+                 (unsigned long)h.duration_ms);
+        if (ctx->tls != NULL) {
+            esp_tls_conn_destroy(ctx->tls);
+            ctx->tls = NULL;
+        }
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "TLS handshake with %s:%d: %lu ms (%s), heap peak %lu bytes", host, port,
+             (unsigned long)h.duration_ms, h.session_offered ? "session offered" : "full",
+             (unsigned long)peak);
+    return 0;
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    tls_transport_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) {
+        return -1;
+    }
+
+    if (esp_tls_get_bytes_avail(ctx->tls) <= 0) {
+        int poll = tls_poll(ctx, timeout_ms, false);
+        if (poll <= 0) {
+            return poll == 0 ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : poll;
+        }
+    }
+
+    ssize_t ret = esp_tls_conn_read(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    if (ret == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    return (int)ret;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    tls_transport_t *ctx = esp_transport_get_context_data(t);
+
+    int poll = tls_poll(ctx, timeout_ms, true);
+    if (poll <= 0) {
+        return poll;
+    }
+
+    ssize_t ret = esp_tls_conn_write(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_WRITE || ret == ESP_TLS_ERR_SSL_WANT_READ) {
+        return 0;
+    }
+    return (int)ret;
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    tls_transport_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls != NULL) {
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+    }
+    return 0;
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    tls_close(t);
+    free(esp_transport_get_context_data(t));
+    return 0;
+}
+
+esp_err_t mqtt_tls_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t len = 0;
+    if (nvs_storage_load_mqtt_ca(NULL, &len) != ESP_OK || len == 0) {
+        ESP_LOGI(TAG, "Using the built-in CA bundle");
+        return ESP_OK;
+    }
+    if (len > MQTT_TLS_CA_MAX) {
+        ESP_LOGW(TAG, "Saved CA bundle too large (%u bytes), ignored", (unsigned)len);
+        return ESP_OK;
+    }
+
+    char *pem = malloc(len);
+    if (pem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int certs = -1;
+    if (nvs_storage_load_mqtt_ca(pem, &len) == ESP_OK) {
+        certs = tls_pem_count_certs(pem, len);
+    }
+    if (certs > 0) {
+        s_ca = ca_create(pem, len, certs);
+    }
+    free(pem);
+
+    if (s_ca == NULL) {
+        ESP_LOGW(TAG, "Saved CA bundle unusable, using the built-in one");
+    } else {
+        ESP_LOGI(TAG, "Using the saved CA bundle (%d certificates)", certs);
+    }
+    return ESP_OK;
+}
+
+void mqtt_tls_configure(esp_mqtt_client_config_t *cfg)
+{
+    /* Only esp-mqtt's own TLS (wss://) uses the bundle and keeps the pointer,
+     * so only it pins the bundle; mqtts:// connections take a reference
+     * through our transport */
+    const char *uri = cfg->broker.address.uri;
+    bool wss = uri != NULL && strncmp(uri, "wss://", 6) == 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_ca != NULL) {
+        if (wss) {
+            s_ca->pinned = true;
+            cfg->broker.verification.certificate = s_ca->pem;
+            cfg->broker.verification.certificate_len = s_ca->len + 1;
+        }
+    } else {
+#ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        cfg->broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    }
+    xSemaphoreGive(s_lock);
+    cfg->broker.verification.ciphersuites_list = CIPHERSUITES;
+}
+
+esp_transport_handle_t mqtt_tls_create_transport(const char *uri)
+{
+    if (uri == NULL || strncmp(uri, "mqtts://", 8) != 0) {
+        return NULL;
+    }
+
+    tls_transport_t *ctx = calloc(1, sizeof(*ctx));
+    esp_transport_handle_t t = esp_transport_init();
+    if (ctx == NULL || t == NULL) {
+        ESP_LOGE(TAG, "Failed to create TLS transport");
+        free(ctx);
+        if (t != NULL) {
+            esp_transport_destroy(t);
+        }
+        return NULL;
+    }
+
+    esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+                           tls_poll_read, tls_poll_write, tls_destroy);
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_default_port(t, MQTTS_DEFAULT_PORT);
+    return t;
+}
+
+esp_err_t mqtt_tls_set_ca(const char *pem, size_t len)
+{
+    if (pem == NULL) {
+        len = 0;
+    }
+    while (len > 0 && pem[len - 1] == '\0') {
+        len--;
+    }
+    if (len > MQTT_TLS_CA_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ca_bundle_t *ca = NULL;
+    if (len > 0) {
+        int certs = tls_pem_count_certs(pem, len);
+        if (certs <= 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        ca = ca_create(pem, len, certs);
+        if (ca == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t err = nvs_storage_save_mqtt_ca(pem, len);
+    if (err != ESP_OK) {
+        ca_put(ca);
+        return err;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    ca_bundle_t *old = s_ca;
+    s_ca = ca;
+    xSemaphoreGive(s_lock);
+    ca_put(old);
+
+    if (ca != NULL) {
+        ESP_LOGI(TAG, "CA bundle set (%d certificates), used from the next connection", ca->certs);
+    } else {
+        ESP_LOGI(TAG, "CA bundle cleared, using the built-in one from the next connection");
+    }
+    return ESP_OK;
+}
+
+mqtt_tls_ca_source_t mqtt_tls_get_ca(int *certs, size_t *bytes)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    mqtt_tls_ca_source_t source = s_ca != NULL ? MQTT_TLS_CA_SAVED : MQTT_TLS_CA_BUILTIN;
+    if (certs != NULL) {
+        *certs = s_ca != NULL ? s_ca->certs : 0;
+    }
+    if (bytes != NULL) {
+        *bytes = s_ca != NULL ? s_ca->len : 0;
+    }
+    xSemaphoreGive(s_lock);
+    return source;
+}
+
+const char *mqtt_tls_ca_source_name(mqtt_tls_ca_source_t source)
+{
+    switch (source) {
+        case MQTT_TLS_CA_SAVED:   return "saved";
+        case MQTT_TLS_CA_BUILTIN: return "builtin";
+        default:                  return "unknown";
+    }
+}
+
+void mqtt_tls_get_metrics(tls_metrics_t *out, int *cached)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_metrics;
+    int n = 0;
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+    for (int i = 0; i < SESSION_CACHE_LEN; i++) {
+        if (s_sessions[i].session != NULL) {
+            n++;
+        }
+    }
+#endif
+    xSemaphoreGive(s_lock);
+    if (cached != NULL) {
+        *cached = n;
+    }
+}
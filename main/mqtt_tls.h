@@ -0,0 +1,86 @@
+/**
+ * @file mqtt_tls.h
+ * @brief TLS for the MQTT clients: CA, session resumption, cipher order
+ *
+ * mqtts:// brokers are reached through a transport of our own on top of
+ * esp-tls, so that the TLS session of the last connection to a broker can
+ * be offered again on the next one (CONFIG_MQTT_TLS_SESSION_RESUMPTION).
+ * A resumed session skips the certificate chain and the key agreement,
+ * which is most of a handshake's CPU time and heap. The server is checked
+ * against the CA bundle saved with mqtt_tls_set_ca(), or the built-in
+ * certificate bundle if none is saved. With CONFIG_MQTT_TLS_PREFER_ECDSA
+ * the ECDSA suites are offered first. Every handshake is timed and its
+ * heap use recorded (tls_metrics.h).
+ *
+ * wss:// stays on esp-mqtt's own TLS transport, with the same CA and
+ * cipher order but without resumption or metrics.
+ */
+
+#ifndef MQTT_TLS_H
+#define MQTT_TLS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_transport.h"
+#include "mqtt_client.h"
+#include "tls_metrics.h"
+
+/** @brief Largest CA bundle accepted, in bytes */
+#define MQTT_TLS_CA_MAX 4096
+
+/**
+ * @brief What the server certificate is checked against
+ */
+typedef enum {
+    MQTT_TLS_CA_SAVED = 0,      /**< Bundle saved with mqtt_tls_set_ca() */
+    MQTT_TLS_CA_BUILTIN,        /**< Built-in certificate bundle */
+} mqtt_tls_ca_source_t;
+
+/**
+ * @brief Load the saved CA bundle (after nvs_storage_init)
+ */
+esp_err_t mqtt_tls_init(void);
+
+/**
+ * @brief Set the CA and cipher order for esp-mqtt's own TLS transport
+ *
+ * Used by wss://; mqtts:// goes through mqtt_tls_create_transport().
+ * Allocates nothing, so it can be applied again with esp_mqtt_set_config().
+ */
+void mqtt_tls_configure(esp_mqtt_client_config_t *cfg);
+
+/**
+ * @brief Create the resuming TLS transport for a broker URI
+ *
+ * Set it as network.transport of the client, which destroys it with
+ * itself; create one per esp_mqtt_client_init().
+ *
+ * @return NULL unless @p uri is mqtts://
+ */
+esp_transport_handle_t mqtt_tls_create_transport(const char *uri);
+
+/**
+ * @brief Replace the CA bundle (PEM) for new connections
+ * @param pem Bundle, or NULL / @p len 0 to go back to the built-in bundle
+ * @return ESP_ERR_INVALID_ARG if it is not one or more PEM certificates,
+ *         ESP_ERR_INVALID_SIZE if over MQTT_TLS_CA_MAX
+ */
+esp_err_t mqtt_tls_set_ca(const char *pem, size_t len);
+
+/**
+ * @brief Describe the CA in use
+ * @param certs Output: certificates in the saved bundle (may be NULL)
+ * @param bytes Output: size of the saved bundle (may be NULL)
+ */
+mqtt_tls_ca_source_t mqtt_tls_get_ca(int *certs, size_t *bytes);
+
+const char *mqtt_tls_ca_source_name(mqtt_tls_ca_source_t source);
+
+/**
+ * @brief Copy the handshake metrics
+ * @param cached Output: sessions held for resumption (may be NULL)
+ */
+void mqtt_tls_get_metrics(tls_metrics_t *out, int *cached);
+
+#endif /* MQTT_TLS_H */
@@ -0,0 +1,75 @@
+/**
+ * @file net_metrics.c
+ * @brief Network self-test transfer accounting and test pattern (host-testable)
+ */
+
+#include "net_metrics.h"
+
+/* Missed frame and buffer overflow counter register layout */
+#define EMAC_MISSED_NO_DESC_MASK    0xFFFFu
+#define EMAC_MISSED_NO_DESC_OVF     (1u << 16)
+#define EMAC_MISSED_FIFO_SHIFT      17
+#define EMAC_MISSED_FIFO_MASK       0x7FFu
+#define EMAC_MISSED_FIFO_OVF        (1u << 28)
+
+static inline uint8_t pattern_byte(uint64_t offset)
+{
+    return (uint8_t)((offset * 31) ^ (offset >> 8));
+}
+
+void net_pattern_fill(uint8_t *buf, size_t len, uint64_t offset)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = pattern_byte(offset + i);
+    }
+}
+
+size_t net_pattern_check(const uint8_t *buf, size_t len, uint64_t offset)
+{
+    size_t errors = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] != pattern_byte(offset + i)) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+uint32_t net_rate_kbps(uint64_t bytes, int64_t elapsed_us)
+{
+    if (elapsed_us <= 0) {
+        return 0;
+    }
+    /* bits per microsecond = Mbit/s, so scale by 1000 for kbit/s */
+    uint64_t kbps = bytes * 8 * 1000 / (uint64_t)elapsed_us;
+    return kbps > UINT32_MAX ? UINT32_MAX : (uint32_t)kbps;
+}
+
+void net_transfer_record(net_transfer_stats_t *stats, uint32_t bytes, int64_t elapsed_us,
+                         bool ok, uint32_t errors)
+{
+    stats->runs++;
+    stats->total_bytes += bytes;
+    stats->last_bytes = bytes;
+    stats->last_ms = elapsed_us > 0 ? (uint32_t)(elapsed_us / 1000) : 0;
+    stats->last_errors = errors;
+
+    if (!ok || errors > 0) {
+        stats->failures++;
+        stats->last_kbps = 0;
+        return;
+    }
+    stats->last_kbps = net_rate_kbps(bytes, elapsed_us);
+    if (stats->last_kbps > stats->best_kbps) {
+        stats->best_kbps = stats->last_kbps;
+    }
+}
+
+void net_emac_drops_add(net_emac_drops_t *drops, uint32_t reg)
+{
+    drops->no_descriptor += reg & EMAC_MISSED_NO_DESC_MASK;
+    drops->fifo_overflow += (reg >> EMAC_MISSED_FIFO_SHIFT) & EMAC_MISSED_FIFO_MASK;
+    if (reg & (EMAC_MISSED_NO_DESC_OVF | EMAC_MISSED_FIFO_OVF)) {
+        drops->saturated = true;
+    }
+}
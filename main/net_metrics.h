@@ -0,0 +1,77 @@
+/**
+ * @file net_metrics.h
+ * @brief Network self-test transfer accounting and test pattern (host-testable)
+ *
+ * The throughput self-test streams a known pattern over HTTP in either
+ * direction. Each byte of the pattern depends only on its offset in the
+ * transfer, not on how the transfer was chunked, so the receiver checks
+ * every chunk as it arrives and a lost, repeated or reordered segment
+ * shows up as mismatched bytes. The pattern repeats every 64 KB.
+ *
+ * The ESP32 EMAC counts the frames it had to drop in a 32-bit register
+ * that clears on read: frames missed because no receive DMA descriptor
+ * was free, and frames lost to a receive FIFO overflow, each with an
+ * overflow bit for when its counter wrapped between two reads.
+ */
+
+#ifndef NET_METRICS_H
+#define NET_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NET_PATTERN_PERIOD  65536
+
+/**
+ * @brief One direction of the throughput test
+ */
+typedef struct {
+    uint32_t runs;
+    uint32_t failures;          /**< Runs aborted or received with mismatches */
+    uint64_t total_bytes;
+    uint32_t last_bytes;
+    uint32_t last_ms;
+    uint32_t last_kbps;         /**< kbit/s */
+    uint32_t best_kbps;
+    uint32_t last_errors;       /**< Mismatched bytes in the last run */
+} net_transfer_stats_t;
+
+/**
+ * @brief Receive frames the EMAC dropped, accumulated across reads
+ */
+typedef struct {
+    uint32_t no_descriptor;     /**< No free receive DMA buffer */
+    uint32_t fifo_overflow;     /**< Receive FIFO overflowed */
+    bool saturated;             /**< A counter wrapped between reads: totals are a lower bound */
+} net_emac_drops_t;
+
+/**
+ * @brief Fill @p buf with the pattern bytes at @p offset onwards
+ */
+void net_pattern_fill(uint8_t *buf, size_t len, uint64_t offset);
+
+/**
+ * @brief Count the bytes of @p buf that differ from the pattern at @p offset
+ */
+size_t net_pattern_check(const uint8_t *buf, size_t len, uint64_t offset);
+
+/**
+ * @brief kbit/s of @p bytes in @p elapsed_us (0 if no time elapsed)
+ */
+uint32_t net_rate_kbps(uint64_t bytes, int64_t elapsed_us);
+
+/**
+ * @brief Record a finished run
+ * @param ok Completed without errors (a short or mismatched run is a failure)
+ * @param errors Mismatched bytes
+ */
+void net_transfer_record(net_transfer_stats_t *stats, uint32_t bytes, int64_t elapsed_us,
+                         bool ok, uint32_t errors);
+
+/**
+ * @brief Add a read of the EMAC missed-frame register to @p drops
+ */
+void net_emac_drops_add(net_emac_drops_t *drops, uint32_t reg);
+
+#endif /* NET_METRICS_H */
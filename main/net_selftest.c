@@ -0,0 +1,256 @@
+/**
+ * @file net_selftest.c
+ * @brief Network self-test: throughput, echo RTT and buffer statistics
+ */
+
+#include "net_selftest.h"
+#include "ethernet_manager.h"
+#include "wifi_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "lwip/stats.h"
+#include <errno.h>
+#include <string.h>
+
+#if CONFIG_ETH_USE_ESP32_EMAC && !CONFIG_ETH_USE_OPENETH
+#include "soc/soc.h"
+/* EMAC DMA "missed frame and buffer overflow counter", cleared on read */
+#define EMAC_DMA_MISSED_FRAMES_REG  (DR_REG_EMAC_BASE + 0x20)
+#define HAVE_EMAC_DROPS 1
+#else
+#define HAVE_EMAC_DROPS 0
+#endif
+
+static const char *TAG = "net_selftest";
+
+#ifndef CONFIG_SELFTEST_ECHO_PORT
+#define CONFIG_SELFTEST_ECHO_PORT 7
+#endif
+
+#define ECHO_BUF_LEN        512
+#define ECHO_MAX_WINDOW_S   600
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static net_transfer_stats_t s_upload;
+static net_transfer_stats_t s_download;
+static bool s_busy;
+static net_emac_drops_t s_emac;
+
+static TaskHandle_t s_echo_task;
+static int64_t s_echo_until_us;
+static uint32_t s_echo_connections;
+static uint64_t s_echo_bytes;
+
+esp_err_t net_selftest_init(void)
+{
+    memset(&s_upload, 0, sizeof(s_upload));
+    memset(&s_download, 0, sizeof(s_download));
+    memset(&s_emac, 0, sizeof(s_emac));
+    ESP_LOGD(TAG, "Network profile: %s", net_selftest_profile());
+    return ESP_OK;
+}
+
+const char *net_selftest_profile(void)
+{
+#if CONFIG_NET_PROFILE_LOW_RAM
+    return "low_ram";
+#elif CONFIG_NET_PROFILE_THROUGHPUT
+    return "throughput";
+#else
+    return "default";
+#endif
+}
+
+bool net_selftest_begin(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    bool claimed = !s_busy;
+    s_busy = true;
+    portEXIT_CRITICAL(&s_mux);
+    return claimed;
+}
+
+void net_selftest_end(bool upload, uint32_t bytes, int64_t elapsed_us, bool ok, uint32_t errors)
+{
+    portENTER_CRITICAL(&s_mux);
+    net_transfer_record(upload ? &s_upload : &s_download, bytes, elapsed_us, ok, errors);
+    s_busy = false;
+    portEXIT_CRITICAL(&s_mux);
+
+    ESP_LOGI(TAG, "%s: %lu bytes in %lld ms%s", upload ? "Upload" : "Download",
+             (unsigned long)bytes, (long long)(elapsed_us / 1000),
+             ok && errors == 0 ? "" : " (failed)");
+}
+
+/**
+ * @brief Echo one client until it closes, goes quiet or the window ends
+ */
+static void echo_client(int sock)
+{
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { .tv_sec = 1 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buf[ECHO_BUF_LEN];
+    while (esp_timer_get_time() < s_echo_until_us) {
+        int n = recv(sock, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        for (int sent = 0; sent < n; ) {
+            int m = send(sock, buf + sent, n - sent, 0);
+            if (m <= 0) {
+                return;
+            }
+            sent += m;
+        }
+        portENTER_CRITICAL(&s_mux);
+        s_echo_bytes += n;
+        portEXIT_CRITICAL(&s_mux);
+    }
+}
+
+/**
+ * @brief Listen on the echo port until the window closes, one client at a time
+ */
+static void echo_task(void *arg)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (listener < 0) {
+        ESP_LOGE(TAG, "Echo: no socket available");
+        goto done;
+    }
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_SELFTEST_ECHO_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0) {
+        ESP_LOGE(TAG, "Echo: cannot listen on port %d", CONFIG_SELFTEST_ECHO_PORT);
+        close(listener);
+        goto done;
+    }
+    ESP_LOGI(TAG, "Echo server listening on port %d", CONFIG_SELFTEST_ECHO_PORT);
+
+    while (esp_timer_get_time() < s_echo_until_us) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        struct timeval tv = { .tv_sec = 1 };
+        if (select(listener + 1, &readable, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        int sock = accept(listener, NULL, NULL);
+        if (sock < 0) {
+            continue;
+        }
+        portENTER_CRITICAL(&s_mux);
+        s_echo_connections++;
+        portEXIT_CRITICAL(&s_mux);
+        echo_client(sock);
+        close(sock);
+    }
+    close(listener);
+    ESP_LOGI(TAG, "Echo server closed");
+
+done:
+    portENTER_CRITICAL(&s_mux);
+    s_echo_task = NULL;
+    s_echo_until_us = 0;
+    portEXIT_CRITICAL(&s_mux);
+    vTaskDelete(NULL);
+}
+
+esp_err_t net_selftest_echo_open(uint32_t seconds)
+{
+    if (seconds == 0 || seconds > ECHO_MAX_WINDOW_S) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    s_echo_until_us = esp_timer_get_time() + (int64_t)seconds * 1000000;
+    bool running = s_echo_task != NULL;
+    portEXIT_CRITICAL(&s_mux);
+    if (running) {
+        return ESP_OK;
+    }
+
+    if (xTaskCreate(echo_task, "echo_task", 3072, NULL, 5, &s_echo_task) != pdPASS) {
+        portENTER_CRITICAL(&s_mux);
+        s_echo_until_us = 0;
+        portEXIT_CRITICAL(&s_mux);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_LWIP_STATS
+static void copy_proto(net_proto_counters_t *out, const struct stats_proto *in)
+{
+    out->xmit = in->xmit;
+    out->recv = in->recv;
+    out->drop = in->drop;
+    out->memerr = in->memerr;
+    out->err = in->err;
+}
+#endif
+
+void net_selftest_get_stats(net_selftest_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    bool eth_up = ethernet_manager_get_link(&stats->eth_speed_mbps, &stats->eth_full_duplex) == ESP_OK;
+    stats->eth_link = eth_up;
+
+#if HAVE_EMAC_DROPS
+    /* Only clocked while Ethernet runs; the read clears the hardware counters */
+    uint32_t missed = eth_up ? REG_READ(EMAC_DMA_MISSED_FRAMES_REG) : 0;
+#endif
+
+    portENTER_CRITICAL(&s_mux);
+#if HAVE_EMAC_DROPS
+    net_emac_drops_add(&s_emac, missed);
+#endif
+    stats->upload = s_upload;
+    stats->download = s_download;
+    stats->busy = s_busy;
+    stats->emac = s_emac;
+    stats->echo_open = s_echo_task != NULL;
+    int64_t remaining_us = s_echo_until_us - esp_timer_get_time();
+    stats->echo_connections = s_echo_connections;
+    stats->echo_bytes = s_echo_bytes;
+    portEXIT_CRITICAL(&s_mux);
+
+    stats->echo_remaining_s = stats->echo_open && remaining_us > 0 ? (uint32_t)(remaining_us / 1000000) : 0;
+    stats->emac_stats = HAVE_EMAC_DROPS;
+
+#if CONFIG_LWIP_STATS
+    stats->lwip_stats = true;
+    copy_proto(&stats->link, &lwip_stats.link);
+    copy_proto(&stats->ip, &lwip_stats.ip);
+    copy_proto(&stats->tcp, &lwip_stats.tcp);
+    copy_proto(&stats->udp, &lwip_stats.udp);
+#endif
+
+    wifi_ap_record_t ap;
+    if (wifi_manager_is_connected() && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        stats->wifi_link = true;
+        stats->wifi_rssi = ap.rssi;
+    }
+
+    stats->free_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    stats->min_free_internal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    stats->free_dma = heap_caps_get_free_size(MALLOC_CAP_DMA);
+}
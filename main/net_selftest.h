@@ -0,0 +1,93 @@
+/**
+ * @file net_selftest.h
+ * @brief Network self-test: throughput, echo RTT and buffer statistics
+ *
+ * Helps tell a slow link from a starved network stack. The web server
+ * streams the test pattern (net_metrics.h) to and from a host for
+ * throughput, and this module records the results. A TCP echo server on
+ * CONFIG_SELFTEST_ECHO_PORT measures round-trip time; it only listens for
+ * the window a client asks for, so it holds no socket otherwise.
+ *
+ * The statistics combine the buffer configuration of the build (the
+ * CONFIG_NET_PROFILE overlay), the lwIP protocol counters when
+ * CONFIG_LWIP_STATS is set, the frames the EMAC dropped for lack of a
+ * receive buffer, and the negotiated link.
+ */
+
+#ifndef NET_SELFTEST_H
+#define NET_SELFTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "net_metrics.h"
+
+/**
+ * @brief lwIP counters of one protocol layer
+ */
+typedef struct {
+    uint32_t xmit;
+    uint32_t recv;
+    uint32_t drop;
+    uint32_t memerr;            /**< Dropped for lack of a buffer */
+    uint32_t err;
+} net_proto_counters_t;
+
+typedef struct {
+    net_transfer_stats_t upload;        /**< Host to device */
+    net_transfer_stats_t download;      /**< Device to host */
+    bool busy;                          /**< A transfer is running */
+
+    bool echo_open;
+    uint32_t echo_remaining_s;
+    uint32_t echo_connections;
+    uint64_t echo_bytes;
+
+    bool lwip_stats;                    /**< CONFIG_LWIP_STATS: the counters below are valid */
+    net_proto_counters_t link;
+    net_proto_counters_t ip;
+    net_proto_counters_t tcp;
+    net_proto_counters_t udp;
+
+    bool emac_stats;                    /**< The ESP32 EMAC is in use: drops are valid */
+    net_emac_drops_t emac;
+
+    bool eth_link;
+    int eth_speed_mbps;
+    bool eth_full_duplex;
+    bool wifi_link;
+    int8_t wifi_rssi;
+
+    uint32_t free_internal;
+    uint32_t min_free_internal;
+    uint32_t free_dma;
+} net_selftest_stats_t;
+
+esp_err_t net_selftest_init(void);
+
+/**
+ * @brief Name of the network tuning profile the image was built with
+ * @return "default", "low_ram" or "throughput"
+ */
+const char *net_selftest_profile(void);
+
+/**
+ * @brief Claim the transfer slot; one transfer runs at a time
+ * @return false if another transfer is running
+ */
+bool net_selftest_begin(void);
+
+/**
+ * @brief Record the transfer begun with net_selftest_begin() and release the slot
+ * @param upload true for host to device
+ */
+void net_selftest_end(bool upload, uint32_t bytes, int64_t elapsed_us, bool ok, uint32_t errors);
+
+/**
+ * @brief Listen for echo clients for the next @p seconds (extends an open window)
+ */
+esp_err_t net_selftest_echo_open(uint32_t seconds);
+
+void net_selftest_get_stats(net_selftest_stats_t *stats);
+
+#endif /* NET_SELFTEST_H */
@@ -21,10 +21,13 @@ esp_err_t nvs_storage_init(void)
 
 /**
  * @brief Convert sensor address to NVS key string
+ *
+ * The one-letter prefix selects the record kind: 's' name, 'r' alert rule,
+ * 'i' read interval, 'p' cable position.
  */
-static void address_to_key(const uint8_t *address, char *key, size_t key_len)
+static void address_to_key(char prefix, const uint8_t *address, char *key, size_t key_len)
 {
-    snprintf(key, key_len, "s_%02x%02x%02x%02x",
+    snprintf(key, key_len, "%c_%02x%02x%02x%02x", prefix,
              address[4], address[5], address[6], address[7]);
 }
 
@@ -34,7 +37,7 @@ esp_err_t nvs_storage_save_sensor_name(const uint8_t *sensor_address, const char
     esp_err_t err;
     char key[16];
 
-    address_to_key(sensor_address, key, sizeof(key));
+    address_to_key('s', sensor_address, key, sizeof(key));
 
     err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (err != ESP_OK) {
@@ -62,7 +65,7 @@ esp_err_t nvs_storage_load_sensor_name(const uint8_t *sensor_address, char *frie
     esp_err_t err;
     char key[16];
 
-    address_to_key(sensor_address, key, sizeof(key));
+    address_to_key('s', sensor_address, key, sizeof(key));
 
     err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
     if (err != ESP_OK) {
@@ -82,7 +85,7 @@ esp_err_t nvs_storage_delete_sensor_name(const uint8_t *sensor_address)
     esp_err_t err;
     char key[16];
 
-    address_to_key(sensor_address, key, sizeof(key));
+    address_to_key('s', sensor_address, key, sizeof(key));
 
     err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (err != ESP_OK) {
@@ -98,6 +101,361 @@ esp_err_t nvs_storage_delete_sensor_name(const uint8_t *sensor_address)
     return err;
 }
 
+esp_err_t nvs_storage_save_alert_rule(const uint8_t *sensor_address, const alert_rule_config_t *rule)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('r', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, key, rule, sizeof(*rule));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved alert rule: %s", key);
+    return err;
+}
+
+esp_err_t nvs_storage_load_alert_rule(const uint8_t *sensor_address, alert_rule_config_t *rule)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('r', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = sizeof(*rule);
+    err = nvs_get_blob(handle, key, rule, &len);
+    nvs_close(handle);
+
+    /* Treat a blob from a different struct layout as absent */
+    if (err == ESP_OK && len != sizeof(*rule)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+esp_err_t nvs_storage_delete_alert_rule(const uint8_t *sensor_address)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('r', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t nvs_storage_save_sensor_interval(const uint8_t *sensor_address, uint32_t interval_ms)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('i', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (interval_ms > 0) {
+        err = nvs_set_u32(handle, key, interval_ms);
+    } else {
+        err = nvs_erase_key(handle, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved sensor interval: %s -> %lu ms", key, (unsigned long)interval_ms);
+    return err;
+}
+
+esp_err_t nvs_storage_load_sensor_interval(const uint8_t *sensor_address, uint32_t *interval_ms)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('i', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_u32(handle, key, interval_ms);
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t nvs_storage_save_sensor_position(const uint8_t *sensor_address, uint8_t position)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('p', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (position > 0) {
+        err = nvs_set_u8(handle, key, position);
+    } else {
+        err = nvs_erase_key(handle, key);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved sensor position: %s -> %u", key, position);
+    return err;
+}
+
+esp_err_t nvs_storage_load_sensor_position(const uint8_t *sensor_address, uint8_t *position)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    address_to_key('p', sensor_address, key, sizeof(key));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_u8(handle, key, position);
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t nvs_storage_save_virtual_sensor(int slot, const virtual_sensor_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "vsens_%d", slot);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, key, cfg, sizeof(*cfg));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved virtual sensor: %s -> %s", key, cfg->id);
+    return err;
+}
+
+esp_err_t nvs_storage_load_virtual_sensor(int slot, virtual_sensor_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "vsens_%d", slot);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = sizeof(*cfg);
+    err = nvs_get_blob(handle, key, cfg, &len);
+    nvs_close(handle);
+
+    /* Treat a blob from a different struct layout as absent */
+    if (err == ESP_OK && len != sizeof(*cfg)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+esp_err_t nvs_storage_delete_virtual_sensor(int slot)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "vsens_%d", slot);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    } else if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t nvs_storage_save_mqtt_target(int index, const mqtt_target_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "mqtt_tgt_%d", index);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, key, cfg, sizeof(*cfg));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved MQTT target: %s -> %s", key, cfg->uri);
+    return err;
+}
+
+esp_err_t nvs_storage_load_mqtt_target(int index, mqtt_target_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "mqtt_tgt_%d", index);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = sizeof(*cfg);
+    err = nvs_get_blob(handle, key, cfg, &len);
+    nvs_close(handle);
+
+    /* Treat a blob from a different struct layout as absent */
+    if (err == ESP_OK && len != sizeof(*cfg)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+esp_err_t nvs_storage_delete_mqtt_target(int index)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+    char key[16];
+
+    snprintf(key, sizeof(key), "mqtt_tgt_%d", index);
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    } else if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t nvs_storage_save_mqtt_ca(const char *pem, size_t len)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (len == 0) {
+        err = nvs_erase_key(handle, "mqtt_ca");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(handle, "mqtt_ca", pem, len);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved MQTT CA bundle (%u bytes)", (unsigned)len);
+    return err;
+}
+
+esp_err_t nvs_storage_load_mqtt_ca(char *pem, size_t *len)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_blob(handle, "mqtt_ca", pem, len);
+    nvs_close(handle);
+    return err;
+}
+
 esp_err_t nvs_storage_save_mqtt_config(const char *broker_uri, const char *username, const char *password)
 {
     nvs_handle_t handle;
@@ -251,6 +609,94 @@ esp_err_t nvs_storage_load_sensor_settings(uint32_t *read_interval_ms, uint32_t
     return ESP_OK;
 }
 
+esp_err_t nvs_storage_save_acq_config(const acq_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, "acq_cfg", cfg, sizeof(*cfg));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGD(TAG, "Saved acquisition settings (enabled=%d)", cfg->enabled);
+    return err;
+}
+
+esp_err_t nvs_storage_load_acq_config(acq_config_t *cfg)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = sizeof(*cfg);
+    err = nvs_get_blob(handle, "acq_cfg", cfg, &len);
+    nvs_close(handle);
+
+    if (err == ESP_OK && len != sizeof(*cfg)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+esp_err_t nvs_storage_save_ota_session(const ota_session_record_t *record)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (record == NULL) {
+        err = nvs_erase_key(handle, "ota_session");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(handle, "ota_session", record, sizeof(*record));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    return err;
+}
+
+esp_err_t nvs_storage_load_ota_session(ota_session_record_t *record)
+{
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = sizeof(*record);
+    err = nvs_get_blob(handle, "ota_session", record, &len);
+    nvs_close(handle);
+
+    if (err == ESP_OK && len != sizeof(*record)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return err;
+}
+
 esp_err_t nvs_storage_save_auth_config(bool enabled, const char *username, const char *password, const char *api_key)
 {
     nvs_handle_t handle;
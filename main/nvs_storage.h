@@ -7,6 +7,11 @@
 #define NVS_STORAGE_H
 
 #include "esp_err.h"
+#include "alert_rules.h"
+#include "acq_controller.h"
+#include "expr_engine.h"
+#include "mqtt_fanout.h"
+#include "ota_chunk.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -40,6 +45,77 @@ esp_err_t nvs_storage_load_sensor_name(const uint8_t *sensor_address, char *frie
  */
 esp_err_t nvs_storage_delete_sensor_name(const uint8_t *sensor_address);
 
+/**
+ * @brief Save a sensor's alert rule
+ * @param sensor_address 8-byte sensor ROM address
+ * @param rule Rule configuration
+ */
+esp_err_t nvs_storage_save_alert_rule(const uint8_t *sensor_address, const alert_rule_config_t *rule);
+
+/**
+ * @brief Load a sensor's alert rule
+ * @param sensor_address 8-byte sensor ROM address
+ * @param rule Output: rule configuration
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if no rule saved
+ */
+esp_err_t nvs_storage_load_alert_rule(const uint8_t *sensor_address, alert_rule_config_t *rule);
+
+/**
+ * @brief Delete a sensor's alert rule
+ * @param sensor_address 8-byte sensor ROM address
+ */
+esp_err_t nvs_storage_delete_alert_rule(const uint8_t *sensor_address);
+
+/**
+ * @brief Save a sensor's target read interval
+ * @param sensor_address 8-byte sensor ROM address
+ * @param interval_ms Interval in ms, 0 to follow the bus default (erases the key)
+ */
+esp_err_t nvs_storage_save_sensor_interval(const uint8_t *sensor_address, uint32_t interval_ms);
+
+/**
+ * @brief Load a sensor's target read interval
+ * @param sensor_address 8-byte sensor ROM address
+ * @param interval_ms Output: interval in ms
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if none saved
+ */
+esp_err_t nvs_storage_load_sensor_interval(const uint8_t *sensor_address, uint32_t *interval_ms);
+
+/**
+ * @brief Save a sensor's position along the bus cable
+ * @param sensor_address 8-byte sensor ROM address
+ * @param position 1-255 counted from the master, 0 to clear (erases the key)
+ */
+esp_err_t nvs_storage_save_sensor_position(const uint8_t *sensor_address, uint8_t position);
+
+/**
+ * @brief Load a sensor's position along the bus cable
+ * @param sensor_address 8-byte sensor ROM address
+ * @param position Output: position
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if none saved
+ */
+esp_err_t nvs_storage_load_sensor_position(const uint8_t *sensor_address, uint8_t *position);
+
+/**
+ * @brief Save a virtual sensor definition
+ * @param slot Slot index (0 to CONFIG_VIRTUAL_SENSORS_MAX-1)
+ */
+esp_err_t nvs_storage_save_virtual_sensor(int slot, const virtual_sensor_config_t *cfg);
+
+/**
+ * @brief Load a virtual sensor definition
+ * @param slot Slot index
+ * @param cfg Output: definition
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if the slot is empty
+ */
+esp_err_t nvs_storage_load_virtual_sensor(int slot, virtual_sensor_config_t *cfg);
+
+/**
+ * @brief Delete a virtual sensor definition
+ * @param slot Slot index
+ */
+esp_err_t nvs_storage_delete_virtual_sensor(int slot);
+
 /**
  * @brief Save MQTT configuration
  */
@@ -52,6 +128,41 @@ esp_err_t nvs_storage_load_mqtt_config(char *broker_uri, size_t uri_len,
                                         char *username, size_t user_len,
                                         char *password, size_t pass_len);
 
+/**
+ * @brief Save an additional MQTT broker target
+ * @param index Target index (0 to CONFIG_MQTT_FANOUT_TARGETS-1)
+ */
+esp_err_t nvs_storage_save_mqtt_target(int index, const mqtt_target_config_t *cfg);
+
+/**
+ * @brief Load an additional MQTT broker target
+ * @param index Target index
+ * @param cfg Output: settings
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if none saved
+ */
+esp_err_t nvs_storage_load_mqtt_target(int index, mqtt_target_config_t *cfg);
+
+/**
+ * @brief Delete an additional MQTT broker target
+ * @param index Target index
+ */
+esp_err_t nvs_storage_delete_mqtt_target(int index);
+
+/**
+ * @brief Save the CA bundle for MQTT over TLS
+ * @param pem PEM certificates
+ * @param len Bytes in @p pem, 0 to delete the bundle
+ */
+esp_err_t nvs_storage_save_mqtt_ca(const char *pem, size_t len);
+
+/**
+ * @brief Load the CA bundle for MQTT over TLS
+ * @param pem Output buffer, or NULL to get the size only
+ * @param len In: size of @p pem; out: bytes of the bundle
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if none saved
+ */
+esp_err_t nvs_storage_load_mqtt_ca(char *pem, size_t *len);
+
 /**
  * @brief Save WiFi credentials
  */
@@ -85,6 +196,29 @@ esp_err_t nvs_storage_save_sensor_settings(uint32_t read_interval_ms, uint32_t p
  */
 esp_err_t nvs_storage_load_sensor_settings(uint32_t *read_interval_ms, uint32_t *publish_interval_ms, uint8_t *resolution);
 
+/**
+ * @brief Save adaptive acquisition settings
+ */
+esp_err_t nvs_storage_save_acq_config(const acq_config_t *cfg);
+
+/**
+ * @brief Load adaptive acquisition settings
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if not configured
+ */
+esp_err_t nvs_storage_load_acq_config(acq_config_t *cfg);
+
+/**
+ * @brief Save the progress of a resumable firmware upload
+ * @param record Session to save, or NULL to delete it
+ */
+esp_err_t nvs_storage_save_ota_session(const ota_session_record_t *record);
+
+/**
+ * @brief Load the resumable firmware upload left by a previous boot
+ * @return ESP_OK if found, ESP_ERR_NVS_NOT_FOUND if none saved
+ */
+esp_err_t nvs_storage_load_ota_session(ota_session_record_t *record);
+
 /**
  * @brief Save web authentication settings
  * @param enabled Whether auth is enabled
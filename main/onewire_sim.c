@@ -0,0 +1,254 @@
+/**
+ * @file onewire_sim.c
+ * @brief Simulated 1-Wire bus of DS18B20 sensors (host-testable)
+ */
+
+#include "onewire_sim.h"
+#include <string.h>
+
+#define CMD_SEARCH_ROM          0xF0
+#define CMD_ALARM_SEARCH        0xEC
+#define CMD_READ_ROM            0x33
+#define CMD_MATCH_ROM           0x55
+#define CMD_SKIP_ROM            0xCC
+#define CMD_CONVERT             0x44
+#define CMD_READ_SCRATCHPAD     0xBE
+#define CMD_WRITE_SCRATCHPAD    0x4E
+
+/* Pattern: a triangle of +-1 °C over 64 conversions, phase-shifted per device */
+#define PATTERN_PERIOD  64
+
+uint8_t onewire_sim_crc8(const uint8_t *data, int len)
+{
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+        for (int b = 0; b < 8; b++) {
+            uint8_t mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+static int rom_bit(const onewire_sim_device_t *d, int pos)
+{
+    return (d->rom[pos / 8] >> (pos % 8)) & 1;
+}
+
+static void update_temperature(onewire_sim_device_t *d, int index, uint32_t conversions)
+{
+    int t = (int)((conversions + (uint32_t)index * 5) % PATTERN_PERIOD);
+    int tri = t < PATTERN_PERIOD / 2 ? t : PATTERN_PERIOD - t;
+    int raw = d->base_raw + tri - PATTERN_PERIOD / 4;
+
+    /* Bits below the resolution read as zero */
+    int bits = 9 + ((d->scratchpad[4] >> 5) & 0x03);
+    raw &= ~((1 << (12 - bits)) - 1);
+
+    d->scratchpad[0] = (uint8_t)(raw & 0xFF);
+    d->scratchpad[1] = (uint8_t)((raw >> 8) & 0xFF);
+    d->scratchpad[8] = onewire_sim_crc8(d->scratchpad, 8);
+}
+
+static bool in_alarm(const onewire_sim_device_t *d)
+{
+    int16_t raw = (int16_t)(d->scratchpad[0] | (d->scratchpad[1] << 8));
+    int whole = raw >> 4;
+    return whole >= (int8_t)d->scratchpad[2] || whole <= (int8_t)d->scratchpad[3];
+}
+
+void onewire_sim_init(onewire_sim_t *sim, int count)
+{
+    memset(sim, 0, sizeof(*sim));
+    if (count < 0) {
+        count = 0;
+    } else if (count > ONEWIRE_SIM_MAX_DEVICES) {
+        count = ONEWIRE_SIM_MAX_DEVICES;
+    }
+    sim->count = count;
+
+    for (int i = 0; i < count; i++) {
+        onewire_sim_device_t *d = &sim->dev[i];
+        const uint8_t rom[7] = {0x28, 0x51, 0x4D, (uint8_t)i, (uint8_t)(i * 37), 0x00, 0x00};
+        memcpy(d->rom, rom, sizeof(rom));
+        d->rom[7] = onewire_sim_crc8(d->rom, 7);
+
+        /* Power-on scratchpad: 85 °C, alarms out of reach, 12 bits */
+        const uint8_t pad[8] = {0x50, 0x05, 0x7F, 0x80, 0x7F, 0xFF, 0x0C, 0x10};
+        memcpy(d->scratchpad, pad, sizeof(pad));
+        d->scratchpad[8] = onewire_sim_crc8(d->scratchpad, 8);
+        d->base_raw = (int16_t)(20 * 16 + i * 8);   /* 20 °C, +0.5 °C per device */
+    }
+}
+
+bool onewire_sim_reset(onewire_sim_t *sim)
+{
+    sim->resets++;
+    sim->in_byte = 0;
+    sim->in_bits = 0;
+    for (int i = 0; i < sim->count; i++) {
+        sim->dev[i].active = true;
+    }
+    sim->state = sim->count > 0 ? OW_SIM_ROM_CMD : OW_SIM_IDLE;
+    return sim->count > 0;
+}
+
+/**
+ * @brief Load out_buf with the wired-AND of the addressed devices' bytes
+ */
+static void start_read(onewire_sim_t *sim, bool scratchpad)
+{
+    int len = scratchpad ? 9 : 8;
+    memset(sim->out_buf, 0xFF, sizeof(sim->out_buf));
+    for (int i = 0; i < sim->count; i++) {
+        if (sim->dev[i].active) {
+            const uint8_t *src = scratchpad ? sim->dev[i].scratchpad : sim->dev[i].rom;
+            for (int b = 0; b < len; b++) {
+                sim->out_buf[b] &= src[b];
+            }
+        }
+    }
+    sim->out_bits = len * 8;
+    sim->out_pos = 0;
+    sim->state = OW_SIM_READ;
+}
+
+static void rom_command(onewire_sim_t *sim, uint8_t cmd)
+{
+    sim->pos = 0;
+    sim->search_phase = 0;
+    switch (cmd) {
+    case CMD_SKIP_ROM:
+        sim->state = OW_SIM_FUNC_CMD;
+        break;
+    case CMD_MATCH_ROM:
+        sim->state = OW_SIM_MATCH;
+        break;
+    case CMD_ALARM_SEARCH:
+        for (int i = 0; i < sim->count; i++) {
+            sim->dev[i].active = in_alarm(&sim->dev[i]);
+        }
+        sim->state = OW_SIM_SEARCH;
+        break;
+    case CMD_SEARCH_ROM:
+        sim->state = OW_SIM_SEARCH;
+        break;
+    case CMD_READ_ROM:
+        start_read(sim, false);
+        break;
+    default:
+        sim->state = OW_SIM_IDLE;
+        break;
+    }
+}
+
+static void function_command(onewire_sim_t *sim, uint8_t cmd)
+{
+    switch (cmd) {
+    case CMD_CONVERT:
+        sim->conversions++;
+        for (int i = 0; i < sim->count; i++) {
+            if (sim->dev[i].active) {
+                update_temperature(&sim->dev[i], i, sim->conversions);
+            }
+        }
+        /* Conversion is instant: read slots return 1 (done) from here */
+        sim->state = OW_SIM_IDLE;
+        break;
+    case CMD_READ_SCRATCHPAD:
+        start_read(sim, true);
+        break;
+    case CMD_WRITE_SCRATCHPAD:
+        sim->pos = 0;
+        sim->state = OW_SIM_WRITE_SCRATCH;
+        break;
+    default:
+        sim->state = OW_SIM_IDLE;
+        break;
+    }
+}
+
+static void write_scratchpad(onewire_sim_t *sim, uint8_t byte)
+{
+    for (int i = 0; i < sim->count; i++) {
+        onewire_sim_device_t *d = &sim->dev[i];
+        if (!d->active) {
+            continue;
+        }
+        if (sim->pos == 2) {
+            d->scratchpad[4] = (byte & 0x60) | 0x1F;    /* Only R1/R0 are writable */
+        } else {
+            d->scratchpad[2 + sim->pos] = byte;         /* TH, then TL */
+        }
+        d->scratchpad[8] = onewire_sim_crc8(d->scratchpad, 8);
+    }
+    if (++sim->pos == 3) {
+        sim->state = OW_SIM_IDLE;
+    }
+}
+
+void onewire_sim_write_bit(onewire_sim_t *sim, uint8_t bit)
+{
+    bit = bit ? 1 : 0;
+    switch (sim->state) {
+    case OW_SIM_ROM_CMD:
+    case OW_SIM_FUNC_CMD:
+    case OW_SIM_WRITE_SCRATCH:
+        sim->in_byte |= (uint8_t)(bit << sim->in_bits);
+        if (++sim->in_bits == 8) {
+            uint8_t byte = sim->in_byte;
+            sim->in_byte = 0;
+            sim->in_bits = 0;
+            if (sim->state == OW_SIM_ROM_CMD) {
+                rom_command(sim, byte);
+            } else if (sim->state == OW_SIM_FUNC_CMD) {
+                function_command(sim, byte);
+            } else {
+                write_scratchpad(sim, byte);
+            }
+        }
+        break;
+    case OW_SIM_MATCH:
+    case OW_SIM_SEARCH:
+        if (sim->state == OW_SIM_SEARCH && sim->search_phase != 2) {
+            break;      /* Direction before both bits were read: ignored */
+        }
+        for (int i = 0; i < sim->count; i++) {
+            if (sim->dev[i].active && rom_bit(&sim->dev[i], sim->pos) != bit) {
+                sim->dev[i].active = false;
+            }
+        }
+        sim->search_phase = 0;
+        if (++sim->pos == 64) {
+            sim->state = OW_SIM_FUNC_CMD;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+uint8_t onewire_sim_read_bit(onewire_sim_t *sim)
+{
+    uint8_t result = 1;
+
+    if (sim->state == OW_SIM_SEARCH && sim->search_phase < 2) {
+        /* Each device sends its bit, then the complement */
+        for (int i = 0; i < sim->count; i++) {
+            if (sim->dev[i].active) {
+                int bit = rom_bit(&sim->dev[i], sim->pos);
+                result &= (uint8_t)(sim->search_phase == 0 ? bit : !bit);
+            }
+        }
+        sim->search_phase++;
+    } else if (sim->state == OW_SIM_READ && sim->out_pos < sim->out_bits) {
+        result = (sim->out_buf[sim->out_pos / 8] >> (sim->out_pos % 8)) & 1;
+        sim->out_pos++;
+    }
+    return result;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file onewire_sim.h
+ * @brief Simulated 1-Wire bus of DS18B20 sensors (host-testable)
+ *
+ * Models the devices at the level of resets and time slots, so the real
+ * driver code (ROM search, Match/Skip ROM, scratchpad reads with CRC,
+ * resolution writes, alarm search) runs unchanged against it. Used by the
+ * QEMU build, where there is no bus to drive. Temperatures follow a slow
+ * deterministic pattern, quantized to each device's resolution.
+ */
+
+#ifndef ONEWIRE_SIM_H
+#define ONEWIRE_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ONEWIRE_SIM_MAX_DEVICES 64
+
+/**
+ * @brief One simulated DS18B20
+ */
+typedef struct {
+    uint8_t rom[8];             /**< Family 0x28, serial, CRC */
+    uint8_t scratchpad[9];      /**< Temperature, TH, TL, config, reserved, CRC */
+    int16_t base_raw;           /**< Temperature pattern centre, 1/16 °C */
+    bool active;                /**< Still addressed in the current transaction */
+} onewire_sim_device_t;
+
+typedef enum {
+    OW_SIM_IDLE,                /**< Ignores slots until the next reset */
+    OW_SIM_ROM_CMD,
+    OW_SIM_MATCH,
+    OW_SIM_SEARCH,
+    OW_SIM_FUNC_CMD,
+    OW_SIM_WRITE_SCRATCH,
+    OW_SIM_READ,                /**< Devices are sending out_buf */
+} onewire_sim_state_t;
+
+typedef struct {
+    onewire_sim_device_t dev[ONEWIRE_SIM_MAX_DEVICES];
+    int count;
+    onewire_sim_state_t state;
+    uint8_t in_byte;            /**< Bits received of the current byte */
+    int in_bits;
+    int pos;                    /**< Bit (match, search) or byte (scratchpad write) index */
+    int search_phase;           /**< 0 = id bit, 1 = complement, 2 = direction */
+    uint8_t out_buf[9];
+    int out_bits;               /**< Bits in out_buf */
+    int out_pos;
+    uint32_t conversions;       /**< Convert commands, drives the pattern */
+    uint32_t resets;
+} onewire_sim_t;
+
+/**
+ * @brief Populate the bus with @p count sensors (clamped to the maximum)
+ */
+void onewire_sim_init(onewire_sim_t *sim, int count);
+
+/**
+ * @brief Reset pulse
+ * @return True if any device answered with a presence pulse
+ */
+bool onewire_sim_reset(onewire_sim_t *sim);
+
+/**
+ * @brief Write time slot
+ */
+void onewire_sim_write_bit(onewire_sim_t *sim, uint8_t bit);
+
+/**
+ * @brief Read time slot: the wired-AND of what the addressed devices send
+ */
+uint8_t onewire_sim_read_bit(onewire_sim_t *sim);
+
+/**
+ * @brief Dallas/Maxim CRC-8 (the ROM and scratchpad CRC)
+ */
+uint8_t onewire_sim_crc8(const uint8_t *data, int len);
+
+#endif /* ONEWIRE_SIM_H */
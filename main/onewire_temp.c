@@ -4,6 +4,8 @@
  */
 
 #include "onewire_temp.h"
+#include "power_manager.h"
+#include "time_sync.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "driver/gpio.h"
@@ -11,15 +13,29 @@
 #include "freertos/task.h"
 #include "onewire_bus.h"
 #include "onewire_cmd.h"
+#include "onewire_crc.h"
 #include "ds18b20.h"
 #include <string.h>
+#include <stdlib.h>
+#if CONFIG_ONEWIRE_SIMULATED
+#include "onewire_bus_interface.h"
+#include "onewire_sim.h"
+#endif
 
 static const char *TAG = "onewire_temp";
 
 static onewire_bus_handle_t s_bus_handle = NULL;
+static int s_gpio_num = -1;
 static ds18b20_device_handle_t *s_ds18b20_handles = NULL;
+static uint64_t *s_addresses = NULL;   /* Indexed like s_ds18b20_handles */
 static int s_device_count = 0;
 static int s_resolution = 12;
+static uint32_t s_generation = 0;   /* Bumped whenever the device list is replaced */
+static int64_t s_convert_us = 0;    /* When the last convert command was sent */
+
+/* Measured bus costs, smoothed (0 = not measured yet) */
+static uint32_t s_overhead_us = 0;
+static uint32_t s_scratchpad_us = 0;
 
 /* Bus error statistics */
 static uint32_t s_total_reads = 0;
@@ -28,21 +44,108 @@ static uint32_t s_failed_reads = 0;
 /* DS18B20 family code and commands */
 #define DS18B20_FAMILY_CODE     0x28
 #define DS18B20_CMD_CONVERT     0x44
+#define DS18B20_CMD_ALARM_SEARCH 0xEC
 
-esp_err_t onewire_temp_init(int gpio_num)
+/* Search errors in a row before a scan gives up on a broken bus */
+#define SCAN_MAX_ERRORS 8
+
+#if CONFIG_ONEWIRE_SIMULATED
+/* Simulated bus (QEMU build): the driver code above it runs unchanged.
+ * Transactions take no time, so measured bus costs read as zero. */
+typedef struct {
+    struct onewire_bus_t base;
+    onewire_sim_t sim;
+} sim_bus_t;
+
+static esp_err_t sim_reset(struct onewire_bus_t *bus)
 {
-    ESP_LOGD(TAG, "Initializing 1-Wire bus on GPIO %d", gpio_num);
+    sim_bus_t *sb = __containerof(bus, sim_bus_t, base);
+    return onewire_sim_reset(&sb->sim) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t sim_write_bit(struct onewire_bus_t *bus, uint8_t tx_bit)
+{
+    sim_bus_t *sb = __containerof(bus, sim_bus_t, base);
+    onewire_sim_write_bit(&sb->sim, tx_bit);
+    return ESP_OK;
+}
+
+static esp_err_t sim_read_bit(struct onewire_bus_t *bus, uint8_t *rx_bit)
+{
+    sim_bus_t *sb = __containerof(bus, sim_bus_t, base);
+    *rx_bit = onewire_sim_read_bit(&sb->sim);
+    return ESP_OK;
+}
 
+static esp_err_t sim_write_bytes(struct onewire_bus_t *bus, const uint8_t *tx_data, uint8_t tx_data_size)
+{
+    for (int i = 0; i < tx_data_size; i++) {
+        for (int b = 0; b < 8; b++) {
+            sim_write_bit(bus, (tx_data[i] >> b) & 1);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_read_bytes(struct onewire_bus_t *bus, uint8_t *rx_buf, size_t rx_buf_size)
+{
+    for (size_t i = 0; i < rx_buf_size; i++) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) {
+            uint8_t bit;
+            sim_read_bit(bus, &bit);
+            byte |= (uint8_t)(bit << b);
+        }
+        rx_buf[i] = byte;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_del(struct onewire_bus_t *bus)
+{
+    free(__containerof(bus, sim_bus_t, base));
+    return ESP_OK;
+}
+
+static esp_err_t create_bus(void)
+{
+    sim_bus_t *sb = calloc(1, sizeof(sim_bus_t));
+    if (sb == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    onewire_sim_init(&sb->sim, CONFIG_ONEWIRE_SIM_SENSORS);
+    sb->base.reset = sim_reset;
+    sb->base.write_bit = sim_write_bit;
+    sb->base.read_bit = sim_read_bit;
+    sb->base.write_bytes = sim_write_bytes;
+    sb->base.read_bytes = sim_read_bytes;
+    sb->base.del = sim_del;
+    s_bus_handle = &sb->base;
+    ESP_LOGW(TAG, "Using a simulated 1-Wire bus with %d sensors", sb->sim.count);
+    return ESP_OK;
+}
+#else
+static esp_err_t create_bus(void)
+{
     /* Configure 1-Wire bus */
     onewire_bus_config_t bus_config = {
-        .bus_gpio_num = gpio_num,
+        .bus_gpio_num = s_gpio_num,
     };
     
     onewire_bus_rmt_config_t rmt_config = {
         .max_rx_bytes = 10,  /* 1 byte ROM command + 8 bytes ROM + 1 byte CRC */
     };
 
-    esp_err_t err = onewire_new_bus_rmt(&bus_config, &rmt_config, &s_bus_handle);
+    return onewire_new_bus_rmt(&bus_config, &rmt_config, &s_bus_handle);
+}
+#endif
+
+esp_err_t onewire_temp_init(int gpio_num)
+{
+    ESP_LOGD(TAG, "Initializing 1-Wire bus on GPIO %d", gpio_num);
+
+    s_gpio_num = gpio_num;
+    esp_err_t err = create_bus();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize 1-Wire bus: %s", esp_err_to_name(err));
         return err;
@@ -52,7 +155,57 @@ esp_err_t onewire_temp_init(int gpio_num)
     return ESP_OK;
 }
 
-esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count)
+esp_err_t onewire_temp_bus_reset(void)
+{
+    if (s_bus_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    power_manager_acquire(PM_ACTIVITY_BUS);
+    esp_err_t err = onewire_bus_reset(s_bus_handle);
+    power_manager_release(PM_ACTIVITY_BUS);
+    return err;
+}
+
+esp_err_t onewire_temp_recreate_bus(void)
+{
+    /* Device handles point at the bus, so they go first */
+    for (int i = 0; i < s_device_count; i++) {
+        if (s_ds18b20_handles[i] != NULL) {
+            ds18b20_del_device(s_ds18b20_handles[i]);
+            s_ds18b20_handles[i] = NULL;
+        }
+    }
+    if (s_bus_handle != NULL) {
+        onewire_bus_del(s_bus_handle);
+        s_bus_handle = NULL;
+    }
+
+    esp_err_t err = create_bus();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to re-create 1-Wire bus: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    power_manager_acquire(PM_ACTIVITY_BUS);
+    int restored = 0;
+    for (int i = 0; i < s_device_count; i++) {
+        onewire_device_t device = { .bus = s_bus_handle, .address = s_addresses[i] };
+        ds18b20_config_t ds18b20_config = {};
+        if (ds18b20_new_device(&device, &ds18b20_config, &s_ds18b20_handles[i]) != ESP_OK) {
+            s_ds18b20_handles[i] = NULL;
+            continue;
+        }
+        ds18b20_set_resolution(s_ds18b20_handles[i], (ds18b20_resolution_t)(s_resolution - 9));
+        restored++;
+    }
+    power_manager_release(PM_ACTIVITY_BUS);
+
+    ESP_LOGW(TAG, "1-Wire bus re-created, %d of %d devices restored", restored, s_device_count);
+    return ESP_OK;
+}
+
+esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count,
+                            onewire_yield_fn_t yield, void *yield_ctx)
 {
     ESP_LOGD(TAG, "Scanning for DS18B20 sensors...");
     
@@ -60,29 +213,46 @@ esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *fou
     onewire_device_iter_handle_t iter = NULL;
     onewire_device_t next_device;
 
+    /* Build the new handle list on the side; reads run during yield() keep
+     * using the current one until the scan is complete */
+    if (s_bus_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ds18b20_device_handle_t *handles = calloc(max_sensors, sizeof(ds18b20_device_handle_t));
+    uint64_t *addresses = calloc(max_sensors, sizeof(uint64_t));
+    if (handles == NULL || addresses == NULL) {
+        free(handles);
+        free(addresses);
+        return ESP_ERR_NO_MEM;
+    }
+    int scan_resolution = s_resolution;
+
     /* Create iterator */
     esp_err_t err = onewire_new_device_iter(s_bus_handle, &iter);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create device iterator");
+        free(handles);
+        free(addresses);
         return err;
     }
 
-    /* Allocate handles array if needed */
-    if (s_ds18b20_handles) {
-        free(s_ds18b20_handles);
-    }
-    s_ds18b20_handles = calloc(max_sensors, sizeof(ds18b20_device_handle_t));
-    
     /* Iterate through all devices */
+    int errors = 0;
     while (count < max_sensors) {
+        power_manager_acquire(PM_ACTIVITY_BUS);
         err = onewire_device_iter_get_next(iter, &next_device);
+        power_manager_release(PM_ACTIVITY_BUS);
         if (err == ESP_ERR_NOT_FOUND) {
             break;  /* No more devices */
         }
         if (err != ESP_OK) {
             ESP_LOGW(TAG, "Error iterating devices: %s", esp_err_to_name(err));
+            if (++errors >= SCAN_MAX_ERRORS) {
+                break;  /* A broken bus would otherwise keep this loop going */
+            }
             continue;
         }
+        errors = 0;
 
         /* Check if this is a DS18B20 (family code 0x28) */
         if ((next_device.address & 0xFF) != DS18B20_FAMILY_CODE) {
@@ -92,28 +262,38 @@ esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *fou
 
         /* Store address in sensor struct */
         memcpy(sensors[count].address, &next_device.address, ONEWIRE_ROM_SIZE);
+        addresses[count] = next_device.address;
         sensors[count].valid = false;
         sensors[count].temperature = 0.0f;
         sensors[count].last_read_time = 0;
+        sensors[count].sample_time = 0;
         sensors[count].total_reads = 0;
         sensors[count].failed_reads = 0;
 
         /* Create DS18B20 device handle */
         ds18b20_config_t ds18b20_config = {};
-        err = ds18b20_new_device(&next_device, &ds18b20_config, &s_ds18b20_handles[count]);
+        err = ds18b20_new_device(&next_device, &ds18b20_config, &handles[count]);
         if (err != ESP_OK) {
             ESP_LOGW(TAG, "Failed to create DS18B20 handle");
             continue;
         }
 
         /* Set resolution */
-        ds18b20_set_resolution(s_ds18b20_handles[count], (ds18b20_resolution_t)(s_resolution - 9));
+        power_manager_acquire(PM_ACTIVITY_BUS);
+        ds18b20_set_resolution(handles[count], (ds18b20_resolution_t)(scan_resolution - 9));
+        power_manager_release(PM_ACTIVITY_BUS);
 
         char addr_str[17];
         onewire_address_to_string(sensors[count].address, addr_str);
         ESP_LOGD(TAG, "Found DS18B20: %s", addr_str);
 
         count++;
+
+        /* Transaction boundary: the search state lives in the iterator, so
+         * other bus commands may run here before the next search pass */
+        if (yield != NULL) {
+            yield(yield_ctx);
+        }
     }
 
     /* Clean up iterator */
@@ -125,13 +305,120 @@ esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *fou
                  "Increase CONFIG_MAX_SENSORS in menuconfig to support more.", max_sensors);
     }
 
+    /* Resolution changed while scanning - bring early finds up to date */
+    if (s_resolution != scan_resolution) {
+        power_manager_acquire(PM_ACTIVITY_BUS);
+        for (int i = 0; i < count; i++) {
+            if (handles[i] != NULL) {
+                ds18b20_set_resolution(handles[i], (ds18b20_resolution_t)(s_resolution - 9));
+            }
+        }
+        power_manager_release(PM_ACTIVITY_BUS);
+    }
+
+    /* Swap in the new list and release the old device handles */
+    ds18b20_device_handle_t *old_handles = s_ds18b20_handles;
+    int old_count = s_device_count;
+    free(s_addresses);
+    s_ds18b20_handles = handles;
+    s_addresses = addresses;
     s_device_count = count;
+    s_generation++;
+    if (old_handles) {
+        for (int i = 0; i < old_count; i++) {
+            if (old_handles[i] != NULL) {
+                ds18b20_del_device(old_handles[i]);
+            }
+        }
+        free(old_handles);
+    }
+
     *found_count = count;
     
     ESP_LOGI(TAG, "Found %d DS18B20 sensor(s)", count);
     return ESP_OK;
 }
 
+esp_err_t onewire_temp_alarm_search(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max_found, int *found_count)
+{
+    uint8_t rom[ONEWIRE_ROM_SIZE] = {0};
+    int last_discrepancy = 0;   /* 1-based bit position, 0 = search complete */
+    int count = 0;
+    esp_err_t result = ESP_OK;
+
+    *found_count = 0;
+    if (s_bus_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    power_manager_acquire(PM_ACTIVITY_BUS);
+
+    /* Standard ROM search, but only devices with the alarm flag respond */
+    do {
+        esp_err_t err = onewire_bus_reset(s_bus_handle);
+        if (err != ESP_OK) {
+            /* No presence pulse means no device at all, not an error */
+            result = (err == ESP_ERR_NOT_FOUND) ? ESP_OK : err;
+            break;
+        }
+        uint8_t cmd = DS18B20_CMD_ALARM_SEARCH;
+        err = onewire_bus_write_bytes(s_bus_handle, &cmd, 1);
+        if (err != ESP_OK) {
+            result = err;
+            break;
+        }
+
+        int last_zero = 0;
+        bool none = false;
+        for (int bit = 1; bit <= ONEWIRE_ROM_SIZE * 8 && err == ESP_OK; bit++) {
+            uint8_t id_bit = 0, cmp_bit = 0;
+            err = onewire_bus_read_bit(s_bus_handle, &id_bit);
+            if (err == ESP_OK) {
+                err = onewire_bus_read_bit(s_bus_handle, &cmp_bit);
+            }
+            if (err != ESP_OK) {
+                break;
+            }
+            if (id_bit && cmp_bit) {
+                none = true;    /* Nobody is alarming (or a device dropped out) */
+                break;
+            }
+
+            int byte = (bit - 1) / 8;
+            uint8_t mask = 1 << ((bit - 1) % 8);
+            uint8_t dir;
+            if (id_bit != cmp_bit) {
+                dir = id_bit;
+            } else {
+                /* Discrepancy: repeat the previous path before it, then branch */
+                dir = bit < last_discrepancy ? ((rom[byte] & mask) != 0) : (bit == last_discrepancy);
+                if (!dir) {
+                    last_zero = bit;
+                }
+            }
+            rom[byte] = dir ? (rom[byte] | mask) : (rom[byte] & ~mask);
+            err = onewire_bus_write_bit(s_bus_handle, dir);
+        }
+        if (err != ESP_OK) {
+            result = err;
+            break;
+        }
+        if (none) {
+            break;
+        }
+        if (onewire_crc8(0, rom, ONEWIRE_ROM_SIZE - 1) != rom[ONEWIRE_ROM_SIZE - 1]) {
+            result = ESP_ERR_INVALID_CRC;
+            break;
+        }
+
+        memcpy(addresses[count++], rom, ONEWIRE_ROM_SIZE);
+        last_discrepancy = last_zero;
+    } while (last_discrepancy != 0 && count < max_found);
+
+    power_manager_release(PM_ACTIVITY_BUS);
+    *found_count = count;
+    return result;
+}
+
 esp_err_t onewire_temp_read(onewire_sensor_t *sensor, int index)
 {
     if (index < 0 || index >= s_device_count || s_ds18b20_handles[index] == NULL) {
@@ -141,8 +428,11 @@ esp_err_t onewire_temp_read(onewire_sensor_t *sensor, int index)
     }
 
     /* Trigger temperature conversion (library handles resolution-based delay) */
+    power_manager_acquire(PM_ACTIVITY_BUS);
+    int64_t convert_us = esp_timer_get_time();
     esp_err_t err = ds18b20_trigger_temperature_conversion(s_ds18b20_handles[index]);
     if (err != ESP_OK) {
+        power_manager_release(PM_ACTIVITY_BUS);
         ESP_LOGE(TAG, "Failed to trigger conversion for sensor %d", index);
         sensor->valid = false;
         return err;
@@ -151,6 +441,7 @@ esp_err_t onewire_temp_read(onewire_sensor_t *sensor, int index)
     /* Read temperature */
     float temp;
     err = ds18b20_get_temperature(s_ds18b20_handles[index], &temp);
+    power_manager_release(PM_ACTIVITY_BUS);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read temperature from sensor %d", index);
         sensor->valid = false;
@@ -160,46 +451,90 @@ esp_err_t onewire_temp_read(onewire_sensor_t *sensor, int index)
     sensor->temperature = temp;
     sensor->valid = true;
     sensor->last_read_time = esp_timer_get_time() / 1000;  /* Convert to ms */
+    sensor->sample_time = time_sync_to_epoch_ms(convert_us);
 
     return ESP_OK;
 }
 
+/* Conversion time by resolution: 9, 10, 11, 12 bit */
+static const int s_conversion_ms[] = {100, 200, 400, 800};
+
+int onewire_temp_get_conversion_ms(void)
+{
+    int idx = s_resolution - 9;
+    if (idx < 0) idx = 0;
+    if (idx > 3) idx = 3;
+    return s_conversion_ms[idx];
+}
+
 esp_err_t onewire_temp_read_all(onewire_sensor_t *sensors, int sensor_count)
+{
+    return onewire_temp_read_selected(sensors, sensor_count, NULL);
+}
+
+/**
+ * @brief Fold a timing sample into a smoothed value (1/8 weight)
+ */
+static void smooth_us(uint32_t *avg, int64_t sample_us)
+{
+    uint32_t sample = sample_us > 0 ? (uint32_t)sample_us : 0;
+    *avg = *avg == 0 ? sample : *avg + ((int32_t)(sample - *avg) >> 3);
+}
+
+esp_err_t onewire_temp_read_selected(onewire_sensor_t *sensors, int sensor_count, const bool *selected)
 {
     if (sensor_count == 0 || sensor_count > s_device_count) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (s_bus_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;   /* Re-creation failed */
+    }
 
     int64_t start_time = esp_timer_get_time();
 
     /* Step 1: Reset bus */
+    power_manager_acquire(PM_ACTIVITY_BUS);
     esp_err_t err = onewire_bus_reset(s_bus_handle);
     if (err != ESP_OK) {
+        power_manager_release(PM_ACTIVITY_BUS);
         ESP_LOGE(TAG, "Bus reset failed");
         return err;
     }
     
     /* Step 2: Send Skip ROM + Convert command to all devices at once */
     uint8_t cmd[2] = {ONEWIRE_CMD_SKIP_ROM, DS18B20_CMD_CONVERT};
+    s_convert_us = esp_timer_get_time();
     err = onewire_bus_write_bytes(s_bus_handle, cmd, sizeof(cmd));
+    power_manager_release(PM_ACTIVITY_BUS);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send convert command");
         return err;
     }
+    smooth_us(&s_overhead_us, esp_timer_get_time() - start_time);
     
-    /* Step 3: Wait for conversion (based on resolution) */
-    const int delays_ms[] = {100, 200, 400, 800};  /* 9, 10, 11, 12 bit */
-    int delay_idx = s_resolution - 9;
-    if (delay_idx < 0) delay_idx = 0;
-    if (delay_idx > 3) delay_idx = 3;
-    vTaskDelay(pdMS_TO_TICKS(delays_ms[delay_idx]));
+    /* Step 3: Wait for conversion (based on resolution). The bus is idle
+     * here, so the system may scale down or sleep. */
+    int delay_ms = onewire_temp_get_conversion_ms();
+    int64_t due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    power_manager_check_deadline(due_us);
     
-    /* Step 4: Read temperature from each sensor */
-    int64_t now = esp_timer_get_time() / 1000;
+    /* Step 4: Read temperature from each selected sensor. Every device has
+     * converted, but only the scratchpads asked for cost bus time. */
+    power_manager_acquire(PM_ACTIVITY_BUS);
+    int64_t read_start = esp_timer_get_time();
+    int64_t now = read_start / 1000;
+    /* All sensors sampled at the convert command */
+    int64_t sample_time = time_sync_to_epoch_ms(s_convert_us);
     esp_err_t result = ESP_OK;
+    int read_count = 0;
     
     for (int i = 0; i < sensor_count && i < s_device_count; i++) {
+        if (selected != NULL && !selected[i]) {
+            continue;
+        }
         if (s_ds18b20_handles[i] != NULL) {
+            read_count++;
             float temp;
             s_total_reads++;
             sensors[i].total_reads++;
@@ -208,6 +543,7 @@ esp_err_t onewire_temp_read_all(onewire_sensor_t *sensors, int sensor_count)
                 sensors[i].temperature = temp;
                 sensors[i].valid = true;
                 sensors[i].last_read_time = now;
+                sensors[i].sample_time = sample_time;
             } else {
                 s_failed_reads++;
                 sensors[i].failed_reads++;
@@ -218,12 +554,28 @@ esp_err_t onewire_temp_read_all(onewire_sensor_t *sensors, int sensor_count)
         }
     }
 
+    power_manager_release(PM_ACTIVITY_BUS);
+    if (read_count > 0) {
+        smooth_us(&s_scratchpad_us, (esp_timer_get_time() - read_start) / read_count);
+    }
+
     int64_t elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
-    ESP_LOGD(TAG, "Read %d sensors in %lld ms", sensor_count, elapsed_ms);
+    ESP_LOGD(TAG, "Read %d sensors in %lld ms", read_count, elapsed_ms);
 
     return result;
 }
 
+int64_t onewire_temp_get_convert_time(void)
+{
+    return s_convert_us;
+}
+
+void onewire_temp_get_timing(uint32_t *overhead_us, uint32_t *scratchpad_us)
+{
+    *overhead_us = s_overhead_us;
+    *scratchpad_us = s_scratchpad_us;
+}
+
 void onewire_address_to_string(const uint8_t *address, char *str)
 {
     sprintf(str, "%02X%02X%02X%02X%02X%02X%02X%02X",
@@ -236,6 +588,11 @@ int onewire_temp_get_resolution(void)
     return s_resolution;
 }
 
+uint32_t onewire_temp_get_generation(void)
+{
+    return s_generation;
+}
+
 void onewire_temp_get_error_stats(uint32_t *total_reads, uint32_t *failed_reads)
 {
     if (total_reads) *total_reads = s_total_reads;
@@ -258,11 +615,13 @@ esp_err_t onewire_temp_set_resolution(int bits)
     s_resolution = bits;
     
     /* Update all existing devices */
+    power_manager_acquire(PM_ACTIVITY_BUS);
     for (int i = 0; i < s_device_count; i++) {
         if (s_ds18b20_handles[i] != NULL) {
             ds18b20_set_resolution(s_ds18b20_handles[i], (ds18b20_resolution_t)(bits - 9));
         }
     }
+    power_manager_release(PM_ACTIVITY_BUS);
     
     ESP_LOGD(TAG, "Resolution set to %d bits", bits);
     return ESP_OK;
@@ -20,6 +20,7 @@ typedef struct {
     float temperature;                    /**< Last read temperature in Celsius */
     bool valid;                           /**< True if last reading was valid */
     int64_t last_read_time;              /**< Timestamp of last reading */
+    int64_t sample_time;                 /**< Conversion start, ms since the epoch (0 = clock not set) */
     uint32_t total_reads;                /**< Total read attempts for this sensor */
     uint32_t failed_reads;               /**< Failed read count for this sensor */
 } onewire_sensor_t;
@@ -30,13 +31,54 @@ typedef struct {
  */
 esp_err_t onewire_temp_init(int gpio_num);
 
+/**
+ * @brief Callback run between search passes of a scan
+ */
+typedef void (*onewire_yield_fn_t)(void *ctx);
+
 /**
  * @brief Scan bus and discover all connected sensors
+ *
+ * The device list used by reads is replaced only when the scan completes, so
+ * @p yield may run other bus transactions (reads, resolution changes) at
+ * each transaction boundary.
+ *
  * @param sensors Array to store discovered sensors
  * @param max_sensors Maximum number of sensors to discover
  * @param found_count Output: actual number of sensors found
+ * @param yield Called after each device is found (may be NULL)
+ * @param yield_ctx Argument for @p yield
+ */
+esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count,
+                            onewire_yield_fn_t yield, void *yield_ctx);
+
+/**
+ * @brief Find sensors whose alarm flag is set (Alarm Search, 0xEC)
+ *
+ * A DS18B20 flags an alarm when its last conversion was above TH or below TL.
+ *
+ * @param addresses Output: ROM addresses of alarming sensors
+ * @param max_found Capacity of @p addresses
+ * @param found_count Output: number of addresses written
+ */
+esp_err_t onewire_temp_alarm_search(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max_found, int *found_count);
+
+/**
+ * @brief Send a reset pulse (recovery)
+ *
+ * Releases devices stuck in the middle of a transaction.
+ *
+ * @return ESP_ERR_NOT_FOUND if no device answered
  */
-esp_err_t onewire_temp_scan(onewire_sensor_t *sensors, int max_sensors, int *found_count);
+esp_err_t onewire_temp_bus_reset(void);
+
+/**
+ * @brief Delete and re-create the RMT bus driver (recovery)
+ *
+ * Device handles are rebuilt for the same addresses, so the device list
+ * and its generation do not change.
+ */
+esp_err_t onewire_temp_recreate_bus(void);
 
 /**
  * @brief Read temperature from a specific sensor by index
@@ -52,6 +94,33 @@ esp_err_t onewire_temp_read(onewire_sensor_t *sensor, int index);
  */
 esp_err_t onewire_temp_read_all(onewire_sensor_t *sensors, int sensor_count);
 
+/**
+ * @brief Convert all sensors at once, then read only the selected ones
+ * @param sensors Array of sensors, indexed like the bus
+ * @param sensor_count Number of sensors in array
+ * @param selected Sensors to read (sensor_count entries), NULL for all
+ */
+esp_err_t onewire_temp_read_selected(onewire_sensor_t *sensors, int sensor_count, const bool *selected);
+
+/**
+ * @brief Conversion wait at the current resolution, in ms
+ */
+int onewire_temp_get_conversion_ms(void);
+
+/**
+ * @brief Time the last convert command went out (esp_timer µs)
+ *
+ * Only meaningful on the bus task, right after a read.
+ */
+int64_t onewire_temp_get_convert_time(void);
+
+/**
+ * @brief Measured bus costs, smoothed over recent reads (0 until measured)
+ * @param overhead_us Output: reset + Skip ROM + Convert
+ * @param scratchpad_us Output: one scratchpad read
+ */
+void onewire_temp_get_timing(uint32_t *overhead_us, uint32_t *scratchpad_us);
+
 /**
  * @brief Convert sensor address to hex string
  * @param address 8-byte sensor address
@@ -64,6 +133,14 @@ void onewire_address_to_string(const uint8_t *address, char *str);
  */
 int onewire_temp_get_resolution(void);
 
+/**
+ * @brief Get the device list generation
+ *
+ * Incremented each time a scan replaces the device list, so a caller can
+ * tell whether the indices it holds still refer to the same sensors.
+ */
+uint32_t onewire_temp_get_generation(void);
+
 /**
  * @brief Set resolution (9-12 bits)
  */
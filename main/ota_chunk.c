@@ -0,0 +1,66 @@
+/**
+ * @file ota_chunk.c
+ * @brief Resumable firmware upload bookkeeping (host-testable)
+ */
+
+#include "ota_chunk.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Parse a decimal uint32 and advance past it
+ */
+static bool parse_u32(const char **p, uint32_t *out)
+{
+    if (!isdigit((unsigned char)**p)) {
+        return false;
+    }
+    char *end;
+    unsigned long long v = strtoull(*p, &end, 10);
+    if (v > UINT32_MAX) {
+        return false;
+    }
+    *out = (uint32_t)v;
+    *p = end;
+    return true;
+}
+
+bool ota_parse_content_range(const char *value, ota_range_t *range)
+{
+    if (value == NULL || strncmp(value, "bytes ", 6) != 0) {
+        return false;
+    }
+    const char *p = value + 6;
+    while (*p == ' ') {
+        p++;
+    }
+    if (!parse_u32(&p, &range->first) || *p++ != '-' ||
+        !parse_u32(&p, &range->last) || *p++ != '/' ||
+        !parse_u32(&p, &range->total) || *p != '\0') {
+        return false;
+    }
+    return range->first <= range->last && range->last < range->total;
+}
+
+ota_chunk_action_t ota_chunk_plan(uint32_t committed, uint32_t size, const ota_range_t *range,
+                                  uint32_t *skip)
+{
+    *skip = 0;
+    if (range->total != size || range->last >= size) {
+        return OTA_CHUNK_INVALID;
+    }
+    if (range->first > committed) {
+        return OTA_CHUNK_GAP;
+    }
+    if (range->last < committed) {
+        return OTA_CHUNK_DUPLICATE;
+    }
+    *skip = committed - range->first;
+    return OTA_CHUNK_APPEND;
+}
+
+uint32_t ota_resume_offset(uint32_t committed, uint32_t sector_size)
+{
+    return committed & ~(sector_size - 1);
+}
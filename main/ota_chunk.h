@@ -0,0 +1,75 @@
+/**
+ * @file ota_chunk.h
+ * @brief Resumable firmware upload bookkeeping (host-testable)
+ *
+ * A resumable upload sends the image as a series of requests, each carrying
+ * a Content-Range. The device commits bytes in order, so a retry after a
+ * dropped connection restarts from the committed offset instead of from 0.
+ */
+
+#ifndef OTA_CHUNK_H
+#define OTA_CHUNK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define OTA_SESSION_ID_LEN      16      /**< Hex characters in a session ID */
+#define OTA_SHA256_LEN          32
+
+/**
+ * @brief Upload session as persisted in NVS, so a reboot does not lose it
+ */
+typedef struct {
+    char id[OTA_SESSION_ID_LEN + 1];
+    uint32_t size;                      /**< Image size announced by the client */
+    uint32_t offset;                    /**< Bytes written and hashed */
+    uint32_t partition_addr;            /**< Flash address of the target slot */
+    uint8_t sha256[OTA_SHA256_LEN];     /**< Digest the image must match */
+} ota_session_record_t;
+
+/**
+ * @brief Byte range of one chunk: "bytes <first>-<last>/<total>"
+ */
+typedef struct {
+    uint32_t first;
+    uint32_t last;                      /**< Inclusive */
+    uint32_t total;
+} ota_range_t;
+
+typedef enum {
+    OTA_CHUNK_APPEND,       /**< Starts at or before the offset; write from skip */
+    OTA_CHUNK_DUPLICATE,    /**< Already committed (a retried request); nothing to write */
+    OTA_CHUNK_GAP,          /**< Starts past the offset; client must resume from it */
+    OTA_CHUNK_INVALID,      /**< Total differs from the session, or past the end */
+} ota_chunk_action_t;
+
+/**
+ * @brief Parse a Content-Range header value
+ * @return true for a well-formed "bytes a-b/n" with a <= b < n
+ */
+bool ota_parse_content_range(const char *value, ota_range_t *range);
+
+/**
+ * @brief Decide what to do with a chunk given the committed offset
+ * @param committed Bytes already committed
+ * @param size Session image size
+ * @param range Parsed Content-Range of the chunk
+ * @param skip Set for OTA_CHUNK_APPEND: leading bytes of the chunk already committed
+ */
+ota_chunk_action_t ota_chunk_plan(uint32_t committed, uint32_t size, const ota_range_t *range,
+                                  uint32_t *skip);
+
+/**
+ * @brief Offset to restart writing from after a reboot
+ *
+ * Writes are erased a flash sector at a time as they reach it, so after a
+ * reboot the sector holding the offset may contain bytes past it that were
+ * never committed. Restarting at the sector start erases it again.
+ *
+ * @param committed Offset persisted before the reboot
+ * @param sector_size Flash erase sector size (power of two)
+ */
+uint32_t ota_resume_offset(uint32_t committed, uint32_t sector_size);
+
+#endif /* OTA_CHUNK_H */
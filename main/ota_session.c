@@ -0,0 +1,293 @@
+/**
+ * @file ota_session.c
+ * @brief Resumable, SHA-256 verified firmware uploads
+ */
+
+#include "ota_session.h"
+#include "nvs_storage.h"
+#include "auth_utils.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_random.h"
+#include "esp_idf_version.h"
+#include "mbedtls/sha256.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "ota_session";
+
+#define FLASH_SECTOR_SIZE   4096
+
+/* Only touched from HTTP handlers, which the server runs one at a time */
+static ota_session_record_t s_record;   /* No session while id[0] == 0 */
+static bool s_open;                     /* Handle and hash are at s_record.offset */
+static bool s_restored;
+static uint32_t s_persisted;
+static uint32_t s_retries;
+static esp_ota_handle_t s_handle;
+static const esp_partition_t *s_partition;
+static mbedtls_sha256_context s_sha;
+
+/**
+ * @brief Forget the session, here and in NVS
+ */
+static void discard(void)
+{
+    if (s_open) {
+        esp_ota_abort(s_handle);
+        mbedtls_sha256_free(&s_sha);
+        s_open = false;
+    }
+    if (s_record.id[0] != '\0') {
+        nvs_storage_save_ota_session(NULL);
+    }
+    memset(&s_record, 0, sizeof(s_record));
+    s_restored = false;
+    s_persisted = 0;
+    s_retries = 0;
+}
+
+static void persist(void)
+{
+    if (nvs_storage_save_ota_session(&s_record) == ESP_OK) {
+        s_persisted = s_record.offset;
+    }
+}
+
+static esp_err_t start_writing(void)
+{
+    s_partition = esp_ota_get_next_update_partition(NULL);
+    if (s_partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_record.size > s_partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    /* Sequential writes erase each sector as it is reached, not the whole slot up front */
+    esp_err_t err = esp_ota_begin(s_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mbedtls_sha256_init(&s_sha);
+    mbedtls_sha256_starts(&s_sha, 0);
+    s_record.partition_addr = s_partition->address;
+    s_record.offset = 0;
+    s_open = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief Reopen a session saved by the previous boot
+ *
+ * The hash is rebuilt from what is in flash, so the final digest check
+ * also covers the bytes written before the reboot.
+ */
+static esp_err_t resume_saved(void)
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0)
+    s_partition = esp_ota_get_next_update_partition(NULL);
+    if (s_partition == NULL || s_partition->address != s_record.partition_addr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t *buf = malloc(FLASH_SECTOR_SIZE);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t offset = ota_resume_offset(s_record.offset, FLASH_SECTOR_SIZE);
+    esp_err_t err = ESP_OK;
+    mbedtls_sha256_init(&s_sha);
+    mbedtls_sha256_starts(&s_sha, 0);
+    for (uint32_t pos = 0; pos < offset && err == ESP_OK; pos += FLASH_SECTOR_SIZE) {
+        err = esp_partition_read(s_partition, pos, buf, FLASH_SECTOR_SIZE);
+        if (err == ESP_OK) {
+            mbedtls_sha256_update(&s_sha, buf, FLASH_SECTOR_SIZE);
+        }
+    }
+    free(buf);
+    if (err == ESP_OK) {
+        err = esp_ota_resume(s_partition, OTA_WITH_SEQUENTIAL_WRITES, offset, &s_handle);
+    }
+    if (err != ESP_OK) {
+        mbedtls_sha256_free(&s_sha);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Resuming upload %s at %lu of %lu bytes", s_record.id,
+             (unsigned long)offset, (unsigned long)s_record.size);
+    s_record.offset = offset;
+    s_persisted = offset;
+    s_open = true;
+    s_restored = true;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Make sure the saved session is open for writing, or drop it
+ */
+static bool ensure_open(void)
+{
+    if (s_open) {
+        return true;
+    }
+    esp_err_t err = resume_saved();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Cannot resume upload %s: %s", s_record.id, esp_err_to_name(err));
+        discard();
+        return false;
+    }
+    return true;
+}
+
+static void fill_status(ota_session_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    if (s_record.id[0] == '\0') {
+        return;
+    }
+    status->active = true;
+    status->restored = s_restored;
+    memcpy(status->id, s_record.id, sizeof(status->id));
+    status->size = s_record.size;
+    status->offset = s_record.offset;
+    status->retries = s_retries;
+}
+
+esp_err_t ota_session_init(void)
+{
+    memset(&s_record, 0, sizeof(s_record));
+    if (nvs_storage_load_ota_session(&s_record) != ESP_OK || s_record.id[0] == '\0') {
+        memset(&s_record, 0, sizeof(s_record));
+        return ESP_OK;
+    }
+    s_record.id[OTA_SESSION_ID_LEN] = '\0';
+    s_persisted = s_record.offset;
+    ESP_LOGI(TAG, "Unfinished upload %s: %lu of %lu bytes", s_record.id,
+             (unsigned long)s_record.offset, (unsigned long)s_record.size);
+    return ESP_OK;
+}
+
+esp_err_t ota_session_open(uint32_t size, const uint8_t sha256[OTA_SHA256_LEN],
+                           ota_session_status_t *status)
+{
+    if (size == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    bool same = s_record.id[0] != '\0' && s_record.size == size &&
+                memcmp(s_record.sha256, sha256, OTA_SHA256_LEN) == 0;
+    if (same && ensure_open()) {
+        fill_status(status);
+        return ESP_OK;
+    }
+
+    discard();
+    s_record.size = size;
+    memcpy(s_record.sha256, sha256, OTA_SHA256_LEN);
+    snprintf(s_record.id, sizeof(s_record.id), "%08lx%08lx",
+             (unsigned long)esp_random(), (unsigned long)esp_random());
+    esp_err_t err = start_writing();
+    if (err != ESP_OK) {
+        memset(&s_record, 0, sizeof(s_record));
+        return err;
+    }
+    persist();
+
+    ESP_LOGI(TAG, "Upload %s started: %lu bytes to %s", s_record.id,
+             (unsigned long)size, s_partition->label);
+    fill_status(status);
+    return ESP_OK;
+}
+
+esp_err_t ota_session_get(const char *id, ota_session_status_t *status)
+{
+    if (s_record.id[0] == '\0' || (id != NULL && strcmp(id, s_record.id) != 0) || !ensure_open()) {
+        memset(status, 0, sizeof(*status));
+        return ESP_ERR_NOT_FOUND;
+    }
+    fill_status(status);
+    return ESP_OK;
+}
+
+esp_err_t ota_session_chunk(const char *id, const ota_range_t *range,
+                            ota_chunk_action_t *action, uint32_t *skip)
+{
+    ota_session_status_t status;
+    esp_err_t err = ota_session_get(id, &status);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *action = ota_chunk_plan(s_record.offset, s_record.size, range, skip);
+    if (*action == OTA_CHUNK_DUPLICATE || (*action == OTA_CHUNK_APPEND && *skip > 0)) {
+        s_retries++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_session_write(const void *data, size_t len)
+{
+    if (!s_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > s_record.size - s_record.offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = esp_ota_write(s_handle, data, len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write at %lu failed: %s", (unsigned long)s_record.offset, esp_err_to_name(err));
+        discard();
+        return err;
+    }
+    mbedtls_sha256_update(&s_sha, data, len);
+    s_record.offset += len;
+    return ESP_OK;
+}
+
+void ota_session_commit(void)
+{
+    if (s_open && s_record.offset != s_persisted) {
+        persist();
+    }
+}
+
+esp_err_t ota_session_finish(void)
+{
+    if (!s_open || s_record.offset != s_record.size) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t digest[OTA_SHA256_LEN];
+    mbedtls_sha256_finish(&s_sha, digest);
+    if (!auth_ct_equal(digest, s_record.sha256, OTA_SHA256_LEN)) {
+        ESP_LOGE(TAG, "Upload %s: SHA-256 mismatch, discarded", s_record.id);
+        discard();
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    mbedtls_sha256_free(&s_sha);
+    s_open = false;
+    esp_err_t err = esp_ota_end(s_handle);
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(s_partition);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Upload %s: %s", s_record.id, esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Upload %s verified, boot partition set to %s", s_record.id, s_partition->label);
+    }
+    discard();
+    return err;
+}
+
+void ota_session_cancel(void)
+{
+    if (s_record.id[0] != '\0') {
+        ESP_LOGI(TAG, "Upload %s discarded at %lu bytes", s_record.id, (unsigned long)s_record.offset);
+    }
+    discard();
+}
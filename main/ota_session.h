@@ -0,0 +1,98 @@
+/**
+ * @file ota_session.h
+ * @brief Resumable, SHA-256 verified firmware uploads
+ *
+ * The client opens a session with the image size and digest, then sends
+ * the image in Content-Range chunks over as many requests as it takes.
+ * Bytes are written to the update slot and hashed as they arrive; progress
+ * is saved to NVS after every chunk, so a dropped connection or a reboot
+ * resumes from the last committed offset. The slot only becomes bootable
+ * once the whole image is in and its digest matches.
+ */
+
+#ifndef OTA_SESSION_H
+#define OTA_SESSION_H
+
+#include "esp_err.h"
+#include "ota_chunk.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    bool active;
+    bool restored;                      /**< Continued from before a reboot */
+    char id[OTA_SESSION_ID_LEN + 1];
+    uint32_t size;
+    uint32_t offset;                    /**< Bytes committed */
+    uint32_t retries;                   /**< Chunks that repeated committed bytes */
+} ota_session_status_t;
+
+/**
+ * @brief Load an upload left unfinished by the previous boot
+ */
+esp_err_t ota_session_init(void);
+
+/**
+ * @brief Open an upload session, or continue the one for the same image
+ *
+ * A session for the same size and digest is kept with its progress, so a
+ * client that lost the session ID can resume. Any other session is
+ * discarded.
+ *
+ * @param size Image size in bytes
+ * @param sha256 Digest the complete image must match
+ * @param status Filled with the session state
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the image does not fit the update slot
+ */
+esp_err_t ota_session_open(uint32_t size, const uint8_t sha256[OTA_SHA256_LEN],
+                           ota_session_status_t *status);
+
+/**
+ * @brief Get the session state
+ * @param id Session ID, or NULL for whichever session exists
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND (status->active is false)
+ */
+esp_err_t ota_session_get(const char *id, ota_session_status_t *status);
+
+/**
+ * @brief Decide what to do with an incoming chunk
+ * @param id Session ID from the request
+ * @param range Content-Range of the chunk
+ * @param action What the caller must do with the body
+ * @param skip Leading bytes of the body to discard for OTA_CHUNK_APPEND
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND for an unknown session
+ */
+esp_err_t ota_session_chunk(const char *id, const ota_range_t *range,
+                            ota_chunk_action_t *action, uint32_t *skip);
+
+/**
+ * @brief Write and hash the next bytes of the image
+ *
+ * A failed write discards the session.
+ *
+ * @return ESP_OK, ESP_ERR_OTA_VALIDATE_FAILED if the image does not start
+ *         with the ESP32 magic byte, or the flash error
+ */
+esp_err_t ota_session_write(const void *data, size_t len);
+
+/**
+ * @brief Save the committed offset, at the end of each chunk request
+ */
+void ota_session_commit(void);
+
+/**
+ * @brief Verify the complete image and make it the boot partition
+ *
+ * The session ends whatever the outcome.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_CRC on a digest mismatch,
+ *         ESP_ERR_OTA_VALIDATE_FAILED if the image is not a valid app
+ */
+esp_err_t ota_session_finish(void);
+
+/**
+ * @brief Discard the session and its progress
+ */
+void ota_session_cancel(void);
+
+#endif /* OTA_SESSION_H */
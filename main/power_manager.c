@@ -0,0 +1,185 @@
+/**
+ * @file power_manager.c
+ * @brief Dynamic frequency scaling and automatic light sleep between
+ *        acquisition cycles
+ *
+ * One ESP_PM_CPU_FREQ_MAX lock per activity class. Holding any of them keeps
+ * the CPU (and APB, which clocks the RMT peripheral) at full speed and
+ * prevents light sleep, so 1-Wire slot timing is never stretched. Between
+ * locks the idle task lets the PM driver drop to the minimum frequency or
+ * sleep until the next timer or network interrupt.
+ *
+ * Note the ESP32 EMAC driver holds its own APB lock while Ethernet is
+ * started, so on PoE the idle state is the minimum CPU frequency rather than
+ * light sleep. On WiFi the node really sleeps between DTIM beacons.
+ */
+
+#include "power_manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+#if CONFIG_POWER_SAVE_ENABLED
+#include "esp_pm.h"
+
+#if CONFIG_POWER_SAVE_LIGHT_SLEEP
+#define LIGHT_SLEEP_ENABLED true
+#else
+#define LIGHT_SLEEP_ENABLED false
+#endif
+#endif
+
+static const char *TAG = "power_mgr";
+
+static const char *s_activity_names[PM_ACTIVITY_COUNT] = {"bus", "http", "net"};
+
+#if CONFIG_POWER_SAVE_ENABLED
+static esp_pm_lock_handle_t s_locks[PM_ACTIVITY_COUNT];
+#endif
+static bool s_enabled = false;
+
+/* Accounting - touched from several tasks, guarded by a spinlock */
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static int s_depth[PM_ACTIVITY_COUNT];
+static int64_t s_since[PM_ACTIVITY_COUNT];
+static uint64_t s_activity_us[PM_ACTIVITY_COUNT];
+static int s_active_depth = 0;
+static int64_t s_active_since = 0;
+static uint64_t s_active_us = 0;
+
+static uint32_t s_deadlines = 0;
+static uint32_t s_deadline_misses = 0;
+static uint32_t s_max_lateness_ms = 0;
+
+esp_err_t power_manager_init(void)
+{
+#if CONFIG_POWER_SAVE_ENABLED
+    for (int i = 0; i < PM_ACTIVITY_COUNT; i++) {
+        esp_err_t err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, s_activity_names[i], &s_locks[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create %s PM lock: %s", s_activity_names[i], esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_POWER_SAVE_MIN_FREQ_MHZ,
+        .light_sleep_enable = LIGHT_SLEEP_ENABLED,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        /* Locks still work as no-ops; keep running at full speed */
+        ESP_LOGW(TAG, "Power management not available: %s", esp_err_to_name(err));
+        return ESP_OK;
+    }
+    s_enabled = true;
+    ESP_LOGI(TAG, "Power save: %d-%d MHz, light sleep %s",
+             CONFIG_POWER_SAVE_MIN_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             LIGHT_SLEEP_ENABLED ? "on" : "off");
+#else
+    ESP_LOGD(TAG, "Power save disabled in configuration");
+#endif
+    return ESP_OK;
+}
+
+void power_manager_acquire(pm_activity_t activity)
+{
+    if (activity >= PM_ACTIVITY_COUNT) {
+        return;
+    }
+#if CONFIG_POWER_SAVE_ENABLED
+    /* Take the lock first so the accounted time starts at full speed */
+    if (s_locks[activity] != NULL) {
+        esp_pm_lock_acquire(s_locks[activity]);
+    }
+#endif
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    if (s_depth[activity]++ == 0) {
+        s_since[activity] = now;
+    }
+    if (s_active_depth++ == 0) {
+        s_active_since = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void power_manager_release(pm_activity_t activity)
+{
+    if (activity >= PM_ACTIVITY_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    if (s_depth[activity] > 0 && --s_depth[activity] == 0) {
+        s_activity_us[activity] += now - s_since[activity];
+    }
+    if (s_active_depth > 0 && --s_active_depth == 0) {
+        s_active_us += now - s_active_since;
+    }
+    portEXIT_CRITICAL(&s_mux);
+#if CONFIG_POWER_SAVE_ENABLED
+    if (s_locks[activity] != NULL) {
+        esp_pm_lock_release(s_locks[activity]);
+    }
+#endif
+}
+
+void power_manager_check_deadline(int64_t due_us)
+{
+    int64_t late_us = esp_timer_get_time() - due_us;
+    uint32_t late_ms = late_us > 0 ? (uint32_t)(late_us / 1000) : 0;
+
+    portENTER_CRITICAL(&s_mux);
+    s_deadlines++;
+    if (late_ms > s_max_lateness_ms) {
+        s_max_lateness_ms = late_ms;
+    }
+    bool missed = late_ms > CONFIG_POWER_DEADLINE_TOLERANCE_MS;
+    if (missed) {
+        s_deadline_misses++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    if (missed) {
+        ESP_LOGW(TAG, "Deadline missed by %lu ms", (unsigned long)late_ms);
+    }
+}
+
+void power_manager_get_stats(power_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->enabled = s_enabled;
+#if CONFIG_POWER_SAVE_ENABLED
+    stats->light_sleep = s_enabled && LIGHT_SLEEP_ENABLED;
+    stats->min_freq_mhz = s_enabled ? CONFIG_POWER_SAVE_MIN_FREQ_MHZ : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+#else
+    stats->min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+#endif
+    stats->max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+
+    int64_t now = esp_timer_get_time();
+    stats->uptime_ms = now / 1000;
+
+    portENTER_CRITICAL(&s_mux);
+    /* Include locks that are currently held */
+    uint64_t active = s_active_us + (s_active_depth > 0 ? now - s_active_since : 0);
+    for (int i = 0; i < PM_ACTIVITY_COUNT; i++) {
+        uint64_t us = s_activity_us[i] + (s_depth[i] > 0 ? now - s_since[i] : 0);
+        stats->activity_ms[i] = us / 1000;
+    }
+    stats->deadlines = s_deadlines;
+    stats->deadline_misses = s_deadline_misses;
+    stats->max_lateness_ms = s_max_lateness_ms;
+    portEXIT_CRITICAL(&s_mux);
+
+    stats->active_ms = active / 1000;
+}
+
+const char *power_manager_activity_name(pm_activity_t activity)
+{
+    return activity < PM_ACTIVITY_COUNT ? s_activity_names[activity] : "unknown";
+}
@@ -0,0 +1,88 @@
+/**
+ * @file power_manager.h
+ * @brief Dynamic frequency scaling and automatic light sleep between
+ *        acquisition cycles
+ *
+ * The node spends almost all of its time waiting for conversions or the next
+ * read interval. With CONFIG_POWER_SAVE_ENABLED the CPU runs at the minimum
+ * frequency and may enter light sleep whenever no PM lock is held. Locks are
+ * taken only around 1-Wire bus transactions, HTTP request handling and
+ * network publishing, and the time spent holding them is accounted as
+ * "active".
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Activity classes that keep the system awake
+ */
+typedef enum {
+    PM_ACTIVITY_BUS = 0,    /**< RMT 1-Wire transaction */
+    PM_ACTIVITY_HTTP,       /**< HTTP request handler */
+    PM_ACTIVITY_NET,        /**< MQTT/network publishing */
+    PM_ACTIVITY_COUNT
+} pm_activity_t;
+
+/**
+ * @brief Power statistics since boot
+ */
+typedef struct {
+    bool enabled;                               /**< DFS/light sleep configured */
+    bool light_sleep;                           /**< Automatic light sleep allowed */
+    int max_freq_mhz;                           /**< Frequency while a lock is held */
+    int min_freq_mhz;                           /**< Frequency when idle */
+    uint64_t uptime_ms;                         /**< Time covered by the accounting */
+    uint64_t active_ms;                         /**< Time with any lock held */
+    uint64_t activity_ms[PM_ACTIVITY_COUNT];    /**< Time per activity class */
+    uint32_t deadlines;                         /**< Timed wake-ups checked */
+    uint32_t deadline_misses;                   /**< Wake-ups later than tolerance */
+    uint32_t max_lateness_ms;                   /**< Worst wake-up lateness */
+} power_stats_t;
+
+/**
+ * @brief Configure power management and create the activity locks
+ *
+ * Without CONFIG_POWER_SAVE_ENABLED (or CONFIG_PM_ENABLE) this only sets up
+ * the accounting; acquire/release still measure active time.
+ */
+esp_err_t power_manager_init(void);
+
+/**
+ * @brief Keep the CPU at full speed and out of light sleep
+ *
+ * Calls nest per class and may come from any task.
+ */
+void power_manager_acquire(pm_activity_t activity);
+
+/**
+ * @brief Release a lock taken with power_manager_acquire()
+ */
+void power_manager_release(pm_activity_t activity);
+
+/**
+ * @brief Check a timed wake-up against its deadline
+ *
+ * Call right after a delay returns. A wake-up later than
+ * CONFIG_POWER_DEADLINE_TOLERANCE_MS counts as a miss, which is how
+ * light sleep exit latency would show up.
+ *
+ * @param due_us esp_timer time the task should have woken at
+ */
+void power_manager_check_deadline(int64_t due_us);
+
+/**
+ * @brief Get power statistics
+ */
+void power_manager_get_stats(power_stats_t *stats);
+
+/**
+ * @brief Get the name of an activity class ("bus", "http", "net")
+ */
+const char *power_manager_activity_name(pm_activity_t activity);
+
+#endif /* POWER_MANAGER_H */
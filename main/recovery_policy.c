@@ -0,0 +1,148 @@
+/**
+ * @file recovery_policy.c
+ * @brief Staged recovery of a failing acquisition loop (host-testable)
+ */
+
+#include "recovery_policy.h"
+#include <string.h>
+
+static const char *s_stage_names[] = {
+    "none", "bus_reset", "bus_recreate", "rescan", "reboot"
+};
+
+static const char *s_cause_names[] = {
+    "failed", "overrun", "stall"
+};
+
+void recovery_init(recovery_policy_t *p, uint8_t threshold)
+{
+    memset(p, 0, sizeof(*p));
+    p->threshold = threshold > 0 ? threshold : 1;
+}
+
+static void open_incident(recovery_policy_t *p, int64_t start_ms, recovery_cause_t cause)
+{
+    p->in_incident = true;
+    p->started_ms = start_ms;
+    p->cause = (uint8_t)cause;
+    p->stage = RECOVERY_NONE;
+    p->bad_cycles = 0;
+}
+
+bool recovery_on_good(recovery_policy_t *p, int64_t now_ms)
+{
+    p->bad_cycles = 0;
+    if (!p->in_incident) {
+        return false;
+    }
+    p->in_incident = false;
+    p->rebooted = false;
+    if (p->stage == RECOVERY_NONE) {
+        /* Healed before any stage ran */
+        return false;
+    }
+
+    int64_t duration = now_ms - p->started_ms;
+    recovery_event_t *ev = &p->history[p->history_next];
+    ev->started_ms = p->started_ms;
+    ev->duration_ms = duration < 0 ? 0 : duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    ev->stage = p->stage;
+    ev->cause = p->cause;
+    p->history_next = (p->history_next + 1) % RECOVERY_HISTORY;
+    if (p->history_count < RECOVERY_HISTORY) {
+        p->history_count++;
+    }
+
+    p->recoveries++;
+    p->total_ms += ev->duration_ms;
+    p->stage = RECOVERY_NONE;
+    return true;
+}
+
+recovery_stage_t recovery_on_bad(recovery_policy_t *p, int64_t now_ms, recovery_cause_t cause)
+{
+    if (!p->in_incident) {
+        open_incident(p, now_ms, cause);
+    }
+    if (++p->bad_cycles < p->threshold) {
+        return RECOVERY_NONE;
+    }
+    p->bad_cycles = 0;
+
+    int next = p->stage + 1;
+    if (next > RECOVERY_REBOOT) {
+        next = RECOVERY_REBOOT;
+    }
+    if (next == RECOVERY_REBOOT && p->rebooted) {
+        next = RECOVERY_RESCAN;
+    }
+    if (next == RECOVERY_REBOOT) {
+        p->rebooted = true;
+    }
+    p->stage = (uint8_t)next;
+    p->stage_counts[next]++;
+    return (recovery_stage_t)next;
+}
+
+recovery_stage_t recovery_on_stall(recovery_policy_t *p, int64_t since_ms)
+{
+    if (p->in_incident && p->rebooted) {
+        return RECOVERY_NONE;
+    }
+    if (!p->in_incident) {
+        open_incident(p, since_ms, RECOVERY_CAUSE_STALL);
+    }
+    p->bad_cycles = 0;
+    p->stage = RECOVERY_REBOOT;
+    p->rebooted = true;
+    p->stage_counts[RECOVERY_REBOOT]++;
+    return RECOVERY_REBOOT;
+}
+
+uint32_t recovery_retry_ms(const recovery_policy_t *p)
+{
+    if (!p->in_incident || (p->rebooted && p->stage >= RECOVERY_RESCAN)) {
+        return 0;
+    }
+    return RECOVERY_RETRY_MS;
+}
+
+uint32_t recovery_mttr_ms(const recovery_policy_t *p)
+{
+    return p->recoveries > 0 ? (uint32_t)(p->total_ms / p->recoveries) : 0;
+}
+
+bool recovery_get_event(const recovery_policy_t *p, int age, recovery_event_t *out)
+{
+    if (age < 0 || age >= p->history_count) {
+        return false;
+    }
+    *out = p->history[(p->history_next + RECOVERY_HISTORY - 1 - age) % RECOVERY_HISTORY];
+    return true;
+}
+
+void recovery_rebase(recovery_policy_t *p, int64_t offset_ms)
+{
+    p->started_ms -= offset_ms;
+    for (int i = 0; i < p->history_count; i++) {
+        p->history[i].started_ms -= offset_ms;
+    }
+}
+
+bool recovery_is_valid(const recovery_policy_t *p)
+{
+    return p->threshold > 0 && p->bad_cycles < p->threshold &&
+           p->stage < RECOVERY_STAGE_COUNT && p->cause < RECOVERY_CAUSE_COUNT &&
+           p->history_count <= RECOVERY_HISTORY && p->history_next < RECOVERY_HISTORY &&
+           p->recoveries >= p->history_count;
+}
+
+const char *recovery_stage_name(recovery_stage_t stage)
+{
+    return stage < RECOVERY_STAGE_COUNT ? s_stage_names[stage] : "unknown";
+}
+
+const char *recovery_cause_name(recovery_cause_t cause)
+{
+    return cause < RECOVERY_CAUSE_COUNT ? s_cause_names[cause] : "unknown";
+}
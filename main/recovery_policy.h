@@ -0,0 +1,136 @@
+/**
+ * @file recovery_policy.h
+ * @brief Staged recovery of a failing acquisition loop (host-testable)
+ *
+ * Every read cycle reports whether it worked. After a run of bad cycles the
+ * policy asks for the next, more drastic recovery stage: bus reset, then
+ * re-creation of the bus driver, then a rescan, then a controlled reboot.
+ * Each further run of bad cycles moves one stage on. The first good cycle
+ * closes the incident and records how long the bus was down, from the first
+ * bad cycle, so the mean time to recovery covers detection as well as the
+ * repair. Runs too short to trigger a stage are not incidents.
+ *
+ * A reboot is only asked for once per incident. If the incident survives
+ * it, the policy keeps repeating the rescan stage instead of rebooting in a
+ * loop. Times are milliseconds of uptime; recovery_rebase() carries the
+ * state over a reboot, leaving earlier times negative.
+ */
+
+#ifndef RECOVERY_POLICY_H
+#define RECOVERY_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Recoveries kept in the history */
+#define RECOVERY_HISTORY 8
+
+/** @brief Delay between retries of a failing cycle while stages remain */
+#define RECOVERY_RETRY_MS 1000
+
+typedef enum {
+    RECOVERY_NONE = 0,
+    RECOVERY_BUS_RESET,         /**< 1-Wire reset pulse */
+    RECOVERY_BUS_RECREATE,      /**< Delete and re-create the RMT bus driver */
+    RECOVERY_RESCAN,            /**< Rediscover devices */
+    RECOVERY_REBOOT,            /**< Controlled restart */
+    RECOVERY_STAGE_COUNT
+} recovery_stage_t;
+
+typedef enum {
+    RECOVERY_CAUSE_FAILED = 0,  /**< Cycle produced no reading */
+    RECOVERY_CAUSE_OVERRUN,     /**< Cycle took far longer than its interval */
+    RECOVERY_CAUSE_STALL,       /**< Acquisition task stopped making progress */
+    RECOVERY_CAUSE_COUNT
+} recovery_cause_t;
+
+/**
+ * @brief A closed incident
+ */
+typedef struct {
+    int64_t started_ms;         /**< First bad cycle (uptime, negative = before the last reboot) */
+    uint32_t duration_ms;       /**< Until the first good cycle */
+    uint8_t stage;              /**< Last stage applied */
+    uint8_t cause;              /**< What opened the incident */
+} recovery_event_t;
+
+/**
+ * @brief Policy state
+ */
+typedef struct {
+    uint8_t threshold;          /**< Bad cycles in a row per stage */
+    uint8_t bad_cycles;         /**< Bad cycles since the last stage or good cycle */
+    bool in_incident;
+    bool rebooted;              /**< The open incident already used its reboot */
+    uint8_t stage;              /**< Last stage applied in the open incident */
+    uint8_t cause;
+    int64_t started_ms;
+    recovery_event_t history[RECOVERY_HISTORY];
+    uint8_t history_count;
+    uint8_t history_next;
+    uint32_t recoveries;
+    uint64_t total_ms;          /**< Sum of recovery durations */
+    uint32_t stage_counts[RECOVERY_STAGE_COUNT];
+} recovery_policy_t;
+
+/**
+ * @brief Start with no history
+ * @param threshold Bad cycles in a row before each stage (at least 1)
+ */
+void recovery_init(recovery_policy_t *p, uint8_t threshold);
+
+/**
+ * @brief Report a cycle that worked
+ * @return true if it closed an incident
+ */
+bool recovery_on_good(recovery_policy_t *p, int64_t now_ms);
+
+/**
+ * @brief Report a bad cycle
+ * @return Stage to apply now, RECOVERY_NONE to keep waiting
+ */
+recovery_stage_t recovery_on_bad(recovery_policy_t *p, int64_t now_ms, recovery_cause_t cause);
+
+/**
+ * @brief Report a stalled acquisition task
+ *
+ * Nothing short of a reboot reaches a task stuck on the bus.
+ *
+ * @param since_ms When the task last made progress
+ * @return RECOVERY_REBOOT, or RECOVERY_NONE if this incident already rebooted
+ */
+recovery_stage_t recovery_on_stall(recovery_policy_t *p, int64_t since_ms);
+
+/**
+ * @brief Delay before retrying a bad cycle, 0 to keep the normal schedule
+ *
+ * Retries come quickly while there are stages left to try, so a dead bus
+ * heals within seconds whatever the read interval.
+ */
+uint32_t recovery_retry_ms(const recovery_policy_t *p);
+
+/**
+ * @brief Mean time to recovery in ms, 0 before the first recovery
+ */
+uint32_t recovery_mttr_ms(const recovery_policy_t *p);
+
+/**
+ * @brief Get a closed incident, newest first
+ * @return false if there is no such entry
+ */
+bool recovery_get_event(const recovery_policy_t *p, int age, recovery_event_t *out);
+
+/**
+ * @brief Shift every time back by @p offset_ms (uptime at reboot)
+ */
+void recovery_rebase(recovery_policy_t *p, int64_t offset_ms);
+
+/**
+ * @brief Check state of unknown origin (e.g. memory kept over a reset)
+ */
+bool recovery_is_valid(const recovery_policy_t *p);
+
+const char *recovery_stage_name(recovery_stage_t stage);
+const char *recovery_cause_name(recovery_cause_t cause);
+
+#endif /* RECOVERY_POLICY_H */
@@ -6,15 +6,163 @@
 #include "sensor_manager.h"
 #include "nvs_storage.h"
 #include "mqtt_client_ha.h"
+#include "event_stream.h"
+#include "bus_task.h"
+#include "trend_estimator.h"
+#include "bus_capacity.h"
+#include "virtual_sensor.h"
+#include "cJSON.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "sensor_mgr";
 
 static managed_sensor_t s_sensors[CONFIG_MAX_SENSORS];
 static int s_sensor_count = 0;
 
+/* Device list generation s_sensors was built from (see onewire_temp_get_generation) */
+static uint32_t s_bus_generation = 0;
+
+/* Guards updates to the sensor table; bus work itself is serialized by the bus task */
+static SemaphoreHandle_t s_lock = NULL;
+
+/* Compiled alert rules, indexed like s_sensors */
+static alert_rule_t s_alert_rules[CONFIG_MAX_SENSORS];
+
+/* On-demand reads: one bus operation at a time, at least the spacing apart */
+static SemaphoreHandle_t s_read_now_lock = NULL;
+static int64_t s_read_now_last_us = 0;
+static sensor_read_now_stats_t s_read_now_stats;
+
+/* Per-sensor read deadlines, indexed like s_sensors */
+static bus_sched_t s_sched;
+static bus_sched_entry_t s_sched_entries[CONFIG_MAX_SENSORS];
+
+/* Rate of change per sensor, fed with every reading */
+static trend_t s_trend[CONFIG_MAX_SENSORS];
+
+/* Read error windows per sensor and for the whole bus */
+static health_window_t s_health[CONFIG_MAX_SENSORS];
+static health_window_t s_bus_health;
+static bool s_health_alert = false;
+
+/* Adaptive acquisition */
+static acq_controller_t s_acq;
+static acq_sensor_state_t s_acq_state[CONFIG_MAX_SENSORS];
+static int64_t s_last_cycle_start = 0;
+
+/* A cycle slower than this many conversions plus the margin is overrun;
+ * reads, queue waits behind other bus work and a rescan pass fit easily */
+#define CYCLE_OVERRUN_FACTOR    2
+#define CYCLE_OVERRUN_MARGIN_MS 2000
+
+/* Change tracking for delta queries */
+static uint32_t s_change_seq = 0;
+static uint32_t s_layout_seq = 0;
+static uint32_t s_boot_id = 0;
+static bool s_cycle_changed = false;
+
+/**
+ * @brief Sequence number to stamp on a sensor changed in the current cycle
+ *
+ * The global sequence advances at most once per cycle, on the first change.
+ */
+static uint32_t cycle_change_seq(void)
+{
+    if (!s_cycle_changed) {
+        s_change_seq++;
+        s_cycle_changed = true;
+    }
+    return s_change_seq;
+}
+
+/**
+ * @brief Mark the whole sensor list as changed (after init/rescan)
+ */
+static void mark_layout_changed(void)
+{
+    s_layout_seq = ++s_change_seq;
+    for (int i = 0; i < s_sensor_count; i++) {
+        s_sensors[i].change_seq = s_layout_seq;
+    }
+}
+
+/**
+ * @brief Copy the sensor table for a bus operation (caller holds s_lock)
+ *
+ * Counters are zeroed in the copy so apply_reading() can add them back.
+ */
+static void snapshot_sensors(onewire_sensor_t *hw_sensors, int count)
+{
+    for (int i = 0; i < count; i++) {
+        memcpy(&hw_sensors[i], &s_sensors[i].hw_sensor, sizeof(onewire_sensor_t));
+        hw_sensors[i].total_reads = 0;
+        hw_sensors[i].failed_reads = 0;
+    }
+}
+
+/**
+ * @brief Index of the sensor with this address, or -1 (caller holds s_lock)
+ */
+static int find_sensor(const char *address_str)
+{
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (strcmp(s_sensors[i].address_str, address_str) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Apply one bus reading to a sensor (caller holds s_lock)
+ *
+ * A periodic cycle and an on-demand read can overlap, so counts are added
+ * and a reading older than the stored one does not replace it.
+ */
+static void apply_reading(int index, const onewire_sensor_t *hw)
+{
+    managed_sensor_t *sensor = &s_sensors[index];
+
+    sensor->hw_sensor.total_reads += hw->total_reads;
+    sensor->hw_sensor.failed_reads += hw->failed_reads;
+    if (hw->total_reads > 0) {
+        int64_t now_ms = esp_timer_get_time() / 1000;
+        health_window_add(&s_health[index], now_ms, hw->total_reads, hw->failed_reads);
+        health_window_add(&s_bus_health, now_ms, hw->total_reads, hw->failed_reads);
+    }
+    if (hw->last_read_time < sensor->hw_sensor.last_read_time) {
+        return;
+    }
+
+    /* Total reads advance every cycle, so they don't count as a visible change */
+    if (sensor->hw_sensor.temperature != hw->temperature ||
+        sensor->hw_sensor.valid != hw->valid || hw->failed_reads > 0) {
+        sensor->change_seq = cycle_change_seq();
+    }
+    sensor->hw_sensor.temperature = hw->temperature;
+    sensor->hw_sensor.valid = hw->valid;
+    sensor->hw_sensor.last_read_time = hw->last_read_time;
+    sensor->hw_sensor.sample_time = hw->sample_time;
+
+    if (hw->valid && hw->total_reads > 0) {
+        trend_add(&s_trend[index], hw->last_read_time, hw->temperature,
+                  (uint32_t)CONFIG_TREND_WINDOW_S * 1000);
+    }
+
+    if (hw->valid) {
+        const char *name = sensor->has_friendly_name ? sensor->friendly_name : sensor->address_str;
+        ESP_LOGD(TAG, "%s: %.2f°C", name, hw->temperature);
+    }
+}
+
 /**
  * @brief Load friendly name from NVS for a sensor
  */
@@ -34,31 +182,281 @@ static void load_friendly_name(managed_sensor_t *sensor)
     }
 }
 
+/**
+ * @brief Load and compile a sensor's alert rule from NVS
+ */
+static void load_alert_rule(int index)
+{
+    managed_sensor_t *sensor = &s_sensors[index];
+    alert_rule_t *rule = &s_alert_rules[index];
+
+    sensor->has_alert_rule =
+        nvs_storage_load_alert_rule(sensor->hw_sensor.address, &sensor->alert_config) == ESP_OK &&
+        alert_rule_compile(&sensor->alert_config, rule);
+
+    if (!sensor->has_alert_rule) {
+        memset(&sensor->alert_config, 0, sizeof(sensor->alert_config));
+        memset(rule, 0, sizeof(*rule));
+    }
+    alert_rule_reset(rule, esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief Load a sensor's target read interval from NVS into the scheduler
+ */
+static void load_sensor_interval(int index)
+{
+    uint32_t interval_ms = 0;
+    if (nvs_storage_load_sensor_interval(s_sensors[index].hw_sensor.address, &interval_ms) != ESP_OK ||
+        !bus_sched_interval_valid(interval_ms)) {
+        interval_ms = 0;
+    }
+    bus_sched_set_interval(&s_sched, index, interval_ms);
+}
+
+/**
+ * @brief Load a sensor's cable position from NVS
+ */
+static void load_sensor_position(managed_sensor_t *sensor)
+{
+    if (nvs_storage_load_sensor_position(sensor->hw_sensor.address, &sensor->position) != ESP_OK) {
+        sensor->position = 0;
+    }
+}
+
+/* Alert payload built under s_lock and published once it is released, so
+ * MQTT and event stream sends never run with the sensor table locked */
+typedef struct alert_msg {
+    struct alert_msg *next;
+    char payload[];
+} alert_msg_t;
+
+/**
+ * @brief Serialize an alert and push it onto the pending list
+ */
+static void queue_alert(alert_msg_t **pending, cJSON *root)
+{
+    char *payload = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (payload == NULL) {
+        return;
+    }
+    size_t len = strlen(payload) + 1;
+    alert_msg_t *msg = malloc(sizeof(alert_msg_t) + len);
+    if (msg != NULL) {
+        memcpy(msg->payload, payload, len);
+        msg->next = *pending;
+        *pending = msg;
+    } else {
+        ESP_LOGE(TAG, "Out of memory, alert dropped");
+    }
+    free(payload);
+}
+
+/**
+ * @brief Publish pending alerts in the order they were raised and free them
+ *
+ * Must be called without s_lock held.
+ */
+static void publish_alerts(alert_msg_t *pending)
+{
+    alert_msg_t *ordered = NULL;
+    while (pending != NULL) {
+        alert_msg_t *next = pending->next;
+        pending->next = ordered;
+        ordered = pending;
+        pending = next;
+    }
+    while (ordered != NULL) {
+        alert_msg_t *next = ordered->next;
+        mqtt_ha_publish_alert(ordered->payload);
+        event_stream_broadcast("alert", ordered->payload);
+        free(ordered);
+        ordered = next;
+    }
+}
+
+/**
+ * @brief Record one alert transition for publishing (caller holds s_lock)
+ */
+static void record_alert(alert_msg_t **pending, int index, uint8_t type, bool raised)
+{
+    const managed_sensor_t *sensor = &s_sensors[index];
+    const char *name = sensor->has_friendly_name ? sensor->friendly_name : sensor->address_str;
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "sensor", sensor->address_str);
+    cJSON_AddStringToObject(root, "name", name);
+    cJSON_AddStringToObject(root, "type", alert_type_name(type));
+    cJSON_AddStringToObject(root, "state", raised ? "raised" : "cleared");
+    if (sensor->hw_sensor.valid) {
+        cJSON_AddNumberToObject(root, "temperature", sensor->hw_sensor.temperature);
+    } else {
+        cJSON_AddNullToObject(root, "temperature");
+    }
+
+    ESP_LOGW(TAG, "Alert %s %s: %s", alert_type_name(type), raised ? "raised" : "cleared", name);
+    queue_alert(pending, root);
+}
+
+/**
+ * @brief Sum the error windows and localize the fault (caller holds s_lock)
+ */
+static void compute_health(int64_t now_ms, health_counts_t *bus, health_counts_t *sensors,
+                           health_fault_t *fault)
+{
+    /* Static to spare the reading tasks' stacks; s_lock guards it */
+    static health_sensor_input_t inputs[CONFIG_MAX_SENSORS];
+    health_counts_t counts;
+
+    health_window_counts(&s_bus_health, now_ms, bus);
+    for (int i = 0; i < s_sensor_count; i++) {
+        health_window_counts(&s_health[i], now_ms, &counts);
+        if (sensors != NULL) {
+            sensors[i] = counts;
+        }
+        inputs[i].reads = counts.reads[HEALTH_SPAN_1H];
+        inputs[i].failed = counts.failed[HEALTH_SPAN_1H];
+        inputs[i].position = s_sensors[i].position;
+    }
+    health_localize(inputs, s_sensor_count, CONFIG_BUS_HEALTH_ALERT_PERCENT, fault);
+}
+
+/**
+ * @brief Record a bus health transition like a sensor alert (caller holds s_lock)
+ */
+static void record_health_alert(alert_msg_t **pending, bool raised, float minute, float hour,
+                                const health_fault_t *fault)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (fault->sensor >= 0) {
+        const managed_sensor_t *sensor = &s_sensors[fault->sensor];
+        cJSON_AddStringToObject(root, "sensor", sensor->address_str);
+        cJSON_AddStringToObject(root, "name", sensor->has_friendly_name ? sensor->friendly_name : sensor->address_str);
+    } else {
+        cJSON_AddNullToObject(root, "sensor");
+        cJSON_AddNullToObject(root, "name");
+    }
+    cJSON_AddStringToObject(root, "type", "bus_health");
+    cJSON_AddStringToObject(root, "state", raised ? "raised" : "cleared");
+    cJSON_AddNumberToObject(root, "error_rate_1m", minute);
+    cJSON_AddNumberToObject(root, "error_rate_1h", hour);
+    cJSON_AddStringToObject(root, "fault", health_fault_name(fault->kind));
+    if (fault->upstream >= 0) {
+        cJSON_AddStringToObject(root, "upstream", s_sensors[fault->upstream].address_str);
+    } else {
+        cJSON_AddNullToObject(root, "upstream");
+    }
+
+    ESP_LOGW(TAG, "Bus health %s: %.1f%% failed (1 min), %.1f%% (1 h), fault: %s",
+             raised ? "degraded" : "recovered", minute, hour, health_fault_name(fault->kind));
+    queue_alert(pending, root);
+}
+
+/**
+ * @brief Raise or clear the bus health alert (caller holds s_lock)
+ *
+ * A failed read only costs one reading, so a rising failure rate shows a
+ * degrading cable before sensors drop out altogether.
+ */
+static void evaluate_bus_health(alert_msg_t **pending)
+{
+    const float limit = CONFIG_BUS_HEALTH_ALERT_PERCENT;
+    health_counts_t bus;
+    health_fault_t fault;
+
+    compute_health(esp_timer_get_time() / 1000, &bus, NULL, &fault);
+    float minute = bus.reads[HEALTH_SPAN_1M] >= HEALTH_MIN_READS ?
+                   health_error_percent(bus.reads[HEALTH_SPAN_1M], bus.failed[HEALTH_SPAN_1M]) : 0.0f;
+    float hour = bus.reads[HEALTH_SPAN_1H] >= HEALTH_MIN_READS ?
+                 health_error_percent(bus.reads[HEALTH_SPAN_1H], bus.failed[HEALTH_SPAN_1H]) : 0.0f;
+
+    if (!s_health_alert && (minute > limit || hour > limit)) {
+        s_health_alert = true;
+        record_health_alert(pending, true, minute, hour, &fault);
+    } else if (s_health_alert && minute <= limit / 2 && hour <= limit) {
+        s_health_alert = false;
+        record_health_alert(pending, false, minute, hour, &fault);
+    }
+}
+
+/**
+ * @brief Evaluate all alert rules against the latest readings (caller holds s_lock)
+ */
+static void evaluate_alerts(alert_msg_t **pending)
+{
+    int64_t now_ms = esp_timer_get_time() / 1000;
+
+    for (int i = 0; i < s_sensor_count; i++) {
+        alert_rule_t *rule = &s_alert_rules[i];
+        if (rule->enabled == 0) {
+            continue;
+        }
+        uint8_t raised, cleared;
+        if (!alert_rule_eval(rule, s_sensors[i].hw_sensor.valid, s_sensors[i].hw_sensor.temperature,
+                             now_ms, &raised, &cleared)) {
+            continue;
+        }
+        for (uint8_t type = ALERT_HIGH; type <= ALERT_STALE; type <<= 1) {
+            if (raised & type) {
+                record_alert(pending, i, type, true);
+            } else if (cleared & type) {
+                record_alert(pending, i, type, false);
+            }
+        }
+    }
+}
+
 esp_err_t sensor_manager_init(void)
 {
     ESP_LOGD(TAG, "Initializing sensor manager");
     
     memset(s_sensors, 0, sizeof(s_sensors));
     s_sensor_count = 0;
+    health_window_init(&s_bus_health);
+
+    s_lock = xSemaphoreCreateMutex();
+    s_read_now_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL || s_read_now_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
 
     /* Scan for sensors */
     onewire_sensor_t hw_sensors[CONFIG_MAX_SENSORS];
     int found = 0;
     
-    esp_err_t err = onewire_temp_scan(hw_sensors, CONFIG_MAX_SENSORS, &found);
+    esp_err_t err = bus_task_scan(hw_sensors, CONFIG_MAX_SENSORS, &found, &s_bus_generation);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to scan for sensors");
         return err;
     }
 
     /* Copy to managed sensors and load friendly names */
+    bus_sched_init(&s_sched, s_sched_entries, found, CONFIG_SENSOR_READ_INTERVAL_MS);
     for (int i = 0; i < found; i++) {
+        trend_init(&s_trend[i]);
+        health_window_init(&s_health[i]);
         memcpy(&s_sensors[i].hw_sensor, &hw_sensors[i], sizeof(onewire_sensor_t));
         onewire_address_to_string(s_sensors[i].hw_sensor.address, s_sensors[i].address_str);
         load_friendly_name(&s_sensors[i]);
+        load_alert_rule(i);
+        load_sensor_interval(i);
+        load_sensor_position(&s_sensors[i]);
     }
     
     s_sensor_count = found;
+    s_boot_id = esp_random();
+    mark_layout_changed();
+
+    /* Start the acquisition controller from saved settings */
+    acq_config_t acq_cfg;
+    if (nvs_storage_load_acq_config(&acq_cfg) != ESP_OK || !acq_config_valid(&acq_cfg)) {
+        acq_config_defaults(&acq_cfg);
+    }
+    acq_init(&s_acq, &acq_cfg, s_acq_state, s_sensor_count);
+    if (acq_cfg.enabled) {
+        bus_task_set_resolution(s_acq.resolution);
+    }
     ESP_LOGD(TAG, "Sensor manager initialized with %d sensors", s_sensor_count);
     
     return ESP_OK;
@@ -67,97 +465,296 @@ esp_err_t sensor_manager_init(void)
 esp_err_t sensor_manager_rescan(void)
 {
     ESP_LOGD(TAG, "Rescanning for sensors...");
-    
-    /* Save current friendly names */
-    char saved_names[CONFIG_MAX_SENSORS][MAX_FRIENDLY_NAME_LEN];
-    uint8_t saved_addresses[CONFIG_MAX_SENSORS][ONEWIRE_ROM_SIZE];
-    int saved_count = s_sensor_count;
-    
-    for (int i = 0; i < s_sensor_count; i++) {
-        memcpy(saved_addresses[i], s_sensors[i].hw_sensor.address, ONEWIRE_ROM_SIZE);
-        strncpy(saved_names[i], s_sensors[i].friendly_name, MAX_FRIENDLY_NAME_LEN);
-    }
 
-    /* Re-scan */
+    /* Re-scan (periodic cycles keep running between search passes) */
     onewire_sensor_t hw_sensors[CONFIG_MAX_SENSORS];
     int found = 0;
+    uint32_t generation = 0;
     
-    esp_err_t err = onewire_temp_scan(hw_sensors, CONFIG_MAX_SENSORS, &found);
+    esp_err_t err = bus_task_scan(hw_sensors, CONFIG_MAX_SENSORS, &found, &generation);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to rescan sensors");
         return err;
     }
 
     /* Clear and rebuild sensor list */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
     memset(s_sensors, 0, sizeof(s_sensors));
     
+    /* New indices: every sensor is due at once and deadlines restart */
+    bus_sched_init(&s_sched, s_sched_entries, found, s_sched.default_interval_ms);
     for (int i = 0; i < found; i++) {
+        trend_init(&s_trend[i]);
+        health_window_init(&s_health[i]);
         memcpy(&s_sensors[i].hw_sensor, &hw_sensors[i], sizeof(onewire_sensor_t));
         onewire_address_to_string(s_sensors[i].hw_sensor.address, s_sensors[i].address_str);
         load_friendly_name(&s_sensors[i]);
+        load_alert_rule(i);
+        load_sensor_interval(i);
+        load_sensor_position(&s_sensors[i]);
     }
     
     s_sensor_count = found;
+    s_bus_generation = generation;
+    mark_layout_changed();
+
+    /* Sensor indices changed - relearn signal estimates */
+    acq_init(&s_acq, &s_acq.cfg, s_acq_state, s_sensor_count);
+    virtual_sensor_bind(s_sensors, s_sensor_count);
+    xSemaphoreGive(s_lock);
+
+    if (s_acq.cfg.enabled) {
+        bus_task_set_resolution(s_acq.resolution);
+    }
     
     ESP_LOGD(TAG, "Rescan complete: %d sensors found", s_sensor_count);
     return ESP_OK;
 }
 
-esp_err_t sensor_manager_read_all(void)
+esp_err_t sensor_manager_read_due(uint32_t default_interval_ms, sensor_cycle_result_t *result)
 {
+    sensor_cycle_result_t outcome_buf;
+    sensor_cycle_result_t *outcome = result != NULL ? result : &outcome_buf;
+    *outcome = SENSOR_CYCLE_IDLE;
+
     if (s_sensor_count == 0) {
         return ESP_OK;
     }
 
-    /* Extract hardware sensor array */
-    onewire_sensor_t hw_sensors[CONFIG_MAX_SENSORS];
-    for (int i = 0; i < s_sensor_count; i++) {
-        memcpy(&hw_sensors[i], &s_sensors[i].hw_sensor, sizeof(onewire_sensor_t));
+    /* Pick the sensors whose deadline has come (or comes within this
+     * conversion) and extract the hardware sensor array */
+    /* Only temp_task calls this; static keeps the arrays off its stack */
+    static onewire_sensor_t hw_sensors[CONFIG_MAX_SENSORS];
+    static bool selected[CONFIG_MAX_SENSORS];
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_sensor_count;
+    uint32_t generation = s_bus_generation;
+    int64_t start = esp_timer_get_time();
+    bus_sched_set_default_interval(&s_sched, default_interval_ms);
+    int due = bus_sched_select(&s_sched, start / 1000, onewire_temp_get_conversion_ms(), count, selected);
+    snapshot_sensors(hw_sensors, count);
+    xSemaphoreGive(s_lock);
+
+    if (due == 0) {
+        return ESP_OK;
     }
 
-    /* Read all temperatures */
-    int64_t start = esp_timer_get_time();
-    esp_err_t err = onewire_temp_read_all(hw_sensors, s_sensor_count);
+    /* One shared conversion, then only the due scratchpads */
+    esp_err_t err = bus_task_read_cycle(hw_sensors, count, selected, generation);
     int64_t elapsed_ms = (esp_timer_get_time() - start) / 1000;
     
-    ESP_LOGI(TAG, "Read %d sensors in %lld ms", s_sensor_count, elapsed_ms);
+    if (err == ESP_ERR_INVALID_STATE) {
+        /* A rescan replaced the device list mid-cycle; these indices are stale */
+        ESP_LOGD(TAG, "Sensor list changed during read, discarding cycle");
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Read %d of %d sensors in %lld ms", due, count, elapsed_ms);
+
+    /* A cycle with no reading at all points at the bus, not a sensor */
+    int read_ok = 0;
+    for (int i = 0; i < count; i++) {
+        read_ok += selected[i] && hw_sensors[i].valid ? 1 : 0;
+    }
+    bool failed = err != ESP_OK && read_ok == 0;
+    if (failed) {
+        *outcome = SENSOR_CYCLE_FAILED;
+    } else if (elapsed_ms > CYCLE_OVERRUN_FACTOR * onewire_temp_get_conversion_ms() + CYCLE_OVERRUN_MARGIN_MS) {
+        *outcome = SENSOR_CYCLE_OVERRUN;
+    } else {
+        *outcome = SENSOR_CYCLE_OK;
+    }
     
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (generation != s_bus_generation) {
+        xSemaphoreGive(s_lock);
+        *outcome = SENSOR_CYCLE_IDLE;
+        return ESP_OK;
+    }
+
     /* Copy back results */
+    s_cycle_changed = false;
+    bool default_due = false;
+    for (int i = 0; i < s_sensor_count; i++) {
+        if (!selected[i]) {
+            continue;
+        }
+        if (!failed) {
+            bus_sched_complete(&s_sched, i, start / 1000);
+        }
+        default_due |= s_sched.entries[i].interval_ms == 0;
+        apply_reading(i, &hw_sensors[i]);
+    }
+
+    /* Alerts are evaluated on every read so they lag by at most one cycle */
+    alert_msg_t *alerts = NULL;
+    evaluate_alerts(&alerts);
+    evaluate_bus_health(&alerts);
+    virtual_sensor_evaluate(s_sensors, s_sensor_count);
+
+    /* Feed the acquisition controller and pick the next interval/resolution */
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    int samples = 0;
     for (int i = 0; i < s_sensor_count; i++) {
-        s_sensors[i].hw_sensor.temperature = hw_sensors[i].temperature;
-        s_sensors[i].hw_sensor.valid = hw_sensors[i].valid;
-        s_sensors[i].hw_sensor.last_read_time = hw_sensors[i].last_read_time;
-        s_sensors[i].hw_sensor.total_reads = hw_sensors[i].total_reads;
-        s_sensors[i].hw_sensor.failed_reads = hw_sensors[i].failed_reads;
-        
-        if (hw_sensors[i].valid) {
-            const char *name = s_sensors[i].has_friendly_name ? 
-                               s_sensors[i].friendly_name : s_sensors[i].address_str;
-            ESP_LOGD(TAG, "%s: %.2f°C", name, hw_sensors[i].temperature);
+        if (!selected[i]) {
+            continue;
         }
+        acq_observe(&s_acq, i, s_sensors[i].hw_sensor.valid, s_sensors[i].hw_sensor.temperature, now_ms);
+        samples += s_sensors[i].hw_sensor.valid ? 1 : 0;
+    }
+    int64_t start_ms = start / 1000;
+    if (s_last_cycle_start > 0) {
+        acq_record_cycle(&s_acq, (uint32_t)elapsed_ms, (uint32_t)(start_ms - s_last_cycle_start), samples);
+    }
+    s_last_cycle_start = start_ms;
+
+    /* The controller sets the bus default, so it only steps on cycles that
+     * served sensors following it; fast per-sensor reads alone would
+     * otherwise count down its relax hysteresis in seconds */
+    uint8_t prev_resolution = s_acq.resolution;
+    if (s_acq.cfg.enabled && default_due) {
+        acq_decide(&s_acq);
+    }
+    xSemaphoreGive(s_lock);
+    publish_alerts(alerts);
+
+    if (s_acq.cfg.enabled && s_acq.resolution != prev_resolution) {
+        bus_task_set_resolution(s_acq.resolution);
+        ESP_LOGI(TAG, "Adaptive: resolution %d -> %d bits (interval %lu ms)",
+                 prev_resolution, s_acq.resolution, (unsigned long)s_acq.interval_ms);
     }
 
     return err;
 }
 
+esp_err_t sensor_manager_read_now(const char *address_str, bool *coalesced)
+{
+    const int64_t spacing_us = (int64_t)CONFIG_SENSOR_READ_NOW_SPACING_MS * 1000;
+    /* Too large for an httpd task stack; s_read_now_lock serializes their use */
+    static onewire_sensor_t hw_sensors[CONFIG_MAX_SENSORS];
+    static bool selected[CONFIG_MAX_SENSORS];
+
+    *coalesced = false;
+
+    /* Requests arriving while a read is converting wait here, then find its
+     * result fresh and return it without touching the bus */
+    xSemaphoreTake(s_read_now_lock, portMAX_DELAY);
+    s_read_now_stats.requests++;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_sensor_count;
+    uint32_t generation = s_bus_generation;
+    int64_t now_us = esp_timer_get_time();
+    int wanted = 0;
+    bool fresh = true;
+    for (int i = 0; i < count; i++) {
+        selected[i] = address_str == NULL || strcmp(s_sensors[i].address_str, address_str) == 0;
+        if (!selected[i]) {
+            continue;
+        }
+        wanted++;
+        if (!s_sensors[i].hw_sensor.valid ||
+            now_us / 1000 - s_sensors[i].hw_sensor.last_read_time >= spacing_us / 1000) {
+            fresh = false;
+        }
+    }
+    snapshot_sensors(hw_sensors, count);
+    xSemaphoreGive(s_lock);
+
+    if (wanted == 0) {
+        xSemaphoreGive(s_read_now_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (fresh) {
+        s_read_now_stats.coalesced++;
+        *coalesced = true;
+        xSemaphoreGive(s_read_now_lock);
+        return ESP_OK;
+    }
+
+    /* Keep on-demand conversions at least the spacing apart */
+    int64_t wait_us = s_read_now_last_us + spacing_us - now_us;
+    if (s_read_now_last_us > 0 && wait_us > 0) {
+        s_read_now_stats.delayed++;
+        vTaskDelay(pdMS_TO_TICKS(wait_us / 1000) + 1);
+    }
+    s_read_now_last_us = esp_timer_get_time();
+    s_read_now_stats.conversions++;
+
+    esp_err_t err = bus_task_read_now(hw_sensors, count, selected, generation);
+    if (err == ESP_ERR_INVALID_STATE) {
+        xSemaphoreGive(s_read_now_lock);
+        return err;
+    }
+
+    alert_msg_t *alerts = NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (generation == s_bus_generation) {
+        s_cycle_changed = false;
+        for (int i = 0; i < s_sensor_count; i++) {
+            if (selected[i]) {
+                apply_reading(i, &hw_sensors[i]);
+            }
+        }
+        evaluate_alerts(&alerts);
+        evaluate_bus_health(&alerts);
+        virtual_sensor_evaluate(s_sensors, s_sensor_count);
+    } else {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreGive(s_lock);
+    xSemaphoreGive(s_read_now_lock);
+    publish_alerts(alerts);
+
+    ESP_LOGD(TAG, "On-demand read of %s: %s", address_str ? address_str : "all sensors",
+             esp_err_to_name(err));
+    return err;
+}
+
+void sensor_manager_get_read_now_stats(sensor_read_now_stats_t *stats)
+{
+    *stats = s_read_now_stats;
+}
+
 esp_err_t sensor_manager_publish_all(void)
 {
+#if CONFIG_SPARKPLUG_ENABLED
+    /* One NDATA carries every changed sensor and virtual sensor */
+    return mqtt_ha_publish_sparkplug_data();
+#else
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+
     int64_t start = esp_timer_get_time();
     int published = 0;
     
-    for (int i = 0; i < s_sensor_count; i++) {
-        if (s_sensors[i].hw_sensor.valid) {
-            const char *name = s_sensors[i].has_friendly_name ? 
-                               s_sensors[i].friendly_name : s_sensors[i].address_str;
+    for (int i = 0; i < count; i++) {
+        if (sensors[i].hw_sensor.valid) {
+            const char *name = sensors[i].has_friendly_name ? 
+                               sensors[i].friendly_name : sensors[i].address_str;
             
-            if (mqtt_ha_publish_temperature(s_sensors[i].address_str, 
+            if (mqtt_ha_publish_temperature(sensors[i].address_str, 
                                             name,
-                                            s_sensors[i].hw_sensor.temperature) == ESP_OK) {
+                                            sensors[i].hw_sensor.temperature) == ESP_OK) {
                 published++;
             }
         }
     }
     
+    virtual_sensor_publish_all();
+
+#if CONFIG_HA_TREND_ENTITIES
+    for (int i = 0; i < count; i++) {
+        float slope, predicted;
+        if (sensor_manager_get_trend(i, &slope, &predicted)) {
+            mqtt_ha_publish_trend(sensors[i].address_str, slope, predicted);
+        }
+    }
+#endif
+    free(sensors);
+
     /* Also publish diagnostic data (network status) */
     mqtt_ha_publish_diagnostics();
     
@@ -165,91 +762,439 @@ esp_err_t sensor_manager_publish_all(void)
     ESP_LOGI(TAG, "Published %d sensors via MQTT in %lld ms", published, elapsed_ms);
     
     return ESP_OK;
+#endif
 }
 
-const managed_sensor_t* sensor_manager_get_sensors(int *count)
+int sensor_manager_copy_sensors(managed_sensor_t *sensors, int max)
 {
-    *count = s_sensor_count;
-    return s_sensors;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_sensor_count < max ? s_sensor_count : max;
+    memcpy(sensors, s_sensors, sizeof(managed_sensor_t) * count);
+    xSemaphoreGive(s_lock);
+    return count;
+}
+
+int sensor_manager_copy_sensors_seq(managed_sensor_t *sensors, sensor_sched_info_t *sched, int max,
+                                    uint32_t *seq, uint32_t *layout_seq)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_sensor_count < max ? s_sensor_count : max;
+    memcpy(sensors, s_sensors, sizeof(managed_sensor_t) * count);
+    for (int i = 0; i < count && sched != NULL; i++) {
+        const bus_sched_entry_t *e = &s_sched.entries[i];
+        sched[i] = (sensor_sched_info_t){
+            .interval_ms = e->interval_ms,
+            .target_ms = bus_sched_target(&s_sched, i),
+            .achieved_ms = (uint32_t)e->achieved_ms,
+            .late = e->late,
+        };
+    }
+    *seq = s_change_seq;
+    *layout_seq = s_layout_seq;
+    xSemaphoreGive(s_lock);
+    return count;
 }
 
 esp_err_t sensor_manager_set_friendly_name(const char *address_str, const char *friendly_name)
 {
-    for (int i = 0; i < s_sensor_count; i++) {
-        if (strcmp(s_sensors[i].address_str, address_str) == 0) {
-            /* Save to NVS */
-            esp_err_t err = nvs_storage_save_sensor_name(s_sensors[i].hw_sensor.address, friendly_name);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to save friendly name");
-                return err;
-            }
-            
-            /* Update in memory */
-            strncpy(s_sensors[i].friendly_name, friendly_name, MAX_FRIENDLY_NAME_LEN - 1);
-            s_sensors[i].friendly_name[MAX_FRIENDLY_NAME_LEN - 1] = '\0';
-            s_sensors[i].has_friendly_name = (strlen(friendly_name) > 0);
-            
-            ESP_LOGI(TAG, "Set friendly name for %s: %s", address_str, friendly_name);
-            
-            /* Re-register with Home Assistant if discovery is enabled */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    if (i < 0) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Sensor not found: %s", address_str);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Save to NVS */
+    esp_err_t err = nvs_storage_save_sensor_name(s_sensors[i].hw_sensor.address, friendly_name);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Failed to save friendly name");
+        return err;
+    }
+    
+    /* Update in memory */
+    strncpy(s_sensors[i].friendly_name, friendly_name, MAX_FRIENDLY_NAME_LEN - 1);
+    s_sensors[i].friendly_name[MAX_FRIENDLY_NAME_LEN - 1] = '\0';
+    s_sensors[i].has_friendly_name = (strlen(friendly_name) > 0);
+    s_sensors[i].change_seq = ++s_change_seq;
+
+    char name[MAX_FRIENDLY_NAME_LEN];
+    snprintf(name, sizeof(name), "%s",
+             s_sensors[i].has_friendly_name ? s_sensors[i].friendly_name : s_sensors[i].address_str);
+
+    /* Virtual sensors may refer to the old or new name */
+    virtual_sensor_bind(s_sensors, s_sensor_count);
+    xSemaphoreGive(s_lock);
+    
+    ESP_LOGI(TAG, "Set friendly name for %s: %s", address_str, friendly_name);
+
+    /* Re-register with Home Assistant if discovery is enabled */
 #if CONFIG_HA_DISCOVERY_ENABLED
-            mqtt_ha_register_sensor(s_sensors[i].address_str, 
-                                   s_sensors[i].has_friendly_name ? 
-                                   s_sensors[i].friendly_name : s_sensors[i].address_str);
+    mqtt_ha_register_sensor(address_str, name);
 #endif
-            
-            return ESP_OK;
+    
+    return ESP_OK;
+}
+
+void sensor_manager_get_display_name(const char *address_str, char *buf, size_t len)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    const char *name = address_str;
+    if (i >= 0 && s_sensors[i].has_friendly_name) {
+        name = s_sensors[i].friendly_name;
+    }
+    snprintf(buf, len, "%s", name);
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t sensor_manager_get_sensor(const char *address_str, managed_sensor_t *sensor)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    if (i >= 0) {
+        *sensor = s_sensors[i];
+    }
+    xSemaphoreGive(s_lock);
+    return i >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+int sensor_manager_get_count(void)
+{
+    return s_sensor_count;
+}
+
+uint32_t sensor_manager_get_change_seq(void)
+{
+    return s_change_seq;
+}
+
+uint32_t sensor_manager_get_layout_seq(void)
+{
+    return s_layout_seq;
+}
+
+uint32_t sensor_manager_get_boot_id(void)
+{
+    return s_boot_id;
+}
+
+esp_err_t sensor_manager_set_alert_rule(const char *address_str, const alert_rule_config_t *rule)
+{
+    alert_rule_t compiled;
+    memset(&compiled, 0, sizeof(compiled));
+    if (rule != NULL && !alert_rule_compile(rule, &compiled)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    uint8_t address[ONEWIRE_ROM_SIZE];
+    if (i >= 0) {
+        memcpy(address, s_sensors[i].hw_sensor.address, sizeof(address));
+    }
+    xSemaphoreGive(s_lock);
+    if (i < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Flash writes can stall for tens of ms, so keep them out of s_lock */
+    esp_err_t err;
+    if (rule != NULL) {
+        err = nvs_storage_save_alert_rule(address, rule);
+    } else {
+        err = nvs_storage_delete_alert_rule(address);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
         }
     }
-    
-    ESP_LOGE(TAG, "Sensor not found: %s", address_str);
-    return ESP_ERR_NOT_FOUND;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save alert rule");
+        return err;
+    }
+
+    /* The sensor list may have been rebuilt while the lock was released */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    i = find_sensor(address_str);
+    if (i < 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Clear alerts the old rule raised before swapping it out */
+    alert_msg_t *alerts = NULL;
+    for (uint8_t type = ALERT_HIGH; type <= ALERT_STALE; type <<= 1) {
+        if (s_alert_rules[i].active & type) {
+            record_alert(&alerts, i, type, false);
+        }
+    }
+
+    alert_rule_reset(&compiled, esp_timer_get_time() / 1000);
+    s_alert_rules[i] = compiled;
+    s_sensors[i].has_alert_rule = (rule != NULL);
+    if (rule != NULL) {
+        s_sensors[i].alert_config = *rule;
+    } else {
+        memset(&s_sensors[i].alert_config, 0, sizeof(s_sensors[i].alert_config));
+    }
+    xSemaphoreGive(s_lock);
+    publish_alerts(alerts);
+
+    ESP_LOGI(TAG, "Alert rule %s for %s", rule ? "set" : "cleared", address_str);
+    return ESP_OK;
 }
 
-const char* sensor_manager_get_display_name(const char *address_str)
+uint32_t sensor_manager_get_read_interval(uint32_t configured_ms)
 {
-    for (int i = 0; i < s_sensor_count; i++) {
-        if (strcmp(s_sensors[i].address_str, address_str) == 0) {
-            return s_sensors[i].has_friendly_name ? 
-                   s_sensors[i].friendly_name : s_sensors[i].address_str;
+    return s_acq.cfg.enabled ? s_acq.interval_ms : configured_ms;
+}
+
+uint32_t sensor_manager_get_read_delay(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t delay_ms = bus_sched_delay_ms(&s_sched, esp_timer_get_time() / 1000);
+    xSemaphoreGive(s_lock);
+    return delay_ms;
+}
+
+/**
+ * @brief Fill in the bus costs and retry rate of a capacity model input
+ */
+static void capacity_costs(bus_capacity_input_t *in)
+{
+    /* Costs measured on this bus, falling back to nominal 1-Wire timing */
+    onewire_temp_get_timing(&in->overhead_us, &in->scratchpad_us);
+    if (in->overhead_us == 0) {
+        in->overhead_us = BUS_CAPACITY_DEFAULT_OVERHEAD_US;
+    }
+    if (in->scratchpad_us == 0) {
+        in->scratchpad_us = BUS_CAPACITY_DEFAULT_SCRATCHPAD_US;
+    }
+    /* A bus already failing more often than the budget needs its real rate */
+    in->retry_rate = BUS_CAPACITY_RETRY_BUDGET;
+    uint32_t total_reads, failed_reads;
+    onewire_temp_get_error_stats(&total_reads, &failed_reads);
+    if (total_reads > 0 && (float)failed_reads / total_reads > in->retry_rate) {
+        in->retry_rate = (float)failed_reads / total_reads;
+    }
+}
+
+esp_err_t sensor_manager_set_sensor_interval(const char *address_str, uint32_t interval_ms,
+                                             bus_capacity_t *cap)
+{
+    if (!bus_sched_interval_valid(interval_ms)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t intervals[CONFIG_MAX_SENSORS];
+    bus_capacity_input_t in = {
+        .bus_resolution = onewire_temp_get_resolution(),
+        .interval_ms = intervals,
+    };
+    capacity_costs(&in);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    if (i < 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Check the bus keeps up with the new interval alongside the others */
+    bus_capacity_t before, after;
+    in.sensor_count = s_sensor_count;
+    in.default_interval_ms = s_sched.default_interval_ms;
+    for (int j = 0; j < s_sensor_count; j++) {
+        intervals[j] = s_sched.entries[j].interval_ms;
+    }
+    bus_capacity_compute(&in, &before);
+    intervals[i] = interval_ms;
+    bus_capacity_compute(&in, &after);
+    if (cap != NULL) {
+        *cap = after;
+    }
+    if (after.verdict == BUS_CAPACITY_OVERLOAD && after.utilization > before.utilization) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = nvs_storage_save_sensor_interval(s_sensors[i].hw_sensor.address, interval_ms);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Failed to save sensor interval");
+        return err;
+    }
+
+    bus_sched_set_interval(&s_sched, i, interval_ms);
+    uint32_t target_ms = bus_sched_target(&s_sched, i);
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Read interval for %s: %lu ms%s", address_str,
+             (unsigned long)target_ms, interval_ms ? "" : " (bus default)");
+    return ESP_OK;
+}
+
+void sensor_manager_get_capacity(int sensor_count, int resolution, uint32_t default_interval_ms,
+                                 bus_capacity_t *out)
+{
+    uint32_t intervals[CONFIG_MAX_SENSORS];
+    bus_capacity_input_t in = {
+        .sensor_count = sensor_count >= 0 ? sensor_count : s_sensor_count,
+        .bus_resolution = resolution > 0 ? resolution : onewire_temp_get_resolution(),
+        .default_interval_ms = default_interval_ms,
+    };
+    capacity_costs(&in);
+
+    /* Per-sensor intervals only apply to the sensors actually present */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (in.sensor_count == s_sensor_count) {
+        for (int i = 0; i < s_sensor_count; i++) {
+            intervals[i] = s_sched.entries[i].interval_ms;
         }
+        in.interval_ms = intervals;
     }
-    return address_str;
+    bus_capacity_compute(&in, out);
+    xSemaphoreGive(s_lock);
 }
 
-const managed_sensor_t* sensor_manager_get_sensor(const char *address_str)
+bool sensor_manager_get_trend(int index, float *slope_per_min, float *predicted)
 {
-    for (int i = 0; i < s_sensor_count; i++) {
-        if (strcmp(s_sensors[i].address_str, address_str) == 0) {
-            return &s_sensors[i];
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool ok = index >= 0 && index < s_sensor_count &&
+              trend_slope(&s_trend[index], slope_per_min) &&
+              trend_predict(&s_trend[index], (uint32_t)CONFIG_TREND_HORIZON_S * 1000, predicted);
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+int sensor_manager_get_bus_snapshot(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max,
+                                    uint32_t *generation)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_sensor_count < max ? s_sensor_count : max;
+    for (int i = 0; i < count; i++) {
+        memcpy(addresses[i], s_sensors[i].hw_sensor.address, ONEWIRE_ROM_SIZE);
+    }
+    *generation = s_bus_generation;
+    xSemaphoreGive(s_lock);
+    return count;
+}
+
+esp_err_t sensor_manager_set_sensor_position(const char *address_str, uint8_t position)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    if (i < 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = nvs_storage_save_sensor_position(s_sensors[i].hw_sensor.address, position);
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Failed to save sensor position");
+        return err;
+    }
+
+    s_sensors[i].position = position;
+    s_sensors[i].change_seq = ++s_change_seq;
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "Cable position for %s: %u", address_str, position);
+    return ESP_OK;
+}
+
+bool sensor_manager_get_health(health_counts_t *bus, health_counts_t *sensors, health_fault_t *fault)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    compute_health(esp_timer_get_time() / 1000, bus, sensors, fault);
+    bool alert = s_health_alert;
+    xSemaphoreGive(s_lock);
+    return alert;
+}
+
+esp_err_t sensor_manager_set_acq_config(const acq_config_t *cfg)
+{
+    if (!acq_config_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_storage_save_acq_config(cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save acquisition config");
+        return err;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool was_enabled = s_acq.cfg.enabled;
+    acq_init(&s_acq, cfg, s_acq_state, s_sensor_count);
+    xSemaphoreGive(s_lock);
+
+    if (cfg->enabled) {
+        bus_task_set_resolution(s_acq.resolution);
+    } else if (was_enabled) {
+        /* Back to the fixed resolution from sensor settings */
+        uint32_t read_ms, publish_ms;
+        uint8_t resolution;
+        if (nvs_storage_load_sensor_settings(&read_ms, &publish_ms, &resolution) == ESP_OK &&
+            resolution >= 9 && resolution <= 12) {
+            bus_task_set_resolution(resolution);
+        } else {
+            bus_task_set_resolution(12);
         }
     }
-    return NULL;
+
+    ESP_LOGI(TAG, "Adaptive acquisition %s (%lu-%lu ms, %d-%d bits)",
+             cfg->enabled ? "enabled" : "disabled",
+             (unsigned long)cfg->min_interval_ms, (unsigned long)cfg->max_interval_ms,
+             cfg->min_resolution, cfg->max_resolution);
+    return ESP_OK;
 }
 
-int sensor_manager_get_count(void)
+const acq_controller_t *sensor_manager_get_acq(void)
 {
-    return s_sensor_count;
+    return &s_acq;
+}
+
+uint8_t sensor_manager_get_active_alerts(int index)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint8_t active = index >= 0 && index < s_sensor_count ? s_alert_rules[index].active : 0;
+    xSemaphoreGive(s_lock);
+    return active;
 }
 
 void sensor_manager_reset_all_error_stats(void)
 {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t seq = ++s_change_seq;
     for (int i = 0; i < s_sensor_count; i++) {
         s_sensors[i].hw_sensor.total_reads = 0;
         s_sensors[i].hw_sensor.failed_reads = 0;
+        s_sensors[i].change_seq = seq;
+        health_window_init(&s_health[i]);
     }
+    health_window_init(&s_bus_health);
+    xSemaphoreGive(s_lock);
     ESP_LOGI(TAG, "All per-sensor error stats reset");
 }
 
 esp_err_t sensor_manager_reset_sensor_error_stats(const char *address_str)
 {
-    for (int i = 0; i < s_sensor_count; i++) {
-        if (strcmp(s_sensors[i].address_str, address_str) == 0) {
-            s_sensors[i].hw_sensor.total_reads = 0;
-            s_sensors[i].hw_sensor.failed_reads = 0;
-            ESP_LOGI(TAG, "Error stats reset for %s", address_str);
-            return ESP_OK;
-        }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int i = find_sensor(address_str);
+    if (i >= 0) {
+        s_sensors[i].hw_sensor.total_reads = 0;
+        s_sensors[i].hw_sensor.failed_reads = 0;
+        s_sensors[i].change_seq = ++s_change_seq;
+        health_window_init(&s_health[i]);
     }
-    return ESP_ERR_NOT_FOUND;
+    xSemaphoreGive(s_lock);
+
+    if (i < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Error stats reset for %s", address_str);
+    return ESP_OK;
 }
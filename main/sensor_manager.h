@@ -8,7 +8,13 @@
 
 #include "esp_err.h"
 #include "onewire_temp.h"
+#include "alert_rules.h"
+#include "acq_controller.h"
+#include "bus_sched.h"
+#include "bus_capacity.h"
+#include "health_window.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 #define MAX_FRIENDLY_NAME_LEN 32
 
@@ -20,8 +26,32 @@ typedef struct {
     char friendly_name[MAX_FRIENDLY_NAME_LEN]; /**< User-assigned friendly name */
     bool has_friendly_name;                    /**< True if friendly name is set */
     char address_str[17];                      /**< Address as hex string */
+    uint32_t change_seq;                       /**< Change sequence of last visible change */
+    alert_rule_config_t alert_config;          /**< Alert rule as configured */
+    bool has_alert_rule;                       /**< True if an alert rule is set */
+    uint8_t position;                          /**< Place on the bus cable, 0 = unknown */
 } managed_sensor_t;
 
+/**
+ * @brief On-demand read statistics
+ */
+typedef struct {
+    uint32_t requests;      /**< Read-now requests */
+    uint32_t conversions;   /**< Bus operations they caused */
+    uint32_t coalesced;     /**< Requests served by a reading younger than the spacing */
+    uint32_t delayed;       /**< Conversions held back to keep the minimum spacing */
+} sensor_read_now_stats_t;
+
+/**
+ * @brief How a periodic read cycle went, for the acquisition watchdog
+ */
+typedef enum {
+    SENSOR_CYCLE_IDLE = 0,  /**< Nothing was due, or the cycle was discarded by a rescan */
+    SENSOR_CYCLE_OK,        /**< At least one sensor read */
+    SENSOR_CYCLE_FAILED,    /**< The bus produced no reading at all */
+    SENSOR_CYCLE_OVERRUN,   /**< Far slower than conversion and reads can explain */
+} sensor_cycle_result_t;
+
 /**
  * @brief Initialize sensor manager and discover sensors
  */
@@ -33,9 +63,132 @@ esp_err_t sensor_manager_init(void);
 esp_err_t sensor_manager_rescan(void);
 
 /**
- * @brief Read temperatures from all sensors
+ * @brief Read the sensors whose deadline has come
+ *
+ * Due sensors share one conversion and only their scratchpads are read;
+ * sensors with a later deadline keep their previous reading. Sensors of a
+ * failed cycle stay due, so the next call retries them.
+ *
+ * @param default_interval_ms Interval for sensors without their own
+ * @param result Output: cycle outcome (may be NULL)
+ */
+esp_err_t sensor_manager_read_due(uint32_t default_interval_ms, sensor_cycle_result_t *result);
+
+/**
+ * @brief Read one sensor, or all, now instead of at their next deadline
+ *
+ * Runs ahead of periodic work on the bus. A reading younger than
+ * CONFIG_SENSOR_READ_NOW_SPACING_MS is returned as is, so requests that
+ * arrive while another is converting share its result. New conversions are
+ * kept at least that far apart. Results are in the sensor table on return.
+ *
+ * @param address_str Sensor address, or NULL for all sensors
+ * @param coalesced Output: true if no new conversion was needed
+ * @return ESP_ERR_NOT_FOUND if the sensor is unknown, ESP_ERR_INVALID_STATE
+ *         if a rescan replaced the sensor list meanwhile
+ */
+esp_err_t sensor_manager_read_now(const char *address_str, bool *coalesced);
+
+/**
+ * @brief Get on-demand read statistics
+ */
+void sensor_manager_get_read_now_stats(sensor_read_now_stats_t *stats);
+
+/**
+ * @brief Time until the next sensor is due, in ms
+ */
+uint32_t sensor_manager_get_read_delay(void);
+
+/**
+ * @brief Set a sensor's target read interval
+ *
+ * Saved to NVS. 0 makes the sensor follow the bus-wide interval (configured
+ * or adaptive). An interval that would overload the bus is refused, unless
+ * it lightens a bus that is already overloaded.
+ *
+ * @param cap Output: capacity with the new interval, or NULL
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if out of range,
+ *         ESP_ERR_NOT_FOUND if sensor not found,
+ *         ESP_ERR_INVALID_STATE if the bus could not keep up
+ */
+esp_err_t sensor_manager_set_sensor_interval(const char *address_str, uint32_t interval_ms,
+                                             bus_capacity_t *cap);
+
+/**
+ * @brief A sensor's read schedule, as copied by sensor_manager_copy_sensors_seq()
+ */
+typedef struct {
+    uint32_t interval_ms;           /**< Own target interval, 0 = bus default */
+    uint32_t target_ms;             /**< Interval actually targeted */
+    uint32_t achieved_ms;           /**< Smoothed interval actually achieved */
+    uint32_t late;                  /**< Reads started late */
+} sensor_sched_info_t;
+
+/**
+ * @brief Evaluate bus capacity for a configuration
+ *
+ * Uses the measured reset/convert and scratchpad costs (nominal ones until
+ * the first read), the per-sensor intervals, and a retry budget of
+ * BUS_CAPACITY_RETRY_BUDGET or the bus's actual failure rate if higher.
+ *
+ * @param sensor_count Sensors to plan for, -1 for the ones present
+ * @param resolution Bits, 0 for the current resolution
+ * @param default_interval_ms Bus-wide read interval
+ * @param out Output: model results
+ */
+void sensor_manager_get_capacity(int sensor_count, int resolution, uint32_t default_interval_ms,
+                                 bus_capacity_t *out);
+
+/**
+ * @brief Get a sensor's rate of change and forecast
+ *
+ * Least-squares fit over the last CONFIG_TREND_WINDOW_S of readings,
+ * extrapolated CONFIG_TREND_HORIZON_S past the newest one.
+ *
+ * @param index Sensor index (as in sensor_manager_copy_sensors())
+ * @param slope_per_min Output: °C per minute
+ * @param predicted Output: forecast temperature (°C)
+ * @return false until the window holds enough readings
+ */
+bool sensor_manager_get_trend(int index, float *slope_per_min, float *predicted);
+
+/**
+ * @brief Copy the sensor addresses in bus order, with the device list
+ *        generation they belong to (for callers driving the bus directly)
+ * @param addresses Output array
+ * @param max Capacity of @p addresses
+ * @param generation Output: device list generation
+ * @return Number of addresses copied
+ */
+int sensor_manager_get_bus_snapshot(uint8_t (*addresses)[ONEWIRE_ROM_SIZE], int max,
+                                    uint32_t *generation);
+
+/**
+ * @brief Set a sensor's position along the bus cable
+ *
+ * Saved to NVS. Positions let fault localization name the cable segment
+ * behind which sensors fail; ROM search order does not follow the cable.
+ *
+ * @param position 1-255 counted from the master, 0 to clear
+ * @return ESP_ERR_NOT_FOUND if sensor not found
+ */
+esp_err_t sensor_manager_set_sensor_position(const char *address_str, uint8_t position);
+
+/**
+ * @brief Get read error rates over the sliding windows and the likely fault
+ *
+ * Localization uses the last hour of per-sensor counts. A bus health alert
+ * is raised when the last minute or hour fails more than
+ * CONFIG_BUS_HEALTH_ALERT_PERCENT of reads, and cleared once the minute is
+ * back under half of it and the hour under it.
+ *
+ * @param bus Output: counts for the whole bus
+ * @param sensors Output: counts indexed like sensor_manager_copy_sensors()
+ *                (CONFIG_MAX_SENSORS entries), or NULL
+ * @param fault Output: localization result (indices into the sensor list)
+ * @return true while the bus health alert is raised
  */
-esp_err_t sensor_manager_read_all(void);
+bool sensor_manager_get_health(health_counts_t *bus, health_counts_t *sensors, health_fault_t *fault);
 
 /**
  * @brief Publish all sensor readings via MQTT
@@ -43,11 +196,30 @@ esp_err_t sensor_manager_read_all(void);
 esp_err_t sensor_manager_publish_all(void);
 
 /**
- * @brief Get all managed sensors
- * @param count Output: number of sensors
- * @return Array of managed sensors (do not free)
+ * @brief Copy the managed sensors
+ *
+ * The copy is taken under the table lock, so it stays consistent while a
+ * rescan rebuilds the table. Indices are valid until the next rescan.
+ *
+ * @param sensors Output array
+ * @param max Capacity of @p sensors (CONFIG_MAX_SENSORS for all of them)
+ * @return Number of sensors copied
  */
-const managed_sensor_t* sensor_manager_get_sensors(int *count);
+int sensor_manager_copy_sensors(managed_sensor_t *sensors, int max);
+
+/**
+ * @brief Copy the sensor table together with its schedules and change sequences
+ *
+ * Like sensor_manager_copy_sensors(), but the schedules and sequences are
+ * read under the same lock, so every change stamped at or below @p seq is
+ * in the copy and @p sched matches @p sensors index for index.
+ *
+ * @param sched Output: read schedules (@p max entries), or NULL
+ * @param seq Output: sensor_manager_get_change_seq() at copy time
+ * @param layout_seq Output: sensor_manager_get_layout_seq() at copy time
+ */
+int sensor_manager_copy_sensors_seq(managed_sensor_t *sensors, sensor_sched_info_t *sched, int max,
+                                    uint32_t *seq, uint32_t *layout_seq);
 
 /**
  * @brief Set friendly name for a sensor
@@ -59,20 +231,46 @@ esp_err_t sensor_manager_set_friendly_name(const char *address_str, const char *
 /**
  * @brief Get friendly name for a sensor
  * @param address_str Sensor address as hex string
- * @return Friendly name or address string if no name set
+ * @param buf Output: friendly name, or the address if no name is set
+ * @param len Size of @p buf
  */
-const char* sensor_manager_get_display_name(const char *address_str);
+void sensor_manager_get_display_name(const char *address_str, char *buf, size_t len);
 
 /**
- * @brief Get sensor by address string
+ * @brief Copy a sensor by address string
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if sensor not found
  */
-const managed_sensor_t* sensor_manager_get_sensor(const char *address_str);
+esp_err_t sensor_manager_get_sensor(const char *address_str, managed_sensor_t *sensor);
 
 /**
  * @brief Get number of sensors
  */
 int sensor_manager_get_count(void);
 
+/**
+ * @brief Get the current change sequence
+ *
+ * Incremented once per read cycle in which any sensor's reading, validity,
+ * name or failure count changed. Each sensor's change_seq records the
+ * sequence of its last change, so clients can ask for "changes since N".
+ * Read counters advance on every read and are not tracked; deltas leave
+ * them out.
+ */
+uint32_t sensor_manager_get_change_seq(void);
+
+/**
+ * @brief Get the sequence at which the sensor list itself last changed
+ *
+ * Clients holding a sequence older than this must refetch the full list
+ * (sensors may have been added or removed by a rescan).
+ */
+uint32_t sensor_manager_get_layout_seq(void);
+
+/**
+ * @brief Get the per-boot identifier that qualifies change sequences
+ */
+uint32_t sensor_manager_get_boot_id(void);
+
 /**
  * @brief Reset error stats for all sensors
  */
@@ -85,4 +283,53 @@ void sensor_manager_reset_all_error_stats(void);
  */
 esp_err_t sensor_manager_reset_sensor_error_stats(const char *address_str);
 
+/**
+ * @brief Set or clear a sensor's alert rule
+ *
+ * The rule is validated, compiled into the evaluation table and saved to
+ * NVS. Rules are evaluated in sensor_manager_read_due() right after each bus
+ * read; transitions are published on MQTT (<base>/alert) and the web event
+ * stream.
+ *
+ * @param address_str Sensor address as hex string
+ * @param rule Rule configuration, or NULL to remove the rule
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the rule is invalid,
+ *         ESP_ERR_NOT_FOUND if sensor not found
+ */
+esp_err_t sensor_manager_set_alert_rule(const char *address_str, const alert_rule_config_t *rule);
+
+/**
+ * @brief Get the alerts currently active for a sensor
+ * @param index Sensor index (0 to count-1)
+ * @return ALERT_* mask
+ */
+uint8_t sensor_manager_get_active_alerts(int index);
+
+/**
+ * @brief Get the bus-wide read interval
+ *
+ * Returns the adaptive controller's interval when adaptive acquisition is
+ * enabled, otherwise @p configured_ms. Sensors without their own interval
+ * are read at this rate.
+ */
+uint32_t sensor_manager_get_read_interval(uint32_t configured_ms);
+
+/**
+ * @brief Set adaptive acquisition configuration
+ *
+ * Validates, saves to NVS and restarts the controller. Disabling restores
+ * the saved fixed resolution.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if bounds are invalid
+ */
+esp_err_t sensor_manager_set_acq_config(const acq_config_t *cfg);
+
+/**
+ * @brief Get adaptive acquisition state (config, decisions, bus statistics)
+ *
+ * Bus utilization, sample rate and per-sensor estimates are maintained
+ * even when adaptive mode is disabled.
+ */
+const acq_controller_t *sensor_manager_get_acq(void);
+
 #endif /* SENSOR_MANAGER_H */
@@ -0,0 +1,331 @@
+/**
+ * @file sparkplug.c
+ * @brief Sparkplug B payload encoding and report-by-exception (host-testable)
+ */
+
+#include "sparkplug.h"
+#include <string.h>
+#include <math.h>
+
+/* Protobuf wire types */
+#define WT_VARINT   0
+#define WT_FIXED64  1
+#define WT_LEN      2
+#define WT_FIXED32  5
+
+/* Payload fields */
+#define PAYLOAD_TIMESTAMP   1
+#define PAYLOAD_METRICS     2
+#define PAYLOAD_SEQ         3
+
+/* Metric fields */
+#define METRIC_NAME         1
+#define METRIC_ALIAS        2
+#define METRIC_TIMESTAMP    3
+#define METRIC_DATATYPE     4
+#define METRIC_IS_NULL      7
+#define METRIC_INT_VALUE    10
+#define METRIC_LONG_VALUE   11
+#define METRIC_FLOAT_VALUE  12
+#define METRIC_BOOL_VALUE   14
+#define METRIC_STRING_VALUE 15
+
+/**
+ * @brief Output buffer; with buf == NULL only counts bytes
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} pb_writer_t;
+
+static void put_byte(pb_writer_t *w, uint8_t byte)
+{
+    if (w->buf != NULL) {
+        if (w->len >= w->size) {
+            w->overflow = true;
+            return;
+        }
+        w->buf[w->len] = byte;
+    }
+    w->len++;
+}
+
+static void put_varint(pb_writer_t *w, uint64_t value)
+{
+    while (value >= 0x80) {
+        put_byte(w, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    put_byte(w, (uint8_t)value);
+}
+
+static void put_tag(pb_writer_t *w, int field, int wire_type)
+{
+    put_varint(w, ((uint64_t)field << 3) | wire_type);
+}
+
+static void put_bytes(pb_writer_t *w, int field, const char *data, size_t len)
+{
+    put_tag(w, field, WT_LEN);
+    put_varint(w, len);
+    for (size_t i = 0; i < len; i++) {
+        put_byte(w, (uint8_t)data[i]);
+    }
+}
+
+static void put_float(pb_writer_t *w, int field, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_tag(w, field, WT_FIXED32);
+    for (int i = 0; i < 4; i++) {
+        put_byte(w, (uint8_t)(bits >> (8 * i)));
+    }
+}
+
+static void put_metric(pb_writer_t *w, const sparkplug_metric_t *m, uint64_t timestamp_ms)
+{
+    if (m->name != NULL) {
+        put_bytes(w, METRIC_NAME, m->name, strlen(m->name));
+    }
+    if (m->alias != 0) {
+        put_tag(w, METRIC_ALIAS, WT_VARINT);
+        put_varint(w, m->alias);
+    }
+    put_tag(w, METRIC_TIMESTAMP, WT_VARINT);
+    put_varint(w, timestamp_ms);
+    if (m->datatype != 0) {
+        put_tag(w, METRIC_DATATYPE, WT_VARINT);
+        put_varint(w, m->datatype);
+    }
+    if (m->is_null) {
+        put_tag(w, METRIC_IS_NULL, WT_VARINT);
+        put_varint(w, 1);
+        return;
+    }
+
+    switch (m->datatype) {
+    case SPARKPLUG_UINT64:
+        put_tag(w, METRIC_LONG_VALUE, WT_VARINT);
+        put_varint(w, m->value.u);
+        break;
+    case SPARKPLUG_BOOLEAN:
+        put_tag(w, METRIC_BOOL_VALUE, WT_VARINT);
+        put_varint(w, m->value.b ? 1 : 0);
+        break;
+    case SPARKPLUG_STRING:
+        put_bytes(w, METRIC_STRING_VALUE, m->value.s, strlen(m->value.s));
+        break;
+    default:
+        /* Data messages leave the datatype out; their values are floats */
+        put_float(w, METRIC_FLOAT_VALUE, m->value.f);
+        break;
+    }
+}
+
+size_t sparkplug_encode(uint8_t *buf, size_t size, uint64_t timestamp_ms, int seq,
+                        const sparkplug_metric_t *metrics, int count)
+{
+    pb_writer_t w = { .buf = buf, .size = size };
+
+    put_tag(&w, PAYLOAD_TIMESTAMP, WT_VARINT);
+    put_varint(&w, timestamp_ms);
+
+    for (int i = 0; i < count; i++) {
+        pb_writer_t sizer = { 0 };
+        put_metric(&sizer, &metrics[i], timestamp_ms);
+        put_tag(&w, PAYLOAD_METRICS, WT_LEN);
+        put_varint(&w, sizer.len);
+        put_metric(&w, &metrics[i], timestamp_ms);
+    }
+
+    if (seq >= 0) {
+        put_tag(&w, PAYLOAD_SEQ, WT_VARINT);
+        put_varint(&w, (uint64_t)seq);
+    }
+    return w.overflow ? 0 : w.len;
+}
+
+/* ===== Decoding ===== */
+
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+} pb_reader_t;
+
+static bool get_varint(pb_reader_t *r, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->pos >= r->len) {
+            return false;
+        }
+        uint8_t byte = r->buf[r->pos++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Read a field; for WT_LEN @p value is the length and @p data the bytes
+ */
+static bool get_field(pb_reader_t *r, int *field, int *wire_type, uint64_t *value, const uint8_t **data)
+{
+    uint64_t tag;
+    if (!get_varint(r, &tag)) {
+        return false;
+    }
+    *field = (int)(tag >> 3);
+    *wire_type = (int)(tag & 7);
+
+    switch (*wire_type) {
+    case WT_VARINT:
+        return get_varint(r, value);
+    case WT_FIXED64:
+    case WT_FIXED32: {
+        size_t n = *wire_type == WT_FIXED64 ? 8 : 4;
+        if (r->len - r->pos < n) {
+            return false;
+        }
+        *value = 0;
+        for (size_t i = 0; i < n; i++) {
+            *value |= (uint64_t)r->buf[r->pos + i] << (8 * i);
+        }
+        r->pos += n;
+        return true;
+    }
+    case WT_LEN:
+        if (!get_varint(r, value) || *value > r->len - r->pos) {
+            return false;
+        }
+        *data = r->buf + r->pos;
+        r->pos += (size_t)*value;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool decode_metric(const uint8_t *buf, size_t len, sparkplug_metric_t *m)
+{
+    pb_reader_t r = { .buf = buf, .len = len };
+    memset(m, 0, sizeof(*m));
+
+    while (r.pos < r.len) {
+        int field, wire_type;
+        uint64_t value;
+        const uint8_t *data = NULL;
+        if (!get_field(&r, &field, &wire_type, &value, &data)) {
+            return false;
+        }
+        switch (field) {
+        case METRIC_NAME:
+            m->name = (const char *)data;
+            m->name_len = (size_t)value;
+            break;
+        case METRIC_ALIAS:
+            m->alias = value;
+            break;
+        case METRIC_DATATYPE:
+            m->datatype = (uint8_t)value;
+            break;
+        case METRIC_IS_NULL:
+            m->is_null = value != 0;
+            break;
+        case METRIC_INT_VALUE:
+        case METRIC_LONG_VALUE:
+            m->value.u = value;
+            break;
+        case METRIC_FLOAT_VALUE: {
+            uint32_t bits = (uint32_t)value;
+            memcpy(&m->value.f, &bits, sizeof(bits));
+            break;
+        }
+        case METRIC_BOOL_VALUE:
+            m->value.b = value != 0;
+            break;
+        case METRIC_STRING_VALUE:
+            m->value.s = (const char *)data;
+            m->str_len = (size_t)value;
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+int sparkplug_decode(const uint8_t *buf, size_t len, int *seq, sparkplug_metric_t *metrics, int max)
+{
+    pb_reader_t r = { .buf = buf, .len = len };
+    int count = 0;
+    if (seq != NULL) {
+        *seq = -1;
+    }
+
+    while (r.pos < r.len) {
+        int field, wire_type;
+        uint64_t value;
+        const uint8_t *data = NULL;
+        if (!get_field(&r, &field, &wire_type, &value, &data)) {
+            return -1;
+        }
+        if (field == PAYLOAD_METRICS && wire_type == WT_LEN) {
+            if (count < max && !decode_metric(data, (size_t)value, &metrics[count])) {
+                return -1;
+            }
+            count++;
+        } else if (field == PAYLOAD_SEQ && seq != NULL) {
+            *seq = (int)value;
+        }
+    }
+    return count;
+}
+
+bool sparkplug_is_rebirth(const uint8_t *buf, size_t len, uint64_t rebirth_alias)
+{
+    sparkplug_metric_t metrics[8];
+    int count = sparkplug_decode(buf, len, NULL, metrics, 8);
+    if (count > 8) {
+        count = 8;
+    }
+    static const size_t name_len = sizeof(SPARKPLUG_REBIRTH_METRIC) - 1;
+
+    for (int i = 0; i < count; i++) {
+        const sparkplug_metric_t *m = &metrics[i];
+        bool named = m->name != NULL && m->name_len == name_len &&
+                     memcmp(m->name, SPARKPLUG_REBIRTH_METRIC, name_len) == 0;
+        bool aliased = m->name == NULL && rebirth_alias != 0 && m->alias == rebirth_alias;
+        if ((named || aliased) && !m->is_null && m->value.b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sparkplug_rbe_update(sparkplug_rbe_t *state, bool valid, float value, float deadband)
+{
+    bool report;
+    if (!state->reported || valid != state->valid) {
+        report = true;
+    } else if (!valid) {
+        report = false;
+    } else if (deadband > 0.0f) {
+        report = fabsf(value - state->value) >= deadband;
+    } else {
+        report = value != state->value;
+    }
+
+    if (report) {
+        state->reported = true;
+        state->valid = valid;
+        state->value = value;
+    }
+    return report;
+}
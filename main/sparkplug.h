@@ -0,0 +1,99 @@
+/**
+ * @file sparkplug.h
+ * @brief Sparkplug B payload encoding and report-by-exception (host-testable)
+ *
+ * Encodes the subset of the Sparkplug B protobuf schema (Payload and
+ * Metric) a temperature node needs, without a protobuf library: payload
+ * timestamp and sequence number, and metrics with name, alias, timestamp,
+ * datatype, null flag and an integer, float, boolean or string value.
+ *
+ * A birth certificate names every metric and gives it an alias and a
+ * datatype; data messages then refer to metrics by alias only. Report by
+ * exception decides which metrics a data message needs: those that changed
+ * by more than a deadband, or became valid or invalid, since they were
+ * last reported.
+ */
+
+#ifndef SPARKPLUG_H
+#define SPARKPLUG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPARKPLUG_NAMESPACE "spBv1.0"
+
+/** @brief Node control metric a host application sets to ask for a new birth */
+#define SPARKPLUG_REBIRTH_METRIC "Node Control/Rebirth"
+
+/** @brief Sparkplug B datatypes used here */
+typedef enum {
+    SPARKPLUG_UINT64 = 8,
+    SPARKPLUG_FLOAT = 9,
+    SPARKPLUG_BOOLEAN = 11,
+    SPARKPLUG_STRING = 12,
+} sparkplug_datatype_t;
+
+/**
+ * @brief A metric to encode, or one decoded from a payload
+ *
+ * Decoded names and strings point into the payload and are not terminated.
+ */
+typedef struct {
+    const char *name;           /**< NULL = refer by alias only */
+    size_t name_len;            /**< Decoded names only */
+    uint64_t alias;             /**< 0 = none */
+    uint8_t datatype;           /**< sparkplug_datatype_t, 0 = leave out (float value) */
+    bool is_null;
+    union {
+        uint64_t u;
+        float f;
+        bool b;
+        const char *s;          /**< Terminated when encoding */
+    } value;
+    size_t str_len;             /**< Decoded strings only */
+} sparkplug_metric_t;
+
+/**
+ * @brief Encode a Payload
+ * @param seq Sequence number 0-255, or -1 to leave out (death certificate)
+ * @param timestamp_ms Payload and metric timestamp (ms since the epoch)
+ * @param buf Output, or NULL to only compute the size
+ * @return Bytes written, 0 if @p size is too small
+ */
+size_t sparkplug_encode(uint8_t *buf, size_t size, uint64_t timestamp_ms, int seq,
+                        const sparkplug_metric_t *metrics, int count);
+
+/**
+ * @brief Decode a Payload
+ * @param seq Output: sequence number, -1 if absent (may be NULL)
+ * @param metrics Output: up to @p max metrics; further ones are skipped
+ * @return Metrics in the payload (may exceed @p max), -1 if malformed
+ */
+int sparkplug_decode(const uint8_t *buf, size_t len, int *seq, sparkplug_metric_t *metrics, int max);
+
+/**
+ * @brief Check a command payload for a rebirth request
+ * @param rebirth_alias Alias the birth gave the rebirth metric, 0 for none
+ */
+bool sparkplug_is_rebirth(const uint8_t *buf, size_t len, uint64_t rebirth_alias);
+
+/**
+ * @brief Report-by-exception state of one metric
+ */
+typedef struct {
+    float value;                /**< Last reported value */
+    bool valid;
+    bool reported;              /**< Reported since the last birth */
+} sparkplug_rbe_t;
+
+/**
+ * @brief Decide whether a metric goes into the next data message
+ *
+ * Records the value as reported when it does.
+ *
+ * @param deadband Smallest change worth reporting (0 = any change)
+ */
+bool sparkplug_rbe_update(sparkplug_rbe_t *state, bool valid, float value, float deadband);
+
+#endif /* SPARKPLUG_H */
@@ -0,0 +1,93 @@
+/**
+ * @file time_align.c
+ * @brief Clock sync quality and wall-clock aligned read cycles (host-testable)
+ */
+
+#include "time_align.h"
+#include <string.h>
+
+static int64_t abs64(int64_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+void clock_sync_init(clock_sync_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void clock_sync_record(clock_sync_t *s, int64_t mono_us, int64_t epoch_us)
+{
+    if (s->count > 0) {
+        /* Where the clock would be had this sync not set it */
+        int64_t elapsed_us = mono_us - s->last_mono_us;
+        int64_t correction = epoch_us - (s->last_epoch_us + elapsed_us);
+        s->last_correction_us = correction;
+        if (abs64(correction) > s->max_correction_us) {
+            s->max_correction_us = abs64(correction);
+        }
+        s->drift_ppm = elapsed_us > 0 ? (int32_t)(correction * 1000000 / elapsed_us) : 0;
+    }
+    s->count++;
+    s->last_mono_us = mono_us;
+    s->last_epoch_us = epoch_us;
+}
+
+void phase_align_init(phase_align_t *p, uint32_t period_ms)
+{
+    memset(p, 0, sizeof(*p));
+    p->period_ms = period_ms > 0 ? period_ms : 1;
+}
+
+int64_t phase_align_next(const phase_align_t *p, int64_t earliest_ms)
+{
+    int64_t period = p->period_ms;
+    int64_t rem = earliest_ms % period;
+    if (rem < 0) {
+        rem += period;
+    }
+    return rem == 0 ? earliest_ms : earliest_ms - rem + period;
+}
+
+uint32_t phase_align_delay_ms(const phase_align_t *p, int64_t now_ms, uint32_t sched_delay_ms,
+                              uint32_t slack_ms, int64_t *boundary_ms)
+{
+    int64_t earliest = now_ms + sched_delay_ms - slack_ms;
+    /* Never aim at a boundary we cannot wake up for in time */
+    if (earliest < now_ms + p->lead_ms) {
+        earliest = now_ms + p->lead_ms;
+    }
+    int64_t boundary = phase_align_next(p, earliest);
+    *boundary_ms = boundary;
+    return (uint32_t)(boundary - p->lead_ms - now_ms);
+}
+
+void phase_align_record(phase_align_t *p, int64_t boundary_ms, int64_t convert_ms)
+{
+    int64_t error = convert_ms - boundary_ms;
+    if (abs64(error) > p->period_ms / 2) {
+        /* Held up (bus busy, clock stepped): says nothing about the lead */
+        p->missed++;
+        return;
+    }
+
+    p->cycles++;
+    p->last_error_ms = (int32_t)error;
+    if (abs64(error) > p->max_error_ms) {
+        p->max_error_ms = (int32_t)abs64(error);
+    }
+    p->total_error_ms += abs64(error);
+
+    int32_t lead = p->lead_ms + (int32_t)(error / 2);
+    if (lead < 0) {
+        lead = 0;
+    } else if (lead > PHASE_LEAD_MAX_MS) {
+        lead = PHASE_LEAD_MAX_MS;
+    }
+    p->lead_ms = lead;
+}
+
+uint32_t phase_align_avg_error_ms(const phase_align_t *p)
+{
+    return p->cycles > 0 ? (uint32_t)(p->total_error_ms / p->cycles) : 0;
+}
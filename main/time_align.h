@@ -0,0 +1,95 @@
+/**
+ * @file time_align.h
+ * @brief Clock sync quality and wall-clock aligned read cycles (host-testable)
+ *
+ * Each SNTP sync is compared with where the free-running clock would have
+ * been without it: the difference is the correction the sync applied, and
+ * divided by the time since the previous sync it gives the drift of the
+ * local oscillator.
+ *
+ * With alignment on, read cycles start on multiples of a period since the
+ * epoch (every 10 s at :00, :10, ...), so nodes sampling at the same period
+ * sample together. The cycle is woken a little ahead of the boundary; that
+ * lead is learned from where the conversions actually started. Times are
+ * milliseconds since the epoch unless noted.
+ */
+
+#ifndef TIME_ALIGN_H
+#define TIME_ALIGN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Most a cycle is woken ahead of its boundary */
+#define PHASE_LEAD_MAX_MS 250
+
+/**
+ * @brief SNTP sync history
+ */
+typedef struct {
+    uint32_t count;             /**< Syncs so far */
+    int64_t last_mono_us;       /**< Monotonic time of the last sync */
+    int64_t last_epoch_us;      /**< Time it set */
+    int64_t last_correction_us; /**< Step of the last sync (0 for the first) */
+    int64_t max_correction_us;  /**< Largest step, absolute */
+    int32_t drift_ppm;          /**< Local clock rate error from the last step */
+} clock_sync_t;
+
+/**
+ * @brief Phase of aligned cycles
+ */
+typedef struct {
+    uint32_t period_ms;
+    int32_t lead_ms;            /**< Woken this much ahead of the boundary */
+    uint32_t cycles;            /**< Aligned cycles recorded */
+    uint32_t missed;            /**< Cycles that started more than half a period off */
+    int32_t last_error_ms;      /**< Conversion start minus boundary */
+    int32_t max_error_ms;       /**< Absolute */
+    int64_t total_error_ms;     /**< Absolute, for the average */
+} phase_align_t;
+
+void clock_sync_init(clock_sync_t *s);
+
+/**
+ * @brief Record a sync
+ * @param mono_us Monotonic time (esp_timer) of the sync
+ * @param epoch_us Time it set, in microseconds since the epoch
+ */
+void clock_sync_record(clock_sync_t *s, int64_t mono_us, int64_t epoch_us);
+
+void phase_align_init(phase_align_t *p, uint32_t period_ms);
+
+/**
+ * @brief First boundary at or after @p earliest_ms
+ */
+int64_t phase_align_next(const phase_align_t *p, int64_t earliest_ms);
+
+/**
+ * @brief How long to sleep to start a cycle on a boundary
+ *
+ * Picks the first boundary no earlier than @p slack_ms before the
+ * scheduler's deadline, so a cycle due right on a boundary is not pushed
+ * to the next one, and wakes the learned lead ahead of it.
+ *
+ * @param now_ms Current time
+ * @param sched_delay_ms Delay until the scheduler's earliest deadline
+ * @param slack_ms How early a cycle may start and still serve the deadline
+ * @param boundary_ms Output: the boundary aimed at
+ */
+uint32_t phase_align_delay_ms(const phase_align_t *p, int64_t now_ms, uint32_t sched_delay_ms,
+                              uint32_t slack_ms, int64_t *boundary_ms);
+
+/**
+ * @brief Record where an aligned cycle's conversion started
+ *
+ * Adjusts the lead by half the error, so it settles on the latency from
+ * wake-up to the convert command within a few cycles.
+ */
+void phase_align_record(phase_align_t *p, int64_t boundary_ms, int64_t convert_ms);
+
+/**
+ * @brief Average absolute phase error, 0 if none
+ */
+uint32_t phase_align_avg_error_ms(const phase_align_t *p);
+
+#endif /* TIME_ALIGN_H */
@@ -0,0 +1,141 @@
+/**
+ * @file time_sync.c
+ * @brief SNTP time, epoch timestamps and wall-clock aligned read cycles
+ */
+
+#include "time_sync.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include <sys/time.h>
+#include <string.h>
+
+static const char *TAG = "time_sync";
+
+#ifndef CONFIG_TIME_ALIGN_PERIOD_MS
+#define CONFIG_TIME_ALIGN_PERIOD_MS 10000
+#endif
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static clock_sync_t s_sync;
+static phase_align_t s_phase;
+static int64_t s_boundary_ms;       /* Boundary the coming cycle aims at, 0 if none */
+
+static int64_t epoch_now_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+#if CONFIG_TIME_SYNC_ENABLED
+/**
+ * @brief SNTP sync notification (lwIP task)
+ */
+static void on_sync(struct timeval *tv)
+{
+    int64_t mono_us = esp_timer_get_time();
+    int64_t epoch_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+    portENTER_CRITICAL(&s_mux);
+    bool first = s_sync.count == 0;
+    clock_sync_record(&s_sync, mono_us, epoch_us);
+    int64_t correction_us = s_sync.last_correction_us;
+    int32_t drift_ppm = s_sync.drift_ppm;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (first) {
+        ESP_LOGI(TAG, "Clock set by SNTP");
+    } else {
+        ESP_LOGD(TAG, "SNTP sync: corrected %lld us, drift %ld ppm",
+                 (long long)correction_us, (long)drift_ppm);
+    }
+}
+#endif
+
+esp_err_t time_sync_init(void)
+{
+    clock_sync_init(&s_sync);
+    phase_align_init(&s_phase, CONFIG_TIME_ALIGN_PERIOD_MS);
+
+#if CONFIG_TIME_SYNC_ENABLED
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_TIME_SYNC_SERVER);
+    config.sync_cb = on_sync;
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start SNTP: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "SNTP started with %s", CONFIG_TIME_SYNC_SERVER);
+#endif
+    return ESP_OK;
+}
+
+bool time_sync_is_synced(void)
+{
+    portENTER_CRITICAL(&s_mux);
+    bool synced = s_sync.count > 0;
+    portEXIT_CRITICAL(&s_mux);
+    return synced;
+}
+
+int64_t time_sync_to_epoch_ms(int64_t mono_us)
+{
+    if (!time_sync_is_synced()) {
+        return 0;
+    }
+    int64_t age_us = esp_timer_get_time() - mono_us;
+    return epoch_now_ms() - age_us / 1000;
+}
+
+uint32_t time_sync_align_delay(uint32_t sched_delay_ms, uint32_t slack_ms)
+{
+#if CONFIG_TIME_ALIGN_ENABLED
+    if (time_sync_is_synced()) {
+        int64_t boundary;
+        int64_t now_ms = epoch_now_ms();
+        portENTER_CRITICAL(&s_mux);
+        uint32_t delay_ms = phase_align_delay_ms(&s_phase, now_ms, sched_delay_ms,
+                                                 slack_ms, &boundary);
+        s_boundary_ms = boundary;
+        portEXIT_CRITICAL(&s_mux);
+        return delay_ms;
+    }
+#endif
+    portENTER_CRITICAL(&s_mux);
+    s_boundary_ms = 0;
+    portEXIT_CRITICAL(&s_mux);
+    return sched_delay_ms;
+}
+
+void time_sync_cycle_done(int64_t convert_us)
+{
+    int64_t convert_ms = convert_us != 0 ? time_sync_to_epoch_ms(convert_us) : 0;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_boundary_ms != 0 && convert_ms != 0) {
+        phase_align_record(&s_phase, s_boundary_ms, convert_ms);
+    }
+    s_boundary_ms = 0;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void time_sync_get_status(time_sync_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    int64_t mono_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_mux);
+    status->sync = s_sync;
+    status->phase = s_phase;
+    portEXIT_CRITICAL(&s_mux);
+
+    status->synced = status->sync.count > 0;
+    status->now_ms = status->synced ? epoch_now_ms() : 0;
+    status->last_sync_age_ms = status->synced ? (mono_us - status->sync.last_mono_us) / 1000 : -1;
+#if CONFIG_TIME_ALIGN_ENABLED
+    status->align_enabled = true;
+#endif
+    status->aligning = status->align_enabled && status->synced;
+}
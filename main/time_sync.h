@@ -0,0 +1,68 @@
+/**
+ * @file time_sync.h
+ * @brief SNTP time, epoch timestamps and wall-clock aligned read cycles
+ *
+ * The system clock is set by SNTP (CONFIG_TIME_SYNC_SERVER). Once it has
+ * been, readings carry the time their conversion started in milliseconds
+ * since the epoch, so readings from several nodes can be compared directly.
+ * With CONFIG_TIME_ALIGN_ENABLED the read cycles also start on multiples of
+ * CONFIG_TIME_ALIGN_PERIOD_MS since the epoch, so nodes sample together.
+ * Until the first sync, cycles follow the read scheduler as before and
+ * readings have no epoch timestamp.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "time_align.h"
+
+/**
+ * @brief Sync and alignment state
+ */
+typedef struct {
+    bool synced;                /**< The clock has been set by SNTP */
+    int64_t now_ms;             /**< Current time, 0 if not synced */
+    int64_t last_sync_age_ms;   /**< -1 if never */
+    clock_sync_t sync;
+    bool align_enabled;
+    bool aligning;              /**< Aligned now: enabled and synced */
+    phase_align_t phase;
+} time_sync_status_t;
+
+/**
+ * @brief Start SNTP (after the network is up)
+ */
+esp_err_t time_sync_init(void);
+
+bool time_sync_is_synced(void);
+
+/**
+ * @brief Convert a monotonic time (esp_timer_get_time) to the epoch
+ * @return Milliseconds since the epoch, 0 if the clock is not synced
+ */
+int64_t time_sync_to_epoch_ms(int64_t mono_us);
+
+/**
+ * @brief Delay until the next read cycle, aligned to the wall clock
+ *
+ * Returns @p sched_delay_ms unchanged unless alignment is enabled and the
+ * clock is synced; otherwise the delay to the first period boundary that
+ * still serves the scheduler's deadline.
+ *
+ * @param sched_delay_ms Delay until the earliest sensor deadline
+ * @param slack_ms How early a cycle may start and still read those sensors
+ */
+uint32_t time_sync_align_delay(uint32_t sched_delay_ms, uint32_t slack_ms);
+
+/**
+ * @brief Report the read cycle that followed time_sync_align_delay()
+ * @param convert_us esp_timer time of its convert command, 0 if it read nothing
+ */
+void time_sync_cycle_done(int64_t convert_us);
+
+void time_sync_get_status(time_sync_status_t *status);
+
+#endif /* TIME_SYNC_H */
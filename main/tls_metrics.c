@@ -0,0 +1,86 @@
+/**
+ * @file tls_metrics.c
+ * @brief TLS handshake cost accounting and CA bundle checks (host-testable)
+ */
+
+#include "tls_metrics.h"
+#include <string.h>
+
+#define PEM_BEGIN "-----BEGIN CERTIFICATE-----"
+#define PEM_END   "-----END CERTIFICATE-----"
+
+uint32_t tls_handshake_heap_peak(const tls_handshake_t *h)
+{
+    return h->free_before > h->min_free_during ? h->free_before - h->min_free_during : 0;
+}
+
+void tls_metrics_record(tls_metrics_t *m, const tls_handshake_t *h)
+{
+    if (!h->ok) {
+        m->failures++;
+        return;
+    }
+
+    tls_duration_stats_t *s = h->session_offered ? &m->with_session : &m->full;
+    s->count++;
+    s->total_ms += h->duration_ms;
+    s->last_ms = h->duration_ms;
+    if (h->duration_ms > s->max_ms) {
+        s->max_ms = h->duration_ms;
+    }
+
+    m->last_heap_peak = tls_handshake_heap_peak(h);
+    if (m->last_heap_peak > m->max_heap_peak) {
+        m->max_heap_peak = m->last_heap_peak;
+    }
+    m->last_heap_retained = h->free_before > h->free_after ? h->free_before - h->free_after : 0;
+    m->last_session_offered = h->session_offered;
+}
+
+uint32_t tls_duration_avg_ms(const tls_duration_stats_t *s)
+{
+    return s->count > 0 ? s->total_ms / s->count : 0;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+/**
+ * @brief Find @p needle in the first @p len bytes of @p hay
+ */
+static const char *find(const char *hay, size_t len, const char *needle)
+{
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= len; i++) {
+        if (memcmp(hay + i, needle, n) == 0) {
+            return hay + i;
+        }
+    }
+    return NULL;
+}
+
+int tls_pem_count_certs(const char *pem, size_t len)
+{
+    int count = 0;
+    size_t pos = 0;
+
+    for (;;) {
+        while (pos < len && is_space(pem[pos])) {
+            pos++;
+        }
+        if (pos == len) {
+            return count;
+        }
+        if (len - pos < sizeof(PEM_BEGIN) - 1 || memcmp(pem + pos, PEM_BEGIN, sizeof(PEM_BEGIN) - 1) != 0) {
+            return -1;
+        }
+        const char *end = find(pem + pos, len - pos, PEM_END);
+        if (end == NULL) {
+            return -1;
+        }
+        pos = (size_t)(end - pem) + sizeof(PEM_END) - 1;
+        count++;
+    }
+}
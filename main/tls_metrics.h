@@ -0,0 +1,74 @@
+/**
+ * @file tls_metrics.h
+ * @brief TLS handshake cost accounting and CA bundle checks (host-testable)
+ *
+ * Every MQTT TLS handshake is recorded with its duration and heap
+ * figures, split by whether a cached session was offered for resumption.
+ * A broker that accepts the session skips the certificate exchange and
+ * the key agreement, which shows as a much shorter handshake; one that
+ * declines it does a full handshake, so the two averages tell them apart.
+ *
+ * The free-heap low is taken from a local minimum monitor started for the
+ * handshake, so the peak covers that handshake rather than everything
+ * since boot. Allocations by other tasks meanwhile are included.
+ */
+
+#ifndef TLS_METRICS_H
+#define TLS_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Heap and timing around one handshake
+ */
+typedef struct {
+    uint32_t duration_ms;
+    bool ok;
+    bool session_offered;       /**< A cached session was offered */
+    uint32_t free_before;       /**< Free heap before the handshake */
+    uint32_t free_after;        /**< Free heap after it (connection still open) */
+    uint32_t min_free_during;   /**< Lowest free heap while it ran */
+} tls_handshake_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t total_ms;
+    uint32_t max_ms;
+    uint32_t last_ms;
+} tls_duration_stats_t;
+
+typedef struct {
+    tls_duration_stats_t full;          /**< No session offered */
+    tls_duration_stats_t with_session;  /**< Session offered */
+    uint32_t failures;
+    uint32_t last_heap_peak;            /**< Bytes, see tls_handshake_heap_peak() */
+    uint32_t max_heap_peak;
+    uint32_t last_heap_retained;        /**< Bytes the open connection keeps */
+    bool last_session_offered;
+} tls_metrics_t;
+
+/**
+ * @brief Most heap in use by the handshake at once
+ */
+uint32_t tls_handshake_heap_peak(const tls_handshake_t *h);
+
+/**
+ * @brief Add a handshake to the metrics
+ */
+void tls_metrics_record(tls_metrics_t *m, const tls_handshake_t *h);
+
+/**
+ * @brief Average duration, 0 if none
+ */
+uint32_t tls_duration_avg_ms(const tls_duration_stats_t *s);
+
+/**
+ * @brief Count the certificates in a PEM bundle
+ * @return Complete BEGIN/END CERTIFICATE blocks, -1 if a block is not
+ *         closed or there is anything else than certificates and whitespace
+ */
+int tls_pem_count_certs(const char *pem, size_t len);
+
+#endif /* TLS_METRICS_H */
@@ -0,0 +1,98 @@
+/**
+ * @file topic_alias.c
+ * @brief MQTT 5 topic alias assignment and PUBLISH wire size (host-testable)
+ */
+
+#include "topic_alias.h"
+#include <string.h>
+
+void topic_alias_init(topic_alias_table_t *t, topic_alias_entry_t *entries, uint16_t capacity)
+{
+    t->entries = entries;
+    t->capacity = capacity;
+    topic_alias_reset(t, capacity);
+}
+
+void topic_alias_reset(topic_alias_table_t *t, uint16_t limit)
+{
+    t->limit = limit < t->capacity ? limit : t->capacity;
+    t->count = 0;
+}
+
+uint16_t topic_alias_get(topic_alias_table_t *t, const char *topic, bool *send_topic)
+{
+    *send_topic = true;
+    size_t len = strlen(topic);
+    if (len == 0 || len >= TOPIC_ALIAS_TOPIC_LEN) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < t->count; i++) {
+        if (strcmp(t->entries[i].topic, topic) == 0) {
+            *send_topic = !t->entries[i].announced;
+            t->entries[i].announced = true;
+            return i + 1;
+        }
+    }
+    if (t->count >= t->limit) {
+        return 0;
+    }
+
+    topic_alias_entry_t *e = &t->entries[t->count++];
+    memcpy(e->topic, topic, len + 1);
+    e->announced = true;
+    return t->count;
+}
+
+void topic_alias_unsent(topic_alias_table_t *t, uint16_t alias)
+{
+    if (alias >= 1 && alias <= t->count) {
+        t->entries[alias - 1].announced = false;
+    }
+}
+
+void topic_alias_limit(topic_alias_table_t *t, uint16_t alias)
+{
+    if (alias == 0) {
+        return;
+    }
+    if (t->limit > alias - 1) {
+        t->limit = alias - 1;
+    }
+    if (t->count > t->limit) {
+        t->count = t->limit;
+    }
+}
+
+/**
+ * @brief Bytes of a Variable Byte Integer
+ */
+static size_t varint_size(size_t value)
+{
+    size_t n = 1;
+    while (value >= 128) {
+        value /= 128;
+        n++;
+    }
+    return n;
+}
+
+size_t mqtt_publish_wire_size(size_t topic_len, size_t payload_len, int qos, bool v5,
+                              uint16_t alias, uint32_t expiry_s)
+{
+    size_t remaining = 2 + topic_len + payload_len;
+    if (qos > 0) {
+        remaining += 2;         /* Packet identifier */
+    }
+    if (v5) {
+        size_t props = 0;
+        if (alias != 0) {
+            props += 3;         /* 0x23 + two byte alias */
+        }
+        if (expiry_s != 0) {
+            props += 5;         /* 0x02 + four byte interval */
+        }
+        remaining += varint_size(props) + props;
+    }
+    return 1 + varint_size(remaining) + remaining;
+}
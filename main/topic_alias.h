@@ -0,0 +1,77 @@
+/**
+ * @file topic_alias.h
+ * @brief MQTT 5 topic alias assignment and PUBLISH wire size (host-testable)
+ *
+ * A topic alias replaces a topic string with a two byte number for the rest
+ * of a network connection. The first PUBLISH on a topic carries the topic
+ * and the alias; later ones carry only the alias and an empty topic. The
+ * mapping does not survive a reconnect, so the table is reset for every
+ * new connection, and aliases are handed out first come, first served, up
+ * to the lower of the table size and the broker's Topic Alias Maximum.
+ */
+
+#ifndef TOPIC_ALIAS_H
+#define TOPIC_ALIAS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @brief Longest topic that gets an alias */
+#define TOPIC_ALIAS_TOPIC_LEN 96
+
+typedef struct {
+    char topic[TOPIC_ALIAS_TOPIC_LEN];
+    bool announced;             /**< Broker has seen the topic with this alias */
+} topic_alias_entry_t;
+
+/**
+ * @brief Alias table; entry i holds alias i + 1
+ */
+typedef struct {
+    topic_alias_entry_t *entries;
+    uint16_t capacity;
+    uint16_t limit;             /**< Aliases usable on this connection */
+    uint16_t count;             /**< Aliases assigned */
+} topic_alias_table_t;
+
+/**
+ * @brief Use caller-provided storage for up to @p capacity aliases
+ */
+void topic_alias_init(topic_alias_table_t *t, topic_alias_entry_t *entries, uint16_t capacity);
+
+/**
+ * @brief Forget every mapping, for a new connection
+ * @param limit Broker's Topic Alias Maximum (capped at the capacity)
+ */
+void topic_alias_reset(topic_alias_table_t *t, uint16_t limit);
+
+/**
+ * @brief Get the alias for a topic, assigning one on first use
+ * @param send_topic Set to true if the topic must be sent with the alias
+ * @return Alias, or 0 to send the topic without one
+ */
+uint16_t topic_alias_get(topic_alias_table_t *t, const char *topic, bool *send_topic);
+
+/**
+ * @brief Note that a PUBLISH announcing @p alias was not sent
+ *
+ * The next use of the alias sends the topic again.
+ */
+void topic_alias_unsent(topic_alias_table_t *t, uint16_t alias);
+
+/**
+ * @brief Stop using @p alias and above (the broker refused it)
+ */
+void topic_alias_limit(topic_alias_table_t *t, uint16_t alias);
+
+/**
+ * @brief Bytes a PUBLISH packet takes on the wire
+ * @param v5 MQTT 5 (property length and properties) rather than 3.1.1
+ * @param alias Topic alias property, 0 for none
+ * @param expiry_s Message expiry interval property, 0 for none
+ */
+size_t mqtt_publish_wire_size(size_t topic_len, size_t payload_len, int qos, bool v5,
+                              uint16_t alias, uint32_t expiry_s);
+
+#endif /* TOPIC_ALIAS_H */
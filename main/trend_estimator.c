@@ -0,0 +1,130 @@
+/**
+ * @file trend_estimator.c
+ * @brief Sliding-window least-squares trend (host-testable)
+ */
+
+#include "trend_estimator.h"
+#include <string.h>
+
+/** @brief Move the origin once the newest sample is this far from it */
+#define TREND_REBASE_MS 300000
+
+void trend_init(trend_t *tr)
+{
+    memset(tr, 0, sizeof(*tr));
+}
+
+static int slot(const trend_t *tr, int i)
+{
+    return (tr->first + i) % TREND_MAX_SAMPLES;
+}
+
+static void drop_oldest(trend_t *tr)
+{
+    double t = tr->t[tr->first];
+    double y = tr->y[tr->first];
+    tr->st -= t;
+    tr->stt -= t * t;
+    tr->sy -= y;
+    tr->sty -= t * y;
+    tr->first = (tr->first + 1) % TREND_MAX_SAMPLES;
+    tr->count--;
+}
+
+/**
+ * @brief Put the origin at the oldest sample and rebuild the sums
+ */
+static void rebase(trend_t *tr)
+{
+    int64_t shift_ms = (int64_t)(tr->t[tr->first] * 1000.0f);
+    float shift = (float)(shift_ms / 1000.0);
+    tr->origin_ms += shift_ms;
+    tr->st = tr->stt = tr->sy = tr->sty = 0;
+    for (int i = 0; i < tr->count; i++) {
+        int k = slot(tr, i);
+        tr->t[k] -= shift;
+        double t = tr->t[k];
+        double y = tr->y[k];
+        tr->st += t;
+        tr->stt += t * t;
+        tr->sy += y;
+        tr->sty += t * y;
+    }
+}
+
+void trend_add(trend_t *tr, int64_t t_ms, float value, uint32_t window_ms)
+{
+    if (tr->count == 0) {
+        tr->origin_ms = t_ms;
+    } else {
+        float newest = tr->t[slot(tr, tr->count - 1)];
+        if ((double)(t_ms - tr->origin_ms) / 1000.0 <= newest) {
+            return;
+        }
+    }
+
+    /* Expire by age, then make room */
+    double cutoff = (double)(t_ms - tr->origin_ms - (int64_t)window_ms) / 1000.0;
+    while (tr->count > 0 && tr->t[tr->first] < cutoff) {
+        drop_oldest(tr);
+    }
+    if (tr->count == TREND_MAX_SAMPLES) {
+        drop_oldest(tr);
+    }
+    if (tr->count == 0) {
+        trend_init(tr);
+        tr->origin_ms = t_ms;
+    } else if (t_ms - tr->origin_ms > TREND_REBASE_MS) {
+        rebase(tr);
+    }
+
+    int k = slot(tr, tr->count);
+    double t = (double)(t_ms - tr->origin_ms) / 1000.0;
+    tr->t[k] = (float)t;
+    tr->y[k] = value;
+    tr->count++;
+    tr->st += t;
+    tr->stt += t * t;
+    tr->sy += value;
+    tr->sty += t * value;
+}
+
+/**
+ * @brief Slope (°C/s) and intercept of the fitted line
+ */
+static bool fit(const trend_t *tr, double *slope, double *intercept)
+{
+    if (tr->count < TREND_MIN_SAMPLES) {
+        return false;
+    }
+    double n = tr->count;
+    double denom = n * tr->stt - tr->st * tr->st;
+    /* Relative threshold: all samples at (nearly) the same time */
+    if (denom <= 1e-9 * n * tr->stt) {
+        return false;
+    }
+    *slope = (n * tr->sty - tr->st * tr->sy) / denom;
+    *intercept = (tr->sy - *slope * tr->st) / n;
+    return true;
+}
+
+bool trend_slope(const trend_t *tr, float *per_min)
+{
+    double slope, intercept;
+    if (!fit(tr, &slope, &intercept)) {
+        return false;
+    }
+    *per_min = (float)(slope * 60.0);
+    return true;
+}
+
+bool trend_predict(const trend_t *tr, uint32_t horizon_ms, float *value)
+{
+    double slope, intercept;
+    if (!fit(tr, &slope, &intercept)) {
+        return false;
+    }
+    double t = tr->t[slot(tr, tr->count - 1)] + horizon_ms / 1000.0;
+    *value = (float)(intercept + slope * t);
+    return true;
+}
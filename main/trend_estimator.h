@@ -0,0 +1,62 @@
+/**
+ * @file trend_estimator.h
+ * @brief Per-sensor rate of change by least squares over a sliding time
+ *        window, with short-horizon extrapolation (host-testable)
+ *
+ * The estimator keeps the samples of the last window and running sums of
+ * t, t², y and t·y, so adding a sample and expiring old ones costs O(1)
+ * each. Times are stored as seconds from an origin that is moved up to the
+ * oldest sample every few minutes; the sums are rebuilt from the buffer at
+ * that point, which also clears accumulated rounding.
+ */
+
+#ifndef TREND_ESTIMATOR_H
+#define TREND_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Samples held per sensor; older ones drop out even inside the window */
+#define TREND_MAX_SAMPLES 32
+
+/** @brief Samples needed before a slope is reported */
+#define TREND_MIN_SAMPLES 3
+
+/**
+ * @brief Estimator state for one sensor
+ */
+typedef struct {
+    float t[TREND_MAX_SAMPLES];     /**< Seconds since origin_ms */
+    float y[TREND_MAX_SAMPLES];     /**< °C */
+    int first;                      /**< Index of the oldest sample */
+    int count;
+    int64_t origin_ms;
+    double st, stt, sy, sty;        /**< Running sums over the held samples */
+} trend_t;
+
+/**
+ * @brief Clear all samples
+ */
+void trend_init(trend_t *tr);
+
+/**
+ * @brief Add a reading and drop samples older than @p window_ms before it
+ *
+ * Readings must arrive in time order; an older one is ignored.
+ */
+void trend_add(trend_t *tr, int64_t t_ms, float value, uint32_t window_ms);
+
+/**
+ * @brief Least-squares slope over the held samples
+ * @param per_min Output: °C per minute
+ * @return false with fewer than TREND_MIN_SAMPLES or no time spread
+ */
+bool trend_slope(const trend_t *tr, float *per_min);
+
+/**
+ * @brief Fitted line evaluated @p horizon_ms after the newest sample
+ * @return false when no slope is available
+ */
+bool trend_predict(const trend_t *tr, uint32_t horizon_ms, float *value);
+
+#endif /* TREND_ESTIMATOR_H */
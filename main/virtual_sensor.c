@@ -0,0 +1,294 @@
+/**
+ * @file virtual_sensor.c
+ * @brief User-defined sensors computed from physical ones
+ */
+
+#include "virtual_sensor.h"
+#include "nvs_storage.h"
+#include "mqtt_client_ha.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+
+static const char *TAG = "virtual";
+
+typedef struct {
+    bool used;
+    virtual_sensor_t vs;
+    expr_program_t prog;
+} vs_slot_t;
+
+static vs_slot_t s_slots[CONFIG_VIRTUAL_SENSORS_MAX];
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buf;
+static uint32_t s_eval_us = 0;
+static uint32_t s_eval_max_us = 0;
+
+typedef struct {
+    const managed_sensor_t *sensors;
+    int count;
+} resolve_ctx_t;
+
+/**
+ * @brief Resolve {address} (any case) or {friendly name} to a sensor index
+ */
+static int resolve(const char *name, size_t len, void *ctx)
+{
+    const resolve_ctx_t *rc = ctx;
+    for (int i = 0; i < rc->count; i++) {
+        const managed_sensor_t *s = &rc->sensors[i];
+        if (len == strlen(s->address_str) && strncasecmp(name, s->address_str, len) == 0) {
+            return i;
+        }
+        if (s->has_friendly_name && len == strlen(s->friendly_name) &&
+            strncmp(name, s->friendly_name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Compile a slot's expression (caller holds s_lock)
+ */
+static void bind_slot(vs_slot_t *slot, const managed_sensor_t *sensors, int count)
+{
+    resolve_ctx_t ctx = { .sensors = sensors, .count = count };
+    expr_error_t err;
+
+    slot->vs.bound = expr_compile(slot->vs.cfg.expression, resolve, &ctx, &slot->prog, &err);
+    slot->vs.valid = false;
+    if (slot->vs.bound) {
+        slot->vs.error[0] = '\0';
+        memcpy(slot->vs.inputs, slot->prog.inputs, sizeof(slot->vs.inputs));
+        slot->vs.input_count = slot->prog.input_count;
+    } else {
+        snprintf(slot->vs.error, sizeof(slot->vs.error), "%s at %d", err.msg, err.pos);
+        slot->vs.input_count = 0;
+        ESP_LOGW(TAG, "%s: %s", slot->vs.cfg.id, slot->vs.error);
+    }
+}
+
+static void topic_id(const char *id, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s%s", VIRTUAL_SENSOR_ID_PREFIX, id);
+}
+
+static const char *display_name(const virtual_sensor_config_t *cfg)
+{
+    return cfg->name[0] ? cfg->name : cfg->id;
+}
+
+esp_err_t virtual_sensor_init(void)
+{
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    if (s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+    int loaded = 0;
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        vs_slot_t *slot = &s_slots[i];
+        memset(slot, 0, sizeof(*slot));
+        if (nvs_storage_load_virtual_sensor(i, &slot->vs.cfg) != ESP_OK) {
+            continue;
+        }
+        slot->vs.cfg.id[EXPR_ID_LEN - 1] = '\0';
+        slot->vs.cfg.name[EXPR_NAME_LEN - 1] = '\0';
+        slot->vs.cfg.expression[EXPR_MAX_SOURCE - 1] = '\0';
+        slot->used = true;
+        bind_slot(slot, sensors, count);
+        loaded++;
+    }
+    free(sensors);
+
+    ESP_LOGD(TAG, "Loaded %d virtual sensors", loaded);
+    return ESP_OK;
+}
+
+void virtual_sensor_bind(const managed_sensor_t *sensors, int count)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        if (s_slots[i].used) {
+            bind_slot(&s_slots[i], sensors, count);
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void virtual_sensor_evaluate(const managed_sensor_t *sensors, int count)
+{
+    float values[CONFIG_MAX_SENSORS];
+    for (int i = 0; i < count; i++) {
+        values[i] = sensors[i].hw_sensor.valid ? sensors[i].hw_sensor.temperature : NAN;
+    }
+
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        vs_slot_t *slot = &s_slots[i];
+        if (!slot->used || !slot->vs.bound) {
+            continue;
+        }
+        float value = expr_eval(&slot->prog, values, count);
+        slot->vs.valid = !isnan(value);
+        if (slot->vs.valid) {
+            slot->vs.value = value;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    s_eval_us = (uint32_t)(esp_timer_get_time() - start);
+    if (s_eval_us > s_eval_max_us) {
+        s_eval_max_us = s_eval_us;
+    }
+}
+
+esp_err_t virtual_sensor_set(const virtual_sensor_config_t *cfg, expr_error_t *err)
+{
+    if (!expr_id_valid(cfg->id)) {
+        err->pos = 0;
+        err->msg = "Invalid id";
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Compile first so a bad expression changes nothing */
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        return ESP_FAIL;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+    resolve_ctx_t ctx = { .sensors = sensors, .count = count };
+    expr_program_t prog;
+    if (!expr_compile(cfg->expression, resolve, &ctx, &prog, err)) {
+        free(sensors);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int index = -1;
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX && index < 0; i++) {
+        if (s_slots[i].used && strcmp(s_slots[i].vs.cfg.id, cfg->id) == 0) {
+            index = i;
+        }
+    }
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX && index < 0; i++) {
+        if (!s_slots[i].used) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        xSemaphoreGive(s_lock);
+        free(sensors);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = nvs_storage_save_virtual_sensor(index, cfg);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(s_lock);
+        free(sensors);
+        ESP_LOGE(TAG, "Failed to save virtual sensor");
+        return ret;
+    }
+
+    vs_slot_t *slot = &s_slots[index];
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->vs.cfg = *cfg;
+    bind_slot(slot, sensors, count);
+    xSemaphoreGive(s_lock);
+    free(sensors);
+
+    char sensor_id[EXPR_ID_LEN + 2];
+    topic_id(cfg->id, sensor_id, sizeof(sensor_id));
+    mqtt_ha_register_virtual_sensor(sensor_id, display_name(cfg));
+
+    ESP_LOGI(TAG, "Virtual sensor %s = %s", cfg->id, cfg->expression);
+    return ESP_OK;
+}
+
+esp_err_t virtual_sensor_remove(const char *id)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        if (!s_slots[i].used || strcmp(s_slots[i].vs.cfg.id, id) != 0) {
+            continue;
+        }
+        esp_err_t err = nvs_storage_delete_virtual_sensor(i);
+        if (err != ESP_OK) {
+            xSemaphoreGive(s_lock);
+            return err;
+        }
+        s_slots[i].used = false;
+        xSemaphoreGive(s_lock);
+
+        char sensor_id[EXPR_ID_LEN + 2];
+        topic_id(id, sensor_id, sizeof(sensor_id));
+        mqtt_ha_unregister_sensor(sensor_id);
+
+        ESP_LOGI(TAG, "Virtual sensor %s removed", id);
+        return ESP_OK;
+    }
+    xSemaphoreGive(s_lock);
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool virtual_sensor_get(int slot, virtual_sensor_t *out)
+{
+    if (slot < 0 || slot >= CONFIG_VIRTUAL_SENSORS_MAX) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool used = s_slots[slot].used;
+    if (used) {
+        *out = s_slots[slot].vs;
+    }
+    xSemaphoreGive(s_lock);
+    return used;
+}
+
+void virtual_sensor_get_eval_time(uint32_t *last_us, uint32_t *max_us)
+{
+    *last_us = s_eval_us;
+    *max_us = s_eval_max_us;
+}
+
+void virtual_sensor_publish_all(void)
+{
+    virtual_sensor_t vs;
+    char sensor_id[EXPR_ID_LEN + 2];
+
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        if (!virtual_sensor_get(i, &vs) || !vs.valid) {
+            continue;
+        }
+        topic_id(vs.cfg.id, sensor_id, sizeof(sensor_id));
+        mqtt_ha_publish_temperature(sensor_id, display_name(&vs.cfg), vs.value);
+    }
+}
+
+void virtual_sensor_register_all(void)
+{
+    virtual_sensor_t vs;
+    char sensor_id[EXPR_ID_LEN + 2];
+
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        if (!virtual_sensor_get(i, &vs)) {
+            continue;
+        }
+        topic_id(vs.cfg.id, sensor_id, sizeof(sensor_id));
+        mqtt_ha_register_virtual_sensor(sensor_id, display_name(&vs.cfg));
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file virtual_sensor.h
+ * @brief User-defined sensors computed from physical ones
+ *
+ * Each virtual sensor is an expression (see expr_engine.h) compiled once
+ * against the current sensor list, and again after a rescan or rename, and
+ * evaluated after every read cycle. Results are published and announced to
+ * Home Assistant like physical sensors, under the sensor id "v_<id>".
+ */
+
+#ifndef VIRTUAL_SENSOR_H
+#define VIRTUAL_SENSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "expr_engine.h"
+#include "sensor_manager.h"
+
+/** @brief Prefix that keeps virtual sensor ids apart from ROM addresses */
+#define VIRTUAL_SENSOR_ID_PREFIX "v_"
+
+/**
+ * @brief A virtual sensor and its latest value
+ */
+typedef struct {
+    virtual_sensor_config_t cfg;
+    bool bound;                             /**< Compiled against the current sensor list */
+    char error[48];                         /**< Why not bound (e.g. a renamed sensor) */
+    bool valid;
+    float value;
+    uint8_t inputs[EXPR_MAX_INPUTS];        /**< Sensor indices referenced */
+    uint8_t input_count;
+} virtual_sensor_t;
+
+/**
+ * @brief Load definitions from NVS and compile them (after sensor_manager_init)
+ */
+esp_err_t virtual_sensor_init(void);
+
+/**
+ * @brief Recompile every definition against a new sensor list
+ *
+ * Called by the sensor manager after a rescan or rename, with its lock
+ * held. References that no longer resolve leave the sensor unbound.
+ */
+void virtual_sensor_bind(const managed_sensor_t *sensors, int count);
+
+/**
+ * @brief Evaluate all virtual sensors from the latest readings
+ *
+ * Called by the sensor manager after each read cycle, with its lock held.
+ */
+void virtual_sensor_evaluate(const managed_sensor_t *sensors, int count);
+
+/**
+ * @brief Add a virtual sensor, or replace the one with the same id
+ *
+ * The expression is compiled before anything is saved.
+ *
+ * @param cfg Definition
+ * @param err Output: compile error position and reason
+ * @return ESP_ERR_INVALID_ARG for a bad id or expression, ESP_ERR_NO_MEM if
+ *         every slot is in use
+ */
+esp_err_t virtual_sensor_set(const virtual_sensor_config_t *cfg, expr_error_t *err);
+
+/**
+ * @brief Remove a virtual sensor
+ * @return ESP_ERR_NOT_FOUND if no sensor has that id
+ */
+esp_err_t virtual_sensor_remove(const char *id);
+
+/**
+ * @brief Copy one slot
+ * @param slot 0 to CONFIG_VIRTUAL_SENSORS_MAX-1
+ * @return false if the slot is empty
+ */
+bool virtual_sensor_get(int slot, virtual_sensor_t *out);
+
+/**
+ * @brief Time spent evaluating in the last cycle and the most ever, in µs
+ */
+void virtual_sensor_get_eval_time(uint32_t *last_us, uint32_t *max_us);
+
+/**
+ * @brief Publish every valid virtual sensor value via MQTT
+ */
+void virtual_sensor_publish_all(void);
+
+/**
+ * @brief Announce every virtual sensor to Home Assistant
+ */
+void virtual_sensor_register_all(void);
+
+#endif /* VIRTUAL_SENSOR_H */
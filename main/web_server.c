@@ -6,11 +6,24 @@
 #include "web_server.h"
 #include "sensor_manager.h"
 #include "ota_updater.h"
+#include "ota_session.h"
 #include "nvs_storage.h"
 #include "onewire_temp.h"
 #include "wifi_manager.h"
 #include "ethernet_manager.h"
 #include "log_buffer.h"
+#include "auth_utils.h"
+#include "event_stream.h"
+#include "power_manager.h"
+#include "bus_task.h"
+#include "burst_capture.h"
+#include "virtual_sensor.h"
+#include "acq_watchdog.h"
+#include "mqtt_client_ha.h"
+#include "mqtt_fanout.h"
+#include "mqtt_tls.h"
+#include "time_sync.h"
+#include "net_selftest.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_system.h"
@@ -21,6 +34,7 @@
 #include "freertos/task.h"
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "esp_random.h"
 #include "esp_timer.h"
 
@@ -36,29 +50,25 @@ static bool s_auth_enabled = false;
 static char s_auth_username[33] = "";
 static char s_auth_password[65] = "";
 
-/* Session management - supports multiple concurrent sessions */
-#define MAX_SESSIONS 4
+/* Session management - hashed table of 128-bit tokens */
 #define SESSION_TIMEOUT_MS (7LL * 24 * 60 * 60 * 1000)  /* 7 days */
 
-typedef struct {
-    char token[33];      /* Random hex token */
-    int64_t expiry;      /* Expiry time (ms since boot) */
-} session_t;
+static auth_session_table_t s_sessions;
 
-static session_t s_sessions[MAX_SESSIONS] = {0};
+/* Header buffers are fixed-size on the stack; longer values are truncated */
+#define AUTH_HDR_BUF_LEN 256
+
+/* Precomputed 401 response */
+static const char s_unauthorized_json[] = "{\"error\":\"Unauthorized\",\"login_required\":true}";
 
 /* API key for stateless API access */
 static char s_api_key[65] = "";  /* 32 hex chars (128-bit key) */
 
 extern const char *APP_VERSION;
 
-/* Forward declarations for reconfiguration */
-extern esp_err_t mqtt_ha_stop(void);
-extern esp_err_t mqtt_ha_init(void);
-extern esp_err_t mqtt_ha_start(void);
-
 /* Forward declarations */
 static void generate_api_key(void);
+static esp_err_t send_conflict(httpd_req_t *req, const char *message);
 
 /* Embedded HTML files (gzipped at build time) */
 extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
@@ -100,46 +110,21 @@ static void load_auth_config(void)
 }
 
 /**
- * @brief Generate a random session token and store in an available slot
- * @return Pointer to the token string (valid until session expires/replaced)
+ * @brief Generate a random session token and add it to the session table
+ * @param token_hex Output: token as hex string (AUTH_TOKEN_HEX_LEN + 1 bytes)
  */
-static const char* generate_session_token(void)
+static void generate_session_token(char *token_hex)
 {
     int64_t now = esp_timer_get_time() / 1000;
-    int slot = -1;
-    int64_t oldest_expiry = INT64_MAX;
-    int oldest_slot = 0;
-    
-    /* Find empty/expired slot, or track oldest for replacement */
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (s_sessions[i].token[0] == '\0' || now > s_sessions[i].expiry) {
-            slot = i;
-            break;
-        }
-        if (s_sessions[i].expiry < oldest_expiry) {
-            oldest_expiry = s_sessions[i].expiry;
-            oldest_slot = i;
-        }
-    }
-    
-    /* Use oldest slot if no empty/expired found */
-    if (slot < 0) {
-        slot = oldest_slot;
-        ESP_LOGD(TAG, "Replacing oldest session in slot %d", slot);
-    }
-    
-    /* Generate random token */
-    uint32_t rnd[4];
-    for (int i = 0; i < 4; i++) {
-        rnd[i] = esp_random();
+    uint8_t token[AUTH_TOKEN_LEN];
+
+    esp_fill_random(token, sizeof(token));
+    if (auth_sessions_add(&s_sessions, token, now + SESSION_TIMEOUT_MS, now)) {
+        ESP_LOGW(TAG, "Session table full (%d), evicted oldest session", AUTH_MAX_SESSIONS);
     }
-    snprintf(s_sessions[slot].token, sizeof(s_sessions[slot].token), "%08lx%08lx%08lx%08lx",
-             (unsigned long)rnd[0], (unsigned long)rnd[1], 
-             (unsigned long)rnd[2], (unsigned long)rnd[3]);
-    s_sessions[slot].expiry = now + SESSION_TIMEOUT_MS;
-    
-    ESP_LOGD(TAG, "Created session in slot %d", slot);
-    return s_sessions[slot].token;
+    auth_bytes_to_hex(token, sizeof(token), token_hex);
+
+    ESP_LOGD(TAG, "Created session (%d active)", s_sessions.count);
 }
 
 /**
@@ -160,55 +145,37 @@ static void generate_api_key(void)
 }
 
 /**
- * @brief Check if session token from cookie is valid
+ * @brief Extract the binary session token from the Cookie header
+ * @return true if a well-formed session cookie was present
  */
-static bool is_session_valid(httpd_req_t *req)
+static bool get_session_token(httpd_req_t *req, uint8_t *token)
 {
-    /* Get Cookie header */
-    size_t cookie_len = httpd_req_get_hdr_value_len(req, "Cookie");
-    if (cookie_len == 0) {
-        return false;
-    }
+    char cookie[AUTH_HDR_BUF_LEN];
 
-    char *cookie = malloc(cookie_len + 1);
-    if (!cookie) {
+    /* A truncated header is still searched - the session cookie is usually first */
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Cookie", cookie, sizeof(cookie));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) {
         return false;
     }
 
-    if (httpd_req_get_hdr_value_str(req, "Cookie", cookie, cookie_len + 1) != ESP_OK) {
-        free(cookie);
+    const char *value;
+    size_t value_len;
+    if (!auth_cookie_find(cookie, "session", &value, &value_len)) {
         return false;
     }
+    return auth_hex_to_bytes(value, value_len, token, AUTH_TOKEN_LEN);
+}
 
-    /* Look for session=TOKEN in cookie */
-    char *session_start = strstr(cookie, "session=");
-    if (!session_start) {
-        free(cookie);
+/**
+ * @brief Check if session token from cookie is valid
+ */
+static bool is_session_valid(httpd_req_t *req)
+{
+    uint8_t token[AUTH_TOKEN_LEN];
+    if (!get_session_token(req, token)) {
         return false;
     }
-
-    session_start += 8;  /* Skip "session=" */
-    char token[33] = {0};
-    int i = 0;
-    while (session_start[i] && session_start[i] != ';' && i < 32) {
-        token[i] = session_start[i];
-        i++;
-    }
-    token[i] = '\0';
-    free(cookie);
-
-    /* Check token against all sessions */
-    int64_t now = esp_timer_get_time() / 1000;
-    for (int j = 0; j < MAX_SESSIONS; j++) {
-        if (s_sessions[j].token[0] != '\0' && strcmp(token, s_sessions[j].token) == 0) {
-            if (now > s_sessions[j].expiry) {
-                s_sessions[j].token[0] = '\0';  /* Clear expired session */
-                return false;
-            }
-            return true;
-        }
-    }
-    return false;
+    return auth_sessions_check(&s_sessions, token, esp_timer_get_time() / 1000);
 }
 
 /**
@@ -244,29 +211,17 @@ static bool check_session_auth(httpd_req_t *req)
  */
 static bool is_api_key_valid(httpd_req_t *req)
 {
-    if (strlen(s_api_key) == 0) {
+    if (s_api_key[0] == '\0') {
         return false;  /* No API key configured */
     }
     
-    /* Check X-API-Key header */
-    size_t key_len = httpd_req_get_hdr_value_len(req, "X-API-Key");
-    if (key_len == 0) {
+    /* Check X-API-Key header (one byte larger than the key to detect overlong values) */
+    char key[sizeof(s_api_key) + 1];
+    if (httpd_req_get_hdr_value_str(req, "X-API-Key", key, sizeof(key)) != ESP_OK) {
         return false;
     }
     
-    char *key = malloc(key_len + 1);
-    if (key == NULL) {
-        return false;
-    }
-    
-    if (httpd_req_get_hdr_value_str(req, "X-API-Key", key, key_len + 1) == ESP_OK) {
-        bool valid = (strcmp(key, s_api_key) == 0);
-        free(key);
-        return valid;
-    }
-    
-    free(key);
-    return false;
+    return auth_ct_str_equal(key, strlen(key), s_api_key);
 }
 
 /**
@@ -292,7 +247,7 @@ static bool check_api_auth(httpd_req_t *req)
 
     httpd_resp_set_status(req, "401 Unauthorized");
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"error\":\"Unauthorized\",\"login_required\":true}");
+    httpd_resp_send(req, s_unauthorized_json, sizeof(s_unauthorized_json) - 1);
     return false;
 }
 
@@ -345,8 +300,56 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(bus_stats, "total_reads", total_reads);
     cJSON_AddNumberToObject(bus_stats, "failed_reads", failed_reads);
     cJSON_AddNumberToObject(bus_stats, "error_rate", total_reads > 0 ? (double)failed_reads / total_reads * 100.0 : 0.0);
+
+    /* Bus command queue */
+    bus_task_stats_t queue_stats;
+    bus_task_get_stats(&queue_stats);
+    cJSON *queue = cJSON_AddObjectToObject(bus_stats, "queue");
+    cJSON_AddNumberToObject(queue, "pending", queue_stats.pending);
+    cJSON_AddNumberToObject(queue, "preempted", queue_stats.preempted);
+    cJSON_AddNumberToObject(queue, "rejected", queue_stats.rejected);
+    cJSON_AddNumberToObject(queue, "max_wait_ms", queue_stats.max_wait_ms);
+    cJSON *executed = cJSON_AddObjectToObject(queue, "executed");
+    for (int i = 0; i < BUS_CMD_COUNT; i++) {
+        cJSON_AddNumberToObject(executed, bus_cmd_name(i), queue_stats.executed[i]);
+    }
+
+    /* On-demand reads */
+    sensor_read_now_stats_t read_now_stats;
+    sensor_manager_get_read_now_stats(&read_now_stats);
+    cJSON *on_demand = cJSON_AddObjectToObject(bus_stats, "on_demand");
+    cJSON_AddNumberToObject(on_demand, "requests", read_now_stats.requests);
+    cJSON_AddNumberToObject(on_demand, "conversions", read_now_stats.conversions);
+    cJSON_AddNumberToObject(on_demand, "coalesced", read_now_stats.coalesced);
+    cJSON_AddNumberToObject(on_demand, "delayed", read_now_stats.delayed);
     cJSON_AddItemToObject(root, "bus_stats", bus_stats);
 
+    /* Acquisition recovery (times are ms of uptime, negative = before the last reboot) */
+    recovery_policy_t *policy = malloc(sizeof(recovery_policy_t));
+    if (policy != NULL) {
+        acq_watchdog_get_state(policy);
+        cJSON *recovery = cJSON_AddObjectToObject(root, "recovery");
+        cJSON_AddBoolToObject(recovery, "recovering", policy->in_incident);
+        cJSON_AddStringToObject(recovery, "stage", recovery_stage_name(policy->stage));
+        cJSON_AddNumberToObject(recovery, "recoveries", policy->recoveries);
+        cJSON_AddNumberToObject(recovery, "mttr_ms", recovery_mttr_ms(policy));
+        cJSON *stages = cJSON_AddObjectToObject(recovery, "stages");
+        for (int i = RECOVERY_BUS_RESET; i < RECOVERY_STAGE_COUNT; i++) {
+            cJSON_AddNumberToObject(stages, recovery_stage_name(i), policy->stage_counts[i]);
+        }
+        cJSON *history = cJSON_AddArrayToObject(recovery, "history");
+        recovery_event_t ev;
+        for (int i = 0; recovery_get_event(policy, i, &ev); i++) {
+            cJSON *item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(item, "started_ms", (double)ev.started_ms);
+            cJSON_AddNumberToObject(item, "duration_ms", ev.duration_ms);
+            cJSON_AddStringToObject(item, "stage", recovery_stage_name(ev.stage));
+            cJSON_AddStringToObject(item, "cause", recovery_cause_name(ev.cause));
+            cJSON_AddItemToArray(history, item);
+        }
+        free(policy);
+    }
+
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
 
@@ -357,34 +360,132 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Append a sensor's JSON representation to an array
+ *
+ * Read counters advance on every read without marking the sensor changed,
+ * so delta entries leave them out rather than carry stale values.
+ */
+static void add_sensor_json(cJSON *array, const managed_sensor_t *sensors,
+                            const sensor_sched_info_t *sched, int index, bool counters)
+{
+    const managed_sensor_t *s = &sensors[index];
+    cJSON *sensor = cJSON_CreateObject();
+    cJSON_AddStringToObject(sensor, "address", s->address_str);
+    cJSON_AddNumberToObject(sensor, "temperature", s->hw_sensor.temperature);
+    cJSON_AddBoolToObject(sensor, "valid", s->hw_sensor.valid);
+    if (s->hw_sensor.sample_time > 0) {
+        cJSON_AddNumberToObject(sensor, "timestamp", (double)s->hw_sensor.sample_time);
+    } else {
+        cJSON_AddNullToObject(sensor, "timestamp");
+    }
+    
+    if (s->has_friendly_name) {
+        cJSON_AddStringToObject(sensor, "friendly_name", s->friendly_name);
+    } else {
+        cJSON_AddNullToObject(sensor, "friendly_name");
+    }
+    
+    if (counters) {
+        cJSON_AddNumberToObject(sensor, "total_reads", s->hw_sensor.total_reads);
+        cJSON_AddNumberToObject(sensor, "failed_reads", s->hw_sensor.failed_reads);
+    }
+    if (s->position > 0) {
+        cJSON_AddNumberToObject(sensor, "position", s->position);
+    } else {
+        cJSON_AddNullToObject(sensor, "position");
+    }
+
+    /* Read schedule: own interval (null = bus default), target and achieved */
+    const sensor_sched_info_t *e = &sched[index];
+    if (e->interval_ms > 0) {
+        cJSON_AddNumberToObject(sensor, "interval_ms", e->interval_ms);
+    } else {
+        cJSON_AddNullToObject(sensor, "interval_ms");
+    }
+    cJSON_AddNumberToObject(sensor, "target_interval_ms", e->target_ms);
+    cJSON_AddNumberToObject(sensor, "achieved_interval_ms", e->achieved_ms);
+    cJSON_AddNumberToObject(sensor, "late_reads", e->late);
+
+    /* Rate of change over the trend window (null until enough readings) */
+    float slope, predicted;
+    if (sensor_manager_get_trend(index, &slope, &predicted)) {
+        cJSON *trend = cJSON_AddObjectToObject(sensor, "trend");
+        cJSON_AddNumberToObject(trend, "slope_per_min", slope);
+        cJSON_AddNumberToObject(trend, "forecast", predicted);
+        cJSON_AddNumberToObject(trend, "horizon_s", CONFIG_TREND_HORIZON_S);
+    } else {
+        cJSON_AddNullToObject(sensor, "trend");
+    }
+    
+    cJSON_AddItemToArray(array, sensor);
+}
+
 /**
  * @brief Handler for GET /api/sensors
+ *
+ * Without a query this returns the full sensor array. With
+ * ?since=<seq>&boot=<id> it returns only sensors changed after <seq>:
+ * {"seq":N,"boot":id,"full":bool,"sensors":[...]}. "full" is set (and every
+ * sensor included) when the client's sequence predates the current sensor
+ * list or belongs to a previous boot.
  */
 static esp_err_t api_sensors_get_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    int count;
-    const managed_sensor_t *sensors = sensor_manager_get_sensors(&count);
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    sensor_sched_info_t *sched = malloc(sizeof(sensor_sched_info_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL || sched == NULL) {
+        free(sensors);
+        free(sched);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    uint32_t seq, layout_seq;
+    int count = sensor_manager_copy_sensors_seq(sensors, sched, CONFIG_MAX_SENSORS, &seq, &layout_seq);
+
+    /* Parse optional delta query */
+    bool delta = false;
+    uint32_t since = 0;
+    uint32_t boot = 0;
+    char query[64];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[16];
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            delta = true;
+            since = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "boot", value, sizeof(value)) == ESP_OK) {
+            boot = strtoul(value, NULL, 10);
+        }
+    }
 
-    cJSON *root = cJSON_CreateArray();
-    
-    for (int i = 0; i < count; i++) {
-        cJSON *sensor = cJSON_CreateObject();
-        cJSON_AddStringToObject(sensor, "address", sensors[i].address_str);
-        cJSON_AddNumberToObject(sensor, "temperature", sensors[i].hw_sensor.temperature);
-        cJSON_AddBoolToObject(sensor, "valid", sensors[i].hw_sensor.valid);
-        
-        if (sensors[i].has_friendly_name) {
-            cJSON_AddStringToObject(sensor, "friendly_name", sensors[i].friendly_name);
-        } else {
-            cJSON_AddNullToObject(sensor, "friendly_name");
+    cJSON *root;
+    cJSON *array;
+    if (delta) {
+        bool full = boot != sensor_manager_get_boot_id() ||
+                    since < layout_seq || since > seq;
+
+        root = cJSON_CreateObject();
+        cJSON_AddNumberToObject(root, "seq", seq);
+        cJSON_AddNumberToObject(root, "boot", sensor_manager_get_boot_id());
+        cJSON_AddBoolToObject(root, "full", full);
+        array = cJSON_AddArrayToObject(root, "sensors");
+
+        for (int i = 0; i < count; i++) {
+            if (full || sensors[i].change_seq > since) {
+                add_sensor_json(array, sensors, sched, i, full);
+            }
+        }
+    } else {
+        root = cJSON_CreateArray();
+        array = root;
+        for (int i = 0; i < count; i++) {
+            add_sensor_json(array, sensors, sched, i, true);
         }
-        
-        cJSON_AddNumberToObject(sensor, "total_reads", sensors[i].hw_sensor.total_reads);
-        cJSON_AddNumberToObject(sensor, "failed_reads", sensors[i].hw_sensor.failed_reads);
-        
-        cJSON_AddItemToArray(root, sensor);
     }
+    free(sensors);
+    free(sched);
 
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -418,6 +519,121 @@ static esp_err_t api_sensors_rescan_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Handler for GET /api/sensors/alarms
+ *
+ * Runs a 1-Wire alarm search and lists the sensors whose hardware alarm
+ * flag (TH/TL) is set.
+ */
+static esp_err_t api_sensors_alarms_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    uint8_t addresses[CONFIG_MAX_SENSORS][ONEWIRE_ROM_SIZE];
+    int found = 0;
+    esp_err_t err = bus_task_alarm_search(addresses, CONFIG_MAX_SENSORS, &found);
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Alarm search failed");
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateArray();
+    for (int i = 0; i < found; i++) {
+        char addr_str[17];
+        onewire_address_to_string(addresses[i], addr_str);
+        cJSON_AddItemToArray(root, cJSON_CreateString(addr_str));
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Add an on-demand reading to a JSON object
+ */
+static void add_fresh_reading_json(cJSON *obj, const managed_sensor_t *s, int64_t now_ms)
+{
+    cJSON_AddStringToObject(obj, "address", s->address_str);
+    cJSON_AddNumberToObject(obj, "temperature", s->hw_sensor.temperature);
+    cJSON_AddBoolToObject(obj, "valid", s->hw_sensor.valid);
+    cJSON_AddNumberToObject(obj, "age_ms", now_ms - s->hw_sensor.last_read_time);
+    if (s->hw_sensor.sample_time > 0) {
+        cJSON_AddNumberToObject(obj, "timestamp", (double)s->hw_sensor.sample_time);
+    } else {
+        cJSON_AddNullToObject(obj, "timestamp");
+    }
+}
+
+/**
+ * @brief Handler for POST /api/sensors/read and /api/sensors/:address/read
+ *
+ * Converts now and returns the fresh readings. Requests within the minimum
+ * spacing share one conversion ("coalesced": true).
+ */
+static esp_err_t api_sensors_read_now_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+
+    /* Extract address from URI: /api/sensors/XXXX/read (none = all sensors) */
+    char address[20] = {0};
+    const char *start = strstr(req->uri, "/api/sensors/");
+    if (start) {
+        start += strlen("/api/sensors/");
+        const char *end = strstr(start, "/read");
+        if (end && (end - start) < sizeof(address)) {
+            strncpy(address, start, end - start);
+        }
+    }
+    bool single = strlen(address) > 0;
+
+    bool coalesced = false;
+    esp_err_t err = sensor_manager_read_now(single ? address : NULL, &coalesced);
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_FAIL;
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Sensor list changed, retry\"}");
+        return ESP_OK;
+    }
+
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "coalesced", coalesced);
+    if (single) {
+        managed_sensor_t s;
+        if (sensor_manager_get_sensor(address, &s) == ESP_OK) {
+            add_fresh_reading_json(root, &s, now_ms);
+        }
+    } else {
+        managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+        int count = sensors != NULL ? sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS) : 0;
+        cJSON *array = cJSON_AddArrayToObject(root, "sensors");
+        for (int i = 0; i < count; i++) {
+            cJSON *item = cJSON_CreateObject();
+            add_fresh_reading_json(item, &sensors[i], now_ms);
+            cJSON_AddItemToArray(array, item);
+        }
+        free(sensors);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
 /**
  * @brief Handler for POST /api/sensors/error-stats/reset
  */
@@ -483,41 +699,50 @@ static esp_err_t api_sensor_error_stats_reset_handler(httpd_req_t *req)
 }
 
 /**
- * @brief Handler for POST /api/sensors/:address/name and /api/sensors/:address/error-stats/reset
+ * @brief Add the configured alert rule to a JSON object
  */
-static esp_err_t api_sensor_name_handler(httpd_req_t *req)
+static void add_alert_rule_json(cJSON *obj, const alert_rule_config_t *cfg)
 {
-    CHECK_AUTH(req);
-    const char *uri = req->uri;
-
-    /* Check if this is a per-sensor error stats reset request */
-    if (strstr(uri, "/error-stats/reset")) {
-        return api_sensor_error_stats_reset_handler(req);
+    if (cfg->high_enabled) {
+        cJSON_AddNumberToObject(obj, "high", cfg->high);
+    } else {
+        cJSON_AddNullToObject(obj, "high");
     }
+    if (cfg->low_enabled) {
+        cJSON_AddNumberToObject(obj, "low", cfg->low);
+    } else {
+        cJSON_AddNullToObject(obj, "low");
+    }
+    cJSON_AddNumberToObject(obj, "hysteresis", cfg->hysteresis);
+    cJSON_AddNumberToObject(obj, "max_rate", cfg->max_rate);
+    cJSON_AddNumberToObject(obj, "stale_s", cfg->stale_ms / 1000);
+}
 
-    /* Otherwise handle as name update */
-    /* Extract address from URI */
+/**
+ * @brief Handler for POST /api/sensors/:address/alerts
+ *
+ * Body: {"high":30,"low":5,"hysteresis":0.5,"max_rate":2,"stale_s":60}.
+ * Omitted or null fields are disabled; a rule with nothing enabled is removed.
+ */
+static esp_err_t api_sensor_alerts_post_handler(httpd_req_t *req)
+{
+    /* Extract address from URI: /api/sensors/XXXX/alerts */
     char address[20] = {0};
-    
-    /* URI format: /api/sensors/XXXX/name */
-    const char *start = strstr(uri, "/api/sensors/");
+    const char *start = strstr(req->uri, "/api/sensors/");
     if (start) {
         start += strlen("/api/sensors/");
-        const char *end = strstr(start, "/name");
+        const char *end = strstr(start, "/alerts");
         if (end && (end - start) < sizeof(address)) {
             strncpy(address, start, end - start);
         }
     }
 
-    ESP_LOGD("web_server", "Set name request for address: '%s'", address);
-
     if (strlen(address) == 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid address");
         return ESP_FAIL;
     }
 
-    /* Read request body */
-    char content[128];
+    char content[256];
     int ret = httpd_req_recv(req, content, sizeof(content) - 1);
     if (ret <= 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
@@ -525,35 +750,55 @@ static esp_err_t api_sensor_name_handler(httpd_req_t *req)
     }
     content[ret] = '\0';
 
-    ESP_LOGD("web_server", "Request body: %s", content);
-
-    /* Parse JSON */
     cJSON *root = cJSON_Parse(content);
     if (!root) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
 
-    cJSON *name_json = cJSON_GetObjectItem(root, "friendly_name");
-    
-    /* Copy the name before deleting cJSON - the pointer becomes invalid after cJSON_Delete */
-    char friendly_name[64] = {0};
-    if (cJSON_IsString(name_json) && name_json->valuestring) {
-        strncpy(friendly_name, name_json->valuestring, sizeof(friendly_name) - 1);
-    }
-
-    ESP_LOGD("web_server", "Setting name for %s: '%s'", address, friendly_name);
+    alert_rule_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
 
+    cJSON *item = cJSON_GetObjectItem(root, "high");
+    if (cJSON_IsNumber(item)) {
+        cfg.high_enabled = true;
+        cfg.high = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(root, "low");
+    if (cJSON_IsNumber(item)) {
+        cfg.low_enabled = true;
+        cfg.low = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(root, "hysteresis");
+    if (cJSON_IsNumber(item)) {
+        cfg.hysteresis = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(root, "max_rate");
+    if (cJSON_IsNumber(item)) {
+        cfg.max_rate = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(root, "stale_s");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) {
+        cfg.stale_ms = (uint32_t)(item->valuedouble * 1000);
+    }
     cJSON_Delete(root);
 
-    /* Update sensor with new name */
-    esp_err_t err = sensor_manager_set_friendly_name(address, friendly_name);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE("web_server", "Failed to set friendly name: %s", esp_err_to_name(err));
+    bool any = cfg.high_enabled || cfg.low_enabled || cfg.max_rate > 0 || cfg.stale_ms > 0;
+    esp_err_t err = sensor_manager_set_alert_rule(address, any ? &cfg : NULL);
+
+    if (err == ESP_ERR_NOT_FOUND) {
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
         return ESP_FAIL;
     }
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "Invalid rule (negative hysteresis/rate or low band overlaps high)");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save rule");
+        return ESP_FAIL;
+    }
 
     cJSON *response = cJSON_CreateObject();
     cJSON_AddBoolToObject(response, "success", true);
@@ -564,107 +809,1631 @@ static esp_err_t api_sensor_name_handler(httpd_req_t *req)
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
-    return ESP_OK;
-}
 
-/**
- * @brief Handler for GET /config
- */
-static esp_err_t config_get_handler(httpd_req_t *req)
-{
-    CHECK_PAGE_AUTH(req);
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-    httpd_resp_send(req, (const char *)config_html_gz_start, config_html_gz_end - config_html_gz_start);
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/ota/check - starts async check
+ * @brief Handler for POST /api/sensors/:address/interval
+ *
+ * Body: {"interval_ms":2000}. 0 or null makes the sensor follow the bus-wide
+ * read interval again.
  */
-static esp_err_t api_ota_check_handler(httpd_req_t *req)
+static esp_err_t api_sensor_interval_post_handler(httpd_req_t *req)
 {
-    CHECK_AUTH(req);
-    ESP_LOGD(TAG, "OTA check requested via web UI");
-    cJSON *root = cJSON_CreateObject();
-    
-#if CONFIG_OTA_ENABLED
-    /* Start async check to avoid stack overflow in httpd task */
-    esp_err_t err = ota_check_for_update_async();
-    
-    if (err == ESP_OK) {
-        cJSON_AddBoolToObject(root, "checking", true);
-        cJSON_AddStringToObject(root, "message", "Check started");
-    } else if (err == ESP_ERR_INVALID_STATE) {
-        cJSON_AddBoolToObject(root, "checking", true);
-        cJSON_AddStringToObject(root, "message", "Check already in progress");
-    } else {
-        cJSON_AddBoolToObject(root, "checking", false);
-        cJSON_AddStringToObject(root, "error", "Failed to start check");
+    /* Extract address from URI: /api/sensors/XXXX/interval */
+    char address[20] = {0};
+    const char *start = strstr(req->uri, "/api/sensors/");
+    if (start) {
+        start += strlen("/api/sensors/");
+        const char *end = strstr(start, "/interval");
+        if (end && (end - start) < sizeof(address)) {
+            strncpy(address, start, end - start);
+        }
     }
-    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
-#else
-    cJSON_AddBoolToObject(root, "checking", false);
-    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
-    cJSON_AddStringToObject(root, "error", "OTA disabled");
-#endif
 
-    char *json = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    if (strlen(address) == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid address");
+        return ESP_FAIL;
+    }
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, strlen(json));
-    free(json);
-    
-    return ESP_OK;
-}
+    char content[64];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    uint32_t interval_ms = 0;
+    cJSON *item = cJSON_GetObjectItem(root, "interval_ms");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) {
+        interval_ms = (uint32_t)item->valuedouble;
+    }
+    cJSON_Delete(root);
+
+    bus_capacity_t cap;
+    esp_err_t err = sensor_manager_set_sensor_interval(address, interval_ms, &cap);
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_FAIL;
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        char message[96];
+        snprintf(message, sizeof(message), "{\"success\":false,\"message\":\"Bus overloaded (%.0f%%) at this interval\"}",
+                 cap.utilization * 100.0f);
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, message);
+        return ESP_OK;
+    }
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Interval must be 0 or 1000-300000 ms");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save interval");
+        return ESP_FAIL;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/sensors/:address/position
+ *
+ * Body: {"position":3}, counted along the cable from the controller. 0 or
+ * null clears it.
+ */
+static esp_err_t api_sensor_position_post_handler(httpd_req_t *req)
+{
+    /* Extract address from URI: /api/sensors/XXXX/position */
+    char address[20] = {0};
+    const char *start = strstr(req->uri, "/api/sensors/");
+    if (start) {
+        start += strlen("/api/sensors/");
+        const char *end = strstr(start, "/position");
+        if (end && (end - start) < sizeof(address)) {
+            strncpy(address, start, end - start);
+        }
+    }
+
+    if (strlen(address) == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid address");
+        return ESP_FAIL;
+    }
+
+    char content[64];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    int position = 0;
+    cJSON *item = cJSON_GetObjectItem(root, "position");
+    if (cJSON_IsNumber(item)) {
+        position = item->valueint;
+    }
+    cJSON_Delete(root);
+
+    if (position < 0 || position > 255) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Position must be 0-255");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = sensor_manager_set_sensor_position(address, (uint8_t)position);
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save position");
+        return ESP_FAIL;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/alerts
+ *
+ * Lists every sensor that has an alert rule, with its active alerts.
+ */
+static esp_err_t api_alerts_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+
+    cJSON *root = cJSON_CreateArray();
+    for (int i = 0; i < count; i++) {
+        if (!sensors[i].has_alert_rule) {
+            continue;
+        }
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "address", sensors[i].address_str);
+        cJSON *rule = cJSON_CreateObject();
+        add_alert_rule_json(rule, &sensors[i].alert_config);
+        cJSON_AddItemToObject(entry, "rule", rule);
+
+        cJSON *active = cJSON_CreateArray();
+        uint8_t mask = sensor_manager_get_active_alerts(i);
+        for (uint8_t type = ALERT_HIGH; type <= ALERT_STALE; type <<= 1) {
+            if (mask & type) {
+                cJSON_AddItemToArray(active, cJSON_CreateString(alert_type_name(type)));
+            }
+        }
+        cJSON_AddItemToObject(entry, "active", active);
+        cJSON_AddItemToArray(root, entry);
+    }
+    free(sensors);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/events (Server-Sent Events)
+ */
+static esp_err_t api_events_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    return event_stream_subscribe(req);
+}
+
+/**
+ * @brief Server close callback - drop event stream subscribers before closing
+ */
+static void web_server_close_fn(httpd_handle_t hd, int sockfd)
+{
+    event_stream_on_close(sockfd);
+    close(sockfd);
+}
+
+/**
+ * @brief Run a URI handler with the HTTP power lock held
+ *
+ * REGISTER_URI stores the real handler in user_ctx and installs this
+ * wrapper, so requests are served at full CPU speed while the server task
+ * can sleep between them.
+ */
+static esp_err_t pm_locked_handler(httpd_req_t *req)
+{
+    esp_err_t (*handler)(httpd_req_t *) = (esp_err_t (*)(httpd_req_t *))req->user_ctx;
+    power_manager_acquire(PM_ACTIVITY_HTTP);
+    esp_err_t ret = handler(req);
+    power_manager_release(PM_ACTIVITY_HTTP);
+    return ret;
+}
+
+/**
+ * @brief Handler for POST /api/sensors/:address/name and /api/sensors/:address/error-stats/reset
+ */
+static esp_err_t api_sensor_name_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    const char *uri = req->uri;
+
+    /* Check if this is a per-sensor error stats reset request */
+    if (strstr(uri, "/error-stats/reset")) {
+        return api_sensor_error_stats_reset_handler(req);
+    }
+
+    /* Check if this is an alert rule update */
+    if (strstr(uri, "/alerts")) {
+        return api_sensor_alerts_post_handler(req);
+    }
+
+    /* Check if this is a read interval update */
+    if (strstr(uri, "/interval")) {
+        return api_sensor_interval_post_handler(req);
+    }
+
+    /* Check if this is a cable position update */
+    if (strstr(uri, "/position")) {
+        return api_sensor_position_post_handler(req);
+    }
+
+    /* Check if this is an on-demand read */
+    if (strstr(uri, "/read")) {
+        return api_sensors_read_now_handler(req);
+    }
+
+    /* Otherwise handle as name update */
+    /* Extract address from URI */
+    char address[20] = {0};
+    
+    /* URI format: /api/sensors/XXXX/name */
+    const char *start = strstr(uri, "/api/sensors/");
+    if (start) {
+        start += strlen("/api/sensors/");
+        const char *end = strstr(start, "/name");
+        if (end && (end - start) < sizeof(address)) {
+            strncpy(address, start, end - start);
+        }
+    }
+
+    ESP_LOGD("web_server", "Set name request for address: '%s'", address);
+
+    if (strlen(address) == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid address");
+        return ESP_FAIL;
+    }
+
+    /* Read request body */
+    char content[128];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    ESP_LOGD("web_server", "Request body: %s", content);
+
+    /* Parse JSON */
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *name_json = cJSON_GetObjectItem(root, "friendly_name");
+    
+    /* Copy the name before deleting cJSON - the pointer becomes invalid after cJSON_Delete */
+    char friendly_name[64] = {0};
+    if (cJSON_IsString(name_json) && name_json->valuestring) {
+        strncpy(friendly_name, name_json->valuestring, sizeof(friendly_name) - 1);
+    }
+
+    ESP_LOGD("web_server", "Setting name for %s: '%s'", address, friendly_name);
+
+    cJSON_Delete(root);
+
+    /* Update sensor with new name */
+    esp_err_t err = sensor_manager_set_friendly_name(address, friendly_name);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE("web_server", "Failed to set friendly name: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_FAIL;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /config
+ */
+static esp_err_t config_get_handler(httpd_req_t *req)
+{
+    CHECK_PAGE_AUTH(req);
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_send(req, (const char *)config_html_gz_start, config_html_gz_end - config_html_gz_start);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/ota/check - starts async check
+ */
+static esp_err_t api_ota_check_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    ESP_LOGD(TAG, "OTA check requested via web UI");
+    cJSON *root = cJSON_CreateObject();
+    
+#if CONFIG_OTA_ENABLED
+    /* Start async check to avoid stack overflow in httpd task */
+    esp_err_t err = ota_check_for_update_async();
+    
+    if (err == ESP_OK) {
+        cJSON_AddBoolToObject(root, "checking", true);
+        cJSON_AddStringToObject(root, "message", "Check started");
+    } else if (err == ESP_ERR_INVALID_STATE) {
+        cJSON_AddBoolToObject(root, "checking", true);
+        cJSON_AddStringToObject(root, "message", "Check already in progress");
+    } else {
+        cJSON_AddBoolToObject(root, "checking", false);
+        cJSON_AddStringToObject(root, "error", "Failed to start check");
+    }
+    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
+#else
+    cJSON_AddBoolToObject(root, "checking", false);
+    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
+    cJSON_AddStringToObject(root, "error", "OTA disabled");
+#endif
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/ota/status - poll for check result and download progress
+ */
+static esp_err_t api_ota_status_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    cJSON *root = cJSON_CreateObject();
+    
+#if CONFIG_OTA_ENABLED
+    int result = ota_get_check_result();
+    bool checking = ota_check_in_progress();
+    bool update_available = ota_is_update_available();
+    char latest_version[32] = {0};
+    ota_get_latest_version(latest_version, sizeof(latest_version));
+    
+    /* Add download progress info */
+    int update_state = ota_get_update_state();  /* 0=idle, 1=downloading, 2=complete, -1=failed */
+    int download_progress = ota_get_download_progress();
+    int received = 0, total = 0;
+    ota_get_download_stats(&received, &total);
+    
+    ESP_LOGD(TAG, "OTA status: checking=%d, result=%d, update=%d, version=%s, update_state=%d, progress=%d%%",
+             checking, result, update_available, latest_version, update_state, download_progress);
+    
+    cJSON_AddBoolToObject(root, "checking", checking);
+    cJSON_AddNumberToObject(root, "result", result);  /* 0=in progress, 1=complete, -1=failed */
+    cJSON_AddBoolToObject(root, "update_available", update_available);
+    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
+    cJSON_AddStringToObject(root, "latest_version", latest_version);
+    
+    /* Download progress fields:
+       update_state: 0=idle, 1=downloading, 2=complete (rebooting soon), -1=failed */
+    cJSON_AddNumberToObject(root, "update_state", update_state);
+    cJSON_AddNumberToObject(root, "download_progress", download_progress);
+    cJSON_AddNumberToObject(root, "download_received", received);
+    cJSON_AddNumberToObject(root, "download_total", total);
+#else
+    cJSON_AddBoolToObject(root, "checking", false);
+    cJSON_AddIntToObject(root, "result", -1);
+    cJSON_AddBoolToObject(root, "update_available", false);
+    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
+    cJSON_AddNumberToObject(root, "update_state", 0);
+    cJSON_AddNumberToObject(root, "download_progress", 0);
+    cJSON_AddStringToObject(root, "error", "OTA disabled");
+#endif
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/ota/update
+ */
+static esp_err_t api_ota_update_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    cJSON *root = cJSON_CreateObject();
+    
+#if CONFIG_OTA_ENABLED
+    if (ota_is_update_available()) {
+        cJSON_AddBoolToObject(root, "started", true);
+        cJSON_AddStringToObject(root, "message", "Update starting, device will restart");
+        
+        char *json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, json, strlen(json));
+        free(json);
+        
+        /* Start OTA in background, in place of any unfinished upload */
+        ota_session_cancel();
+        ota_start_update();
+    } else {
+        cJSON_AddBoolToObject(root, "started", false);
+        cJSON_AddStringToObject(root, "message", "No update available");
+        
+        char *json = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+        
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, json, strlen(json));
+        free(json);
+    }
+#else
+    cJSON_AddBoolToObject(root, "started", false);
+    cJSON_AddStringToObject(root, "error", "OTA disabled");
+    
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+#endif
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/ota/upload - Manual firmware upload
+ * 
+ * Expects raw binary firmware data (not multipart form)
+ */
+static esp_err_t api_ota_upload_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    esp_err_t err;
+    esp_ota_handle_t ota_handle = 0;
+    const esp_partition_t *update_partition = NULL;
+    char *buf = NULL;
+    const int buf_size = 4096;
+    int received = 0;
+    int remaining = req->content_len;
+    bool ota_started = false;
+    bool first_chunk = true;
+    
+    ESP_LOGI(TAG, "Starting manual firmware upload, size: %d bytes", req->content_len);
+    
+    /* Validate content length */
+    if (req->content_len == 0 || req->content_len > 1500000) {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Invalid firmware size\"}");
+        return ESP_FAIL;
+    }
+    
+    /* Allocate receive buffer */
+    buf = malloc(buf_size);
+    if (!buf) {
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Memory allocation failed\"}");
+        return ESP_FAIL;
+    }
+    
+    /* Get update partition */
+    update_partition = esp_ota_get_next_update_partition(NULL);
+    if (!update_partition) {
+        ESP_LOGE(TAG, "No update partition found");
+        free(buf);
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"No update partition available\"}");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGD(TAG, "Writing to partition: %s at 0x%lx", update_partition->label, update_partition->address);
+
+    /* A one-shot upload replaces any unfinished resumable one */
+    ota_session_cancel();
+    
+    /* Receive and write firmware data */
+    while (remaining > 0) {
+        int recv_len = httpd_req_recv(req, buf, MIN(remaining, buf_size));
+        if (recv_len < 0) {
+            if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            ESP_LOGE(TAG, "Receive error: %d", recv_len);
+            goto upload_error;
+        }
+        
+        /* Validate first chunk contains valid ESP32 firmware */
+        if (first_chunk) {
+            if ((uint8_t)buf[0] != 0xE9) {
+                ESP_LOGE(TAG, "Invalid firmware magic byte: 0x%02x (expected 0xE9)", (uint8_t)buf[0]);
+                free(buf);
+                httpd_resp_set_status(req, "400 Bad Request");
+                httpd_resp_set_type(req, "application/json");
+                httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Invalid firmware file - not an ESP32 binary\"}");
+                return ESP_FAIL;
+            }
+            
+            /* Begin OTA now that we've validated the firmware */
+            err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+                free(buf);
+                httpd_resp_set_status(req, "500 Internal Server Error");
+                httpd_resp_set_type(req, "application/json");
+                httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Failed to start OTA\"}");
+                return ESP_FAIL;
+            }
+            ota_started = true;
+            first_chunk = false;
+        }
+        
+        err = esp_ota_write(ota_handle, buf, recv_len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
+            goto upload_error;
+        }
+        
+        received += recv_len;
+        remaining -= recv_len;
+        
+        if (received % 102400 == 0) {
+            ESP_LOGD(TAG, "Upload progress: %d/%d bytes", received, req->content_len);
+        }
+    }
+    
+    /* Finish OTA */
+    err = esp_ota_end(ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+        free(buf);
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Firmware validation failed - file may be corrupted\"}");
+        return ESP_FAIL;
+    }
+    
+    /* Set boot partition */
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
+        free(buf);
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Failed to set boot partition\"}");
+        return ESP_FAIL;
+    }
+    
+    free(buf);
+    
+    ESP_LOGI(TAG, "Manual firmware upload complete, restarting...");
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"Firmware uploaded successfully, restarting...\"}");
+    
+    /* Restart after short delay to allow response to be sent */
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
+    
+    return ESP_OK;
+
+upload_error:
+    if (ota_started) {
+        esp_ota_abort(ota_handle);
+    }
+    free(buf);
+    httpd_resp_set_status(req, "500 Internal Server Error");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Upload failed\"}");
+    return ESP_FAIL;
+}
+
+/* Resumable uploads receive through a buffer of this size; chunks can be any size */
+#define OTA_SESSION_BUF_LEN  4096
+
+/**
+ * @brief Send the state of the resumable upload, with an optional HTTP status
+ */
+static esp_err_t send_ota_session(httpd_req_t *req, const char *http_status, bool success,
+                                  const char *message, const ota_session_status_t *status)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "success", success);
+    if (message) {
+        cJSON_AddStringToObject(root, "message", message);
+    }
+    cJSON_AddBoolToObject(root, "active", status->active);
+    if (status->active) {
+        cJSON_AddStringToObject(root, "id", status->id);
+        cJSON_AddNumberToObject(root, "size", status->size);
+        cJSON_AddNumberToObject(root, "offset", status->offset);
+        cJSON_AddNumberToObject(root, "retries", status->retries);
+        cJSON_AddBoolToObject(root, "restored", status->restored);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    if (http_status) {
+        httpd_resp_set_status(req, http_status);
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/ota/session - progress of the resumable upload
+ */
+static esp_err_t api_ota_session_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    ota_session_status_t status;
+    ota_session_get(NULL, &status);
+    return send_ota_session(req, NULL, true, NULL, &status);
+}
+
+/**
+ * @brief Handler for POST /api/ota/session - open or continue a resumable upload
+ *
+ * Body: {"size": <bytes>, "sha256": "<64 hex digits>"}
+ */
+static esp_err_t api_ota_session_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[192];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    cJSON *size = root ? cJSON_GetObjectItem(root, "size") : NULL;
+    cJSON *sha256 = root ? cJSON_GetObjectItem(root, "sha256") : NULL;
+    uint8_t digest[OTA_SHA256_LEN];
+    bool valid = cJSON_IsNumber(size) && size->valuedouble >= 1 && size->valuedouble <= UINT32_MAX &&
+                 cJSON_IsString(sha256) &&
+                 auth_hex_to_bytes(sha256->valuestring, strlen(sha256->valuestring), digest, sizeof(digest));
+    uint32_t image_size = valid ? (uint32_t)size->valuedouble : 0;
+    cJSON_Delete(root);
+    if (!valid) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "size and sha256 (64 hex digits) required");
+        return ESP_FAIL;
+    }
+    if (ota_update_in_progress()) {
+        return send_conflict(req, "An update from GitHub is in progress");
+    }
+
+    ota_session_status_t status;
+    esp_err_t err = ota_session_open(image_size, digest, &status);
+    if (err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Image larger than the update partition");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot open upload session: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA");
+        return ESP_FAIL;
+    }
+    return send_ota_session(req, NULL, true, NULL, &status);
+}
+
+/**
+ * @brief Handler for PUT /api/ota/session - one chunk of a resumable upload
+ *
+ * Headers: X-Upload-Session: <id>, Content-Range: bytes <first>-<last>/<size>.
+ * A chunk may repeat bytes already committed (a retry); only the new ones
+ * are written. The chunk completing the image is verified against the
+ * session digest before the device switches to it and restarts.
+ */
+static esp_err_t api_ota_session_put_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char id[OTA_SESSION_ID_LEN + 1];
+    char range_hdr[64];
+    ota_range_t range;
+    if (httpd_req_get_hdr_value_str(req, "X-Upload-Session", id, sizeof(id)) != ESP_OK ||
+        httpd_req_get_hdr_value_str(req, "Content-Range", range_hdr, sizeof(range_hdr)) != ESP_OK ||
+        !ota_parse_content_range(range_hdr, &range) ||
+        req->content_len != (size_t)(range.last - range.first) + 1) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "X-Upload-Session and a Content-Range matching the body required");
+        return ESP_FAIL;
+    }
+
+    ota_session_status_t status;
+    ota_chunk_action_t action;
+    uint32_t skip;
+    if (ota_session_chunk(id, &range, &action, &skip) != ESP_OK) {
+        ota_session_get(NULL, &status);
+        return send_ota_session(req, "404 Not Found", false, "No such upload session", &status);
+    }
+    if (action == OTA_CHUNK_INVALID) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content-Range does not match the image size");
+        return ESP_FAIL;
+    }
+    if (action != OTA_CHUNK_APPEND) {
+        /* Duplicate: already committed. Gap: the client resumes from offset */
+        ota_session_get(id, &status);
+        return send_ota_session(req, action == OTA_CHUNK_GAP ? "409 Conflict" : NULL,
+                                action == OTA_CHUNK_DUPLICATE, NULL, &status);
+    }
+
+    char *buf = malloc(OTA_SESSION_BUF_LEN);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    size_t remaining = req->content_len;
+    bool received = true;
+    esp_err_t err = ESP_OK;
+    while (remaining > 0) {
+        int len = httpd_req_recv(req, buf, MIN(remaining, OTA_SESSION_BUF_LEN));
+        if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (len <= 0) {
+            received = false;
+            break;
+        }
+        remaining -= len;
+        uint32_t drop = MIN(skip, (uint32_t)len);
+        skip -= drop;
+        if ((uint32_t)len > drop) {
+            err = ota_session_write(buf + drop, len - drop);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+    }
+    free(buf);
+
+    /* Whatever arrived before a drop is kept, so the retry only sends the rest */
+    ota_session_commit();
+    if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid firmware file - not an ESP32 binary");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Flash write failed, upload discarded");
+        return ESP_FAIL;
+    }
+    if (!received) {
+        ESP_LOGW(TAG, "Upload chunk cut off, %u bytes short", (unsigned)remaining);
+        return ESP_FAIL;
+    }
+
+    ota_session_get(id, &status);
+    if (status.offset < status.size) {
+        return send_ota_session(req, NULL, true, NULL, &status);
+    }
+
+    err = ota_session_finish();
+    status.active = err == ESP_OK;
+    if (err == ESP_ERR_INVALID_CRC) {
+        return send_ota_session(req, "400 Bad Request", false, "SHA-256 mismatch, upload discarded", &status);
+    }
+    if (err != ESP_OK) {
+        return send_ota_session(req, "400 Bad Request", false,
+                                "Firmware validation failed - file may be corrupted", &status);
+    }
+
+    ESP_LOGI(TAG, "Resumable firmware upload complete, restarting...");
+    send_ota_session(req, NULL, true, "Firmware verified, restarting...", &status);
+
+    /* Restart after short delay to allow response to be sent */
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for DELETE /api/ota/session - abandon the resumable upload
+ */
+static esp_err_t api_ota_session_delete_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    ota_session_status_t status = { 0 };
+    ota_session_cancel();
+    return send_ota_session(req, NULL, true, NULL, &status);
+}
+
+/**
+ * @brief Handler for GET /api/wifi/scan - Scan for available networks
+ */
+static esp_err_t api_wifi_scan_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    wifi_ap_record_t ap_records[20];
+    uint16_t ap_count = 0;
+    
+    esp_err_t err = wifi_manager_scan(ap_records, 20, &ap_count);
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON *networks = cJSON_CreateArray();
+    
+    if (err == ESP_OK) {
+        for (int i = 0; i < ap_count; i++) {
+            /* Skip duplicates and empty SSIDs */
+            if (strlen((char *)ap_records[i].ssid) == 0) continue;
+            
+            /* Check for duplicate SSID already in array */
+            bool duplicate = false;
+            cJSON *item;
+            cJSON_ArrayForEach(item, networks) {
+                cJSON *ssid_item = cJSON_GetObjectItem(item, "ssid");
+                if (ssid_item && strcmp(ssid_item->valuestring, (char *)ap_records[i].ssid) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (duplicate) continue;
+            
+            cJSON *network = cJSON_CreateObject();
+            cJSON_AddStringToObject(network, "ssid", (char *)ap_records[i].ssid);
+            cJSON_AddNumberToObject(network, "rssi", ap_records[i].rssi);
+            cJSON_AddNumberToObject(network, "channel", ap_records[i].primary);
+            cJSON_AddBoolToObject(network, "secure", ap_records[i].authmode != WIFI_AUTH_OPEN);
+            cJSON_AddItemToArray(networks, network);
+        }
+        cJSON_AddBoolToObject(root, "success", true);
+    } else {
+        cJSON_AddBoolToObject(root, "success", false);
+        cJSON_AddStringToObject(root, "error", esp_err_to_name(err));
+    }
+    
+    cJSON_AddItemToObject(root, "networks", networks);
+    
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/logs - returns recent log buffer contents
+ */
+static esp_err_t api_logs_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    /* Allocate buffer for logs (same size as ring buffer) */
+    char *log_data = malloc(LOG_BUFFER_SIZE);
+    if (!log_data) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    
+    size_t len = log_buffer_get(log_data, LOG_BUFFER_SIZE);
+    
+    httpd_resp_set_type(req, "text/plain");
+    httpd_resp_send(req, log_data, len);
+    
+    free(log_data);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/logs/clear - clears log buffer
+ */
+static esp_err_t api_logs_clear_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    log_buffer_clear();
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"success\":true}");
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/logs/level - returns current log level
+ */
+static esp_err_t api_logs_level_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    /* Get current log level for "main" tag (representative of app) */
+    esp_log_level_t level = esp_log_level_get("main");
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "level", (int)level);
+    
+    /* Also provide human-readable name */
+    const char *level_names[] = {"none", "error", "warn", "info", "debug", "verbose"};
+    cJSON_AddStringToObject(root, "level_name", level_names[level]);
+    
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/logs/level - sets log level
+ * Body: {"level": 3} where 0=none, 1=error, 2=warn, 3=info, 4=debug, 5=verbose
+ */
+static esp_err_t api_logs_level_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[64];
+    int received = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (received <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No content");
+        return ESP_FAIL;
+    }
+    content[received] = '\0';
+    
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    
+    cJSON *level_json = cJSON_GetObjectItem(root, "level");
+    if (!level_json || !cJSON_IsNumber(level_json)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing level");
+        return ESP_FAIL;
+    }
+    
+    int level = level_json->valueint;
+    cJSON_Delete(root);
+    
+    if (level < 0 || level > 5) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid level (0-5)");
+        return ESP_FAIL;
+    }
+    
+    /* Set log level for all components */
+    esp_log_level_set("*", (esp_log_level_t)level);
+    
+    ESP_LOGI(TAG, "Log level changed to %d", level);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"success\":true}");
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/config/wifi
+ */
+static esp_err_t api_config_wifi_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char ssid[32] = {0};
+    char password[64] = {0};
+    
+    /* Try NVS first, then menuconfig defaults */
+    esp_err_t err = nvs_storage_load_wifi_config(ssid, sizeof(ssid), 
+                                                  password, sizeof(password));
+    if (err != ESP_OK || strlen(ssid) == 0) {
+#ifdef CONFIG_WIFI_SSID
+        strncpy(ssid, CONFIG_WIFI_SSID, sizeof(ssid) - 1);
+#endif
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "ssid", ssid);
+    /* Don't send password for security */
+    
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/config/wifi
+ */
+static esp_err_t api_config_wifi_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[256];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+    
+    cJSON *root = cJSON_Parse(content);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    
+    cJSON *ssid_item = cJSON_GetObjectItem(root, "ssid");
+    cJSON *password_item = cJSON_GetObjectItem(root, "password");
+    
+    if (!cJSON_IsString(ssid_item) || strlen(ssid_item->valuestring) == 0) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ssid");
+        return ESP_FAIL;
+    }
+    
+    /* If password not provided, load existing one */
+    char password[64] = {0};
+    if (cJSON_IsString(password_item) && strlen(password_item->valuestring) > 0) {
+        strncpy(password, password_item->valuestring, sizeof(password) - 1);
+    } else {
+        char existing_ssid[32];
+        nvs_storage_load_wifi_config(existing_ssid, sizeof(existing_ssid),
+                                      password, sizeof(password));
+    }
+    
+    esp_err_t err = nvs_storage_save_wifi_config(ssid_item->valuestring, password);
+    cJSON_Delete(root);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err == ESP_OK) {
+        cJSON_AddStringToObject(response, "message", "WiFi config saved. Restart to apply.");
+    }
+    
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/config/mqtt
+ */
+static esp_err_t api_config_mqtt_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char uri[128] = {0};
+    char username[64] = {0};
+    char password[64] = {0};
+    
+    esp_err_t err = nvs_storage_load_mqtt_config(uri, sizeof(uri),
+                                                  username, sizeof(username),
+                                                  password, sizeof(password));
+    if (err != ESP_OK || strlen(uri) == 0) {
+#ifdef CONFIG_MQTT_BROKER_URI
+        strncpy(uri, CONFIG_MQTT_BROKER_URI, sizeof(uri) - 1);
+#endif
+#ifdef CONFIG_MQTT_USERNAME
+        strncpy(username, CONFIG_MQTT_USERNAME, sizeof(username) - 1);
+#endif
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "uri", uri);
+    cJSON_AddStringToObject(root, "username", username);
+    /* Don't send password for security */
+    cJSON_AddBoolToObject(root, "connected", mqtt_ha_is_connected());
+    cJSON_AddStringToObject(root, "protocol", mqtt_ha_get_protocol());
+    cJSON_AddStringToObject(root, "switch", mqtt_ha_switch_state_name(mqtt_ha_get_switch_state()));
+    
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/config/mqtt
+ */
+static esp_err_t api_config_mqtt_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[384];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+    
+    cJSON *root = cJSON_Parse(content);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    
+    cJSON *uri_item = cJSON_GetObjectItem(root, "uri");
+    cJSON *username_item = cJSON_GetObjectItem(root, "username");
+    cJSON *password_item = cJSON_GetObjectItem(root, "password");
+    
+    if (!cJSON_IsString(uri_item) || strlen(uri_item->valuestring) == 0) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing uri");
+        return ESP_FAIL;
+    }
+    
+    const char *username = "";
+    const char *password = "";
+    char existing_password[64] = {0};
+    
+    if (cJSON_IsString(username_item)) {
+        username = username_item->valuestring;
+    }
+    
+    if (cJSON_IsString(password_item) && strlen(password_item->valuestring) > 0) {
+        password = password_item->valuestring;
+    } else {
+        /* Load existing password */
+        char existing_uri[128], existing_user[64];
+        nvs_storage_load_mqtt_config(existing_uri, sizeof(existing_uri),
+                                      existing_user, sizeof(existing_user),
+                                      existing_password, sizeof(existing_password));
+        password = existing_password;
+    }
+    
+    esp_err_t err = nvs_storage_save_mqtt_config(uri_item->valuestring, username, password);
+    cJSON_Delete(root);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err == ESP_OK) {
+        cJSON_AddStringToObject(response, "message", "MQTT config saved");
+    }
+    
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/mqtt/reconnect
+ */
+static esp_err_t api_mqtt_reconnect_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    ESP_LOGD(TAG, "MQTT reconnect requested");
+    
+    /* The current connection stays up until one with the new settings is */
+    bool changed = false;
+    esp_err_t err = mqtt_ha_reconfigure(&changed);
+    if (err == ESP_ERR_INVALID_STATE) {
+        return send_conflict(req, "MQTT switch already in progress");
+    }
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    cJSON_AddBoolToObject(response, "changed", changed);
+    if (err != ESP_OK) {
+        cJSON_AddStringToObject(response, "message", esp_err_to_name(err));
+    } else if (changed) {
+        cJSON_AddStringToObject(response, "message", "Switching MQTT broker");
+    } else {
+        cJSON_AddStringToObject(response, "message", mqtt_ha_is_connected() ?
+                                "MQTT settings unchanged" : "MQTT reconnecting");
+    }
+    
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+    
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/mqtt/targets
+ */
+static esp_err_t api_mqtt_targets_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    int64_t now_ms = esp_timer_get_time() / 1000;
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "max", CONFIG_MQTT_FANOUT_TARGETS);
+    cJSON *array = cJSON_AddArrayToObject(root, "targets");
+
+    for (int i = 0; i < CONFIG_MQTT_FANOUT_TARGETS; i++) {
+        mqtt_target_config_t cfg;
+        mqtt_target_status_t st;
+        if (mqtt_fanout_get_target(i, &cfg, &st) != ESP_OK) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "index", i);
+        cJSON_AddStringToObject(item, "uri", cfg.uri);
+        cJSON_AddStringToObject(item, "username", cfg.username);
+        /* Don't send password for security */
+        cJSON_AddStringToObject(item, "prefix", cfg.prefix);
+        cJSON_AddStringToObject(item, "scheme", mqtt_fanout_scheme_name(cfg.scheme));
+        cJSON_AddNumberToObject(item, "qos", cfg.qos);
+        cJSON_AddNumberToObject(item, "budget", cfg.budget);
+        cJSON_AddBoolToObject(item, "connected", st.connected);
+        cJSON_AddNumberToObject(item, "connects", st.connects);
+        cJSON_AddNumberToObject(item, "disconnects", st.disconnects);
+        cJSON_AddNumberToObject(item, "published", st.published);
+        cJSON_AddNumberToObject(item, "dropped", st.dropped);
+        cJSON_AddNumberToObject(item, "failed", st.failed);
+        cJSON_AddNumberToObject(item, "queued", st.queued);
+        cJSON_AddNumberToObject(item, "queued_bytes", st.queued_bytes);
+        cJSON_AddNumberToObject(item, "outbox_bytes", st.outbox_bytes);
+        cJSON_AddNumberToObject(item, "lag_ms", (double)st.lag_ms);
+        if (st.last_publish_ms >= 0) {
+            cJSON_AddNumberToObject(item, "last_publish_age_ms", (double)(now_ms - st.last_publish_ms));
+        } else {
+            cJSON_AddNullToObject(item, "last_publish_age_ms");
+        }
+        cJSON_AddItemToArray(array, item);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/mqtt/targets
+ *
+ * Body: {"index":0,"uri":"mqtt://plant:1883","prefix":"site1/thermux","scheme":"batch",
+ * "qos":1,"budget":16384} adds or replaces a target; "uri": null removes it.
+ */
+static esp_err_t api_mqtt_targets_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[512];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *index = cJSON_GetObjectItem(root, "index");
+    cJSON *uri = cJSON_GetObjectItem(root, "uri");
+    cJSON *username = cJSON_GetObjectItem(root, "username");
+    cJSON *password = cJSON_GetObjectItem(root, "password");
+    cJSON *prefix = cJSON_GetObjectItem(root, "prefix");
+    cJSON *scheme = cJSON_GetObjectItem(root, "scheme");
+    cJSON *qos = cJSON_GetObjectItem(root, "qos");
+    cJSON *budget = cJSON_GetObjectItem(root, "budget");
+
+    if (!cJSON_IsNumber(index) || index->valueint < 0 || index->valueint >= CONFIG_MQTT_FANOUT_TARGETS) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid index");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err;
+    if (uri == NULL || cJSON_IsNull(uri)) {
+        err = mqtt_fanout_set_target(index->valueint, NULL);
+    } else {
+        mqtt_target_config_t cfg = { 0 };
+        mqtt_target_config_t existing;
+        bool known = mqtt_fanout_get_target(index->valueint, &existing, NULL) == ESP_OK;
+
+        const char *error = NULL;
+        if (!cJSON_IsString(uri) || strlen(uri->valuestring) == 0 ||
+            strlen(uri->valuestring) >= sizeof(cfg.uri)) {
+            error = "Missing or too long uri";
+        } else if ((cJSON_IsString(username) && strlen(username->valuestring) >= sizeof(cfg.username)) ||
+                   (cJSON_IsString(password) && strlen(password->valuestring) >= sizeof(cfg.password)) ||
+                   (cJSON_IsString(prefix) && strlen(prefix->valuestring) >= sizeof(cfg.prefix))) {
+            error = "Username, password or prefix too long";
+        } else if (scheme != NULL && !(cJSON_IsString(scheme) &&
+                   (strcmp(scheme->valuestring, "batch") == 0 || strcmp(scheme->valuestring, "sensor") == 0))) {
+            error = "Scheme must be batch or sensor";
+        } else if (qos != NULL && !(cJSON_IsNumber(qos) && (qos->valueint == 0 || qos->valueint == 1))) {
+            error = "QoS must be 0 or 1";
+        } else if (budget != NULL && !(cJSON_IsNumber(budget) && budget->valueint >= 1024)) {
+            error = "Budget must be at least 1024 bytes";
+        }
+        if (error != NULL) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+            return ESP_FAIL;
+        }
+
+        strncpy(cfg.uri, uri->valuestring, sizeof(cfg.uri) - 1);
+        if (cJSON_IsString(username)) {
+            strncpy(cfg.username, username->valuestring, sizeof(cfg.username) - 1);
+        }
+        if (cJSON_IsString(password) && strlen(password->valuestring) > 0) {
+            strncpy(cfg.password, password->valuestring, sizeof(cfg.password) - 1);
+        } else if (known) {
+            /* Keep the stored password */
+            memcpy(cfg.password, existing.password, sizeof(cfg.password));
+        }
+        if (cJSON_IsString(prefix)) {
+            strncpy(cfg.prefix, prefix->valuestring, sizeof(cfg.prefix) - 1);
+        }
+        cfg.scheme = cJSON_IsString(scheme) && strcmp(scheme->valuestring, "sensor") == 0 ?
+                     MQTT_TARGET_SCHEME_SENSOR : MQTT_TARGET_SCHEME_BATCH;
+        cfg.qos = cJSON_IsNumber(qos) ? qos->valueint : 1;
+        cfg.budget = cJSON_IsNumber(budget) ? (uint32_t)budget->valueint :
+                     CONFIG_MQTT_FANOUT_DEFAULT_BUDGET_KB * 1024;
+        err = mqtt_fanout_set_target(index->valueint, &cfg);
+    }
+    cJSON_Delete(root);
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err != ESP_OK) {
+        cJSON_AddStringToObject(response, "message", esp_err_to_name(err));
+        httpd_resp_set_status(req, "500 Internal Server Error");
+    }
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Add handshake duration statistics to a JSON object
+ */
+static void add_tls_duration_json(cJSON *obj, const char *name, const tls_duration_stats_t *s)
+{
+    cJSON *item = cJSON_AddObjectToObject(obj, name);
+    cJSON_AddNumberToObject(item, "count", s->count);
+    cJSON_AddNumberToObject(item, "avg_ms", tls_duration_avg_ms(s));
+    cJSON_AddNumberToObject(item, "max_ms", s->max_ms);
+    cJSON_AddNumberToObject(item, "last_ms", s->last_ms);
+}
+
+/**
+ * @brief Handler for GET /api/config/mqtt/tls
+ */
+static esp_err_t api_config_mqtt_tls_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    int certs = 0;
+    size_t bytes = 0;
+    mqtt_tls_ca_source_t source = mqtt_tls_get_ca(&certs, &bytes);
+    tls_metrics_t m;
+    int cached = 0;
+    mqtt_tls_get_metrics(&m, &cached);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *ca = cJSON_AddObjectToObject(root, "ca");
+    cJSON_AddStringToObject(ca, "source", mqtt_tls_ca_source_name(source));
+    cJSON_AddNumberToObject(ca, "certificates", certs);
+    cJSON_AddNumberToObject(ca, "bytes", bytes);
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+    cJSON_AddBoolToObject(root, "session_resumption", true);
+#else
+    cJSON_AddBoolToObject(root, "session_resumption", false);
+#endif
+#if CONFIG_MQTT_TLS_PREFER_ECDSA
+    cJSON_AddBoolToObject(root, "prefer_ecdsa", true);
+#else
+    cJSON_AddBoolToObject(root, "prefer_ecdsa", false);
+#endif
+    cJSON_AddNumberToObject(root, "cached_sessions", cached);
+
+    cJSON *hs = cJSON_AddObjectToObject(root, "handshakes");
+    add_tls_duration_json(hs, "full", &m.full);
+    add_tls_duration_json(hs, "with_session", &m.with_session);
+    cJSON_AddNumberToObject(hs, "failures", m.failures);
+    cJSON_AddBoolToObject(hs, "last_session_offered", m.last_session_offered);
+    cJSON_AddNumberToObject(hs, "last_heap_peak", m.last_heap_peak);
+    cJSON_AddNumberToObject(hs, "max_heap_peak", m.max_heap_peak);
+    cJSON_AddNumberToObject(hs, "last_heap_retained", m.last_heap_retained);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
 
 /**
- * @brief Handler for GET /api/ota/status - poll for check result and download progress
+ * @brief Handler for POST /api/config/mqtt/ca
+ *
+ * Body: the CA certificates as PEM; an empty body goes back to the
+ * built-in bundle. Applies from the next TLS connection.
  */
-static esp_err_t api_ota_status_handler(httpd_req_t *req)
+static esp_err_t api_config_mqtt_ca_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    if (req->content_len > MQTT_TLS_CA_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "CA bundle too large");
+        return ESP_FAIL;
+    }
+
+    char *pem = malloc(req->content_len + 1);
+    if (pem == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    int received = 0;
+    while (received < (int)req->content_len) {
+        int ret = httpd_req_recv(req, pem + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            free(pem);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to receive body");
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+
+    esp_err_t err = mqtt_tls_set_ca(pem, received);
+    free(pem);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body must be PEM certificates");
+        return ESP_FAIL;
+    }
+
+    int certs = 0;
+    mqtt_tls_ca_source_t source = mqtt_tls_get_ca(&certs, NULL);
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err != ESP_OK) {
+        cJSON_AddStringToObject(response, "message", esp_err_to_name(err));
+        httpd_resp_set_status(req, "500 Internal Server Error");
+    } else {
+        cJSON_AddStringToObject(response, "source", mqtt_tls_ca_source_name(source));
+        cJSON_AddNumberToObject(response, "certificates", certs);
+    }
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/* External accessor functions from main.c */
+extern uint32_t get_sensor_read_interval(void);
+extern uint32_t get_sensor_publish_interval(void);
+extern void set_sensor_read_interval(uint32_t ms);
+extern void set_sensor_publish_interval(uint32_t ms);
+
+/**
+ * @brief Add a capacity evaluation to a JSON object
+ */
+static void add_capacity_json(cJSON *obj, const bus_capacity_t *cap, uint32_t interval_ms)
+{
+    cJSON_AddNumberToObject(obj, "interval_ms", interval_ms);
+    cJSON_AddNumberToObject(obj, "conversion_ms", cap->conversion_ms);
+    cJSON_AddNumberToObject(obj, "cycle_ms", cap->cycle_ms);
+    cJSON_AddNumberToObject(obj, "min_interval_ms", cap->min_interval_ms);
+    cJSON_AddNumberToObject(obj, "min_default_interval_ms", cap->min_default_interval_ms);
+    cJSON_AddNumberToObject(obj, "conversions_per_s", cap->conversions_per_s);
+    cJSON_AddNumberToObject(obj, "reads_per_s", cap->reads_per_s);
+    cJSON_AddNumberToObject(obj, "utilization", cap->utilization);
+    cJSON_AddStringToObject(obj, "verdict", bus_capacity_verdict_name(cap->verdict));
+}
+
+/**
+ * @brief Handler for GET /api/bus/capacity
+ *
+ * Evaluates the current configuration, or a what-if one with
+ * ?sensors=N&resolution=B&interval_ms=T.
+ */
+static esp_err_t api_bus_capacity_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
+    int sensors = -1;
+    int resolution = 0;
+    uint32_t interval_ms = sensor_manager_get_read_interval(get_sensor_read_interval());
+
+    char query[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[16];
+        if (httpd_query_key_value(query, "sensors", value, sizeof(value)) == ESP_OK) {
+            sensors = atoi(value);
+        }
+        if (httpd_query_key_value(query, "resolution", value, sizeof(value)) == ESP_OK) {
+            resolution = atoi(value);
+        }
+        if (httpd_query_key_value(query, "interval_ms", value, sizeof(value)) == ESP_OK) {
+            interval_ms = strtoul(value, NULL, 10);
+        }
+    }
+    if (sensors < -1 || sensors > 1000 || (resolution != 0 && (resolution < 9 || resolution > 12)) ||
+        interval_ms == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid sensors, resolution or interval_ms");
+        return ESP_FAIL;
+    }
+
+    bus_capacity_t cap;
+    sensor_manager_get_capacity(sensors, resolution, interval_ms, &cap);
+
+    uint32_t overhead_us, scratchpad_us;
+    onewire_temp_get_timing(&overhead_us, &scratchpad_us);
+
     cJSON *root = cJSON_CreateObject();
-    
-#if CONFIG_OTA_ENABLED
-    int result = ota_get_check_result();
-    bool checking = ota_check_in_progress();
-    bool update_available = ota_is_update_available();
-    char latest_version[32] = {0};
-    ota_get_latest_version(latest_version, sizeof(latest_version));
-    
-    /* Add download progress info */
-    int update_state = ota_get_update_state();  /* 0=idle, 1=downloading, 2=complete, -1=failed */
-    int download_progress = ota_get_download_progress();
-    int received = 0, total = 0;
-    ota_get_download_stats(&received, &total);
-    
-    ESP_LOGD(TAG, "OTA status: checking=%d, result=%d, update=%d, version=%s, update_state=%d, progress=%d%%",
-             checking, result, update_available, latest_version, update_state, download_progress);
-    
-    cJSON_AddBoolToObject(root, "checking", checking);
-    cJSON_AddNumberToObject(root, "result", result);  /* 0=in progress, 1=complete, -1=failed */
-    cJSON_AddBoolToObject(root, "update_available", update_available);
-    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
-    cJSON_AddStringToObject(root, "latest_version", latest_version);
-    
-    /* Download progress fields:
-       update_state: 0=idle, 1=downloading, 2=complete (rebooting soon), -1=failed */
-    cJSON_AddNumberToObject(root, "update_state", update_state);
-    cJSON_AddNumberToObject(root, "download_progress", download_progress);
-    cJSON_AddNumberToObject(root, "download_received", received);
-    cJSON_AddNumberToObject(root, "download_total", total);
-#else
-    cJSON_AddBoolToObject(root, "checking", false);
-    cJSON_AddIntToObject(root, "result", -1);
-    cJSON_AddBoolToObject(root, "update_available", false);
-    cJSON_AddStringToObject(root, "current_version", APP_VERSION);
-    cJSON_AddNumberToObject(root, "update_state", 0);
-    cJSON_AddNumberToObject(root, "download_progress", 0);
-    cJSON_AddStringToObject(root, "error", "OTA disabled");
-#endif
+    cJSON_AddNumberToObject(root, "sensor_count", sensors >= 0 ? sensors : sensor_manager_get_count());
+    cJSON_AddNumberToObject(root, "resolution", resolution > 0 ? resolution : onewire_temp_get_resolution());
+    add_capacity_json(root, &cap, interval_ms);
+
+    /* Costs measured on this bus (null until the first read) */
+    cJSON *measured = cJSON_AddObjectToObject(root, "measured");
+    if (scratchpad_us > 0) {
+        cJSON_AddNumberToObject(measured, "overhead_us", overhead_us);
+        cJSON_AddNumberToObject(measured, "scratchpad_us", scratchpad_us);
+    } else {
+        cJSON_AddNullToObject(measured, "overhead_us");
+        cJSON_AddNullToObject(measured, "scratchpad_us");
+    }
 
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -672,46 +2441,250 @@ static esp_err_t api_ota_status_handler(httpd_req_t *req)
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/ota/update
+ * @brief Add windowed read counts to a JSON object, one member per span
  */
-static esp_err_t api_ota_update_handler(httpd_req_t *req)
+static void add_health_counts_json(cJSON *obj, const health_counts_t *counts)
+{
+    for (int span = 0; span < HEALTH_SPAN_COUNT; span++) {
+        cJSON *window = cJSON_AddObjectToObject(obj, health_span_name(span));
+        cJSON_AddNumberToObject(window, "reads", counts->reads[span]);
+        cJSON_AddNumberToObject(window, "failed", counts->failed[span]);
+        cJSON_AddNumberToObject(window, "error_rate", health_error_percent(counts->reads[span], counts->failed[span]));
+    }
+}
+
+/**
+ * @brief Handler for GET /api/bus/health
+ *
+ * Read error rates over the last minute, hour and day for the bus and each
+ * sensor, and where the failures point to on the cable.
+ */
+static esp_err_t api_bus_health_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    health_counts_t bus;
+    health_fault_t fault;
+    health_counts_t *counts = malloc(sizeof(health_counts_t) * CONFIG_MAX_SENSORS);
+    if (counts == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        free(counts);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    bool degraded = sensor_manager_get_health(&bus, counts, &fault);
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "alert_active", degraded);
+    cJSON_AddNumberToObject(root, "alert_threshold", CONFIG_BUS_HEALTH_ALERT_PERCENT);
+    add_health_counts_json(cJSON_AddObjectToObject(root, "bus"), &bus);
+
+    /* Localization over the last hour; indices refer to the sensor list */
+    cJSON *fault_obj = cJSON_AddObjectToObject(root, "fault");
+    cJSON_AddStringToObject(fault_obj, "kind", health_fault_name(fault.kind));
+    if (fault.sensor >= 0 && fault.sensor < count) {
+        cJSON_AddStringToObject(fault_obj, "sensor", sensors[fault.sensor].address_str);
+    } else {
+        cJSON_AddNullToObject(fault_obj, "sensor");
+    }
+    if (fault.upstream >= 0 && fault.upstream < count) {
+        cJSON_AddStringToObject(fault_obj, "upstream", sensors[fault.upstream].address_str);
+    } else {
+        cJSON_AddNullToObject(fault_obj, "upstream");
+    }
+    cJSON_AddNumberToObject(fault_obj, "failing", fault.failing);
+    cJSON_AddNumberToObject(fault_obj, "considered", fault.considered);
+
+    /* Sensors in bus (ROM search) order */
+    cJSON *array = cJSON_AddArrayToObject(root, "sensors");
+    for (int i = 0; i < count; i++) {
+        cJSON *sensor = cJSON_CreateObject();
+        cJSON_AddStringToObject(sensor, "address", sensors[i].address_str);
+        if (sensors[i].position > 0) {
+            cJSON_AddNumberToObject(sensor, "position", sensors[i].position);
+        } else {
+            cJSON_AddNullToObject(sensor, "position");
+        }
+        add_health_counts_json(sensor, &counts[i]);
+        cJSON_AddItemToArray(array, sensor);
+    }
+    free(counts);
+    free(sensors);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/virtual-sensors
+ */
+static esp_err_t api_virtual_sensors_get_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    if (sensors == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    int count = sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS);
+    uint32_t eval_us, eval_max_us;
+    virtual_sensor_get_eval_time(&eval_us, &eval_max_us);
+
     cJSON *root = cJSON_CreateObject();
-    
-#if CONFIG_OTA_ENABLED
-    if (ota_is_update_available()) {
-        cJSON_AddBoolToObject(root, "started", true);
-        cJSON_AddStringToObject(root, "message", "Update starting, device will restart");
-        
-        char *json = cJSON_PrintUnformatted(root);
+    cJSON_AddNumberToObject(root, "max", CONFIG_VIRTUAL_SENSORS_MAX);
+    cJSON_AddNumberToObject(root, "eval_us", eval_us);
+    cJSON_AddNumberToObject(root, "max_eval_us", eval_max_us);
+    cJSON *array = cJSON_AddArrayToObject(root, "sensors");
+
+    virtual_sensor_t vs;
+    for (int i = 0; i < CONFIG_VIRTUAL_SENSORS_MAX; i++) {
+        if (!virtual_sensor_get(i, &vs)) {
+            continue;
+        }
+        cJSON *item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "id", vs.cfg.id);
+        cJSON_AddStringToObject(item, "name", vs.cfg.name[0] ? vs.cfg.name : vs.cfg.id);
+        cJSON_AddStringToObject(item, "expression", vs.cfg.expression);
+        if (vs.valid) {
+            cJSON_AddNumberToObject(item, "value", vs.value);
+        } else {
+            cJSON_AddNullToObject(item, "value");
+        }
+        cJSON_AddBoolToObject(item, "valid", vs.valid);
+        if (vs.bound) {
+            cJSON_AddNullToObject(item, "error");
+        } else {
+            cJSON_AddStringToObject(item, "error", vs.error);
+        }
+        cJSON *inputs = cJSON_AddArrayToObject(item, "inputs");
+        for (int j = 0; j < vs.input_count; j++) {
+            if (vs.inputs[j] < count) {
+                cJSON_AddItemToArray(inputs, cJSON_CreateString(sensors[vs.inputs[j]].address_str));
+            }
+        }
+        cJSON_AddItemToArray(array, item);
+    }
+    free(sensors);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST /api/virtual-sensors
+ *
+ * Body: {"id":"hx_delta","name":"HX delta","expression":"{Supply} - {Return}"}
+ * adds or replaces a virtual sensor; "expression": null removes it.
+ */
+static esp_err_t api_virtual_sensors_post_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    char content[384];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *id = cJSON_GetObjectItem(root, "id");
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    cJSON *expression = cJSON_GetObjectItem(root, "expression");
+    if (!cJSON_IsString(id)) {
         cJSON_Delete(root);
-        
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, json, strlen(json));
-        free(json);
-        
-        /* Start OTA in background */
-        ota_start_update();
-    } else {
-        cJSON_AddBoolToObject(root, "started", false);
-        cJSON_AddStringToObject(root, "message", "No update available");
-        
-        char *json = cJSON_PrintUnformatted(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing id");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err;
+    expr_error_t expr_err = { 0 };
+    if (expression == NULL || cJSON_IsNull(expression)) {
+        err = virtual_sensor_remove(id->valuestring);
+    } else if (!cJSON_IsString(expression) || strlen(expression->valuestring) >= EXPR_MAX_SOURCE ||
+               strlen(id->valuestring) >= EXPR_ID_LEN ||
+               (cJSON_IsString(name) && strlen(name->valuestring) >= EXPR_NAME_LEN)) {
         cJSON_Delete(root);
-        
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, json, strlen(json));
-        free(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Id, name or expression too long");
+        return ESP_FAIL;
+    } else {
+        virtual_sensor_config_t cfg = { 0 };
+        strncpy(cfg.id, id->valuestring, sizeof(cfg.id) - 1);
+        if (cJSON_IsString(name)) {
+            strncpy(cfg.name, name->valuestring, sizeof(cfg.name) - 1);
+        }
+        strncpy(cfg.expression, expression->valuestring, sizeof(cfg.expression) - 1);
+        err = virtual_sensor_set(&cfg, &expr_err);
     }
-#else
-    cJSON_AddBoolToObject(root, "started", false);
-    cJSON_AddStringToObject(root, "error", "OTA disabled");
+    cJSON_Delete(root);
+
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Virtual sensor not found");
+        return ESP_FAIL;
+    }
+    if (err == ESP_ERR_NO_MEM) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "All virtual sensor slots are in use");
+        return ESP_FAIL;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err == ESP_ERR_INVALID_ARG) {
+        /* Say where the expression went wrong */
+        cJSON_AddStringToObject(response, "message", expr_err.msg);
+        cJSON_AddNumberToObject(response, "position", expr_err.pos);
+        httpd_resp_set_status(req, "400 Bad Request");
+    } else if (err != ESP_OK) {
+        cJSON_AddStringToObject(response, "message", "Failed to save virtual sensor");
+        httpd_resp_set_status(req, "500 Internal Server Error");
+    }
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Handler for GET /api/config/sensor
+ */
+static esp_err_t api_config_sensor_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "read_interval", get_sensor_read_interval());
+    cJSON_AddNumberToObject(root, "publish_interval", get_sensor_publish_interval());
+    cJSON_AddNumberToObject(root, "resolution", onewire_temp_get_resolution());
     
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -719,635 +2692,813 @@ static esp_err_t api_ota_update_handler(httpd_req_t *req)
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-#endif
     
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/ota/upload - Manual firmware upload
- * 
- * Expects raw binary firmware data (not multipart form)
+ * @brief Handler for POST /api/config/sensor
  */
-static esp_err_t api_ota_upload_handler(httpd_req_t *req)
+static esp_err_t api_config_sensor_post_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    esp_err_t err;
-    esp_ota_handle_t ota_handle = 0;
-    const esp_partition_t *update_partition = NULL;
-    char *buf = NULL;
-    const int buf_size = 4096;
-    int received = 0;
-    int remaining = req->content_len;
-    bool ota_started = false;
-    bool first_chunk = true;
-    
-    ESP_LOGI(TAG, "Starting manual firmware upload, size: %d bytes", req->content_len);
-    
-    /* Validate content length */
-    if (req->content_len == 0 || req->content_len > 1500000) {
-        httpd_resp_set_status(req, "400 Bad Request");
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Invalid firmware size\"}");
+    char content[256];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
         return ESP_FAIL;
     }
+    content[ret] = '\0';
     
-    /* Allocate receive buffer */
-    buf = malloc(buf_size);
-    if (!buf) {
-        httpd_resp_set_status(req, "500 Internal Server Error");
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Memory allocation failed\"}");
+    cJSON *root = cJSON_Parse(content);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
     
-    /* Get update partition */
-    update_partition = esp_ota_get_next_update_partition(NULL);
-    if (!update_partition) {
-        ESP_LOGE(TAG, "No update partition found");
-        free(buf);
-        httpd_resp_set_status(req, "500 Internal Server Error");
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"No update partition available\"}");
-        return ESP_FAIL;
+    cJSON *read_item = cJSON_GetObjectItem(root, "read_interval");
+    cJSON *publish_item = cJSON_GetObjectItem(root, "publish_interval");
+    cJSON *resolution_item = cJSON_GetObjectItem(root, "resolution");
+    
+    uint32_t read_interval = get_sensor_read_interval();
+    uint32_t publish_interval = get_sensor_publish_interval();
+    uint8_t resolution = onewire_temp_get_resolution();
+    bool set_resolution = false;
+    
+    if (cJSON_IsNumber(read_item)) {
+        read_interval = (uint32_t)read_item->valueint;
+        if (read_interval < 1000) read_interval = 1000;
+        if (read_interval > 300000) read_interval = 300000;
     }
     
-    ESP_LOGD(TAG, "Writing to partition: %s at 0x%lx", update_partition->label, update_partition->address);
+    if (cJSON_IsNumber(publish_item)) {
+        publish_interval = (uint32_t)publish_item->valueint;
+        if (publish_interval < 5000) publish_interval = 5000;
+        if (publish_interval > 600000) publish_interval = 600000;
+    }
     
-    /* Receive and write firmware data */
-    while (remaining > 0) {
-        int recv_len = httpd_req_recv(req, buf, MIN(remaining, buf_size));
-        if (recv_len < 0) {
-            if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
-                continue;
-            }
-            ESP_LOGE(TAG, "Receive error: %d", recv_len);
-            goto upload_error;
-        }
-        
-        /* Validate first chunk contains valid ESP32 firmware */
-        if (first_chunk) {
-            if ((uint8_t)buf[0] != 0xE9) {
-                ESP_LOGE(TAG, "Invalid firmware magic byte: 0x%02x (expected 0xE9)", (uint8_t)buf[0]);
-                free(buf);
-                httpd_resp_set_status(req, "400 Bad Request");
-                httpd_resp_set_type(req, "application/json");
-                httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Invalid firmware file - not an ESP32 binary\"}");
-                return ESP_FAIL;
-            }
-            
-            /* Begin OTA now that we've validated the firmware */
-            err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
-                free(buf);
-                httpd_resp_set_status(req, "500 Internal Server Error");
-                httpd_resp_set_type(req, "application/json");
-                httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Failed to start OTA\"}");
-                return ESP_FAIL;
-            }
-            ota_started = true;
-            first_chunk = false;
-        }
-        
-        err = esp_ota_write(ota_handle, buf, recv_len);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
-            goto upload_error;
-        }
-        
-        received += recv_len;
-        remaining -= recv_len;
-        
-        if (received % 102400 == 0) {
-            ESP_LOGD(TAG, "Upload progress: %d/%d bytes", received, req->content_len);
+    if (cJSON_IsNumber(resolution_item)) {
+        if (resolution_item->valueint >= 9 && resolution_item->valueint <= 12) {
+            resolution = (uint8_t)resolution_item->valueint;
+            set_resolution = true;
         }
     }
     
-    /* Finish OTA */
-    err = esp_ota_end(ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
-        free(buf);
-        httpd_resp_set_status(req, "500 Internal Server Error");
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Firmware validation failed - file may be corrupted\"}");
+    cJSON_Delete(root);
+
+    /* Refuse settings the bus cannot keep up with */
+    bus_capacity_t cap;
+    sensor_manager_get_capacity(-1, resolution, read_interval, &cap);
+    if (cap.verdict == BUS_CAPACITY_OVERLOAD) {
+        /* The suggestion keeps the sensors that have their own interval */
+        char message[128];
+        if (cap.min_default_interval_ms == UINT32_MAX) {
+            snprintf(message, sizeof(message),
+                     "Bus overloaded (%.0f%%): per-sensor read intervals alone exceed it at %d bits",
+                     cap.utilization * 100.0f, resolution);
+        } else {
+            snprintf(message, sizeof(message),
+                     "Bus overloaded (%.0f%%): read interval must be at least %lu ms at %d bits",
+                     cap.utilization * 100.0f, (unsigned long)cap.min_default_interval_ms, resolution);
+        }
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, message);
         return ESP_FAIL;
     }
-    
-    /* Set boot partition */
-    err = esp_ota_set_boot_partition(update_partition);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
-        free(buf);
-        httpd_resp_set_status(req, "500 Internal Server Error");
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Failed to set boot partition\"}");
-        return ESP_FAIL;
+
+    set_sensor_read_interval(read_interval);
+    set_sensor_publish_interval(publish_interval);
+    if (set_resolution) {
+        bus_task_set_resolution(resolution);
     }
     
-    free(buf);
+    /* Save to NVS */
+    esp_err_t err = nvs_storage_save_sensor_settings(read_interval, publish_interval, resolution);
     
-    ESP_LOGI(TAG, "Manual firmware upload complete, restarting...");
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+    if (err == ESP_OK) {
+        cJSON_AddStringToObject(response, "message", "Sensor settings saved");
+    }
+    if (cap.verdict == BUS_CAPACITY_WARN) {
+        cJSON_AddStringToObject(response, "warning",
+                                "Bus utilization above 80%: on-demand reads and rescans will queue");
+    }
+    cJSON *capacity = cJSON_AddObjectToObject(response, "capacity");
+    add_capacity_json(capacity, &cap, read_interval);
     
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"success\":true,\"message\":\"Firmware uploaded successfully, restarting...\"}");
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
     
-    /* Restart after short delay to allow response to be sent */
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    esp_restart();
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
     
     return ESP_OK;
+}
 
-upload_error:
-    if (ota_started) {
-        esp_ota_abort(ota_handle);
+/**
+ * @brief Handler for GET /api/config/acquisition
+ */
+static esp_err_t api_config_acq_get_handler(httpd_req_t *req)
+{
+    CHECK_AUTH(req);
+    const acq_controller_t *acq = sensor_manager_get_acq();
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", acq->cfg.enabled);
+    cJSON_AddNumberToObject(root, "min_interval", acq->cfg.min_interval_ms);
+    cJSON_AddNumberToObject(root, "max_interval", acq->cfg.max_interval_ms);
+    cJSON_AddNumberToObject(root, "min_resolution", acq->cfg.min_resolution);
+    cJSON_AddNumberToObject(root, "max_resolution", acq->cfg.max_resolution);
+    cJSON_AddNumberToObject(root, "quiet_rate", acq->cfg.quiet_rate);
+    cJSON_AddNumberToObject(root, "active_rate", acq->cfg.active_rate);
+
+    /* Live state - what the bus is actually doing */
+    cJSON *status = cJSON_CreateObject();
+    cJSON_AddNumberToObject(status, "interval", sensor_manager_get_read_interval(get_sensor_read_interval()));
+    cJSON_AddNumberToObject(status, "resolution", onewire_temp_get_resolution());
+    cJSON_AddNumberToObject(status, "activity", acq->activity);
+    cJSON_AddNumberToObject(status, "bus_utilization", acq->utilization * 100.0f);
+    cJSON_AddNumberToObject(status, "sample_rate", acq->sample_rate);
+
+    managed_sensor_t *sensors = malloc(sizeof(managed_sensor_t) * CONFIG_MAX_SENSORS);
+    int count = sensors != NULL ? sensor_manager_copy_sensors(sensors, CONFIG_MAX_SENSORS) : 0;
+    cJSON *array = cJSON_AddArrayToObject(status, "sensors");
+    for (int i = 0; i < count && i < acq->sensor_count; i++) {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "address", sensors[i].address_str);
+        cJSON_AddNumberToObject(entry, "rate", acq->sensors[i].rate);
+        cJSON_AddNumberToObject(entry, "noise", acq->sensors[i].noise);
+        cJSON_AddItemToArray(array, entry);
     }
-    free(buf);
-    httpd_resp_set_status(req, "500 Internal Server Error");
+    free(sensors);
+    cJSON_AddItemToObject(root, "status", status);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"success\":false,\"message\":\"Upload failed\"}");
-    return ESP_FAIL;
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
+    return ESP_OK;
 }
 
 /**
- * @brief Handler for GET /api/wifi/scan - Scan for available networks
+ * @brief Handler for POST /api/config/acquisition
  */
-static esp_err_t api_wifi_scan_handler(httpd_req_t *req)
+static esp_err_t api_config_acq_post_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    wifi_ap_record_t ap_records[20];
-    uint16_t ap_count = 0;
-    
-    esp_err_t err = wifi_manager_scan(ap_records, 20, &ap_count);
-    
-    cJSON *root = cJSON_CreateObject();
-    cJSON *networks = cJSON_CreateArray();
-    
-    if (err == ESP_OK) {
-        for (int i = 0; i < ap_count; i++) {
-            /* Skip duplicates and empty SSIDs */
-            if (strlen((char *)ap_records[i].ssid) == 0) continue;
-            
-            /* Check for duplicate SSID already in array */
-            bool duplicate = false;
-            cJSON *item;
-            cJSON_ArrayForEach(item, networks) {
-                cJSON *ssid_item = cJSON_GetObjectItem(item, "ssid");
-                if (ssid_item && strcmp(ssid_item->valuestring, (char *)ap_records[i].ssid) == 0) {
-                    duplicate = true;
-                    break;
-                }
-            }
-            if (duplicate) continue;
-            
-            cJSON *network = cJSON_CreateObject();
-            cJSON_AddStringToObject(network, "ssid", (char *)ap_records[i].ssid);
-            cJSON_AddNumberToObject(network, "rssi", ap_records[i].rssi);
-            cJSON_AddNumberToObject(network, "channel", ap_records[i].primary);
-            cJSON_AddBoolToObject(network, "secure", ap_records[i].authmode != WIFI_AUTH_OPEN);
-            cJSON_AddItemToArray(networks, network);
-        }
-        cJSON_AddBoolToObject(root, "success", true);
-    } else {
-        cJSON_AddBoolToObject(root, "success", false);
-        cJSON_AddStringToObject(root, "error", esp_err_to_name(err));
+    char content[256];
+    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
+        return ESP_FAIL;
+    }
+    content[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    /* Start from the current settings so partial updates work */
+    acq_config_t cfg = sensor_manager_get_acq()->cfg;
+    cJSON *item = cJSON_GetObjectItem(root, "enabled");
+    if (cJSON_IsBool(item)) {
+        cfg.enabled = cJSON_IsTrue(item);
+    }
+    item = cJSON_GetObjectItem(root, "min_interval");
+    if (cJSON_IsNumber(item)) {
+        cfg.min_interval_ms = (uint32_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(root, "max_interval");
+    if (cJSON_IsNumber(item)) {
+        cfg.max_interval_ms = (uint32_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(root, "min_resolution");
+    if (cJSON_IsNumber(item)) {
+        cfg.min_resolution = (uint8_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(root, "max_resolution");
+    if (cJSON_IsNumber(item)) {
+        cfg.max_resolution = (uint8_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(root, "quiet_rate");
+    if (cJSON_IsNumber(item)) {
+        cfg.quiet_rate = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(root, "active_rate");
+    if (cJSON_IsNumber(item)) {
+        cfg.active_rate = (float)item->valuedouble;
     }
-    
-    cJSON_AddItemToObject(root, "networks", networks);
-    
-    char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
+
+    esp_err_t err = sensor_manager_set_acq_config(&cfg);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "Invalid bounds (interval 1000-300000 ms, resolution 9-12, quiet_rate < active_rate)");
+        return ESP_FAIL;
+    }
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
+
+    char *json = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for GET /api/logs - returns recent log buffer contents
+ * @brief Handler for GET /api/power
  */
-static esp_err_t api_logs_get_handler(httpd_req_t *req)
+static esp_err_t api_power_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    /* Allocate buffer for logs (same size as ring buffer) */
-    char *log_data = malloc(LOG_BUFFER_SIZE);
-    if (!log_data) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
-        return ESP_FAIL;
+    power_stats_t stats;
+    power_manager_get_stats(&stats);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", stats.enabled);
+    cJSON_AddBoolToObject(root, "light_sleep", stats.light_sleep);
+    cJSON_AddNumberToObject(root, "max_freq_mhz", stats.max_freq_mhz);
+    cJSON_AddNumberToObject(root, "min_freq_mhz", stats.min_freq_mhz);
+    cJSON_AddNumberToObject(root, "uptime_ms", (double)stats.uptime_ms);
+    cJSON_AddNumberToObject(root, "active_ms", (double)stats.active_ms);
+    cJSON_AddNumberToObject(root, "idle_ms", (double)(stats.uptime_ms - stats.active_ms));
+    cJSON_AddNumberToObject(root, "active_percent",
+                            stats.uptime_ms > 0 ? (double)stats.active_ms * 100.0 / stats.uptime_ms : 0.0);
+
+    cJSON *activity = cJSON_AddObjectToObject(root, "activity_ms");
+    for (int i = 0; i < PM_ACTIVITY_COUNT; i++) {
+        cJSON_AddNumberToObject(activity, power_manager_activity_name(i), (double)stats.activity_ms[i]);
     }
-    
-    size_t len = log_buffer_get(log_data, LOG_BUFFER_SIZE);
-    
-    httpd_resp_set_type(req, "text/plain");
-    httpd_resp_send(req, log_data, len);
-    
-    free(log_data);
+
+    cJSON *deadlines = cJSON_AddObjectToObject(root, "deadlines");
+    cJSON_AddNumberToObject(deadlines, "checked", stats.deadlines);
+    cJSON_AddNumberToObject(deadlines, "missed", stats.deadline_misses);
+    cJSON_AddNumberToObject(deadlines, "max_lateness_ms", stats.max_lateness_ms);
+    cJSON_AddNumberToObject(deadlines, "tolerance_ms", CONFIG_POWER_DEADLINE_TOLERANCE_MS);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/logs/clear - clears log buffer
+ * @brief Handler for GET /api/time
  */
-static esp_err_t api_logs_clear_handler(httpd_req_t *req)
+static esp_err_t api_time_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    log_buffer_clear();
-    
+    time_sync_status_t st;
+    time_sync_get_status(&st);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "synced", st.synced);
+    if (st.synced) {
+        cJSON_AddNumberToObject(root, "time", (double)st.now_ms);
+        cJSON_AddNumberToObject(root, "last_sync_age_s", (double)(st.last_sync_age_ms / 1000));
+    } else {
+        cJSON_AddNullToObject(root, "time");
+        cJSON_AddNullToObject(root, "last_sync_age_s");
+    }
+#if CONFIG_TIME_SYNC_ENABLED
+    cJSON_AddStringToObject(root, "server", CONFIG_TIME_SYNC_SERVER);
+#else
+    cJSON_AddNullToObject(root, "server");
+#endif
+    cJSON_AddNumberToObject(root, "syncs", st.sync.count);
+    cJSON_AddNumberToObject(root, "last_correction_ms", st.sync.last_correction_us / 1000.0);
+    cJSON_AddNumberToObject(root, "max_correction_ms", st.sync.max_correction_us / 1000.0);
+    cJSON_AddNumberToObject(root, "drift_ppm", st.sync.drift_ppm);
+
+    cJSON *align = cJSON_AddObjectToObject(root, "alignment");
+    cJSON_AddBoolToObject(align, "enabled", st.align_enabled);
+    cJSON_AddBoolToObject(align, "active", st.aligning);
+    cJSON_AddNumberToObject(align, "period_ms", st.phase.period_ms);
+    cJSON_AddNumberToObject(align, "lead_ms", st.phase.lead_ms);
+    cJSON_AddNumberToObject(align, "cycles", st.phase.cycles);
+    cJSON_AddNumberToObject(align, "missed", st.phase.missed);
+    cJSON_AddNumberToObject(align, "last_error_ms", st.phase.last_error_ms);
+    cJSON_AddNumberToObject(align, "max_error_ms", st.phase.max_error_ms);
+    cJSON_AddNumberToObject(align, "avg_error_ms", phase_align_avg_error_ms(&st.phase));
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"success\":true}");
+    httpd_resp_send(req, json, strlen(json));
+    free(json);
+
     return ESP_OK;
 }
 
+#if CONFIG_SELFTEST_ENABLED
+#define SELFTEST_CHUNK  4096
+
+static void add_transfer_stats(cJSON *parent, const char *name, const net_transfer_stats_t *t)
+{
+    cJSON *obj = cJSON_AddObjectToObject(parent, name);
+    cJSON_AddNumberToObject(obj, "runs", t->runs);
+    cJSON_AddNumberToObject(obj, "failures", t->failures);
+    cJSON_AddNumberToObject(obj, "total_bytes", (double)t->total_bytes);
+    cJSON_AddNumberToObject(obj, "last_bytes", t->last_bytes);
+    cJSON_AddNumberToObject(obj, "last_ms", t->last_ms);
+    cJSON_AddNumberToObject(obj, "last_kbps", t->last_kbps);
+    cJSON_AddNumberToObject(obj, "best_kbps", t->best_kbps);
+    cJSON_AddNumberToObject(obj, "last_errors", t->last_errors);
+}
+
+static void add_proto_counters(cJSON *parent, const char *name, const net_proto_counters_t *c)
+{
+    cJSON *obj = cJSON_AddObjectToObject(parent, name);
+    cJSON_AddNumberToObject(obj, "xmit", c->xmit);
+    cJSON_AddNumberToObject(obj, "recv", c->recv);
+    cJSON_AddNumberToObject(obj, "drop", c->drop);
+    cJSON_AddNumberToObject(obj, "memerr", c->memerr);
+    cJSON_AddNumberToObject(obj, "err", c->err);
+}
+
 /**
- * @brief Handler for GET /api/logs/level - returns current log level
+ * @brief Handler for GET /api/selftest
  */
-static esp_err_t api_logs_level_get_handler(httpd_req_t *req)
+static esp_err_t api_selftest_get_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    /* Get current log level for "main" tag (representative of app) */
-    esp_log_level_t level = esp_log_level_get("main");
-    
+    net_selftest_stats_t st;
+    net_selftest_get_stats(&st);
+
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "level", (int)level);
-    
-    /* Also provide human-readable name */
-    const char *level_names[] = {"none", "error", "warn", "info", "debug", "verbose"};
-    cJSON_AddStringToObject(root, "level_name", level_names[level]);
-    
+    cJSON_AddStringToObject(root, "profile", net_selftest_profile());
+    cJSON_AddBoolToObject(root, "busy", st.busy);
+
+    /* What the build configured, to read the counters against */
+    cJSON *buffers = cJSON_AddObjectToObject(root, "buffers");
+    cJSON_AddNumberToObject(buffers, "tcp_mss", CONFIG_LWIP_TCP_MSS);
+    cJSON_AddNumberToObject(buffers, "tcp_snd_buf", CONFIG_LWIP_TCP_SND_BUF_DEFAULT);
+    cJSON_AddNumberToObject(buffers, "tcp_wnd", CONFIG_LWIP_TCP_WND_DEFAULT);
+    cJSON_AddNumberToObject(buffers, "tcp_recvmbox", CONFIG_LWIP_TCP_RECVMBOX_SIZE);
+    cJSON_AddNumberToObject(buffers, "tcpip_recvmbox", CONFIG_LWIP_TCPIP_RECVMBOX_SIZE);
+    cJSON_AddNumberToObject(buffers, "max_sockets", CONFIG_LWIP_MAX_SOCKETS);
+#ifdef CONFIG_ETH_DMA_RX_BUFFER_NUM
+    cJSON_AddNumberToObject(buffers, "eth_dma_rx", CONFIG_ETH_DMA_RX_BUFFER_NUM);
+    cJSON_AddNumberToObject(buffers, "eth_dma_tx", CONFIG_ETH_DMA_TX_BUFFER_NUM);
+    cJSON_AddNumberToObject(buffers, "eth_dma_size", CONFIG_ETH_DMA_BUFFER_SIZE);
+#endif
+#ifdef CONFIG_ESP_WIFI_STATIC_RX_BUFFER_NUM
+    cJSON_AddNumberToObject(buffers, "wifi_static_rx", CONFIG_ESP_WIFI_STATIC_RX_BUFFER_NUM);
+    cJSON_AddNumberToObject(buffers, "wifi_dynamic_rx", CONFIG_ESP_WIFI_DYNAMIC_RX_BUFFER_NUM);
+#endif
+#ifdef CONFIG_ESP_WIFI_DYNAMIC_TX_BUFFER_NUM
+    cJSON_AddNumberToObject(buffers, "wifi_dynamic_tx", CONFIG_ESP_WIFI_DYNAMIC_TX_BUFFER_NUM);
+#endif
+
+    cJSON *link = cJSON_AddObjectToObject(root, "link");
+    cJSON *eth = cJSON_AddObjectToObject(link, "ethernet");
+    cJSON_AddBoolToObject(eth, "up", st.eth_link);
+    if (st.eth_link) {
+        cJSON_AddNumberToObject(eth, "speed_mbps", st.eth_speed_mbps);
+        cJSON_AddBoolToObject(eth, "full_duplex", st.eth_full_duplex);
+    }
+    cJSON *wifi = cJSON_AddObjectToObject(link, "wifi");
+    cJSON_AddBoolToObject(wifi, "up", st.wifi_link);
+    if (st.wifi_link) {
+        cJSON_AddNumberToObject(wifi, "rssi", st.wifi_rssi);
+    }
+
+    add_transfer_stats(root, "upload", &st.upload);
+    add_transfer_stats(root, "download", &st.download);
+
+    cJSON *echo = cJSON_AddObjectToObject(root, "echo");
+    cJSON_AddNumberToObject(echo, "port", CONFIG_SELFTEST_ECHO_PORT);
+    cJSON_AddBoolToObject(echo, "open", st.echo_open);
+    cJSON_AddNumberToObject(echo, "remaining_s", st.echo_remaining_s);
+    cJSON_AddNumberToObject(echo, "connections", st.echo_connections);
+    cJSON_AddNumberToObject(echo, "bytes", (double)st.echo_bytes);
+
+    if (st.lwip_stats) {
+        cJSON *lwip = cJSON_AddObjectToObject(root, "lwip");
+        add_proto_counters(lwip, "link", &st.link);
+        add_proto_counters(lwip, "ip", &st.ip);
+        add_proto_counters(lwip, "tcp", &st.tcp);
+        add_proto_counters(lwip, "udp", &st.udp);
+    } else {
+        cJSON_AddNullToObject(root, "lwip");
+    }
+
+    if (st.emac_stats) {
+        cJSON *emac = cJSON_AddObjectToObject(root, "emac");
+        cJSON_AddNumberToObject(emac, "rx_no_buffer", st.emac.no_descriptor);
+        cJSON_AddNumberToObject(emac, "rx_fifo_overflow", st.emac.fifo_overflow);
+        cJSON_AddBoolToObject(emac, "saturated", st.emac.saturated);
+    } else {
+        cJSON_AddNullToObject(root, "emac");
+    }
+
+    cJSON *heap = cJSON_AddObjectToObject(root, "heap");
+    cJSON_AddNumberToObject(heap, "free_internal", st.free_internal);
+    cJSON_AddNumberToObject(heap, "min_free_internal", st.min_free_internal);
+    cJSON_AddNumberToObject(heap, "free_dma", st.free_dma);
+
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/logs/level - sets log level
- * Body: {"level": 3} where 0=none, 1=error, 2=warn, 3=info, 4=debug, 5=verbose
+ * @brief Handler for GET /api/selftest/download?bytes=N (pattern source)
  */
-static esp_err_t api_logs_level_post_handler(httpd_req_t *req)
+static esp_err_t api_selftest_download_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char content[64];
-    int received = httpd_req_recv(req, content, sizeof(content) - 1);
-    if (received <= 0) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No content");
-        return ESP_FAIL;
+    uint32_t bytes = 1024 * 1024;
+    char query[32];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[16];
+        if (httpd_query_key_value(query, "bytes", value, sizeof(value)) == ESP_OK) {
+            bytes = strtoul(value, NULL, 10);
+        }
     }
-    content[received] = '\0';
-    
-    cJSON *root = cJSON_Parse(content);
-    if (!root) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    if (bytes == 0 || bytes > CONFIG_SELFTEST_MAX_KB * 1024u) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bytes out of range");
         return ESP_FAIL;
     }
-    
-    cJSON *level_json = cJSON_GetObjectItem(root, "level");
-    if (!level_json || !cJSON_IsNumber(level_json)) {
-        cJSON_Delete(root);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing level");
+
+    uint8_t *buf = malloc(SELFTEST_CHUNK);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
         return ESP_FAIL;
     }
-    
-    int level = level_json->valueint;
-    cJSON_Delete(root);
-    
-    if (level < 0 || level > 5) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid level (0-5)");
-        return ESP_FAIL;
+    if (!net_selftest_begin()) {
+        free(buf);
+        return send_conflict(req, "Another self-test transfer is running");
     }
-    
-    /* Set log level for all components */
-    esp_log_level_set("*", (esp_log_level_t)level);
-    
-    ESP_LOGI(TAG, "Log level changed to %d", level);
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, "{\"success\":true}");
-    return ESP_OK;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    int64_t start = esp_timer_get_time();
+    uint32_t sent = 0;
+    esp_err_t err = ESP_OK;
+    while (sent < bytes && err == ESP_OK) {
+        uint32_t len = MIN(bytes - sent, SELFTEST_CHUNK);
+        net_pattern_fill(buf, len, sent);
+        err = httpd_resp_send_chunk(req, (const char *)buf, len);
+        if (err == ESP_OK) {
+            sent += len;
+        }
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    net_selftest_end(false, sent, esp_timer_get_time() - start, err == ESP_OK, 0);
+    free(buf);
+
+    return err == ESP_OK ? ESP_OK : ESP_FAIL;
 }
 
 /**
- * @brief Handler for GET /api/config/wifi
+ * @brief Handler for POST /api/selftest/upload (pattern sink)
  */
-static esp_err_t api_config_wifi_get_handler(httpd_req_t *req)
+static esp_err_t api_selftest_upload_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char ssid[32] = {0};
-    char password[64] = {0};
-    
-    /* Try NVS first, then menuconfig defaults */
-    esp_err_t err = nvs_storage_load_wifi_config(ssid, sizeof(ssid), 
-                                                  password, sizeof(password));
-    if (err != ESP_OK || strlen(ssid) == 0) {
-#ifdef CONFIG_WIFI_SSID
-        strncpy(ssid, CONFIG_WIFI_SSID, sizeof(ssid) - 1);
-#endif
+    if (req->content_len == 0 || req->content_len > CONFIG_SELFTEST_MAX_KB * 1024u) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body size out of range");
+        return ESP_FAIL;
     }
-    
+
+    uint8_t *buf = malloc(SELFTEST_CHUNK);
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    if (!net_selftest_begin()) {
+        free(buf);
+        return send_conflict(req, "Another self-test transfer is running");
+    }
+
+    int64_t start = esp_timer_get_time();
+    size_t received = 0;
+    uint32_t errors = 0;
+    bool ok = true;
+    while (received < req->content_len) {
+        int len = httpd_req_recv(req, (char *)buf, MIN(req->content_len - received, SELFTEST_CHUNK));
+        if (len == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (len <= 0) {
+            ok = false;
+            break;
+        }
+        errors += net_pattern_check(buf, len, received);
+        received += len;
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    net_selftest_end(true, received, elapsed_us, ok, errors);
+    free(buf);
+    if (!ok) {
+        return ESP_FAIL;
+    }
+
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "ssid", ssid);
-    /* Don't send password for security */
-    
+    cJSON_AddBoolToObject(root, "success", errors == 0);
+    cJSON_AddNumberToObject(root, "bytes", received);
+    cJSON_AddNumberToObject(root, "ms", (double)(elapsed_us / 1000));
+    cJSON_AddNumberToObject(root, "kbps", net_rate_kbps(received, elapsed_us));
+    cJSON_AddNumberToObject(root, "errors", errors);
+
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/config/wifi
+ * @brief Handler for POST /api/selftest/echo (open the echo port for a while)
  */
-static esp_err_t api_config_wifi_post_handler(httpd_req_t *req)
+static esp_err_t api_selftest_echo_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char content[256];
+    int seconds = 30;
+    char content[64];
     int ret = httpd_req_recv(req, content, sizeof(content) - 1);
-    if (ret <= 0) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
-        return ESP_FAIL;
-    }
-    content[ret] = '\0';
-    
-    cJSON *root = cJSON_Parse(content);
-    if (root == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
-        return ESP_FAIL;
-    }
-    
-    cJSON *ssid_item = cJSON_GetObjectItem(root, "ssid");
-    cJSON *password_item = cJSON_GetObjectItem(root, "password");
-    
-    if (!cJSON_IsString(ssid_item) || strlen(ssid_item->valuestring) == 0) {
+    if (ret > 0) {
+        content[ret] = '\0';
+        cJSON *root = cJSON_Parse(content);
+        cJSON *value = root ? cJSON_GetObjectItem(root, "seconds") : NULL;
+        if (cJSON_IsNumber(value)) {
+            seconds = value->valueint;
+        }
         cJSON_Delete(root);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ssid");
+    }
+
+    esp_err_t err = seconds > 0 ? net_selftest_echo_open((uint32_t)seconds) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "seconds must be 1-600");
         return ESP_FAIL;
     }
-    
-    /* If password not provided, load existing one */
-    char password[64] = {0};
-    if (cJSON_IsString(password_item) && strlen(password_item->valuestring) > 0) {
-        strncpy(password, password_item->valuestring, sizeof(password) - 1);
-    } else {
-        char existing_ssid[32];
-        nvs_storage_load_wifi_config(existing_ssid, sizeof(existing_ssid),
-                                      password, sizeof(password));
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "success", err == ESP_OK);
+    cJSON_AddNumberToObject(root, "port", CONFIG_SELFTEST_ECHO_PORT);
+    cJSON_AddNumberToObject(root, "seconds", seconds);
+    if (err != ESP_OK) {
+        cJSON_AddStringToObject(root, "message", esp_err_to_name(err));
     }
-    
-    esp_err_t err = nvs_storage_save_wifi_config(ssid_item->valuestring, password);
+
+    char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
-    if (err == ESP_OK) {
-        cJSON_AddStringToObject(response, "message", "WiFi config saved. Restart to apply.");
-    }
-    
-    char *json = cJSON_PrintUnformatted(response);
-    cJSON_Delete(response);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
+#endif /* CONFIG_SELFTEST_ENABLED */
 
 /**
- * @brief Handler for GET /api/config/mqtt
+ * @brief Send a 409 with a JSON message
  */
-static esp_err_t api_config_mqtt_get_handler(httpd_req_t *req)
+static esp_err_t send_conflict(httpd_req_t *req, const char *message)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "success", false);
+    cJSON_AddStringToObject(root, "message", message);
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    httpd_resp_set_status(req, "409 Conflict");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+    free(json);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET /api/burst
+ */
+static esp_err_t api_burst_get_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char uri[128] = {0};
-    char username[64] = {0};
-    char password[64] = {0};
-    
-    esp_err_t err = nvs_storage_load_mqtt_config(uri, sizeof(uri),
-                                                  username, sizeof(username),
-                                                  password, sizeof(password));
-    if (err != ESP_OK || strlen(uri) == 0) {
-#ifdef CONFIG_MQTT_BROKER_URI
-        strncpy(uri, CONFIG_MQTT_BROKER_URI, sizeof(uri) - 1);
-#endif
-#ifdef CONFIG_MQTT_USERNAME
-        strncpy(username, CONFIG_MQTT_USERNAME, sizeof(username) - 1);
-#endif
-    }
-    
+    static const char *states[] = {"idle", "running", "done"};
+    burst_status_t status;
+    burst_capture_get_status(&status);
+
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "uri", uri);
-    cJSON_AddStringToObject(root, "username", username);
-    /* Don't send password for security */
-    
+    cJSON_AddStringToObject(root, "state", states[status.state]);
+    cJSON_AddStringToObject(root, "stop_reason", burst_stop_name(status.reason));
+    cJSON_AddNumberToObject(root, "resolution", status.resolution);
+
+    cJSON *sensors = cJSON_AddArrayToObject(root, "sensors");
+    for (int i = 0; i < status.sensor_count; i++) {
+        char address[17];
+        onewire_address_to_string(status.addresses[i], address);
+        cJSON_AddItemToArray(sensors, cJSON_CreateString(address));
+    }
+
+    cJSON_AddNumberToObject(root, "capacity", status.capacity);
+    cJSON_AddNumberToObject(root, "window", status.window);
+    cJSON_AddNumberToObject(root, "samples", status.count);
+    cJSON_AddNumberToObject(root, "total", status.total);
+    cJSON_AddNumberToObject(root, "elapsed_ms", status.elapsed_ms);
+    cJSON_AddBoolToObject(root, "triggered", status.triggered);
+    /* Conversions per second actually achieved, per sensor */
+    cJSON_AddNumberToObject(root, "rate_hz",
+                            status.elapsed_ms > 0 && status.sensor_count > 0 ?
+                            (double)status.total * 1000.0 / status.sensor_count / status.elapsed_ms : 0.0);
+    if (status.state == BURST_DONE) {
+        cJSON_AddNumberToObject(root, "download_bytes", burst_capture_export_size());
+    }
+
     char *json = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/config/mqtt
+ * @brief Handler for POST /api/burst/start
  */
-static esp_err_t api_config_mqtt_post_handler(httpd_req_t *req)
+static esp_err_t api_burst_start_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char content[384];
+    char content[768];
     int ret = httpd_req_recv(req, content, sizeof(content) - 1);
-    if (ret <= 0) {
+    if (ret < 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
         return ESP_FAIL;
     }
     content[ret] = '\0';
-    
-    cJSON *root = cJSON_Parse(content);
+
+    /* An empty body captures every sensor with the defaults */
+    cJSON *root = ret > 0 ? cJSON_Parse(content) : cJSON_CreateObject();
     if (root == NULL) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
-    
-    cJSON *uri_item = cJSON_GetObjectItem(root, "uri");
-    cJSON *username_item = cJSON_GetObjectItem(root, "username");
-    cJSON *password_item = cJSON_GetObjectItem(root, "password");
-    
-    if (!cJSON_IsString(uri_item) || strlen(uri_item->valuestring) == 0) {
-        cJSON_Delete(root);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing uri");
-        return ESP_FAIL;
+
+    burst_request_t burst = { .resolution = 9 };
+    bool valid = true;
+
+    cJSON *item = cJSON_GetObjectItem(root, "sensors");
+    if (cJSON_IsArray(item)) {
+        cJSON *sensor;
+        cJSON_ArrayForEach(sensor, item) {
+            if (!cJSON_IsString(sensor) || burst.sensor_count >= CONFIG_MAX_SENSORS) {
+                valid = false;
+                break;
+            }
+            burst.sensors[burst.sensor_count++] = sensor->valuestring;
+        }
     }
-    
-    const char *username = "";
-    const char *password = "";
-    char existing_password[64] = {0};
-    
-    if (cJSON_IsString(username_item)) {
-        username = username_item->valuestring;
+    item = cJSON_GetObjectItem(root, "resolution");
+    if (cJSON_IsNumber(item)) {
+        burst.resolution = item->valueint;
     }
-    
-    if (cJSON_IsString(password_item) && strlen(password_item->valuestring) > 0) {
-        password = password_item->valuestring;
-    } else {
-        /* Load existing password */
-        char existing_uri[128], existing_user[64];
-        nvs_storage_load_mqtt_config(existing_uri, sizeof(existing_uri),
-                                      existing_user, sizeof(existing_user),
-                                      existing_password, sizeof(existing_password));
-        password = existing_password;
+    item = cJSON_GetObjectItem(root, "max_samples");
+    if (cJSON_IsNumber(item)) {
+        valid &= item->valuedouble >= 0;
+        burst.max_samples = (uint32_t)item->valuedouble;
     }
-    
-    esp_err_t err = nvs_storage_save_mqtt_config(uri_item->valuestring, username, password);
+    item = cJSON_GetObjectItem(root, "duration_s");
+    if (cJSON_IsNumber(item)) {
+        valid &= item->valuedouble >= 0 && item->valuedouble * 1000.0 <= BURST_MAX_DURATION_MS;
+        burst.duration_ms = (uint32_t)(item->valuedouble * 1000.0);
+    }
+
+    cJSON *trigger = cJSON_GetObjectItem(root, "trigger");
+    if (cJSON_IsObject(trigger)) {
+        cJSON *sensor = cJSON_GetObjectItem(trigger, "sensor");
+        cJSON *above = cJSON_GetObjectItem(trigger, "above");
+        cJSON *below = cJSON_GetObjectItem(trigger, "below");
+        cJSON *post = cJSON_GetObjectItem(trigger, "post_samples");
+        /* Exactly one of above/below */
+        if (!cJSON_IsString(sensor) || cJSON_IsNumber(above) == cJSON_IsNumber(below)) {
+            valid = false;
+        } else {
+            burst.trigger_sensor = sensor->valuestring;
+            burst.trigger_above = cJSON_IsNumber(above);
+            burst.trigger_level = (float)(burst.trigger_above ? above : below)->valuedouble;
+            if (cJSON_IsNumber(post)) {
+                valid &= post->valuedouble >= 0;
+                burst.post_samples = (uint32_t)post->valuedouble;
+            }
+        }
+    }
+
+    esp_err_t err = valid ? burst_capture_start(&burst) : ESP_ERR_INVALID_ARG;
     cJSON_Delete(root);
-    
+
+    if (err == ESP_ERR_INVALID_STATE) {
+        return send_conflict(req, "A capture is already running");
+    }
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sensor not found");
+        return ESP_FAIL;
+    }
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "Invalid capture (resolution 9-12, max_samples up to the ring size, "
+                            "duration_s up to 3600, post_samples below the window)");
+        return ESP_FAIL;
+    }
+
     cJSON *response = cJSON_CreateObject();
     cJSON_AddBoolToObject(response, "success", err == ESP_OK);
-    if (err == ESP_OK) {
-        cJSON_AddStringToObject(response, "message", "MQTT config saved");
-    }
-    
+
     char *json = cJSON_PrintUnformatted(response);
     cJSON_Delete(response);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/mqtt/reconnect
+ * @brief Handler for POST /api/burst/stop
  */
-static esp_err_t api_mqtt_reconnect_handler(httpd_req_t *req)
+static esp_err_t api_burst_stop_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    ESP_LOGD(TAG, "MQTT reconnect requested");
-    
-    /* Stop and reinitialize MQTT with new settings */
-    mqtt_ha_stop();
-    mqtt_ha_init();
-    mqtt_ha_start();
-    
+    if (burst_capture_stop() != ESP_OK) {
+        return send_conflict(req, "No capture running");
+    }
+
     cJSON *response = cJSON_CreateObject();
     cJSON_AddBoolToObject(response, "success", true);
-    cJSON_AddStringToObject(response, "message", "MQTT reconnecting");
-    
+
     char *json = cJSON_PrintUnformatted(response);
     cJSON_Delete(response);
-    
+
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json, strlen(json));
     free(json);
-    
+
     return ESP_OK;
 }
 
-/* External accessor functions from main.c */
-extern uint32_t get_sensor_read_interval(void);
-extern uint32_t get_sensor_publish_interval(void);
-extern void set_sensor_read_interval(uint32_t ms);
-extern void set_sensor_publish_interval(uint32_t ms);
-
-/**
- * @brief Handler for GET /api/config/sensor
- */
-static esp_err_t api_config_sensor_get_handler(httpd_req_t *req)
+static esp_err_t burst_write_chunk(void *ctx, const void *data, size_t len)
 {
-    CHECK_AUTH(req);
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "read_interval", get_sensor_read_interval());
-    cJSON_AddNumberToObject(root, "publish_interval", get_sensor_publish_interval());
-    cJSON_AddNumberToObject(root, "resolution", onewire_temp_get_resolution());
-    
-    char *json = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, strlen(json));
-    free(json);
-    
-    return ESP_OK;
+    return len > 0 ? httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) : ESP_OK;
 }
 
 /**
- * @brief Handler for POST /api/config/sensor
+ * @brief Handler for GET /api/burst/data (binary capture download)
  */
-static esp_err_t api_config_sensor_post_handler(httpd_req_t *req)
+static esp_err_t api_burst_data_handler(httpd_req_t *req)
 {
     CHECK_AUTH(req);
-    char content[256];
-    int ret = httpd_req_recv(req, content, sizeof(content) - 1);
-    if (ret <= 0) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
-        return ESP_FAIL;
-    }
-    content[ret] = '\0';
-    
-    cJSON *root = cJSON_Parse(content);
-    if (root == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
-        return ESP_FAIL;
-    }
-    
-    cJSON *read_item = cJSON_GetObjectItem(root, "read_interval");
-    cJSON *publish_item = cJSON_GetObjectItem(root, "publish_interval");
-    cJSON *resolution_item = cJSON_GetObjectItem(root, "resolution");
-    
-    uint32_t read_interval = get_sensor_read_interval();
-    uint32_t publish_interval = get_sensor_publish_interval();
-    uint8_t resolution = onewire_temp_get_resolution();
-    
-    if (cJSON_IsNumber(read_item)) {
-        read_interval = (uint32_t)read_item->valueint;
-        if (read_interval < 1000) read_interval = 1000;
-        if (read_interval > 300000) read_interval = 300000;
-        set_sensor_read_interval(read_interval);
+    burst_status_t status;
+    burst_capture_get_status(&status);
+    if (status.state != BURST_DONE) {
+        return send_conflict(req, status.state == BURST_RUNNING ?
+                             "Capture still running" : "No capture to download");
     }
-    
-    if (cJSON_IsNumber(publish_item)) {
-        publish_interval = (uint32_t)publish_item->valueint;
-        if (publish_interval < 5000) publish_interval = 5000;
-        if (publish_interval > 600000) publish_interval = 600000;
-        set_sensor_publish_interval(publish_interval);
-    }
-    
-    if (cJSON_IsNumber(resolution_item)) {
-        resolution = (uint8_t)resolution_item->valueint;
-        if (resolution >= 9 && resolution <= 12) {
-            onewire_temp_set_resolution(resolution);
-        }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"burst.bin\"");
+
+    esp_err_t err = burst_capture_export(burst_write_chunk, req);
+    if (err == ESP_ERR_INVALID_STATE) {
+        /* A new capture started in between */
+        return send_conflict(req, "Capture still running");
     }
-    
-    cJSON_Delete(root);
-    
-    /* Save to NVS */
-    esp_err_t err = nvs_storage_save_sensor_settings(read_interval, publish_interval, resolution);
-    
-    cJSON *response = cJSON_CreateObject();
-    cJSON_AddBoolToObject(response, "success", err == ESP_OK);
-    if (err == ESP_OK) {
-        cJSON_AddStringToObject(response, "message", "Sensor settings saved");
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Burst download aborted: %s", esp_err_to_name(err));
+        return ESP_FAIL;
     }
-    
-    char *json = cJSON_PrintUnformatted(response);
-    cJSON_Delete(response);
-    
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json, strlen(json));
-    free(json);
-    
+    httpd_resp_send_chunk(req, NULL, 0);
+
     return ESP_OK;
 }
 
@@ -1495,12 +3646,13 @@ static esp_err_t api_auth_login_handler(httpd_req_t *req)
     cJSON *password = cJSON_GetObjectItem(root, "password");
 
     bool success = false;
-    const char *session_token = NULL;
+    char session_token[AUTH_TOKEN_HEX_LEN + 1];
     if (cJSON_IsString(username) && cJSON_IsString(password)) {
-        if (strcmp(username->valuestring, s_auth_username) == 0 &&
-            strcmp(password->valuestring, s_auth_password) == 0) {
+        bool user_ok = auth_ct_str_equal(username->valuestring, strlen(username->valuestring), s_auth_username);
+        bool pass_ok = auth_ct_str_equal(password->valuestring, strlen(password->valuestring), s_auth_password);
+        if (user_ok && pass_ok) {
             success = true;
-            session_token = generate_session_token();
+            generate_session_token(session_token);
             ESP_LOGI(TAG, "User '%s' logged in", s_auth_username);
         } else {
             ESP_LOGW(TAG, "Failed login attempt for user '%s'", 
@@ -1512,7 +3664,7 @@ static esp_err_t api_auth_login_handler(httpd_req_t *req)
     cJSON *response = cJSON_CreateObject();
     cJSON_AddBoolToObject(response, "success", success);
 
-    if (success && session_token) {
+    if (success) {
         /* Set session cookie */
         char cookie[80];
         snprintf(cookie, sizeof(cookie), "session=%s; Path=/; HttpOnly; SameSite=Strict", session_token);
@@ -1535,30 +3687,9 @@ static esp_err_t api_auth_login_handler(httpd_req_t *req)
 static esp_err_t api_auth_logout_handler(httpd_req_t *req)
 {
     /* Get the session token from cookie and clear that specific session */
-    size_t cookie_len = httpd_req_get_hdr_value_len(req, "Cookie");
-    if (cookie_len > 0) {
-        char *cookie = malloc(cookie_len + 1);
-        if (cookie && httpd_req_get_hdr_value_str(req, "Cookie", cookie, cookie_len + 1) == ESP_OK) {
-            char *session_start = strstr(cookie, "session=");
-            if (session_start) {
-                session_start += 8;
-                char token[33] = {0};
-                int i = 0;
-                while (session_start[i] && session_start[i] != ';' && i < 32) {
-                    token[i] = session_start[i];
-                    i++;
-                }
-                /* Find and clear matching session */
-                for (int j = 0; j < MAX_SESSIONS; j++) {
-                    if (strcmp(token, s_sessions[j].token) == 0) {
-                        s_sessions[j].token[0] = '\0';
-                        s_sessions[j].expiry = 0;
-                        break;
-                    }
-                }
-            }
-        }
-        free(cookie);
+    uint8_t token[AUTH_TOKEN_LEN];
+    if (get_session_token(req, token)) {
+        auth_sessions_remove(&s_sessions, token);
     }
     ESP_LOGI(TAG, "User logged out");
 
@@ -1736,7 +3867,13 @@ esp_err_t web_server_start(void)
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = CONFIG_WEB_SERVER_PORT;
     config.uri_match_fn = httpd_uri_match_wildcard;
-    config.max_uri_handlers = 32;  /* 28 endpoints + room for future */
+    config.max_uri_handlers = 65;  /* 60 endpoints + room for future */
+    config.close_fn = web_server_close_fn;
+    /* Event stream subscribers hold their sockets for as long as the page is
+     * open; leave room for ordinary requests next to them, and let a new
+     * connection evict the least recently used socket rather than be refused */
+    config.max_open_sockets = EVENT_STREAM_MAX_CLIENTS + 5;
+    config.lru_purge_enable = true;
 
     esp_err_t err = httpd_start(&s_server, &config);
     if (err != ESP_OK) {
@@ -1744,8 +3881,13 @@ esp_err_t web_server_start(void)
         return err;
     }
 
-    /* Helper macro to register URI handler with error checking */
+    event_stream_init(s_server);
+
+    /* Helper macro to register URI handler with error checking.
+     * Every handler runs under the HTTP power lock (see pm_locked_handler). */
     #define REGISTER_URI(uri_cfg) do { \
+        uri_cfg.user_ctx = (void *)uri_cfg.handler; \
+        uri_cfg.handler = pm_locked_handler; \
         esp_err_t ret = httpd_register_uri_handler(s_server, &uri_cfg); \
         if (ret != ESP_OK) { \
             ESP_LOGE(TAG, "ERROR: Failed to register %s - increase max_uri_handlers!", uri_cfg.uri); \
@@ -1810,6 +3952,20 @@ esp_err_t web_server_start(void)
     };
     REGISTER_URI(rescan_uri);
 
+    httpd_uri_t sensors_alarms_uri = {
+        .uri = "/api/sensors/alarms",
+        .method = HTTP_GET,
+        .handler = api_sensors_alarms_handler,
+    };
+    REGISTER_URI(sensors_alarms_uri);
+
+    httpd_uri_t sensors_read_now_uri = {
+        .uri = "/api/sensors/read",
+        .method = HTTP_POST,
+        .handler = api_sensors_read_now_handler,
+    };
+    REGISTER_URI(sensors_read_now_uri);
+
     httpd_uri_t error_stats_reset_uri = {
         .uri = "/api/sensors/error-stats/reset",
         .method = HTTP_POST,
@@ -1824,6 +3980,20 @@ esp_err_t web_server_start(void)
     };
     REGISTER_URI(sensor_name_uri);
 
+    httpd_uri_t alerts_uri = {
+        .uri = "/api/alerts",
+        .method = HTTP_GET,
+        .handler = api_alerts_get_handler,
+    };
+    REGISTER_URI(alerts_uri);
+
+    httpd_uri_t events_uri = {
+        .uri = "/api/events",
+        .method = HTTP_GET,
+        .handler = api_events_handler,
+    };
+    REGISTER_URI(events_uri);
+
     httpd_uri_t ota_check_uri = {
         .uri = "/api/ota/check",
         .method = HTTP_POST,
@@ -1852,6 +4022,34 @@ esp_err_t web_server_start(void)
     };
     REGISTER_URI(ota_upload_uri);
 
+    httpd_uri_t ota_session_get_uri = {
+        .uri = "/api/ota/session",
+        .method = HTTP_GET,
+        .handler = api_ota_session_get_handler,
+    };
+    REGISTER_URI(ota_session_get_uri);
+
+    httpd_uri_t ota_session_post_uri = {
+        .uri = "/api/ota/session",
+        .method = HTTP_POST,
+        .handler = api_ota_session_post_handler,
+    };
+    REGISTER_URI(ota_session_post_uri);
+
+    httpd_uri_t ota_session_put_uri = {
+        .uri = "/api/ota/session",
+        .method = HTTP_PUT,
+        .handler = api_ota_session_put_handler,
+    };
+    REGISTER_URI(ota_session_put_uri);
+
+    httpd_uri_t ota_session_delete_uri = {
+        .uri = "/api/ota/session",
+        .method = HTTP_DELETE,
+        .handler = api_ota_session_delete_handler,
+    };
+    REGISTER_URI(ota_session_delete_uri);
+
     /* Configuration page */
     httpd_uri_t config_uri = {
         .uri = "/config",
@@ -1934,6 +4132,34 @@ esp_err_t web_server_start(void)
     };
     REGISTER_URI(mqtt_reconnect_uri);
 
+    httpd_uri_t mqtt_targets_get_uri = {
+        .uri = "/api/mqtt/targets",
+        .method = HTTP_GET,
+        .handler = api_mqtt_targets_get_handler,
+    };
+    REGISTER_URI(mqtt_targets_get_uri);
+
+    httpd_uri_t mqtt_targets_post_uri = {
+        .uri = "/api/mqtt/targets",
+        .method = HTTP_POST,
+        .handler = api_mqtt_targets_post_handler,
+    };
+    REGISTER_URI(mqtt_targets_post_uri);
+
+    httpd_uri_t mqtt_tls_get_uri = {
+        .uri = "/api/config/mqtt/tls",
+        .method = HTTP_GET,
+        .handler = api_config_mqtt_tls_get_handler,
+    };
+    REGISTER_URI(mqtt_tls_get_uri);
+
+    httpd_uri_t mqtt_ca_post_uri = {
+        .uri = "/api/config/mqtt/ca",
+        .method = HTTP_POST,
+        .handler = api_config_mqtt_ca_post_handler,
+    };
+    REGISTER_URI(mqtt_ca_post_uri);
+
     /* Sensor config endpoints */
     httpd_uri_t sensor_config_get_uri = {
         .uri = "/api/config/sensor",
@@ -1950,6 +4176,120 @@ esp_err_t web_server_start(void)
     REGISTER_URI(sensor_config_post_uri);
 
     /* System endpoints */
+    httpd_uri_t acq_config_get_uri = {
+        .uri = "/api/config/acquisition",
+        .method = HTTP_GET,
+        .handler = api_config_acq_get_handler,
+    };
+    REGISTER_URI(acq_config_get_uri);
+
+    httpd_uri_t acq_config_post_uri = {
+        .uri = "/api/config/acquisition",
+        .method = HTTP_POST,
+        .handler = api_config_acq_post_handler,
+    };
+    REGISTER_URI(acq_config_post_uri);
+
+    httpd_uri_t power_uri = {
+        .uri = "/api/power",
+        .method = HTTP_GET,
+        .handler = api_power_handler,
+    };
+    REGISTER_URI(power_uri);
+
+    httpd_uri_t time_uri = {
+        .uri = "/api/time",
+        .method = HTTP_GET,
+        .handler = api_time_handler,
+    };
+    REGISTER_URI(time_uri);
+
+#if CONFIG_SELFTEST_ENABLED
+    httpd_uri_t selftest_uri = {
+        .uri = "/api/selftest",
+        .method = HTTP_GET,
+        .handler = api_selftest_get_handler,
+    };
+    REGISTER_URI(selftest_uri);
+
+    httpd_uri_t selftest_download_uri = {
+        .uri = "/api/selftest/download",
+        .method = HTTP_GET,
+        .handler = api_selftest_download_handler,
+    };
+    REGISTER_URI(selftest_download_uri);
+
+    httpd_uri_t selftest_upload_uri = {
+        .uri = "/api/selftest/upload",
+        .method = HTTP_POST,
+        .handler = api_selftest_upload_handler,
+    };
+    REGISTER_URI(selftest_upload_uri);
+
+    httpd_uri_t selftest_echo_uri = {
+        .uri = "/api/selftest/echo",
+        .method = HTTP_POST,
+        .handler = api_selftest_echo_handler,
+    };
+    REGISTER_URI(selftest_echo_uri);
+#endif
+
+    httpd_uri_t bus_capacity_uri = {
+        .uri = "/api/bus/capacity",
+        .method = HTTP_GET,
+        .handler = api_bus_capacity_handler,
+    };
+    REGISTER_URI(bus_capacity_uri);
+
+    httpd_uri_t bus_health_uri = {
+        .uri = "/api/bus/health",
+        .method = HTTP_GET,
+        .handler = api_bus_health_handler,
+    };
+    REGISTER_URI(bus_health_uri);
+
+    httpd_uri_t virtual_sensors_get_uri = {
+        .uri = "/api/virtual-sensors",
+        .method = HTTP_GET,
+        .handler = api_virtual_sensors_get_handler,
+    };
+    REGISTER_URI(virtual_sensors_get_uri);
+
+    httpd_uri_t virtual_sensors_post_uri = {
+        .uri = "/api/virtual-sensors",
+        .method = HTTP_POST,
+        .handler = api_virtual_sensors_post_handler,
+    };
+    REGISTER_URI(virtual_sensors_post_uri);
+
+    httpd_uri_t burst_get_uri = {
+        .uri = "/api/burst",
+        .method = HTTP_GET,
+        .handler = api_burst_get_handler,
+    };
+    REGISTER_URI(burst_get_uri);
+
+    httpd_uri_t burst_start_uri = {
+        .uri = "/api/burst/start",
+        .method = HTTP_POST,
+        .handler = api_burst_start_handler,
+    };
+    REGISTER_URI(burst_start_uri);
+
+    httpd_uri_t burst_stop_uri = {
+        .uri = "/api/burst/stop",
+        .method = HTTP_POST,
+        .handler = api_burst_stop_handler,
+    };
+    REGISTER_URI(burst_stop_uri);
+
+    httpd_uri_t burst_data_uri = {
+        .uri = "/api/burst/data",
+        .method = HTTP_GET,
+        .handler = api_burst_data_handler,
+    };
+    REGISTER_URI(burst_data_uri);
+
     httpd_uri_t system_restart_uri = {
         .uri = "/api/system/restart",
         .method = HTTP_POST,
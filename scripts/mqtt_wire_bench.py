@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""
+Minimal MQTT broker stand-in that counts the bytes a Thermux device sends.
+Point the device's broker URI at this host, let it publish for a while and
+compare a build with CONFIG_MQTT_USE_V5 against one without. --v311-only
+refuses MQTT 5 like an old broker, to check the fallback. With --tls-cert
+and --tls-key it is an mqtts:// broker and also reports each handshake's
+cipher suite and whether the device resumed its previous session.
+Usage: mqtt_wire_bench.py [--port 1883] [--alias-max N] [--v311-only] [--report S]
+                          [--tls-cert PEM --tls-key PEM]
+"""
+import argparse
+import socket
+import ssl
+import struct
+import threading
+import time
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+PINGREQ, PINGRESP, DISCONNECT = 12, 13, 14
+
+PROP_MESSAGE_EXPIRY = 0x02
+PROP_TOPIC_ALIAS = 0x23
+PROP_TOPIC_ALIAS_MAX = 0x22
+
+# Fixed-length MQTT 5 properties by identifier (bytes after the identifier)
+PROP_SIZES = {0x01: 1, 0x02: 4, 0x0B: None, 0x11: 4, 0x17: 1, 0x18: 4, 0x19: 1,
+              0x21: 2, 0x22: 2, 0x23: 2, 0x24: 1, 0x25: 1, 0x27: 4, 0x28: 1,
+              0x29: 1, 0x2A: 1, 0x13: 2}
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.by_proto = {}
+        self.handshakes = {}
+
+    def add_handshake(self, resumed, cipher, ms):
+        kind = 'resumed' if resumed else 'full'
+        with self.lock:
+            count, total, ciphers = self.handshakes.get(kind, (0, 0.0, set()))
+            self.handshakes[kind] = (count + 1, total + ms, ciphers | {cipher})
+
+    def add(self, proto, kind, size):
+        with self.lock:
+            entry = self.by_proto.setdefault(proto, {})
+            count, total = entry.get(kind, (0, 0))
+            entry[kind] = (count + 1, total + size)
+
+    def report(self):
+        with self.lock:
+            for proto, entry in sorted(self.by_proto.items()):
+                print(f"MQTT {proto}:")
+                for kind, (count, total) in sorted(entry.items()):
+                    print(f"  {kind:<16} {count:>7} packets {total:>9} bytes "
+                          f"{total / count:7.1f} bytes/packet")
+            for kind, (count, total, ciphers) in sorted(self.handshakes.items()):
+                print(f"TLS {kind:<8} {count:>7} handshakes {total / count:7.1f} ms "
+                      f"({', '.join(sorted(ciphers))})")
+
+
+def read_exact(sock, n):
+    data = b''
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError('closed')
+        data += chunk
+    return data
+
+
+def read_varint(buf, pos):
+    value, shift = 0, 0
+    while True:
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+def read_packet(sock):
+    """Return (type, flags, body, size on the wire)"""
+    header = read_exact(sock, 1)
+    length, shift, raw = 0, 0, header
+    while True:
+        byte = read_exact(sock, 1)
+        raw += byte
+        length |= (byte[0] & 0x7F) << shift
+        if not byte[0] & 0x80:
+            break
+        shift += 7
+    body = read_exact(sock, length)
+    return header[0] >> 4, header[0] & 0x0F, body, len(raw) + length
+
+
+def parse_properties(body, pos):
+    length, pos = read_varint(body, pos)
+    end = pos + length
+    props = {}
+    while pos < end:
+        ident = body[pos]
+        pos += 1
+        size = PROP_SIZES.get(ident)
+        if size is None:
+            if ident == 0x0B:
+                value, pos = read_varint(body, pos)
+                props[ident] = value
+                continue
+            # Strings, binary data and user properties: skip by prefix
+            count = 2 if ident == 0x26 else 1
+            for _ in range(count):
+                (n,) = struct.unpack_from('>H', body, pos)
+                pos += 2 + n
+            continue
+        props[ident] = int.from_bytes(body[pos:pos + size], 'big')
+        pos += size
+    return props, end
+
+
+def is_value_topic(topic):
+    return '/sensor/' in topic and topic.rsplit('/', 1)[-1] in ('state', 'trend', 'forecast')
+
+
+def handle(sock, addr, args, stats, tls):
+    aliases = {}
+    proto = '?'
+    try:
+        if tls is not None:
+            start = time.monotonic()
+            sock = tls.wrap_socket(sock, server_side=True)
+            ms = (time.monotonic() - start) * 1000
+            cipher = sock.cipher()[0]
+            print(f"{addr[0]}: TLS {sock.version()} {cipher}, "
+                  f"{'session resumed' if sock.session_reused else 'full handshake'}, {ms:.0f} ms")
+            stats.add_handshake(sock.session_reused, cipher, ms)
+        ptype, _, body, size = read_packet(sock)
+        if ptype != CONNECT:
+            return
+        (name_len,) = struct.unpack_from('>H', body, 0)
+        level = body[2 + name_len]
+        proto = '5' if level == 5 else '3.1.1'
+        if level == 5 and args.v311_only:
+            print(f"{addr[0]}: refusing MQTT 5")
+            sock.sendall(bytes([CONNACK << 4, 2, 0, 0x01]))
+            return
+        print(f"{addr[0]}: connected with MQTT {proto}")
+        stats.add(proto, 'connect', size)
+        if level == 5:
+            props = bytes([PROP_TOPIC_ALIAS_MAX]) + struct.pack('>H', args.alias_max)
+            sock.sendall(bytes([CONNACK << 4, 3 + len(props), 0, 0, len(props)]) + props)
+        else:
+            sock.sendall(bytes([CONNACK << 4, 2, 0, 0]))
+
+        while True:
+            ptype, flags, body, size = read_packet(sock)
+            if ptype == PUBLISH:
+                qos = (flags >> 1) & 3
+                (topic_len,) = struct.unpack_from('>H', body, 0)
+                topic = body[2:2 + topic_len].decode(errors='replace')
+                pos = 2 + topic_len
+                packet_id = None
+                if qos:
+                    (packet_id,) = struct.unpack_from('>H', body, pos)
+                    pos += 2
+                if level == 5:
+                    props, pos = parse_properties(body, pos)
+                    alias = props.get(PROP_TOPIC_ALIAS)
+                    if alias:
+                        if topic:
+                            aliases[alias] = topic
+                        elif alias in aliases:
+                            topic = aliases[alias]
+                        else:
+                            print(f"{addr[0]}: protocol error, unknown topic alias {alias}")
+                            return
+                kind = 'value publish' if is_value_topic(topic) else 'other publish'
+                stats.add(proto, kind, size)
+                if packet_id is not None:
+                    sock.sendall(bytes([PUBACK << 4, 2]) + struct.pack('>H', packet_id))
+            elif ptype == PINGREQ:
+                stats.add(proto, 'ping', size)
+                sock.sendall(bytes([PINGRESP << 4, 0]))
+            elif ptype == DISCONNECT:
+                print(f"{addr[0]}: disconnected")
+                return
+    except (ConnectionError, OSError, ssl.SSLError):
+        print(f"{addr[0]}: connection lost (MQTT {proto})")
+    finally:
+        sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--port', type=int, default=1883, help='TCP port to listen on')
+    parser.add_argument('--alias-max', type=int, default=10,
+                        help='Topic Alias Maximum announced to MQTT 5 clients')
+    parser.add_argument('--v311-only', action='store_true', help='Refuse MQTT 5 connections')
+    parser.add_argument('--report', type=float, default=60, help='Seconds between reports')
+    parser.add_argument('--tls-cert', help='Server certificate (PEM): accept mqtts:// instead')
+    parser.add_argument('--tls-key', help='Private key of --tls-cert (PEM)')
+    args = parser.parse_args()
+
+    tls = None
+    if args.tls_cert:
+        # Session tickets are on by default, so a device that offers its
+        # previous session gets an abbreviated handshake
+        tls = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        tls.load_cert_chain(args.tls_cert, args.tls_key)
+
+    stats = Stats()
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(('', args.port))
+    server.listen(4)
+    server.settimeout(1.0)
+    print(f"Listening on port {args.port}")
+
+    next_report = time.monotonic() + args.report
+    try:
+        while True:
+            try:
+                sock, addr = server.accept()
+                threading.Thread(target=handle, args=(sock, addr, args, stats, tls), daemon=True).start()
+            except socket.timeout:
+                pass
+            if time.monotonic() >= next_report:
+                stats.report()
+                next_report += args.report
+    except KeyboardInterrupt:
+        pass
+    stats.report()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Drive a Thermux device's network self-test and report where time goes.
+Measures download and upload throughput against /api/selftest (the device
+checks the uploaded pattern), round-trip time over its TCP echo port, and
+the lwIP and EMAC drop counters that moved during the run, next to the
+buffer profile the firmware was built with.
+Usage: net_selftest.py <host> [--bytes N] [--runs N] [--pings N] [--api-key KEY]
+"""
+import argparse
+import http.client
+import json
+import socket
+import sys
+import time
+
+from pm_benchmark import percentile
+
+PATTERN_PERIOD = 65536
+PATTERN = bytes(((i * 31) ^ (i >> 8)) & 0xFF for i in range(PATTERN_PERIOD))
+
+
+def pattern(length):
+    """The test pattern from offset 0, as net_pattern_fill() makes it"""
+    return (PATTERN * (length // PATTERN_PERIOD + 1))[:length]
+
+
+class Device:
+    def __init__(self, host, api_key, timeout):
+        self.host, _, port = host.partition(':')
+        self.conn = http.client.HTTPConnection(self.host, int(port or 80), timeout=timeout)
+        self.headers = {'X-API-Key': api_key} if api_key else {}
+
+    def request(self, method, path, body=None, content_type='application/json'):
+        headers = dict(self.headers)
+        if body is not None:
+            headers['Content-Type'] = content_type
+        self.conn.request(method, path, body=body, headers=headers)
+        resp = self.conn.getresponse()
+        data = resp.read()
+        if resp.status != 200:
+            raise RuntimeError(f'{method} {path}: HTTP {resp.status} {data[:120].decode(errors="replace")}')
+        return data
+
+    def get_json(self, path):
+        return json.loads(self.request('GET', path))
+
+    def post_json(self, path, payload, content_type='application/json'):
+        return json.loads(self.request('POST', path, payload, content_type))
+
+
+def download(device, size):
+    start = time.perf_counter()
+    data = device.request('GET', f'/api/selftest/download?bytes={size}')
+    elapsed = time.perf_counter() - start
+    errors = sum(1 for a, b in zip(data, pattern(len(data))) if a != b) + abs(size - len(data))
+    return len(data) * 8 / elapsed / 1000.0, errors
+
+
+def upload(device, body):
+    start = time.perf_counter()
+    result = device.post_json('/api/selftest/upload', body, 'application/octet-stream')
+    elapsed = time.perf_counter() - start
+    return len(body) * 8 / elapsed / 1000.0, result
+
+
+def ping(host, port, count, size, timeout):
+    """Round trips of size-byte messages over the echo port, in ms"""
+    payload = bytes(i & 0xFF for i in range(size))
+    rtts = []
+    with socket.create_connection((host, port), timeout=timeout) as sock:
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        for _ in range(count):
+            start = time.perf_counter()
+            sock.sendall(payload)
+            got = b''
+            while len(got) < size:
+                chunk = sock.recv(size - len(got))
+                if not chunk:
+                    raise ConnectionError('echo closed the connection')
+                got += chunk
+            rtts.append((time.perf_counter() - start) * 1000.0)
+            if got != payload:
+                raise RuntimeError('echo returned different bytes')
+            time.sleep(0.02)
+    return rtts
+
+
+def counter_deltas(before, after):
+    """Counters that grew during the run: {'lwip.tcp.drop': 3, ...}"""
+    deltas = {}
+    if before.get('lwip') and after.get('lwip'):
+        for proto, counters in after['lwip'].items():
+            for name in ('drop', 'memerr', 'err'):
+                # lwIP counters are 16-bit and wrap
+                grown = (counters[name] - before['lwip'][proto][name]) % 65536
+                if grown:
+                    deltas[f'lwip.{proto}.{name}'] = grown
+    if before.get('emac') and after.get('emac'):
+        for name, count in after['emac'].items():
+            if name != 'saturated' and count > before['emac'][name]:
+                deltas[f'emac.{name}'] = count - before['emac'][name]
+    return deltas
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('host', help='Device hostname or IP (e.g. thermux.local)')
+    parser.add_argument('--bytes', type=int, default=1024 * 1024, help='Bytes per transfer')
+    parser.add_argument('--runs', type=int, default=3, help='Transfers in each direction')
+    parser.add_argument('--pings', type=int, default=100, help='Echo round trips')
+    parser.add_argument('--ping-size', type=int, default=64, help='Bytes per echo round trip')
+    parser.add_argument('--api-key', help='X-API-Key when authentication is enabled')
+    parser.add_argument('--timeout', type=float, default=30, help='Seconds per request')
+    parser.add_argument('--min-kbps', type=float, default=0,
+                        help='Fail if the slower direction is below this (0 = report only)')
+    args = parser.parse_args()
+
+    device = Device(args.host, args.api_key, args.timeout)
+    before = device.get_json('/api/selftest')
+    buffers = before['buffers']
+    eth, wifi = before['link']['ethernet'], before['link']['wifi']
+    if eth['up']:
+        link = f"Ethernet {eth['speed_mbps']} Mbit/s {'full' if eth['full_duplex'] else 'half'} duplex"
+    elif wifi['up']:
+        link = f"WiFi, RSSI {wifi['rssi']} dBm"
+    else:
+        link = 'no link reported'
+    print(f"Profile {before['profile']}: TCP window {buffers['tcp_wnd']}, send buffer {buffers['tcp_snd_buf']}, "
+          f"mailbox {buffers['tcp_recvmbox']}; {link}")
+
+    failed = False
+    down, up = [], []
+    body = pattern(args.bytes)
+    for _ in range(args.runs):
+        kbps, errors = download(device, args.bytes)
+        down.append(kbps)
+        if errors:
+            print(f"Download: {errors} bytes differ from the pattern")
+            failed = True
+        kbps, result = upload(device, body)
+        up.append(kbps)
+        if result['errors']:
+            print(f"Upload: the device saw {result['errors']} bytes differ from the pattern")
+            failed = True
+
+    print(f"Download {min(down):8.0f} / {max(down):8.0f} kbit/s (worst / best of {args.runs})")
+    print(f"Upload   {min(up):8.0f} / {max(up):8.0f} kbit/s "
+          f"(device measured {result['kbps']} kbit/s on the last run)")
+
+    if args.pings > 0:
+        opened = device.post_json('/api/selftest/echo', json.dumps(
+            {'seconds': max(10, int(args.pings * 0.05) + 10)}).encode())
+        if not opened.get('success'):
+            print(f"Echo: {opened.get('message', 'could not open')}")
+            failed = True
+        else:
+            rtts = ping(device.host, opened['port'], args.pings, args.ping_size, args.timeout)
+            print(f"Echo RTT ({args.ping_size} B): p50 {percentile(rtts, 50):.1f} ms, "
+                  f"p95 {percentile(rtts, 95):.1f} ms, max {max(rtts):.1f} ms")
+
+    after = device.get_json('/api/selftest')
+    deltas = counter_deltas(before, after)
+    if deltas:
+        print('Drops during the test: ' + ', '.join(f'{k} +{v}' for k, v in sorted(deltas.items())))
+    elif after.get('lwip') is None:
+        print('No lwIP counters (build with CONFIG_LWIP_STATS)')
+    else:
+        print('No drops during the test')
+    print(f"Heap: {after['heap']['free_internal']} B internal free, "
+          f"{after['heap']['min_free_internal']} B lowest since boot")
+
+    if args.min_kbps and min(min(down), min(up)) < args.min_kbps:
+        print(f"Slower than {args.min_kbps:.0f} kbit/s")
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Measure HTTP latency and acquisition deadline misses on a Thermux device.
+Run once with power save enabled and once without to compare.
+Usage: pm_benchmark.py <host> [--requests N] [--interval S] [--api-key KEY]
+"""
+import argparse
+import json
+import statistics
+import sys
+import time
+import urllib.request
+
+
+def get_json(base, path, api_key):
+    req = urllib.request.Request(base + path)
+    if api_key:
+        req.add_header('X-API-Key', api_key)
+    with urllib.request.urlopen(req, timeout=10) as resp:
+        return json.loads(resp.read())
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('host', help='Device hostname or IP (e.g. thermux.local)')
+    parser.add_argument('--requests', type=int, default=100, help='Number of timed requests')
+    parser.add_argument('--interval', type=float, default=0.5,
+                        help='Seconds between requests (spaced out so the device idles in between)')
+    parser.add_argument('--api-key', help='X-API-Key when authentication is enabled')
+    parser.add_argument('--max-p95-ms', type=float, default=0,
+                        help='Fail if 95th percentile latency exceeds this (0 = report only)')
+    args = parser.parse_args()
+
+    base = 'http://' + args.host
+    before = get_json(base, '/api/power', args.api_key)
+
+    latencies = []
+    for _ in range(args.requests):
+        start = time.perf_counter()
+        get_json(base, '/api/status', args.api_key)
+        latencies.append((time.perf_counter() - start) * 1000.0)
+        time.sleep(args.interval)
+
+    after = get_json(base, '/api/power', args.api_key)
+
+    missed = after['deadlines']['missed'] - before['deadlines']['missed']
+    checked = after['deadlines']['checked'] - before['deadlines']['checked']
+    span = after['uptime_ms'] - before['uptime_ms']
+    active = after['active_ms'] - before['active_ms']
+
+    print(f"Power save: {'on' if after['enabled'] else 'off'} "
+          f"({after['min_freq_mhz']}-{after['max_freq_mhz']} MHz, "
+          f"light sleep {'on' if after['light_sleep'] else 'off'})")
+    print(f"HTTP latency over {len(latencies)} requests: "
+          f"median {statistics.median(latencies):.1f} ms, "
+          f"p95 {percentile(latencies, 95):.1f} ms, max {max(latencies):.1f} ms")
+    print(f"Active during run: {active} of {span} ms ({active * 100.0 / span:.1f}%)" if span > 0 else
+          "Active during run: n/a")
+    print(f"Deadlines: {missed} missed of {checked} "
+          f"(worst lateness since boot {after['deadlines']['max_lateness_ms']} ms, "
+          f"tolerance {after['deadlines']['tolerance_ms']} ms)")
+
+    failed = missed > 0
+    if args.max_p95_ms > 0 and percentile(latencies, 95) > args.max_p95_ms:
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+"""
+End-to-end performance test of the real firmware image under QEMU.
+Boots build_qemu/ (sdkconfig + sdkconfig.qemu: open_eth networking, simulated
+1-Wire bus) in Espressif's qemu-system-xtensa, stands in for the MQTT broker
+at 10.0.2.2:1883, and measures boot-to-first-publish, /api/sensors latency
+under concurrent clients and publish throughput. Exits non-zero when the
+firmware crashes or a measurement is worse than its stored baseline.
+Usage: qemu_e2e.py [--build] [--clients N] [--requests N] [--duration S]
+                   [--baselines FILE] [--update-baselines]
+"""
+import argparse
+import json
+import os
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+from mqtt_wire_bench import (CONNECT, CONNACK, PUBLISH, PUBACK, PINGREQ, PINGRESP,
+                             DISCONNECT, parse_properties, read_packet)
+from pm_benchmark import percentile
+
+SUBSCRIBE, SUBACK = 8, 9
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BUILD_DIR = os.path.join(ROOT, 'build_qemu')
+FLASH_SIZE = '4MB'
+CRASH_MARKERS = ('Guru Meditation', 'abort() was called', 'ESP_ERROR_CHECK failed',
+                 'Stack canary', 'Task watchdog got triggered')
+
+
+class Broker:
+    """Accepts the device's clients and timestamps every PUBLISH"""
+
+    def __init__(self, port):
+        self.lock = threading.Lock()
+        self.first_state_publish = None
+        self.publishes = []         # (time, size on the wire)
+        self.connects = 0
+        self.server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.server.bind(('', port))
+        self.server.listen(8)
+        threading.Thread(target=self.accept_loop, daemon=True).start()
+
+    def accept_loop(self):
+        while True:
+            sock, _ = self.server.accept()
+            threading.Thread(target=self.handle, args=(sock,), daemon=True).start()
+
+    def count_since(self, start):
+        with self.lock:
+            sizes = [size for t, size in self.publishes if t >= start]
+        return len(sizes), sum(sizes)
+
+    def handle(self, sock):
+        try:
+            ptype, _, body, _ = read_packet(sock)
+            if ptype != CONNECT:
+                return
+            (name_len,) = struct.unpack_from('>H', body, 0)
+            level = body[2 + name_len]
+            with self.lock:
+                self.connects += 1
+            sock.sendall(bytes([CONNACK << 4, 3, 0, 0, 0]) if level == 5
+                         else bytes([CONNACK << 4, 2, 0, 0]))
+
+            while True:
+                ptype, flags, body, size = read_packet(sock)
+                now = time.monotonic()
+                if ptype == PUBLISH:
+                    qos = (flags >> 1) & 3
+                    (topic_len,) = struct.unpack_from('>H', body, 0)
+                    topic = body[2:2 + topic_len].decode(errors='replace')
+                    with self.lock:
+                        self.publishes.append((now, size))
+                        if self.first_state_publish is None and '/sensor/' in topic \
+                                and topic.endswith('/state'):
+                            self.first_state_publish = now
+                    if qos:
+                        (packet_id,) = struct.unpack_from('>H', body, 2 + topic_len)
+                        sock.sendall(bytes([PUBACK << 4, 2]) + struct.pack('>H', packet_id))
+                elif ptype == SUBSCRIBE:
+                    (packet_id,) = struct.unpack_from('>H', body, 0)
+                    pos = 2
+                    if level == 5:
+                        _, pos = parse_properties(body, pos)
+                    granted = []
+                    while pos < len(body):
+                        (filter_len,) = struct.unpack_from('>H', body, pos)
+                        pos += 2 + filter_len
+                        granted.append(min(body[pos] & 3, 1))
+                        pos += 1
+                    payload = struct.pack('>H', packet_id) + (b'\x00' if level == 5 else b'') \
+                        + bytes(granted)
+                    sock.sendall(bytes([SUBACK << 4, len(payload)]) + payload)
+                elif ptype == PINGREQ:
+                    sock.sendall(bytes([PINGRESP << 4, 0]))
+                elif ptype == DISCONNECT:
+                    return
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            sock.close()
+
+
+class Qemu:
+    """Runs the merged flash image and watches the console for crashes"""
+
+    def __init__(self, image, http_port, log_path):
+        cmd = ['qemu-system-xtensa', '-nographic', '-no-reboot', '-machine', 'esp32',
+               '-drive', f'file={image},if=mtd,format=raw',
+               '-nic', f'user,model=open_eth,hostfwd=tcp:127.0.0.1:{http_port}-:80',
+               '-global', 'driver=timer.esp32.timg,property=wdt_disable,value=true']
+        self.started = time.monotonic()
+        self.crash = None
+        self.network_up = None
+        self.log = open(log_path, 'w')
+        self.proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                     stdin=subprocess.DEVNULL)
+        threading.Thread(target=self.watch, daemon=True).start()
+
+    def watch(self):
+        for raw in self.proc.stdout:
+            line = raw.decode(errors='replace')
+            self.log.write(line)
+            if self.network_up is None and 'Network connected' in line:
+                self.network_up = time.monotonic()
+            if self.crash is None and any(marker in line for marker in CRASH_MARKERS):
+                self.crash = line.strip()
+        self.log.flush()
+
+    def check(self):
+        if self.crash:
+            raise RuntimeError(f'firmware crashed: {self.crash}')
+        if self.proc.poll() is not None:
+            raise RuntimeError(f'QEMU exited with status {self.proc.returncode}')
+
+    def stop(self):
+        self.proc.terminate()
+        try:
+            self.proc.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+        self.log.close()
+
+
+def build():
+    subprocess.run(['idf.py', '-B', BUILD_DIR, '-D', f'SDKCONFIG={BUILD_DIR}/sdkconfig',
+                    '-D', 'SDKCONFIG_DEFAULTS=sdkconfig;sdkconfig.qemu', 'build'],
+                   cwd=ROOT, check=True)
+    subprocess.run(['esptool.py', '--chip', 'esp32', 'merge_bin', '--fill-flash-size', FLASH_SIZE,
+                    '-o', 'flash_qemu.bin', '@flash_args'], cwd=BUILD_DIR, check=True)
+
+
+def request(base, path, api_key, data=None):
+    req = urllib.request.Request(base + path, data=data)
+    if api_key:
+        req.add_header('X-API-Key', api_key)
+    if data is not None:
+        req.add_header('Content-Type', 'application/json')
+    with urllib.request.urlopen(req, timeout=10) as resp:
+        return json.loads(resp.read())
+
+
+def wait_for(what, predicate, qemu, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        qemu.check()
+        if predicate():
+            return
+        time.sleep(0.1)
+    raise RuntimeError(f'timed out after {timeout:.0f} s waiting for {what}')
+
+
+def measure_latency(base, api_key, clients, requests):
+    def one(_):
+        start = time.perf_counter()
+        request(base, '/api/sensors', api_key)
+        return (time.perf_counter() - start) * 1000.0
+
+    with ThreadPoolExecutor(max_workers=clients) as pool:
+        return list(pool.map(one, range(requests)))
+
+
+def compare(results, baselines):
+    """Return the metrics that are worse than baseline plus tolerance"""
+    failures = []
+    for name, value in results.items():
+        entry = baselines.get(name)
+        if entry is None:
+            print(f"  {name:<28} {value:10.1f}   (no baseline)")
+            continue
+        slack = entry['value'] * entry.get('tolerance_pct', 0) / 100.0
+        if entry['better'] == 'lower':
+            limit = entry['value'] + slack
+            ok = value <= limit
+        else:
+            limit = entry['value'] - slack
+            ok = value >= limit
+        print(f"  {name:<28} {value:10.1f}   limit {limit:10.1f}   {'ok' if ok else 'FAIL'}")
+        if not ok:
+            failures.append(name)
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--build', action='store_true', help='Build build_qemu/ first (needs idf.py)')
+    parser.add_argument('--image', default=os.path.join(BUILD_DIR, 'flash_qemu.bin'),
+                        help='Merged flash image')
+    parser.add_argument('--http-port', type=int, default=8080, help='Host port forwarded to port 80')
+    parser.add_argument('--mqtt-port', type=int, default=1883,
+                        help='Broker stand-in port (must match the URI in sdkconfig.qemu)')
+    parser.add_argument('--clients', type=int, default=4, help='Concurrent HTTP clients')
+    parser.add_argument('--requests', type=int, default=200, help='Timed /api/sensors requests')
+    parser.add_argument('--duration', type=float, default=30, help='Seconds of publish throughput')
+    parser.add_argument('--boot-timeout', type=float, default=180,
+                        help='Seconds to wait for the first publish')
+    parser.add_argument('--api-key', help='X-API-Key when authentication is enabled')
+    parser.add_argument('--baselines', default=os.path.join(ROOT, 'scripts', 'qemu_baselines.json'))
+    parser.add_argument('--update-baselines', action='store_true',
+                        help='Store this run as the new baselines instead of comparing')
+    args = parser.parse_args()
+
+    if args.build:
+        build()
+    if not os.path.exists(args.image):
+        sys.exit(f"{args.image} not found: run with --build (in an ESP-IDF shell) first")
+
+    broker = Broker(args.mqtt_port)
+    qemu = Qemu(args.image, args.http_port, os.path.join(BUILD_DIR, 'qemu_console.log'))
+    base = f'http://127.0.0.1:{args.http_port}'
+    results = {}
+    try:
+        wait_for('the first sensor publish', lambda: broker.first_state_publish is not None,
+                 qemu, args.boot_timeout)
+        results['boot_to_first_publish_ms'] = (broker.first_state_publish - qemu.started) * 1000.0
+        if qemu.network_up is not None:
+            print(f"Network up {(qemu.network_up - qemu.started):.1f} s after launch")
+
+        def http_up():
+            try:
+                request(base, '/api/status', args.api_key)
+                return True
+            except OSError:
+                return False
+        wait_for('the web server', http_up, qemu, 60)
+
+        latencies = measure_latency(base, args.api_key, args.clients, args.requests)
+        qemu.check()
+        results['sensors_p50_ms'] = percentile(latencies, 50)
+        results['sensors_p95_ms'] = percentile(latencies, 95)
+        results['sensors_max_ms'] = max(latencies)
+
+        # A per-reading fan-out target on top of the Home Assistant client
+        request(base, '/api/mqtt/targets', args.api_key, json.dumps({
+            'index': 0, 'uri': f'mqtt://10.0.2.2:{args.mqtt_port}', 'prefix': 'e2e',
+            'scheme': 'sensor', 'qos': 0}).encode())
+        time.sleep(5)   # Let the target connect
+        start = time.monotonic()
+        time.sleep(args.duration)
+        qemu.check()
+        count, size = broker.count_since(start)
+        results['publishes_per_s'] = count / args.duration
+        results['publish_bytes_per_s'] = size / args.duration
+    except (RuntimeError, OSError) as err:
+        print(f"FAILED: {err} (console log in {qemu.log.name})")
+        qemu.stop()
+        sys.exit(1)
+    qemu.stop()
+
+    print(f"{args.requests} /api/sensors requests from {args.clients} clients, "
+          f"{args.duration:.0f} s of publishing, {broker.connects} MQTT connections")
+
+    try:
+        with open(args.baselines) as f:
+            baselines = json.load(f)
+    except FileNotFoundError:
+        baselines = {}
+
+    if args.update_baselines:
+        for name, value in results.items():
+            entry = baselines.setdefault(name, {'tolerance_pct': 50,
+                                                'better': 'higher' if name.startswith('publish')
+                                                else 'lower'})
+            entry['value'] = round(value, 1)
+        with open(args.baselines, 'w') as f:
+            json.dump(baselines, f, indent=2, sort_keys=True)
+            f.write('\n')
+        print(f"Baselines written to {args.baselines}")
+        return
+
+    failures = compare(results, baselines)
+    if failures:
+        print(f"Worse than baseline: {', '.join(failures)}")
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
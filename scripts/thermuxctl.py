@@ -0,0 +1,554 @@
+#!/usr/bin/env python3
+"""
+Manage a fleet of Thermux devices through their REST API, many at a time.
+Finds devices by mDNS (_thermux._tcp) unless --hosts is given, and runs each
+operation on up to --jobs devices concurrently over one keep-alive connection
+per device.
+Usage: thermuxctl.py [--hosts H1,H2|@FILE] [--api-key KEY] [--jobs N] COMMAND ...
+  discover                          list the devices found
+  status                            version, uptime, sensors and links
+  config-apply FILE [--dry-run]     POST {"sensor": {...}, ...} to /api/config/<section>
+  rename FILE.csv                   set friendly names from address,name rows
+  metrics [--format prom|json]      scrape status and readings
+  ota [--firmware APP.bin]          staggered rollout with health gates
+"""
+import argparse
+import csv
+import hashlib
+import http.client
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+MDNS_GROUP = ('224.0.0.251', 5353)
+SERVICE = '_thermux._tcp.local'
+TYPE_A, TYPE_PTR, TYPE_TXT, TYPE_SRV = 1, 12, 16, 33
+APP_DESC_OFFSET = 32        # Image header (24) + first segment header (8)
+APP_DESC_MAGIC = 0xABCD5432
+
+_print_lock = threading.Lock()
+
+
+def log(*args):
+    with _print_lock:
+        print(*args, flush=True)
+
+
+# ===== Discovery =====
+
+def _encode_name(name):
+    out = b''
+    for label in name.split('.'):
+        out += bytes([len(label)]) + label.encode()
+    return out + b'\x00'
+
+
+def _read_name(data, pos):
+    """Decode a possibly compressed DNS name; return (name, position after it)"""
+    labels = []
+    end = None
+    for _ in range(64):
+        length = data[pos]
+        if length & 0xC0 == 0xC0:
+            if end is None:
+                end = pos + 2
+            pos = ((length & 0x3F) << 8) | data[pos + 1]
+            continue
+        pos += 1
+        if length == 0:
+            break
+        labels.append(data[pos:pos + length].decode(errors='replace'))
+        pos += length
+    return '.'.join(labels), end if end is not None else pos
+
+
+def _parse_response(data):
+    """Return the resource records of an mDNS response as (name, type, rdata offset, rdata)"""
+    _, flags, qdcount, ancount, nscount, arcount = struct.unpack_from('>6H', data, 0)
+    if not flags & 0x8000:
+        return []
+    pos = 12
+    for _ in range(qdcount):
+        _, pos = _read_name(data, pos)
+        pos += 4
+    records = []
+    for _ in range(ancount + nscount + arcount):
+        name, pos = _read_name(data, pos)
+        rtype, _, _, rdlength = struct.unpack_from('>HHIH', data, pos)
+        pos += 10
+        records.append((name, rtype, pos, data[pos:pos + rdlength]))
+        pos += rdlength
+    return records
+
+
+def discover(timeout):
+    """
+    One-shot mDNS query for _thermux._tcp. Devices answer the source port
+    directly (legacy unicast), so no multicast membership is needed.
+    Returns {address: {'host', 'port', 'name', 'version'}}.
+    """
+    query = struct.pack('>6H', 0, 0, 1, 0, 0, 0) + _encode_name(SERVICE) + struct.pack('>HH', TYPE_PTR, 1)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 255)
+    sock.settimeout(0.2)
+    found = {}
+    deadline = time.monotonic() + timeout
+    next_query = 0
+    while time.monotonic() < deadline:
+        if time.monotonic() >= next_query:
+            sock.sendto(query, MDNS_GROUP)
+            next_query = time.monotonic() + 1.0
+        try:
+            data, (ip, _) = sock.recvfrom(9000)
+        except socket.timeout:
+            continue
+        try:
+            records = _parse_response(data)
+        except (struct.error, IndexError):
+            continue
+        node = {'host': ip, 'port': 80, 'name': '', 'version': ''}
+        for _, rtype, offset, rdata in records:
+            if rtype == TYPE_SRV:
+                _, _, node['port'] = struct.unpack_from('>HHH', rdata, 0)
+                node['name'], _ = _read_name(data, offset + 6)
+            elif rtype == TYPE_A and len(rdata) == 4:
+                node['host'] = socket.inet_ntoa(rdata)
+            elif rtype == TYPE_TXT:
+                pos = 0
+                while pos < len(rdata):
+                    item = rdata[pos + 1:pos + 1 + rdata[pos]].decode(errors='replace')
+                    pos += 1 + rdata[pos]
+                    if item.startswith('version='):
+                        node['version'] = item[len('version='):]
+        if any(rtype == TYPE_SRV for _, rtype, _, _ in records):
+            found[f"{node['host']}:{node['port']}"] = node
+    sock.close()
+    return found
+
+
+# ===== REST client =====
+
+class HTTPError(RuntimeError):
+    def __init__(self, message, status):
+        super().__init__(message)
+        self.status = status
+
+
+class Device:
+    """One device, one persistent HTTP/1.1 connection, reopened when dropped"""
+
+    def __init__(self, address, api_key, timeout):
+        host, _, port = address.partition(':')
+        self.address = address
+        self.host = host
+        self.port = int(port or 80)
+        self.api_key = api_key
+        self.timeout = timeout
+        self.conn = None
+
+    def close(self):
+        if self.conn is not None:
+            self.conn.close()
+            self.conn = None
+
+    def request(self, method, path, body=None, content_type='application/json', timeout=None, headers=None):
+        headers = dict(headers or {})
+        if self.api_key:
+            headers['X-API-Key'] = self.api_key
+        if body is not None:
+            headers['Content-Type'] = content_type
+            if isinstance(body, (dict, list)):
+                body = json.dumps(body).encode()
+        for attempt in (0, 1):
+            if self.conn is None:
+                self.conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+            self.conn.timeout = timeout or self.timeout
+            if self.conn.sock is not None:
+                self.conn.sock.settimeout(self.conn.timeout)
+            try:
+                self.conn.request(method, path, body=body, headers=headers)
+                resp = self.conn.getresponse()
+                data = resp.read()
+            except (http.client.RemoteDisconnected, ConnectionResetError, BrokenPipeError):
+                # The server closed an idle keep-alive connection: retry once on a new one
+                self.close()
+                if attempt:
+                    raise
+                continue
+            except (OSError, http.client.HTTPException):
+                self.close()
+                raise
+            if resp.getheader('Connection', '').lower() == 'close':
+                self.close()
+            if resp.status >= 400:
+                raise HTTPError(f'{method} {path}: HTTP {resp.status} {data[:120].decode(errors="replace")}',
+                                resp.status)
+            return json.loads(data) if data else None
+
+    def get(self, path, timeout=None):
+        return self.request('GET', path, timeout=timeout)
+
+    def post(self, path, body=None, **kwargs):
+        return self.request('POST', path, body=body if body is not None else {}, **kwargs)
+
+
+def run_all(devices, jobs, fn):
+    """Run fn(device) on every device, up to jobs at once; return {address: (ok, result)}"""
+    results = {}
+
+    def one(device):
+        try:
+            results[device.address] = (True, fn(device))
+        except (RuntimeError, OSError, ValueError, KeyError, http.client.HTTPException) as err:
+            results[device.address] = (False, str(err) or type(err).__name__)
+            device.close()
+
+    with ThreadPoolExecutor(max_workers=max(1, jobs)) as pool:
+        list(pool.map(one, devices))
+    return results
+
+
+def report_failures(results):
+    failed = {a: r for a, (ok, r) in results.items() if not ok}
+    for address, err in sorted(failed.items()):
+        log(f'{address:<22} FAILED: {err}')
+    return 1 if failed else 0
+
+
+# ===== Commands =====
+
+def cmd_discover(args, devices, found):
+    for address in sorted(found):
+        node = found[address]
+        print(f"{address:<22} {node['name']:<24} {node['version']}")
+    print(f'{len(found)} device(s)')
+    return 0
+
+
+def cmd_status(args, devices, found):
+    results = run_all(devices, args.jobs, lambda d: d.get('/api/status'))
+    print(f"{'device':<22} {'version':<10} {'uptime':>9} {'sensors':>7} {'heap':>7} mqtt eth  wifi")
+    for address in sorted(results):
+        ok, s = results[address]
+        if ok:
+            print(f"{address:<22} {s.get('version', ''):<10} {s.get('uptime_seconds', 0):>8}s "
+                  f"{s.get('sensor_count', 0):>7} {s.get('free_heap', 0):>7} "
+                  f"{'up' if s.get('mqtt_connected') else '-':<4} "
+                  f"{'up' if s.get('ethernet_connected') else '-':<4} "
+                  f"{'up' if s.get('wifi_connected') else '-'}")
+    return report_failures(results)
+
+
+def cmd_config_apply(args, devices, found):
+    with open(args.file) as f:
+        sections = json.load(f)
+    if not isinstance(sections, dict) or not sections:
+        sys.exit(f'{args.file}: expected an object of sections, e.g. {{"sensor": {{...}}}}')
+
+    def apply(device):
+        changed = []
+        for section, wanted in sections.items():
+            path = f'/api/config/{section}'
+            try:
+                current = device.get(path)
+            except RuntimeError:
+                current = None      # Write-only section
+            # Only write what differs: an unchanged MQTT config would still reconnect
+            if isinstance(current, dict) and all(current.get(k) == v for k, v in wanted.items()):
+                continue
+            if not args.dry_run:
+                device.post(path, wanted)
+            changed.append(section)
+        return changed
+
+    results = run_all(devices, args.jobs, apply)
+    for address in sorted(results):
+        ok, changed = results[address]
+        if ok:
+            verb = 'would change' if args.dry_run else 'changed'
+            log(f"{address:<22} {verb + ' ' + ', '.join(changed) if changed else 'up to date'}")
+    return report_failures(results)
+
+
+def cmd_rename(args, devices, found):
+    names = {}
+    with open(args.file, newline='') as f:
+        for row in csv.reader(f):
+            if len(row) < 2 or row[0].strip().lower() in ('', 'address'):
+                continue
+            names[row[0].strip().upper()] = row[1].strip()
+
+    # Sensors are addressed fleet-wide, so first find which device has each one
+    inventory = run_all(devices, args.jobs, lambda d: d.get('/api/sensors'))
+    owners = {}
+    for address, (ok, sensors) in inventory.items():
+        if ok:
+            for sensor in sensors:
+                owners[sensor['address'].upper()] = (address, sensor.get('friendly_name') or '')
+    for sensor in sorted(set(names) - set(owners)):
+        log(f'{sensor} not found on any device')
+
+    def rename(device):
+        done = 0
+        for sensor, name in names.items():
+            owner = owners.get(sensor)
+            if owner is None or owner[0] != device.address or owner[1] == name:
+                continue
+            device.post(f'/api/sensors/{sensor}/name', {'friendly_name': name})
+            done += 1
+        return done
+
+    by_address = {d.address: d for d in devices}
+    targets = [by_address[a] for a in sorted({o[0] for s, o in owners.items() if s in names})]
+    results = run_all(targets, args.jobs, rename)
+    renamed = sum(r for ok, r in results.values() if ok)
+    log(f'{renamed} sensor(s) renamed on {len(targets)} device(s)')
+    return report_failures({**inventory, **results}) or (1 if set(names) - set(owners) else 0)
+
+
+def _prom_labels(**labels):
+    return ','.join(f'{k}="{str(v).replace(chr(92), chr(92) * 2).replace(chr(34), chr(92) + chr(34))}"'
+                    for k, v in labels.items())
+
+
+def cmd_metrics(args, devices, found):
+    results = run_all(devices, args.jobs,
+                      lambda d: {'status': d.get('/api/status'), 'sensors': d.get('/api/sensors')})
+    if args.format == 'json':
+        print(json.dumps({a: r for a, (ok, r) in sorted(results.items()) if ok}, indent=2))
+        return report_failures(results)
+
+    lines = []
+    for address in sorted(results):
+        ok, r = results[address]
+        lines.append(f'thermux_up{{{_prom_labels(device=address)}}} {1 if ok else 0}')
+        if not ok:
+            continue
+        s = r['status']
+        dev = _prom_labels(device=address, version=s.get('version', ''))
+        lines.append(f'thermux_uptime_seconds{{{dev}}} {s.get("uptime_seconds", 0)}')
+        lines.append(f'thermux_free_heap_bytes{{{dev}}} {s.get("free_heap", 0)}')
+        lines.append(f'thermux_mqtt_connected{{{dev}}} {1 if s.get("mqtt_connected") else 0}')
+        bus = s.get('bus_stats', {})
+        lines.append(f'thermux_bus_reads_total{{{dev}}} {bus.get("total_reads", 0)}')
+        lines.append(f'thermux_bus_failed_reads_total{{{dev}}} {bus.get("failed_reads", 0)}')
+        for sensor in r['sensors']:
+            labels = _prom_labels(device=address, address=sensor['address'],
+                                  name=sensor.get('friendly_name') or '')
+            if sensor.get('valid'):
+                lines.append(f'thermux_temperature_celsius{{{labels}}} {sensor["temperature"]}')
+            lines.append(f'thermux_sensor_failed_reads_total{{{labels}}} {sensor.get("failed_reads", 0)}')
+    print('\n'.join(lines))
+    return report_failures(results)
+
+
+def firmware_version(image):
+    """Version string from the app descriptor of an application image"""
+    if len(image) < APP_DESC_OFFSET + 48 or image[0] != 0xE9:
+        raise ValueError('not an ESP32 application image')
+    (magic,) = struct.unpack_from('<I', image, APP_DESC_OFFSET)
+    if magic != APP_DESC_MAGIC:
+        raise ValueError('no application descriptor in the image')
+    return image[APP_DESC_OFFSET + 16:APP_DESC_OFFSET + 48].split(b'\0')[0].decode()
+
+
+def _wait_ota_status(device, key, pending, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        status = device.get('/api/ota/status')
+        if status.get(key) != pending:
+            return status
+        time.sleep(1)
+    raise RuntimeError(f'OTA {key} still pending after {timeout:.0f} s')
+
+
+def _wait_rebooted(device, started, timeout):
+    """Poll until the device answers with an uptime shorter than the time since started"""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        time.sleep(2)
+        try:
+            status = device.get('/api/status', timeout=3)
+        except (OSError, RuntimeError, http.client.HTTPException):
+            device.close()
+            continue
+        if status.get('uptime_seconds', 1 << 30) < time.monotonic() - started:
+            return status
+    raise RuntimeError(f'did not come back within {timeout:.0f} s')
+
+
+def upload_resumable(device, image, chunk_size, retries):
+    """Upload through /api/ota/session, resuming after drops; False if the firmware predates it"""
+    try:
+        session = device.post('/api/ota/session', {'size': len(image), 'sha256': hashlib.sha256(image).hexdigest()})
+    except HTTPError as err:
+        if err.status in (404, 405):
+            return False
+        raise
+    offset, failures, resync = session['offset'], 0, False
+    while offset < len(image):
+        last = min(offset + chunk_size, len(image)) - 1
+        try:
+            if resync:
+                # The device may have kept part of the chunk, or rebooted and gone back a sector
+                state = device.get('/api/ota/session')
+                if state.get('id') != session['id']:
+                    if last == len(image) - 1:
+                        return True     # Lost the reply to the last chunk; the reboot check decides
+                    raise RuntimeError('upload session was discarded by the device')
+                offset, resync = state['offset'], False
+                continue
+            result = device.request('PUT', '/api/ota/session', image[offset:last + 1],
+                                    content_type='application/octet-stream', timeout=60,
+                                    headers={'X-Upload-Session': session['id'],
+                                             'Content-Range': f'bytes {offset}-{last}/{len(image)}'})
+            offset, failures = result['offset'], 0
+        except HTTPError as err:
+            if err.status != 409:
+                raise
+            resync = True
+        except (OSError, http.client.HTTPException) as err:
+            failures += 1
+            if failures > retries:
+                raise RuntimeError(f'upload stopped at {offset}/{len(image)} bytes: {err}')
+            device.close()
+            time.sleep(min(2 ** failures, 30))
+            resync = True
+    return True
+
+
+def ota_one(device, args, image, image_version):
+    before = device.get('/api/status')
+    if image is not None:
+        target = image_version
+        if before.get('version') == target:
+            return f'already at {target}'
+        started = time.monotonic()
+        if not upload_resumable(device, image, args.chunk_kb * 1024, args.retries):
+            device.post('/api/ota/upload', image, content_type='application/octet-stream', timeout=180)
+    else:
+        device.post('/api/ota/check')
+        status = _wait_ota_status(device, 'result', 0, 60)
+        if status.get('result') != 1:
+            raise RuntimeError('update check failed')
+        if not status.get('update_available'):
+            return f"already at {status.get('current_version')}"
+        target = status.get('latest_version')
+        started = time.monotonic()
+        device.post('/api/ota/update')
+    device.close()
+
+    after = _wait_rebooted(device, started, args.boot_timeout)
+    # Health gates: right version, and nothing the device had before has gone missing
+    if after.get('version') != target:
+        raise RuntimeError(f"came back running {after.get('version')}, not {target} (rolled back?)")
+    time.sleep(args.settle)
+    after = device.get('/api/status')
+    if after.get('sensor_count', 0) < before.get('sensor_count', 0):
+        raise RuntimeError(f"sensors {before.get('sensor_count')} -> {after.get('sensor_count')}")
+    if before.get('mqtt_connected') and not after.get('mqtt_connected'):
+        raise RuntimeError('MQTT not reconnected')
+    error_rate = after.get('bus_stats', {}).get('error_rate', 0)
+    if error_rate > args.max_error_rate:
+        raise RuntimeError(f'bus error rate {error_rate:.1f}%')
+    return f"{before.get('version')} -> {target} in {time.monotonic() - started:.0f} s"
+
+
+def cmd_ota(args, devices, found):
+    image = image_version = None
+    if args.firmware:
+        with open(args.firmware, 'rb') as f:
+            image = f.read()
+        try:
+            image_version = firmware_version(image)
+        except ValueError as err:
+            sys.exit(f'{args.firmware}: {err}')
+        log(f'Rolling out {image_version} from {args.firmware}')
+
+    # A canary wave first, then waves of --wave devices; stop once too many fail
+    waves = [devices[:args.canary]]
+    rest = devices[args.canary:]
+    waves += [rest[i:i + args.wave] for i in range(0, len(rest), args.wave)]
+    failures = 0
+    for number, wave in enumerate(w for w in waves if w):
+        log(f"Wave {number + 1}: {', '.join(d.address for d in wave)}")
+        results = run_all(wave, args.jobs, lambda d: ota_one(d, args, image, image_version))
+        for address in sorted(results):
+            ok, message = results[address]
+            log(f"{address:<22} {'ok: ' if ok else 'FAILED: '}{message}")
+            failures += 0 if ok else 1
+        if failures > args.max_failures:
+            log(f'Stopping the rollout after {failures} failure(s)')
+            return 1
+    return 1 if failures else 0
+
+
+def load_hosts(spec):
+    if spec.startswith('@'):
+        with open(spec[1:]) as f:
+            return [line.split('#')[0].strip() for line in f if line.split('#')[0].strip()]
+    return [h.strip() for h in spec.split(',') if h.strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('--hosts', help='Comma-separated host[:port] list, or @FILE with one per line '
+                        '(default: discover by mDNS)')
+    parser.add_argument('--discover-time', type=float, default=3, help='Seconds to listen for mDNS answers')
+    parser.add_argument('--api-key', default=os.environ.get('THERMUX_API_KEY'),
+                        help='X-API-Key (default: $THERMUX_API_KEY)')
+    parser.add_argument('--jobs', type=int, default=16, help='Devices handled concurrently')
+    parser.add_argument('--timeout', type=float, default=10, help='Seconds per HTTP request')
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    sub.add_parser('discover', help='List the devices found')
+    sub.add_parser('status', help='Show version, uptime, sensors and links')
+    p = sub.add_parser('config-apply', help='Apply configuration sections to every device')
+    p.add_argument('file', help='JSON object: section name -> body, e.g. {"sensor": {"read_interval": 5000}}')
+    p.add_argument('--dry-run', action='store_true', help='Only report which devices would change')
+    p = sub.add_parser('rename', help='Set sensor friendly names from a CSV of address,name')
+    p.add_argument('file')
+    p = sub.add_parser('metrics', help='Scrape status and readings')
+    p.add_argument('--format', choices=('prom', 'json'), default='prom')
+    p = sub.add_parser('ota', help='Update firmware in waves, checking each device afterwards')
+    p.add_argument('--firmware', help='Upload this application image instead of the GitHub release')
+    p.add_argument('--chunk-kb', type=int, default=64, help='Upload chunk size; a drop resends at most one')
+    p.add_argument('--retries', type=int, default=5, help='Consecutive failed chunks before giving up on a device')
+    p.add_argument('--canary', type=int, default=1, help='Devices in the first wave')
+    p.add_argument('--wave', type=int, default=5, help='Devices per following wave')
+    p.add_argument('--max-failures', type=int, default=0, help='Failures tolerated before stopping')
+    p.add_argument('--boot-timeout', type=float, default=180, help='Seconds for a device to come back')
+    p.add_argument('--settle', type=float, default=20,
+                   help='Seconds after restart before checking sensors and MQTT')
+    p.add_argument('--max-error-rate', type=float, default=5.0, help='Highest bus error rate (%%) accepted')
+    args = parser.parse_args()
+
+    started = time.monotonic()
+    found = {}
+    if args.hosts:
+        addresses = load_hosts(args.hosts)
+    else:
+        found = discover(args.discover_time)
+        addresses = sorted(found)
+    if not addresses:
+        sys.exit('No devices: none answered on mDNS and no --hosts given')
+
+    devices = [Device(a, args.api_key, args.timeout) for a in addresses]
+    commands = {'discover': cmd_discover, 'status': cmd_status, 'config-apply': cmd_config_apply,
+                'rename': cmd_rename, 'metrics': cmd_metrics, 'ota': cmd_ota}
+    try:
+        status = commands[args.command](args, devices, found)
+    finally:
+        for device in devices:
+            device.close()
+    print(f'{len(devices)} device(s) in {time.monotonic() - started:.1f} s', file=sys.stderr)
+    sys.exit(status)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,166 @@
+/**
+ * @file test_acq_controller.c
+ * @brief Unit tests for the adaptive acquisition controller
+ */
+
+#include "unity.h"
+#include "acq_controller.h"
+#include <math.h>
+
+static acq_config_t enabled_config(void)
+{
+    acq_config_t cfg;
+    acq_config_defaults(&cfg);
+    cfg.enabled = true;
+    return cfg;
+}
+
+/* Feed one reading per sensor at fixed spacing and run a decision */
+static int64_t run_cycles(acq_controller_t *ctrl, int cycles, int64_t t, float *temps,
+                          const float *slopes_per_min)
+{
+    for (int c = 0; c < cycles; c++) {
+        t += ctrl->interval_ms;
+        for (int i = 0; i < ctrl->sensor_count; i++) {
+            temps[i] += slopes_per_min[i] * (float)ctrl->interval_ms / 60000.0f;
+            acq_observe(ctrl, i, true, temps[i], t);
+        }
+        acq_decide(ctrl);
+    }
+    return t;
+}
+
+/* ===== Configuration Tests ===== */
+
+void test_acq_config_validation(void)
+{
+    acq_config_t cfg = enabled_config();
+    TEST_ASSERT_TRUE(acq_config_valid(&cfg));
+
+    cfg.min_resolution = 8;
+    TEST_ASSERT_FALSE(acq_config_valid(&cfg));
+
+    cfg = enabled_config();
+    cfg.min_interval_ms = 30000;
+    cfg.max_interval_ms = 10000;
+    TEST_ASSERT_FALSE(acq_config_valid(&cfg));
+
+    cfg = enabled_config();
+    cfg.active_rate = cfg.quiet_rate;
+    TEST_ASSERT_FALSE(acq_config_valid(&cfg));
+}
+
+void test_acq_resolution_step(void)
+{
+    TEST_ASSERT_TRUE(fabsf(acq_resolution_step(9) - 0.5f) < 1e-6f);
+    TEST_ASSERT_TRUE(fabsf(acq_resolution_step(12) - 0.0625f) < 1e-6f);
+}
+
+/* ===== Control Tests ===== */
+
+void test_acq_starts_fast_and_precise(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[2];
+    acq_controller_t ctrl;
+
+    acq_init(&ctrl, &cfg, states, 2);
+    TEST_ASSERT_EQUAL_INT(ACQ_DEFAULT_MIN_INTERVAL_MS, (int)ctrl.interval_ms);
+    TEST_ASSERT_EQUAL_INT(12, ctrl.resolution);
+}
+
+void test_acq_quiet_signals_relax(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[2];
+    acq_controller_t ctrl;
+    float temps[2] = {20.0f, 21.0f};
+    const float slopes[2] = {0.0f, 0.0f};
+
+    acq_init(&ctrl, &cfg, states, 2);
+    run_cycles(&ctrl, 60, 0, temps, slopes);
+
+    TEST_ASSERT_EQUAL_INT(ACQ_DEFAULT_MAX_INTERVAL_MS, (int)ctrl.interval_ms);
+    TEST_ASSERT_EQUAL_INT(9, ctrl.resolution);
+}
+
+void test_acq_relaxes_gradually(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[1];
+    acq_controller_t ctrl;
+    float temps[1] = {20.0f};
+    const float slopes[1] = {0.0f};
+
+    acq_init(&ctrl, &cfg, states, 1);
+    /* A few quiet cycles are not enough to slow down */
+    run_cycles(&ctrl, ACQ_RELAX_CYCLES - 1, 0, temps, slopes);
+    TEST_ASSERT_EQUAL_INT(ACQ_DEFAULT_MIN_INTERVAL_MS, (int)ctrl.interval_ms);
+    TEST_ASSERT_EQUAL_INT(12, ctrl.resolution);
+}
+
+void test_acq_one_active_sensor_speeds_up_bus(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[3];
+    acq_controller_t ctrl;
+    float temps[3] = {20.0f, 21.0f, 22.0f};
+    float slopes[3] = {0.0f, 0.0f, 0.0f};
+
+    acq_init(&ctrl, &cfg, states, 3);
+    int64_t t = run_cycles(&ctrl, 60, 0, temps, slopes);
+    TEST_ASSERT_EQUAL_INT(ACQ_DEFAULT_MAX_INTERVAL_MS, (int)ctrl.interval_ms);
+
+    /* One probe starts heating at 3 °C/min */
+    slopes[1] = 3.0f;
+    run_cycles(&ctrl, 3, t, temps, slopes);
+    TEST_ASSERT_LESS_THAN(10000, (int)ctrl.interval_ms);
+    TEST_ASSERT_EQUAL_INT(12, ctrl.resolution);
+}
+
+void test_acq_noise_caps_resolution(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[1];
+    acq_controller_t ctrl;
+
+    acq_init(&ctrl, &cfg, states, 1);
+    ctrl.resolution = 9;
+    /* Fast-moving but noisy signal: +-1 °C jitter on a steep ramp */
+    int64_t t = 0;
+    float base = 20.0f;
+    for (int c = 0; c < 30; c++) {
+        t += 2000;
+        base += 0.2f;
+        acq_observe(&ctrl, 0, true, base + ((c & 1) ? 1.0f : -1.0f), t);
+        acq_decide(&ctrl);
+    }
+    TEST_ASSERT_LESS_THAN(12, ctrl.resolution);
+}
+
+void test_acq_bus_statistics(void)
+{
+    acq_config_t cfg = enabled_config();
+    acq_sensor_state_t states[4];
+    acq_controller_t ctrl;
+
+    acq_init(&ctrl, &cfg, states, 4);
+    acq_record_cycle(&ctrl, 1000, 10000, 4);
+    TEST_ASSERT_TRUE(fabsf(ctrl.utilization - 0.1f) < 1e-4f);
+    TEST_ASSERT_TRUE(fabsf(ctrl.sample_rate - 0.4f) < 1e-4f);
+
+    acq_record_cycle(&ctrl, 1000, 10000, 4);
+    TEST_ASSERT_TRUE(fabsf(ctrl.utilization - 0.1f) < 1e-4f);
+}
+
+void run_acq_tests(void)
+{
+    RUN_TEST(test_acq_config_validation);
+    RUN_TEST(test_acq_resolution_step);
+    RUN_TEST(test_acq_starts_fast_and_precise);
+    RUN_TEST(test_acq_quiet_signals_relax);
+    RUN_TEST(test_acq_relaxes_gradually);
+    RUN_TEST(test_acq_one_active_sensor_speeds_up_bus);
+    RUN_TEST(test_acq_noise_caps_resolution);
+    RUN_TEST(test_acq_bus_statistics);
+}
@@ -0,0 +1,155 @@
+/**
+ * @file test_alert_rules.c
+ * @brief Unit tests for alert rule compilation and evaluation
+ */
+
+#include "unity.h"
+#include "alert_rules.h"
+#include <string.h>
+
+static alert_rule_config_t make_config(void)
+{
+    alert_rule_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    return cfg;
+}
+
+/* ===== Compile Tests ===== */
+
+void test_alert_compile_empty(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+
+    TEST_ASSERT_TRUE(alert_rule_compile(&cfg, &rule));
+    TEST_ASSERT_EQUAL_INT(0, rule.enabled);
+}
+
+void test_alert_compile_rejects_invalid(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+
+    cfg.hysteresis = -1.0f;
+    TEST_ASSERT_FALSE(alert_rule_compile(&cfg, &rule));
+
+    /* Low band overlaps high threshold */
+    cfg = make_config();
+    cfg.high_enabled = true;
+    cfg.high = 30.0f;
+    cfg.low_enabled = true;
+    cfg.low = 29.0f;
+    cfg.hysteresis = 2.0f;
+    TEST_ASSERT_FALSE(alert_rule_compile(&cfg, &rule));
+
+    TEST_ASSERT_FALSE(alert_rule_compile(NULL, &rule));
+}
+
+/* ===== Threshold Tests ===== */
+
+void test_alert_high_with_hysteresis(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+    uint8_t raised, cleared;
+
+    cfg.high_enabled = true;
+    cfg.high = 30.0f;
+    cfg.hysteresis = 1.0f;
+    alert_rule_compile(&cfg, &rule);
+    alert_rule_reset(&rule, 0);
+
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 29.0f, 1000, &raised, &cleared));
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 30.5f, 2000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_HIGH, raised);
+
+    /* Inside the hysteresis band: stays active */
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 29.5f, 3000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_HIGH, rule.active);
+
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 29.0f, 4000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_HIGH, cleared);
+    TEST_ASSERT_EQUAL_INT(0, rule.active);
+}
+
+void test_alert_low_with_hysteresis(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+    uint8_t raised, cleared;
+
+    cfg.low_enabled = true;
+    cfg.low = 5.0f;
+    cfg.hysteresis = 0.5f;
+    alert_rule_compile(&cfg, &rule);
+    alert_rule_reset(&rule, 0);
+
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 4.0f, 1000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_LOW, raised);
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 5.25f, 2000, &raised, &cleared));
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 5.5f, 3000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_LOW, cleared);
+}
+
+/* ===== Rate Tests ===== */
+
+void test_alert_rate_of_change(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+    uint8_t raised, cleared;
+
+    cfg.max_rate = 2.0f;    /* °C per minute */
+    alert_rule_compile(&cfg, &rule);
+    alert_rule_reset(&rule, 0);
+
+    /* First reading has nothing to compare against */
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 20.0f, 0, &raised, &cleared));
+    /* 1°C in 60 s is within limit */
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 21.0f, 60000, &raised, &cleared));
+    /* 1°C in 10 s = 6°C/min */
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 22.0f, 70000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_RATE, raised);
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 22.0f, 80000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_RATE, cleared);
+}
+
+/* ===== Stale Tests ===== */
+
+void test_alert_stale_sensor(void)
+{
+    alert_rule_config_t cfg = make_config();
+    alert_rule_t rule;
+    uint8_t raised, cleared;
+
+    cfg.stale_ms = 10000;
+    alert_rule_compile(&cfg, &rule);
+    alert_rule_reset(&rule, 0);
+
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, true, 20.0f, 1000, &raised, &cleared));
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, false, 0.0f, 5000, &raised, &cleared));
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, false, 0.0f, 12000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_STALE, raised);
+    /* Stays raised without repeating the transition */
+    TEST_ASSERT_FALSE(alert_rule_eval(&rule, false, 0.0f, 20000, &raised, &cleared));
+    TEST_ASSERT_TRUE(alert_rule_eval(&rule, true, 20.0f, 21000, &raised, &cleared));
+    TEST_ASSERT_EQUAL_INT(ALERT_STALE, cleared);
+}
+
+void test_alert_type_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("high", alert_type_name(ALERT_HIGH));
+    TEST_ASSERT_EQUAL_STRING("stale", alert_type_name(ALERT_STALE));
+    TEST_ASSERT_EQUAL_STRING("unknown", alert_type_name(0));
+}
+
+void run_alert_tests(void)
+{
+    RUN_TEST(test_alert_compile_empty);
+    RUN_TEST(test_alert_compile_rejects_invalid);
+    RUN_TEST(test_alert_high_with_hysteresis);
+    RUN_TEST(test_alert_low_with_hysteresis);
+    RUN_TEST(test_alert_rate_of_change);
+    RUN_TEST(test_alert_stale_sensor);
+    RUN_TEST(test_alert_type_names);
+}
@@ -0,0 +1,199 @@
+/**
+ * @file test_auth_utils.c
+ * @brief Unit tests for session table and auth helpers
+ */
+
+#include "unity.h"
+#include "auth_utils.h"
+#include <string.h>
+
+static void make_token(uint8_t *token, uint32_t seed)
+{
+    for (int i = 0; i < AUTH_TOKEN_LEN; i++) {
+        seed = seed * 1103515245u + 12345u;
+        token[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+/* ===== Constant-time Compare Tests ===== */
+
+void test_auth_ct_equal(void)
+{
+    uint8_t a[4] = {1, 2, 3, 4};
+    uint8_t b[4] = {1, 2, 3, 4};
+    uint8_t c[4] = {1, 2, 3, 5};
+
+    TEST_ASSERT_TRUE(auth_ct_equal(a, b, sizeof(a)));
+    TEST_ASSERT_FALSE(auth_ct_equal(a, c, sizeof(a)));
+}
+
+void test_auth_ct_str_equal(void)
+{
+    TEST_ASSERT_TRUE(auth_ct_str_equal("secret", 6, "secret"));
+    TEST_ASSERT_FALSE(auth_ct_str_equal("secreT", 6, "secret"));
+    TEST_ASSERT_FALSE(auth_ct_str_equal("secret1", 7, "secret"));
+    TEST_ASSERT_FALSE(auth_ct_str_equal("secre", 5, "secret"));
+    TEST_ASSERT_FALSE(auth_ct_str_equal("", 0, "secret"));
+    TEST_ASSERT_FALSE(auth_ct_str_equal(NULL, 0, "secret"));
+}
+
+/* ===== Hex Conversion Tests ===== */
+
+void test_auth_hex_roundtrip(void)
+{
+    uint8_t token[AUTH_TOKEN_LEN];
+    uint8_t parsed[AUTH_TOKEN_LEN];
+    char hex[AUTH_TOKEN_HEX_LEN + 1];
+
+    make_token(token, 42);
+    auth_bytes_to_hex(token, sizeof(token), hex);
+
+    TEST_ASSERT_EQUAL_INT(AUTH_TOKEN_HEX_LEN, (int)strlen(hex));
+    TEST_ASSERT_TRUE(auth_hex_to_bytes(hex, strlen(hex), parsed, sizeof(parsed)));
+    TEST_ASSERT_TRUE(memcmp(token, parsed, sizeof(token)) == 0);
+}
+
+void test_auth_hex_invalid(void)
+{
+    uint8_t out[2];
+
+    TEST_ASSERT_FALSE(auth_hex_to_bytes("abc", 3, out, sizeof(out)));
+    TEST_ASSERT_FALSE(auth_hex_to_bytes("zz00", 4, out, sizeof(out)));
+    TEST_ASSERT_TRUE(auth_hex_to_bytes("aBcD", 4, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_INT(0xAB, out[0]);
+    TEST_ASSERT_EQUAL_INT(0xCD, out[1]);
+}
+
+/* ===== Cookie Parsing Tests ===== */
+
+void test_auth_cookie_find(void)
+{
+    const char *value;
+    size_t len;
+
+    TEST_ASSERT_TRUE(auth_cookie_find("session=abc123", "session", &value, &len));
+    TEST_ASSERT_EQUAL_INT(6, (int)len);
+    TEST_ASSERT_TRUE(strncmp(value, "abc123", len) == 0);
+
+    TEST_ASSERT_TRUE(auth_cookie_find("theme=dark; session=ff00; lang=en", "session", &value, &len));
+    TEST_ASSERT_EQUAL_INT(4, (int)len);
+    TEST_ASSERT_TRUE(strncmp(value, "ff00", len) == 0);
+}
+
+void test_auth_cookie_not_found(void)
+{
+    const char *value;
+    size_t len;
+
+    TEST_ASSERT_FALSE(auth_cookie_find("theme=dark", "session", &value, &len));
+    /* Name must match a whole cookie name, not a suffix */
+    TEST_ASSERT_FALSE(auth_cookie_find("oldsession=abc", "session", &value, &len));
+    TEST_ASSERT_FALSE(auth_cookie_find(NULL, "session", &value, &len));
+}
+
+/* ===== Session Table Tests ===== */
+
+void test_auth_sessions_add_check_remove(void)
+{
+    auth_session_table_t table;
+    uint8_t token[AUTH_TOKEN_LEN];
+    uint8_t other[AUTH_TOKEN_LEN];
+
+    auth_sessions_init(&table);
+    make_token(token, 1);
+    make_token(other, 2);
+
+    TEST_ASSERT_FALSE(auth_sessions_add(&table, token, 1000, 0));
+    TEST_ASSERT_TRUE(auth_sessions_check(&table, token, 500));
+    TEST_ASSERT_FALSE(auth_sessions_check(&table, other, 500));
+
+    TEST_ASSERT_TRUE(auth_sessions_remove(&table, token));
+    TEST_ASSERT_FALSE(auth_sessions_check(&table, token, 500));
+    TEST_ASSERT_EQUAL_INT(0, table.count);
+}
+
+void test_auth_sessions_expiry(void)
+{
+    auth_session_table_t table;
+    uint8_t token[AUTH_TOKEN_LEN];
+
+    auth_sessions_init(&table);
+    make_token(token, 7);
+
+    auth_sessions_add(&table, token, 1000, 0);
+    TEST_ASSERT_FALSE(auth_sessions_check(&table, token, 1001));
+    TEST_ASSERT_EQUAL_INT(0, table.count);
+}
+
+void test_auth_sessions_many_without_eviction(void)
+{
+    auth_session_table_t table;
+    uint8_t token[AUTH_TOKEN_LEN];
+
+    auth_sessions_init(&table);
+    for (uint32_t i = 0; i < AUTH_MAX_SESSIONS; i++) {
+        make_token(token, i + 100);
+        TEST_ASSERT_FALSE(auth_sessions_add(&table, token, 10000 + i, 0));
+    }
+
+    /* Every session is still valid - no login churn */
+    for (uint32_t i = 0; i < AUTH_MAX_SESSIONS; i++) {
+        make_token(token, i + 100);
+        TEST_ASSERT_TRUE(auth_sessions_check(&table, token, 1));
+    }
+}
+
+void test_auth_sessions_full_evicts_oldest(void)
+{
+    auth_session_table_t table;
+    uint8_t token[AUTH_TOKEN_LEN];
+
+    auth_sessions_init(&table);
+    for (uint32_t i = 0; i < AUTH_MAX_SESSIONS; i++) {
+        make_token(token, i + 100);
+        auth_sessions_add(&table, token, 10000 + i, 0);
+    }
+
+    make_token(token, 999);
+    TEST_ASSERT_TRUE(auth_sessions_add(&table, token, 20000, 0));
+    TEST_ASSERT_EQUAL_INT(AUTH_MAX_SESSIONS, table.count);
+
+    /* Session with the earliest expiry was evicted, the newest is present */
+    make_token(token, 100);
+    TEST_ASSERT_FALSE(auth_sessions_check(&table, token, 1));
+    make_token(token, 999);
+    TEST_ASSERT_TRUE(auth_sessions_check(&table, token, 1));
+}
+
+void test_auth_sessions_full_purges_expired_first(void)
+{
+    auth_session_table_t table;
+    uint8_t token[AUTH_TOKEN_LEN];
+
+    auth_sessions_init(&table);
+    for (uint32_t i = 0; i < AUTH_MAX_SESSIONS; i++) {
+        make_token(token, i + 100);
+        /* First session expires early, the rest much later */
+        auth_sessions_add(&table, token, i == 0 ? 50 : 10000, 0);
+    }
+
+    make_token(token, 999);
+    TEST_ASSERT_FALSE(auth_sessions_add(&table, token, 20000, 100));
+    make_token(token, 101);
+    TEST_ASSERT_TRUE(auth_sessions_check(&table, token, 100));
+}
+
+void run_auth_tests(void)
+{
+    RUN_TEST(test_auth_ct_equal);
+    RUN_TEST(test_auth_ct_str_equal);
+    RUN_TEST(test_auth_hex_roundtrip);
+    RUN_TEST(test_auth_hex_invalid);
+    RUN_TEST(test_auth_cookie_find);
+    RUN_TEST(test_auth_cookie_not_found);
+    RUN_TEST(test_auth_sessions_add_check_remove);
+    RUN_TEST(test_auth_sessions_expiry);
+    RUN_TEST(test_auth_sessions_many_without_eviction);
+    RUN_TEST(test_auth_sessions_full_evicts_oldest);
+    RUN_TEST(test_auth_sessions_full_purges_expired_first);
+}
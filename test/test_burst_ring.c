@@ -0,0 +1,149 @@
+/**
+ * @file test_burst_ring.c
+ * @brief Unit tests for the burst capture ring
+ */
+
+#include "unity.h"
+#include "burst_ring.h"
+#include <string.h>
+
+#define CAP 16
+
+static burst_record_t s_records[CAP];
+
+static burst_config_t config(uint32_t max_samples, uint32_t duration_ms)
+{
+    burst_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.max_samples = max_samples;
+    cfg.duration_ms = duration_ms;
+    return cfg;
+}
+
+/* ===== Stop Condition Tests ===== */
+
+void test_burst_stops_when_full(void)
+{
+    burst_ring_t r;
+    burst_config_t cfg = config(4, 0);
+
+    burst_ring_init(&r, s_records, CAP);
+    TEST_ASSERT_TRUE(burst_ring_start(&r, &cfg, 1000000));
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(burst_ring_add(&r, 1000000 + i * 100000, 0, true, 20.0f));
+    }
+    TEST_ASSERT_FALSE(burst_ring_add(&r, 1300000, 0, true, 20.0f));
+    TEST_ASSERT_EQUAL_INT(BURST_DONE, r.state);
+    TEST_ASSERT_EQUAL_INT(BURST_STOP_SIZE, r.reason);
+    TEST_ASSERT_FALSE(burst_ring_add(&r, 1400000, 0, true, 20.0f));
+    TEST_ASSERT_EQUAL_INT(4, r.count);
+}
+
+void test_burst_stops_on_time(void)
+{
+    burst_ring_t r;
+    burst_config_t cfg = config(0, 500);
+
+    burst_ring_init(&r, s_records, CAP);
+    burst_ring_start(&r, &cfg, 0);
+    TEST_ASSERT_TRUE(burst_ring_check_time(&r, 499999));
+    TEST_ASSERT_FALSE(burst_ring_check_time(&r, 500000));
+    TEST_ASSERT_EQUAL_INT(BURST_STOP_TIME, r.reason);
+    TEST_ASSERT_EQUAL_STRING("time", burst_stop_name(r.reason));
+}
+
+void test_burst_trigger_keeps_history(void)
+{
+    burst_ring_t r;
+    burst_config_t cfg = config(8, 0);
+    burst_record_t out[CAP];
+
+    cfg.trigger_enabled = true;
+    cfg.trigger_sensor = 1;
+    cfg.trigger_above = true;
+    cfg.trigger_level = 30.0f;
+    cfg.post_samples = 3;
+
+    burst_ring_init(&r, s_records, CAP);
+    TEST_ASSERT_TRUE(burst_ring_start(&r, &cfg, 0));
+
+    /* Twenty quiet samples wrap the 8-sample window without stopping */
+    int64_t t = 0;
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_TRUE(burst_ring_add(&r, t += 100000, i % 2, true, 20.0f));
+    }
+    /* Wrong sensor over the level does not fire */
+    TEST_ASSERT_TRUE(burst_ring_add(&r, t += 100000, 0, true, 35.0f));
+    /* Trigger, then three more samples */
+    TEST_ASSERT_TRUE(burst_ring_add(&r, t += 100000, 1, true, 31.0f));
+    TEST_ASSERT_TRUE(r.triggered);
+    TEST_ASSERT_TRUE(burst_ring_add(&r, t += 100000, 0, true, 20.0f));
+    TEST_ASSERT_TRUE(burst_ring_add(&r, t += 100000, 1, true, 32.0f));
+    TEST_ASSERT_FALSE(burst_ring_add(&r, t += 100000, 0, true, 20.0f));
+    TEST_ASSERT_EQUAL_INT(BURST_STOP_TRIGGER, r.reason);
+
+    /* Window holds the last 8 samples in order, trigger 4th from the end */
+    TEST_ASSERT_EQUAL_INT(8, burst_ring_read(&r, 0, out, CAP));
+    for (int i = 1; i < 8; i++) {
+        TEST_ASSERT_TRUE(out[i].t_us > out[i - 1].t_us);
+    }
+    TEST_ASSERT_EQUAL_INT(31 * 16, out[4].temp_16);
+    TEST_ASSERT_EQUAL_INT(r.total, 25);
+}
+
+/* ===== Record Tests ===== */
+
+void test_burst_record_encoding(void)
+{
+    burst_ring_t r;
+    burst_config_t cfg = config(0, 0);
+    burst_record_t out[2];
+
+    TEST_ASSERT_EQUAL_INT(8, sizeof(burst_record_t));
+
+    burst_ring_init(&r, s_records, CAP);
+    burst_ring_start(&r, &cfg, 5000000);
+    burst_ring_add(&r, 5000250, 3, true, -10.0625f);
+    burst_ring_add(&r, 5100000, 2, false, 85.0f);
+
+    TEST_ASSERT_EQUAL_INT(2, burst_ring_read(&r, 0, out, 2));
+    TEST_ASSERT_EQUAL_INT(250, out[0].t_us);
+    TEST_ASSERT_EQUAL_INT(3, out[0].sensor);
+    TEST_ASSERT_EQUAL_INT(BURST_FLAG_VALID, out[0].flags);
+    TEST_ASSERT_EQUAL_INT(-161, out[0].temp_16);
+    TEST_ASSERT_EQUAL_INT(0, out[1].flags);
+
+    /* Chunked reads continue where the last one stopped */
+    TEST_ASSERT_EQUAL_INT(1, burst_ring_read(&r, 1, out, 2));
+    TEST_ASSERT_EQUAL_INT(100000, out[0].t_us);
+    TEST_ASSERT_EQUAL_INT(0, burst_ring_read(&r, 2, out, 2));
+}
+
+void test_burst_config_validation(void)
+{
+    burst_ring_t r;
+    burst_config_t cfg = config(CAP, 1000);
+
+    burst_ring_init(&r, s_records, CAP);
+    TEST_ASSERT_TRUE(burst_config_valid(&r, &cfg));
+    cfg.max_samples = CAP + 1;
+    TEST_ASSERT_FALSE(burst_config_valid(&r, &cfg));
+    cfg.max_samples = 0;
+    cfg.duration_ms = BURST_MAX_DURATION_MS + 1;
+    TEST_ASSERT_FALSE(burst_config_valid(&r, &cfg));
+    cfg.duration_ms = 0;
+    cfg.trigger_enabled = true;
+    cfg.post_samples = CAP;
+    TEST_ASSERT_FALSE(burst_config_valid(&r, &cfg));
+    cfg.post_samples = CAP - 1;
+    TEST_ASSERT_TRUE(burst_config_valid(&r, &cfg));
+}
+
+void run_burst_ring_tests(void)
+{
+    RUN_TEST(test_burst_stops_when_full);
+    RUN_TEST(test_burst_stops_on_time);
+    RUN_TEST(test_burst_trigger_keeps_history);
+    RUN_TEST(test_burst_record_encoding);
+    RUN_TEST(test_burst_config_validation);
+}
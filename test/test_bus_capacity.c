@@ -0,0 +1,127 @@
+/**
+ * @file test_bus_capacity.c
+ * @brief Unit tests for the bus timing model
+ */
+
+#include "unity.h"
+#include "bus_capacity.h"
+#include <math.h>
+
+static bus_capacity_input_t input(int sensors, uint8_t bits, uint32_t interval_ms)
+{
+    bus_capacity_input_t in = {
+        .sensor_count = sensors,
+        .bus_resolution = bits,
+        .default_interval_ms = interval_ms,
+        .overhead_us = 2000,
+        .scratchpad_us = 10000,
+        .retry_rate = 0.0f,
+    };
+    return in;
+}
+
+static bool near(float a, float b, float tol)
+{
+    return fabsf(a - b) <= tol;
+}
+
+/* ===== Cycle Model Tests ===== */
+
+void test_bus_capacity_cycle_time(void)
+{
+    bus_capacity_input_t in = input(10, 12, 10000);
+    bus_capacity_t out;
+
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(800, out.conversion_ms);
+    /* 2 ms overhead + 800 ms conversion + 10 x 10 ms scratchpads */
+    TEST_ASSERT(near(out.cycle_ms, 902.0f, 0.01f));
+    TEST_ASSERT_EQUAL_INT(902, out.min_interval_ms);
+    TEST_ASSERT_EQUAL_INT(902, out.min_default_interval_ms);
+    TEST_ASSERT(near(out.utilization, 0.0902f, 0.0001f));
+    TEST_ASSERT_EQUAL_INT(BUS_CAPACITY_OK, out.verdict);
+}
+
+void test_bus_capacity_overload(void)
+{
+    /* 100 sensors at 12 bits cannot be read every second */
+    bus_capacity_input_t in = input(100, 12, 1000);
+    bus_capacity_t out;
+
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(1802, out.min_interval_ms);
+    TEST_ASSERT_EQUAL_INT(BUS_CAPACITY_OVERLOAD, out.verdict);
+    TEST_ASSERT_EQUAL_STRING("overload", bus_capacity_verdict_name(out.verdict));
+
+    /* At 9 bits the cycle fits, but with little headroom */
+    in.bus_resolution = 9;
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(1102, out.min_interval_ms);
+    in.sensor_count = 85;
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(BUS_CAPACITY_WARN, out.verdict);
+}
+
+void test_bus_capacity_retry_budget(void)
+{
+    bus_capacity_input_t in = input(20, 9, 5000);
+    bus_capacity_t out;
+
+    in.retry_rate = 0.5f;
+    bus_capacity_compute(&in, &out);
+    /* 2 + 100 + 20 x 15 ms */
+    TEST_ASSERT_EQUAL_INT(402, out.min_interval_ms);
+}
+
+/* ===== Mixed Configuration Tests ===== */
+
+void test_bus_capacity_per_sensor_resolution(void)
+{
+    uint8_t bits[3] = {9, 11, 9};
+    bus_capacity_input_t in = input(3, 9, 10000);
+    bus_capacity_t out;
+
+    in.resolution = bits;
+    bus_capacity_compute(&in, &out);
+    /* All sensors convert together, so the slowest one sets the wait */
+    TEST_ASSERT_EQUAL_INT(400, out.conversion_ms);
+}
+
+void test_bus_capacity_per_sensor_intervals(void)
+{
+    uint32_t intervals[4] = {0, 0, 1000, 1000};
+    bus_capacity_input_t in = input(4, 9, 10000);
+    bus_capacity_t out;
+
+    in.interval_ms = intervals;
+    bus_capacity_compute(&in, &out);
+    /* Two groups: one conversion per second plus one per ten seconds */
+    TEST_ASSERT(near(out.conversions_per_s, 1.1f, 0.0001f));
+    TEST_ASSERT(near(out.reads_per_s, 2.2f, 0.0001f));
+    /* 1.1 x 102 ms + 2.2 x 10 ms */
+    TEST_ASSERT(near(out.utilization, 0.1342f, 0.0001f));
+    /* The fast pair uses 122 ms/s; the other two need 122 ms per interval */
+    TEST_ASSERT_EQUAL_INT(139, out.min_default_interval_ms);
+
+    /* Fast sensors alone can saturate the bus whatever the default */
+    uint32_t fast[4] = {0, 0, 100, 200};
+    in.interval_ms = fast;
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(BUS_CAPACITY_OVERLOAD, out.verdict);
+    TEST_ASSERT(out.min_default_interval_ms == UINT32_MAX);
+
+    /* With no sensor following it, any default will do */
+    uint32_t own[4] = {1000, 1000, 1000, 1000};
+    in.interval_ms = own;
+    bus_capacity_compute(&in, &out);
+    TEST_ASSERT_EQUAL_INT(0, out.min_default_interval_ms);
+}
+
+void run_bus_capacity_tests(void)
+{
+    RUN_TEST(test_bus_capacity_cycle_time);
+    RUN_TEST(test_bus_capacity_overload);
+    RUN_TEST(test_bus_capacity_retry_budget);
+    RUN_TEST(test_bus_capacity_per_sensor_resolution);
+    RUN_TEST(test_bus_capacity_per_sensor_intervals);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file test_bus_queue.c
+ * @brief Unit tests for the bus command priority queue
+ */
+
+#include "unity.h"
+#include "bus_queue.h"
+#include <string.h>
+
+/* ===== Ordering Tests ===== */
+
+void test_bus_queue_empty(void)
+{
+    bus_queue_t q;
+    bus_queue_entry_t e;
+
+    bus_queue_init(&q);
+    TEST_ASSERT_EQUAL_INT(0, bus_queue_count(&q));
+    TEST_ASSERT_FALSE(bus_queue_pop(&q, &e));
+}
+
+void test_bus_queue_priority_order(void)
+{
+    bus_queue_t q;
+    bus_queue_entry_t e;
+    int a, b, c;
+
+    bus_queue_init(&q);
+    bus_queue_push(&q, BUS_CMD_RESCAN, &a);
+    bus_queue_push(&q, BUS_CMD_CYCLE, &b);
+    bus_queue_push(&q, BUS_CMD_READ, &c);
+
+    TEST_ASSERT_TRUE(bus_queue_pop(&q, &e));
+    TEST_ASSERT_EQUAL_INT(BUS_CMD_READ, e.type);
+    TEST_ASSERT(e.ctx == &c);
+    TEST_ASSERT_TRUE(bus_queue_pop(&q, &e));
+    TEST_ASSERT_EQUAL_INT(BUS_CMD_CYCLE, e.type);
+    TEST_ASSERT_TRUE(bus_queue_pop(&q, &e));
+    TEST_ASSERT_EQUAL_INT(BUS_CMD_RESCAN, e.type);
+    TEST_ASSERT_FALSE(bus_queue_pop(&q, &e));
+}
+
+void test_bus_queue_fifo_within_priority(void)
+{
+    bus_queue_t q;
+    bus_queue_entry_t e;
+    int ctx[4];
+
+    bus_queue_init(&q);
+    for (int i = 0; i < 4; i++) {
+        bus_queue_push(&q, BUS_CMD_READ, &ctx[i]);
+    }
+    /* Removal reorders the array; order must still follow submission */
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(bus_queue_pop(&q, &e));
+        TEST_ASSERT(e.ctx == &ctx[i]);
+    }
+}
+
+void test_bus_queue_full(void)
+{
+    bus_queue_t q;
+
+    bus_queue_init(&q);
+    for (int i = 0; i < BUS_QUEUE_CAPACITY; i++) {
+        TEST_ASSERT_TRUE(bus_queue_push(&q, BUS_CMD_CYCLE, NULL));
+    }
+    TEST_ASSERT_FALSE(bus_queue_push(&q, BUS_CMD_READ, NULL));
+    TEST_ASSERT_FALSE(bus_queue_push(&q, BUS_CMD_COUNT, NULL));
+    TEST_ASSERT_EQUAL_INT(BUS_QUEUE_CAPACITY, bus_queue_count(&q));
+}
+
+/* ===== Preemption Tests ===== */
+
+void test_bus_queue_preempting_only_more_urgent(void)
+{
+    bus_queue_t q;
+    bus_queue_entry_t e;
+
+    bus_queue_init(&q);
+    bus_queue_push(&q, BUS_CMD_RESCAN, NULL);
+    bus_queue_push(&q, BUS_CMD_ALARM_SEARCH, NULL);
+
+    /* Nothing more urgent than an alarm search is waiting */
+    TEST_ASSERT_FALSE(bus_queue_pop_preempting(&q, BUS_CMD_ALARM_SEARCH, &e));
+
+    bus_queue_push(&q, BUS_CMD_READ, NULL);
+    TEST_ASSERT_TRUE(bus_queue_pop_preempting(&q, BUS_CMD_RESCAN, &e));
+    TEST_ASSERT_EQUAL_INT(BUS_CMD_READ, e.type);
+    TEST_ASSERT_TRUE(bus_queue_pop_preempting(&q, BUS_CMD_RESCAN, &e));
+    TEST_ASSERT_EQUAL_INT(BUS_CMD_ALARM_SEARCH, e.type);
+    /* Equal priority does not preempt */
+    TEST_ASSERT_FALSE(bus_queue_pop_preempting(&q, BUS_CMD_RESCAN, &e));
+    TEST_ASSERT_EQUAL_INT(1, bus_queue_count(&q));
+}
+
+void test_bus_cmd_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("read", bus_cmd_name(BUS_CMD_READ));
+    TEST_ASSERT_EQUAL_STRING("rescan", bus_cmd_name(BUS_CMD_RESCAN));
+    TEST_ASSERT_EQUAL_STRING("recover", bus_cmd_name(BUS_CMD_RECOVER));
+    TEST_ASSERT_EQUAL_STRING("unknown", bus_cmd_name(BUS_CMD_COUNT));
+}
+
+void run_bus_queue_tests(void)
+{
+    RUN_TEST(test_bus_queue_empty);
+    RUN_TEST(test_bus_queue_priority_order);
+    RUN_TEST(test_bus_queue_fifo_within_priority);
+    RUN_TEST(test_bus_queue_full);
+    RUN_TEST(test_bus_queue_preempting_only_more_urgent);
+    RUN_TEST(test_bus_cmd_names);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file test_bus_sched.c
+ * @brief Unit tests for the per-sensor read scheduler
+ */
+
+#include "unity.h"
+#include "bus_sched.h"
+
+#define N 4
+
+/* Run one cycle: select, then complete everything selected */
+static int run_cycle(bus_sched_t *s, int64_t now, uint32_t window, bool *selected)
+{
+    int n = bus_sched_select(s, now, window, N, selected);
+    for (int i = 0; i < s->count; i++) {
+        if (selected[i]) {
+            bus_sched_complete(s, i, now);
+        }
+    }
+    return n;
+}
+
+/* ===== Selection Tests ===== */
+
+void test_bus_sched_all_due_at_start(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, N, 10000);
+    TEST_ASSERT_EQUAL_INT(N, run_cycle(&s, 1000, 800, selected));
+    /* Same default interval: everyone comes due together again */
+    TEST_ASSERT_EQUAL_INT(10000, bus_sched_delay_ms(&s, 1000));
+    TEST_ASSERT_EQUAL_INT(0, run_cycle(&s, 5000, 800, selected));
+    TEST_ASSERT_EQUAL_INT(N, run_cycle(&s, 11000, 800, selected));
+}
+
+void test_bus_sched_mixed_intervals(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, N, 60000);
+    bus_sched_set_interval(&s, 0, 2000);
+    run_cycle(&s, 1000, 800, selected);
+
+    /* Only the critical probe is read between ambient cycles */
+    int64_t t = 1000;
+    int critical_reads = 0;
+    while (t < 61000) {
+        t += bus_sched_delay_ms(&s, t);
+        if (t >= 61000) {
+            break;
+        }
+        TEST_ASSERT_EQUAL_INT(1, run_cycle(&s, t, 800, selected));
+        TEST_ASSERT_TRUE(selected[0]);
+        critical_reads++;
+    }
+    TEST_ASSERT_EQUAL_INT(29, critical_reads);
+    TEST_ASSERT_EQUAL_INT(2000, (int)entries[0].achieved_ms);
+
+    /* At the ambient deadline everything shares one conversion */
+    TEST_ASSERT_EQUAL_INT(N, run_cycle(&s, 61000, 800, selected));
+}
+
+void test_bus_sched_pulls_in_within_window(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, 2, 10000);
+    entries[0].due_ms = 1000;
+    entries[1].due_ms = 1500;
+
+    /* Sensor 1 would need its own conversion 500 ms later otherwise */
+    TEST_ASSERT_EQUAL_INT(2, bus_sched_select(&s, 1000, 800, N, selected));
+    TEST_ASSERT_EQUAL_INT(1, bus_sched_select(&s, 1000, 100, N, selected));
+    TEST_ASSERT_TRUE(selected[0]);
+    TEST_ASSERT_FALSE(selected[1]);
+}
+
+void test_bus_sched_batch_is_earliest_deadline_first(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, N, 10000);
+    entries[0].due_ms = 900;
+    entries[1].due_ms = 100;
+    entries[2].due_ms = 500;
+    entries[3].due_ms = 300;
+
+    TEST_ASSERT_EQUAL_INT(2, bus_sched_select(&s, 1000, 0, 2, selected));
+    TEST_ASSERT_TRUE(selected[1]);
+    TEST_ASSERT_TRUE(selected[3]);
+    TEST_ASSERT_FALSE(selected[0]);
+    TEST_ASSERT_FALSE(selected[2]);
+}
+
+/* ===== Deadline Tests ===== */
+
+void test_bus_sched_late_restarts_grid(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, 1, 2000);
+    run_cycle(&s, 1000, 0, selected);
+    TEST_ASSERT_EQUAL_INT(0, entries[0].late);
+
+    /* Bus was busy for three intervals: one late read, no catch-up burst */
+    run_cycle(&s, 9000, 0, selected);
+    TEST_ASSERT_EQUAL_INT(1, entries[0].late);
+    TEST_ASSERT_EQUAL_INT(2000, bus_sched_delay_ms(&s, 9000));
+
+    /* A few ms of jitter is not late */
+    run_cycle(&s, 11050, 0, selected);
+    TEST_ASSERT_EQUAL_INT(1, entries[0].late);
+}
+
+void test_bus_sched_interval_changes(void)
+{
+    bus_sched_entry_t entries[N];
+    bus_sched_t s;
+    bool selected[N];
+
+    bus_sched_init(&s, entries, 2, 30000);
+    bus_sched_set_interval(&s, 1, 5000);
+    run_cycle(&s, 1000, 0, selected);
+    TEST_ASSERT_EQUAL_INT(5000, bus_sched_delay_ms(&s, 1000));
+
+    /* Shortening the default moves only the sensors that follow it */
+    bus_sched_set_default_interval(&s, 3000);
+    TEST_ASSERT_EQUAL_INT(4000, entries[0].due_ms);
+    TEST_ASSERT_EQUAL_INT(6000, entries[1].due_ms);
+
+    /* Clearing an override falls back to the default */
+    bus_sched_set_interval(&s, 1, 0);
+    TEST_ASSERT_EQUAL_INT(3000, bus_sched_target(&s, 1));
+    TEST_ASSERT_EQUAL_INT(4000, entries[1].due_ms);
+}
+
+void test_bus_sched_interval_validation(void)
+{
+    TEST_ASSERT_TRUE(bus_sched_interval_valid(0));
+    TEST_ASSERT_TRUE(bus_sched_interval_valid(BUS_SCHED_MIN_INTERVAL_MS));
+    TEST_ASSERT_TRUE(bus_sched_interval_valid(BUS_SCHED_MAX_INTERVAL_MS));
+    TEST_ASSERT_FALSE(bus_sched_interval_valid(BUS_SCHED_MIN_INTERVAL_MS - 1));
+    TEST_ASSERT_FALSE(bus_sched_interval_valid(BUS_SCHED_MAX_INTERVAL_MS + 1));
+}
+
+void run_bus_sched_tests(void)
+{
+    RUN_TEST(test_bus_sched_all_due_at_start);
+    RUN_TEST(test_bus_sched_mixed_intervals);
+    RUN_TEST(test_bus_sched_pulls_in_within_window);
+    RUN_TEST(test_bus_sched_batch_is_earliest_deadline_first);
+    RUN_TEST(test_bus_sched_late_restarts_grid);
+    RUN_TEST(test_bus_sched_interval_changes);
+    RUN_TEST(test_bus_sched_interval_validation);
+}
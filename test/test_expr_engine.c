@@ -0,0 +1,171 @@
+/**
+ * @file test_expr_engine.c
+ * @brief Unit tests for the virtual sensor expression compiler and evaluator
+ */
+
+#include "unity.h"
+#include "expr_engine.h"
+#include <string.h>
+#include <math.h>
+
+/* Sensors "a" to "d" (or "Supply"/"Return") map to inputs 0-3 */
+static int resolve(const char *name, size_t len, void *ctx)
+{
+    (void)ctx;
+    if (len == 6 && strncmp(name, "Supply", len) == 0) {
+        return 0;
+    }
+    if (len == 6 && strncmp(name, "Return", len) == 0) {
+        return 1;
+    }
+    if (len == 1 && name[0] >= 'a' && name[0] <= 'd') {
+        return name[0] - 'a';
+    }
+    return -1;
+}
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) <= 0.0001f;
+}
+
+static float run(const char *src, const float *values)
+{
+    expr_program_t prog;
+    /* Not NaN, so a compile failure fails the caller's assert either way */
+    if (!expr_compile(src, resolve, NULL, &prog, NULL)) {
+        return -999.0f;
+    }
+    return expr_eval(&prog, values, 4);
+}
+
+/* ===== Arithmetic Tests ===== */
+
+void test_expr_arithmetic(void)
+{
+    const float v[] = { 40.0f, 30.0f, 2.0f, 4.0f };
+
+    TEST_ASSERT(near(run("{Supply} - {Return}", v), 10.0f));
+    TEST_ASSERT(near(run("{a} - {b} * 2", v), -20.0f));
+    TEST_ASSERT(near(run("({a} - {b}) * 2", v), 20.0f));
+    TEST_ASSERT(near(run("-{c} + 10 / {d}", v), 0.5f));
+    TEST_ASSERT(near(run("1.5e1 - -{c}", v), 17.0f));
+    TEST_ASSERT(near(run("abs({b} - {a})", v), 10.0f));
+    TEST_ASSERT(isnan(run("{a} / ({c} - 2)", v)));
+}
+
+void test_expr_aggregates_skip_invalid(void)
+{
+    float v[] = { 20.0f, NAN, 24.0f, 19.0f };
+
+    TEST_ASSERT(near(run("avg({a}, {b}, {c})", v), 22.0f));
+    TEST_ASSERT(near(run("min({a}, {b}, {c}, {d})", v), 19.0f));
+    TEST_ASSERT(near(run("max({a}, {b}, {c}, {d})", v), 24.0f));
+    /* Arithmetic on an invalid reading is invalid */
+    TEST_ASSERT(isnan(run("{a} - {b}", v)));
+    v[0] = NAN;
+    v[2] = NAN;
+    v[3] = NAN;
+    TEST_ASSERT(isnan(run("avg({a}, {b}, {c}, {d})", v)));
+}
+
+void test_expr_deadband(void)
+{
+    expr_program_t prog;
+    float v[] = { 20.0f, 0, 0, 0 };
+
+    TEST_ASSERT(expr_compile("deadband({a}, 0.5)", resolve, NULL, &prog, NULL));
+    TEST_ASSERT(near(expr_eval(&prog, v, 4), 20.0f));
+    v[0] = 20.4f;
+    TEST_ASSERT(near(expr_eval(&prog, v, 4), 20.0f));
+    v[0] = 20.6f;
+    TEST_ASSERT(near(expr_eval(&prog, v, 4), 20.6f));
+    v[0] = 20.2f;
+    TEST_ASSERT(near(expr_eval(&prog, v, 4), 20.6f));
+
+    expr_reset_state(&prog);
+    TEST_ASSERT(near(expr_eval(&prog, v, 4), 20.2f));
+}
+
+/* ===== Compiler Tests ===== */
+
+void test_expr_inputs_and_constants(void)
+{
+    expr_program_t prog;
+
+    TEST_ASSERT(expr_compile("({b} + {a} + {b}) / 2 + 2", resolve, NULL, &prog, NULL));
+    TEST_ASSERT_EQUAL_INT(2, prog.input_count);
+    TEST_ASSERT_EQUAL_INT(1, prog.inputs[0]);
+    TEST_ASSERT_EQUAL_INT(0, prog.inputs[1]);
+    TEST_ASSERT_EQUAL_INT(1, prog.const_count);
+
+    /* Inputs past the value array read as invalid */
+    const float v[] = { 1.0f };
+    TEST_ASSERT(isnan(expr_eval(&prog, v, 1)));
+}
+
+void test_expr_errors(void)
+{
+    expr_program_t prog;
+    expr_error_t err;
+
+    TEST_ASSERT_FALSE(expr_compile("{a} + {x}", resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Unknown sensor", err.msg);
+    TEST_ASSERT_EQUAL_INT(7, err.pos);
+
+    TEST_ASSERT_FALSE(expr_compile("{a} +", resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Unexpected end of expression", err.msg);
+
+    TEST_ASSERT_FALSE(expr_compile("median({a})", resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Unknown function", err.msg);
+    TEST_ASSERT_EQUAL_INT(0, err.pos);
+
+    TEST_ASSERT_FALSE(expr_compile("deadband({a})", resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Wrong number of arguments", err.msg);
+
+    TEST_ASSERT_FALSE(expr_compile("({a} + 1", resolve, NULL, &prog, &err));
+    TEST_ASSERT_FALSE(expr_compile("{a} {b}", resolve, NULL, &prog, &err));
+    TEST_ASSERT_FALSE(expr_compile("", resolve, NULL, &prog, &err));
+
+    /* Each parenthesis level keeps a value on the stack */
+    TEST_ASSERT_FALSE(expr_compile("1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+(1+1))))))))))))))))",
+                                   resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Expression nested too deeply", err.msg);
+
+    /* Parentheses and unary minus stack nothing but still recurse */
+    char src[EXPR_MAX_SOURCE];
+    memset(src, '(', 100);
+    src[100] = '1';
+    memset(src + 101, ')', 26);
+    src[127] = '\0';
+    TEST_ASSERT_FALSE(expr_compile(src, resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Expression nested too deeply", err.msg);
+
+    memset(src, '-', 100);
+    strcpy(src + 100, "1");
+    TEST_ASSERT_FALSE(expr_compile(src, resolve, NULL, &prog, &err));
+    TEST_ASSERT_EQUAL_STRING("Expression nested too deeply", err.msg);
+
+    /* Within the bound both still compile */
+    TEST_ASSERT_TRUE(expr_compile("((((((((1))))))))", resolve, NULL, &prog, &err));
+    TEST_ASSERT_TRUE(expr_compile("--------{a}", resolve, NULL, &prog, &err));
+}
+
+void test_expr_id_valid(void)
+{
+    TEST_ASSERT(expr_id_valid("hx_delta_1"));
+    TEST_ASSERT_FALSE(expr_id_valid(""));
+    TEST_ASSERT_FALSE(expr_id_valid("HX"));
+    TEST_ASSERT_FALSE(expr_id_valid("a/b"));
+    TEST_ASSERT_FALSE(expr_id_valid("abcdefghijklmnopqrstuvwxyz"));
+}
+
+void run_expr_engine_tests(void)
+{
+    RUN_TEST(test_expr_arithmetic);
+    RUN_TEST(test_expr_aggregates_skip_invalid);
+    RUN_TEST(test_expr_deadband);
+    RUN_TEST(test_expr_inputs_and_constants);
+    RUN_TEST(test_expr_errors);
+    RUN_TEST(test_expr_id_valid);
+}
@@ -0,0 +1,174 @@
+/**
+ * @file test_fanout_queue.c
+ * @brief Unit tests for per-cycle payloads shared across broker targets
+ */
+
+#include "unity.h"
+#include "fanout_queue.h"
+#include <string.h>
+
+static fanout_batch_t *make_batch(uint32_t seq, int64_t time_ms)
+{
+    fanout_input_t in[2] = {
+        { .id = "28FF641E8516035C", .value = 21.5f, .valid = true },
+        { .id = "v_delta", .value = 0.0f, .valid = false },
+    };
+    return fanout_batch_create(seq, time_ms, 0, in, 2);
+}
+
+/* ===== Batch Tests ===== */
+
+void test_fanout_batch_serialized_once(void)
+{
+    fanout_batch_t *b = make_batch(7, 1000);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_STRING("{\"seq\":7,\"readings\":{\"28FF641E8516035C\":21.50,\"v_delta\":null}}", b->json);
+    TEST_ASSERT_EQUAL_INT((int)strlen(b->json), (int)b->json_len);
+    TEST_ASSERT_EQUAL_INT(2, b->count);
+    TEST_ASSERT_EQUAL_STRING("21.50", b->readings[0].value);
+    TEST_ASSERT_EQUAL_STRING("", b->readings[1].value);
+    fanout_batch_release(b);
+
+    /* With a synced clock the batch carries the sample time */
+    fanout_input_t in = { .id = "28FF641E8516035C", .value = 21.5f, .valid = true };
+    b = fanout_batch_create(8, 1000, 1767225600000LL, &in, 1);
+    TEST_ASSERT_EQUAL_STRING("{\"seq\":8,\"time\":1767225600000,\"readings\":{\"28FF641E8516035C\":21.50}}", b->json);
+    TEST_ASSERT_EQUAL_INT((int)strlen(b->json), (int)b->json_len);
+    fanout_batch_release(b);
+}
+
+void test_fanout_batch_id_fits(void)
+{
+    /* "v_" plus the longest virtual sensor id fits */
+    char id[FANOUT_ID_LEN];
+    memset(id, 'a', sizeof(id) - 1);
+    id[0] = 'v';
+    id[1] = '_';
+    id[sizeof(id) - 1] = '\0';
+    TEST_ASSERT_EQUAL_INT(EXPR_ID_LEN - 1 + 2, (int)strlen(id));
+
+    char too_long[FANOUT_ID_LEN + 1];
+    memset(too_long, 'b', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+
+    fanout_input_t in[3] = {
+        { .id = too_long, .value = 1.0f, .valid = true },
+        { .id = id, .value = 2.0f, .valid = true },
+        { .id = "28FF641E8516035C", .value = 3.0f, .valid = true },
+    };
+    fanout_batch_t *b = fanout_batch_create(1, 0, 0, in, 3);
+    TEST_ASSERT_NOT_NULL(b);
+
+    /* A truncated id would publish under the wrong name, so it is left out */
+    TEST_ASSERT_EQUAL_INT(2, b->count);
+    TEST_ASSERT_EQUAL_STRING(id, b->readings[0].id);
+    TEST_ASSERT_EQUAL_STRING("28FF641E8516035C", b->readings[1].id);
+    TEST_ASSERT_NULL(strstr(b->json, "bbb"));
+    TEST_ASSERT_EQUAL_INT((int)strlen(b->json), (int)b->json_len);
+    fanout_batch_release(b);
+}
+
+void test_fanout_batch_shared_by_reference(void)
+{
+    fanout_queue_t q[3];
+    fanout_batch_t *b = make_batch(1, 0);
+    for (int i = 0; i < 3; i++) {
+        fanout_queue_init(&q[i], 4096);
+        fanout_queue_push(&q[i], b);
+        TEST_ASSERT_TRUE(fanout_queue_peek(&q[i]) == b);
+    }
+    fanout_batch_release(b);
+    TEST_ASSERT_EQUAL_INT(3, b->refs);
+
+    fanout_queue_pop(&q[0]);
+    fanout_queue_pop(&q[1]);
+    TEST_ASSERT_EQUAL_INT(1, b->refs);
+    TEST_ASSERT_NULL(fanout_queue_peek(&q[0]));
+    fanout_queue_clear(&q[2]);
+    TEST_ASSERT_EQUAL_INT(0, q[2].count);
+    TEST_ASSERT_EQUAL_INT(0, (int)q[2].bytes);
+}
+
+/* ===== Budget Tests ===== */
+
+void test_fanout_queue_budget_drops_oldest(void)
+{
+    fanout_queue_t q;
+    fanout_batch_t *b = make_batch(1, 0);
+    fanout_queue_init(&q, 2 * fanout_batch_size(b));
+
+    TEST_ASSERT_EQUAL_INT(0, fanout_queue_push(&q, b));
+    fanout_batch_release(b);
+    for (uint32_t seq = 2; seq <= 3; seq++) {
+        b = make_batch(seq, 0);
+        fanout_queue_push(&q, b);
+        fanout_batch_release(b);
+    }
+    TEST_ASSERT_EQUAL_INT(2, q.count);
+    TEST_ASSERT_EQUAL_INT(1, (int)q.dropped);
+    TEST_ASSERT_EQUAL_INT(2, (int)fanout_queue_peek(&q)->seq);
+
+    /* A batch larger than the whole budget still goes in, alone */
+    q.budget = 1;
+    b = make_batch(4, 0);
+    TEST_ASSERT_EQUAL_INT(2, fanout_queue_push(&q, b));
+    fanout_batch_release(b);
+    TEST_ASSERT_EQUAL_INT(1, q.count);
+    TEST_ASSERT_EQUAL_INT(4, (int)fanout_queue_peek(&q)->seq);
+    fanout_queue_clear(&q);
+}
+
+void test_fanout_queue_length_cap(void)
+{
+    fanout_queue_t q;
+    fanout_queue_init(&q, 1 << 20);
+    for (uint32_t seq = 1; seq <= FANOUT_QUEUE_LEN + 3; seq++) {
+        fanout_batch_t *b = make_batch(seq, 0);
+        fanout_queue_push(&q, b);
+        fanout_batch_release(b);
+    }
+    TEST_ASSERT_EQUAL_INT(FANOUT_QUEUE_LEN, q.count);
+    TEST_ASSERT_EQUAL_INT(3, (int)q.dropped);
+    TEST_ASSERT_EQUAL_INT(4, (int)fanout_queue_peek(&q)->seq);
+    fanout_queue_clear(&q);
+}
+
+/* ===== Isolation Tests ===== */
+
+void test_fanout_slow_target_isolated(void)
+{
+    /* One target drains every cycle, the other's broker is unreachable */
+    fanout_queue_t fast, slow;
+    fanout_batch_t *b = make_batch(10, 0);
+    size_t budget = 4 * fanout_batch_size(b);
+    fanout_batch_release(b);
+    fanout_queue_init(&fast, budget);
+    fanout_queue_init(&slow, budget);
+
+    for (uint32_t seq = 1; seq <= 10; seq++) {
+        b = make_batch(seq, seq * 1000);
+        fanout_queue_push(&fast, b);
+        fanout_queue_push(&slow, b);
+        fanout_batch_release(b);
+        fanout_queue_pop(&fast);
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, fast.count);
+    TEST_ASSERT_EQUAL_INT(0, (int)fast.dropped);
+    TEST_ASSERT_EQUAL_INT(0, (int)fanout_queue_lag_ms(&fast, 10000));
+
+    TEST_ASSERT_EQUAL_INT(4, slow.count);
+    TEST_ASSERT_EQUAL_INT(6, (int)slow.dropped);
+    TEST_ASSERT_EQUAL_INT(3000, (int)fanout_queue_lag_ms(&slow, 10000));
+    fanout_queue_clear(&slow);
+}
+
+void run_fanout_queue_tests(void)
+{
+    RUN_TEST(test_fanout_batch_serialized_once);
+    RUN_TEST(test_fanout_batch_id_fits);
+    RUN_TEST(test_fanout_batch_shared_by_reference);
+    RUN_TEST(test_fanout_queue_budget_drops_oldest);
+    RUN_TEST(test_fanout_queue_length_cap);
+    RUN_TEST(test_fanout_slow_target_isolated);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file test_health_window.c
+ * @brief Unit tests for windowed error rates and fault localization
+ */
+
+#include "unity.h"
+#include "health_window.h"
+#include <math.h>
+
+#define MIN_MS  60000LL
+#define HOUR_MS 3600000LL
+
+/* ===== Window Tests ===== */
+
+void test_health_window_spans(void)
+{
+    health_window_t w;
+    health_counts_t c;
+
+    health_window_init(&w);
+    health_window_add(&w, 0, 10, 1);
+    health_window_add(&w, 30000, 10, 0);
+
+    health_window_counts(&w, 30000, &c);
+    TEST_ASSERT_EQUAL_INT(20, c.reads[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(1, c.failed[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(20, c.reads[HEALTH_SPAN_1H]);
+    TEST_ASSERT_EQUAL_INT(20, c.reads[HEALTH_SPAN_24H]);
+
+    /* Two minutes on the first minute has left the short window only */
+    health_window_counts(&w, 2 * MIN_MS, &c);
+    TEST_ASSERT_EQUAL_INT(0, c.reads[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(20, c.reads[HEALTH_SPAN_1H]);
+    TEST_ASSERT_EQUAL_INT(1, c.failed[HEALTH_SPAN_1H]);
+}
+
+void test_health_window_expiry(void)
+{
+    health_window_t w;
+    health_counts_t c;
+
+    health_window_init(&w);
+    health_window_add(&w, 0, 100, 50);
+
+    /* A new add after a long gap clears the stale buckets */
+    health_window_add(&w, 2 * HOUR_MS, 10, 0);
+    health_window_counts(&w, 2 * HOUR_MS, &c);
+    TEST_ASSERT_EQUAL_INT(10, c.reads[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(10, c.reads[HEALTH_SPAN_1H]);
+    TEST_ASSERT_EQUAL_INT(0, c.failed[HEALTH_SPAN_1H]);
+    TEST_ASSERT_EQUAL_INT(110, c.reads[HEALTH_SPAN_24H]);
+    TEST_ASSERT_EQUAL_INT(50, c.failed[HEALTH_SPAN_24H]);
+
+    /* Without adds the window still ages out */
+    health_window_counts(&w, 30 * HOUR_MS, &c);
+    TEST_ASSERT_EQUAL_INT(0, c.reads[HEALTH_SPAN_24H]);
+}
+
+void test_health_window_rolling_minute(void)
+{
+    health_window_t w;
+    health_counts_t c;
+
+    health_window_init(&w);
+    /* One read every second for three minutes, every tenth one failing */
+    for (int t = 0; t < 180; t++) {
+        health_window_add(&w, t * 1000LL, 1, t % 10 == 0 ? 1 : 0);
+    }
+    health_window_counts(&w, 179000, &c);
+    TEST_ASSERT_EQUAL_INT(60, c.reads[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(6, c.failed[HEALTH_SPAN_1M]);
+    TEST_ASSERT_EQUAL_INT(180, c.reads[HEALTH_SPAN_1H]);
+    TEST_ASSERT(fabsf(health_error_percent(c.reads[HEALTH_SPAN_1M], c.failed[HEALTH_SPAN_1M]) - 10.0f) < 0.01f);
+    TEST_ASSERT(health_error_percent(0, 0) == 0.0f);
+}
+
+/* ===== Localization Tests ===== */
+
+void test_health_localize_segment(void)
+{
+    /* Search order differs from cable order; positions 4 and 5 fail */
+    health_sensor_input_t s[] = {
+        { 100, 40, 5 }, { 100, 0, 1 }, { 100, 1, 3 }, { 100, 30, 4 }, { 100, 0, 2 },
+    };
+    health_fault_t f;
+
+    health_localize(s, 5, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_SEGMENT, f.kind);
+    TEST_ASSERT_EQUAL_INT(3, f.sensor);
+    TEST_ASSERT_EQUAL_INT(2, f.upstream);
+    TEST_ASSERT_EQUAL_INT(2, f.failing);
+    TEST_ASSERT_EQUAL_INT(5, f.considered);
+
+    /* A healthy sensor behind a failing one breaks the pattern */
+    s[0].failed = 0;
+    s[4].failed = 20;
+    health_localize(s, 5, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_SCATTERED, f.kind);
+
+    /* Without positions a tail cannot be told apart from scatter */
+    s[4].failed = 0;
+    s[0].failed = 40;
+    s[1].position = 0;
+    health_localize(s, 5, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_SCATTERED, f.kind);
+}
+
+void test_health_localize_sensor_and_bus(void)
+{
+    health_sensor_input_t s[] = {
+        { 100, 0, 0 }, { 100, 50, 0 }, { 5, 5, 0 },
+    };
+    health_fault_t f;
+
+    /* The third sensor has too few reads to count */
+    health_localize(s, 3, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_SENSOR, f.kind);
+    TEST_ASSERT_EQUAL_INT(1, f.sensor);
+    TEST_ASSERT_EQUAL_INT(2, f.considered);
+
+    s[0].failed = 10;
+    health_localize(s, 3, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_BUS, f.kind);
+
+    s[0].failed = 0;
+    s[1].failed = 0;
+    health_localize(s, 3, 5.0f, &f);
+    TEST_ASSERT_EQUAL_INT(HEALTH_FAULT_NONE, f.kind);
+    TEST_ASSERT_EQUAL_INT(-1, f.sensor);
+    TEST_ASSERT_EQUAL_STRING("none", health_fault_name(f.kind));
+}
+
+void run_health_window_tests(void)
+{
+    RUN_TEST(test_health_window_spans);
+    RUN_TEST(test_health_window_expiry);
+    RUN_TEST(test_health_window_rolling_minute);
+    RUN_TEST(test_health_localize_segment);
+    RUN_TEST(test_health_localize_sensor_and_bus);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file test_mqtt_payload.c
+ * @brief Unit tests for Home Assistant topic and payload builders
+ */
+
+#include "unity.h"
+#include "mqtt_payload.h"
+#include <string.h>
+
+static const mqtt_node_t s_node = {
+    .discovery_prefix = "homeassistant",
+    .base_topic = "thermux",
+    .sw_version = "1.2.3",
+};
+
+/* ===== Topic Tests ===== */
+
+void test_mqtt_payload_topics(void)
+{
+    char buf[MQTT_DISCOVERY_TOPIC_LEN];
+
+    TEST_ASSERT_EQUAL_INT(37, mqtt_state_topic(buf, sizeof(buf), &s_node, "28FF641E8516035C", "state"));
+    TEST_ASSERT_EQUAL_STRING("thermux/sensor/28FF641E8516035C/state", buf);
+    mqtt_state_topic(buf, sizeof(buf), &s_node, "28FF641E8516035C", "forecast");
+    TEST_ASSERT_EQUAL_STRING("thermux/sensor/28FF641E8516035C/forecast", buf);
+
+    mqtt_status_topic(buf, sizeof(buf), &s_node);
+    TEST_ASSERT_EQUAL_STRING("thermux/status", buf);
+
+    mqtt_discovery_topic(buf, sizeof(buf), &s_node, "28FF641E8516035C", NULL);
+    TEST_ASSERT_EQUAL_STRING("homeassistant/sensor/thermux_28FF641E8516035C/config", buf);
+    mqtt_discovery_topic(buf, sizeof(buf), &s_node, "28FF641E8516035C", "trend");
+    TEST_ASSERT_EQUAL_STRING("homeassistant/sensor/thermux_28FF641E8516035C_trend/config", buf);
+
+    /* Truncation is an error, not a shorter topic */
+    TEST_ASSERT_EQUAL_INT(-1, mqtt_state_topic(buf, 37, &s_node, "28FF641E8516035C", "state"));
+}
+
+void test_mqtt_payload_state_values(void)
+{
+    char buf[16];
+
+    TEST_ASSERT_EQUAL_INT(5, mqtt_state_payload(buf, sizeof(buf), 21.5f, 2));
+    TEST_ASSERT_EQUAL_STRING("21.50", buf);
+    mqtt_state_payload(buf, sizeof(buf), -0.125f, 3);
+    TEST_ASSERT_EQUAL_STRING("-0.125", buf);
+}
+
+/* ===== Discovery Tests ===== */
+
+void test_mqtt_payload_discovery_matches_firmware_format(void)
+{
+    char buf[MQTT_DISCOVERY_PAYLOAD_LEN];
+    mqtt_entity_t entity = {
+        .sensor_id = "28FF641E8516035C",
+        .name = "Living Room",
+        .unit = "°C",
+        .device_class = "temperature",
+    };
+
+    /* Same keys, order and formatting as the cJSON document it replaces */
+    const char *expected =
+        "{\"name\":\"Living Room\",\"unique_id\":\"thermux_28FF641E8516035C\","
+        "\"state_topic\":\"thermux/sensor/28FF641E8516035C/state\","
+        "\"availability_topic\":\"thermux/status\",\"device_class\":\"temperature\","
+        "\"unit_of_measurement\":\"°C\",\"state_class\":\"measurement\","
+        "\"device\":{\"name\":\"Thermux\",\"manufacturer\":\"Custom\",\"model\":\"ESP32-POE-ISO\","
+        "\"sw_version\":\"1.2.3\",\"identifiers\":[\"thermux\"]}}";
+    int len = mqtt_discovery_payload(buf, sizeof(buf), &s_node, &entity);
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+    TEST_ASSERT_EQUAL_INT((int)strlen(expected), len);
+
+    /* Too small a buffer fails */
+    TEST_ASSERT_EQUAL_INT(-1, mqtt_discovery_payload(buf, (size_t)len, &s_node, &entity));
+    TEST_ASSERT_EQUAL_INT(len, mqtt_discovery_payload(buf, (size_t)len + 1, &s_node, &entity));
+}
+
+void test_mqtt_payload_discovery_trend_and_escaping(void)
+{
+    char buf[MQTT_DISCOVERY_PAYLOAD_LEN];
+    mqtt_entity_t entity = {
+        .sensor_id = "28FF641E8516035C",
+        .name = "Tank \"A\"\\1\n\x01 trend",
+        .suffix = "trend",
+        .unit = "°C/min",
+        .icon = "mdi:chart-line-variant",
+    };
+
+    TEST_ASSERT_GREATER_THAN(0, mqtt_discovery_payload(buf, sizeof(buf), &s_node, &entity));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "{\"name\":\"Tank \\\"A\\\"\\\\1\\n\\u0001 trend\","));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"unique_id\":\"thermux_28FF641E8516035C_trend\""));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"state_topic\":\"thermux/sensor/28FF641E8516035C/trend\""));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"icon\":\"mdi:chart-line-variant\",\"unit_of_measurement\""));
+    TEST_ASSERT_NULL(strstr(buf, "device_class"));
+}
+
+void run_mqtt_payload_tests(void)
+{
+    RUN_TEST(test_mqtt_payload_topics);
+    RUN_TEST(test_mqtt_payload_state_values);
+    RUN_TEST(test_mqtt_payload_discovery_matches_firmware_format);
+    RUN_TEST(test_mqtt_payload_discovery_trend_and_escaping);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file test_net_metrics.c
+ * @brief Unit tests for network self-test accounting and test pattern
+ */
+
+#include "unity.h"
+#include "net_metrics.h"
+#include <string.h>
+
+/* ===== Pattern Tests ===== */
+
+void test_net_pattern_independent_of_chunking(void)
+{
+    static uint8_t whole[3000];
+    static uint8_t chunked[3000];
+
+    net_pattern_fill(whole, sizeof(whole), 0);
+    net_pattern_fill(chunked, 1000, 0);
+    net_pattern_fill(chunked + 1000, 1, 1000);
+    net_pattern_fill(chunked + 1001, 1999, 1001);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(whole, chunked, sizeof(whole)));
+
+    TEST_ASSERT_EQUAL_INT(0, net_pattern_check(whole + 1500, 1500, 1500));
+
+    /* Repeats every period, and only then */
+    uint8_t a[256], b[256];
+    net_pattern_fill(a, sizeof(a), 4096);
+    net_pattern_fill(b, sizeof(b), 4096 + NET_PATTERN_PERIOD);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(a, b, sizeof(a)));
+    net_pattern_fill(b, sizeof(b), 4096 + 256);
+    TEST_ASSERT_GREATER_THAN(200, (int)net_pattern_check(b, sizeof(b), 4096));
+}
+
+void test_net_pattern_detects_lost_segment(void)
+{
+    static uint8_t buf[2920];
+
+    /* The second 1460-byte segment is lost: what arrives next is checked at the wrong offset */
+    net_pattern_fill(buf, 1460, 0);
+    net_pattern_fill(buf + 1460, 1460, 2920);
+    TEST_ASSERT_EQUAL_INT(0, net_pattern_check(buf, 1460, 0));
+    TEST_ASSERT_GREATER_THAN(1000, (int)net_pattern_check(buf + 1460, 1460, 1460));
+
+    buf[7] ^= 0x01;
+    TEST_ASSERT_EQUAL_INT(1, net_pattern_check(buf, 1460, 0));
+}
+
+/* ===== Accounting Tests ===== */
+
+void test_net_transfer_record(void)
+{
+    net_transfer_stats_t s;
+    memset(&s, 0, sizeof(s));
+
+    TEST_ASSERT_EQUAL_INT(8000, net_rate_kbps(1000000, 1000000));
+    TEST_ASSERT_EQUAL_INT(0, net_rate_kbps(1000, 0));
+
+    net_transfer_record(&s, 1000000, 1000000, true, 0);
+    net_transfer_record(&s, 1000000, 2000000, true, 0);
+    TEST_ASSERT_EQUAL_INT(2, s.runs);
+    TEST_ASSERT_EQUAL_INT(4000, s.last_kbps);
+    TEST_ASSERT_EQUAL_INT(8000, s.best_kbps);
+    TEST_ASSERT_EQUAL_INT(2000, s.last_ms);
+
+    /* Corrupted and aborted runs count as failures and do not set a rate */
+    net_transfer_record(&s, 1000000, 500000, true, 3);
+    net_transfer_record(&s, 1000, 500000, false, 0);
+    TEST_ASSERT_EQUAL_INT(4, s.runs);
+    TEST_ASSERT_EQUAL_INT(2, s.failures);
+    TEST_ASSERT_EQUAL_INT(0, s.last_kbps);
+    TEST_ASSERT_EQUAL_INT(8000, s.best_kbps);
+    TEST_ASSERT_TRUE(s.total_bytes == 3001000);
+}
+
+void test_net_emac_drops_add(void)
+{
+    net_emac_drops_t d;
+    memset(&d, 0, sizeof(d));
+
+    net_emac_drops_add(&d, 5 | (3u << 17));
+    net_emac_drops_add(&d, 2);
+    TEST_ASSERT_EQUAL_INT(7, d.no_descriptor);
+    TEST_ASSERT_EQUAL_INT(3, d.fifo_overflow);
+    TEST_ASSERT_FALSE(d.saturated);
+
+    /* Wrapped since the last read: the total is only a lower bound */
+    net_emac_drops_add(&d, 0xFFFF | (1u << 16));
+    TEST_ASSERT_EQUAL_INT(7 + 0xFFFF, d.no_descriptor);
+    TEST_ASSERT_TRUE(d.saturated);
+}
+
+void run_net_metrics_tests(void)
+{
+    RUN_TEST(test_net_pattern_independent_of_chunking);
+    RUN_TEST(test_net_pattern_detects_lost_segment);
+    RUN_TEST(test_net_transfer_record);
+    RUN_TEST(test_net_emac_drops_add);
+}
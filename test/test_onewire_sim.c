@@ -0,0 +1,204 @@
+/**
+ * @file test_onewire_sim.c
+ * @brief Unit tests for the simulated DS18B20 bus
+ */
+
+#include "unity.h"
+#include "onewire_sim.h"
+#include <string.h>
+
+/* ===== Master-side helpers (what the onewire_bus component does) ===== */
+
+static void write_byte(onewire_sim_t *sim, uint8_t byte)
+{
+    for (int i = 0; i < 8; i++) {
+        onewire_sim_write_bit(sim, (byte >> i) & 1);
+    }
+}
+
+static uint8_t read_byte(onewire_sim_t *sim)
+{
+    uint8_t byte = 0;
+    for (int i = 0; i < 8; i++) {
+        byte |= (uint8_t)(onewire_sim_read_bit(sim) << i);
+    }
+    return byte;
+}
+
+static void match_rom(onewire_sim_t *sim, const uint8_t *rom)
+{
+    onewire_sim_reset(sim);
+    write_byte(sim, 0x55);
+    for (int i = 0; i < 8; i++) {
+        write_byte(sim, rom[i]);
+    }
+}
+
+static void read_scratchpad(onewire_sim_t *sim, const uint8_t *rom, uint8_t *pad)
+{
+    match_rom(sim, rom);
+    write_byte(sim, 0xBE);
+    for (int i = 0; i < 9; i++) {
+        pad[i] = read_byte(sim);
+    }
+}
+
+/**
+ * @brief Standard ROM search; returns the number of devices found
+ */
+static int search_all(onewire_sim_t *sim, uint8_t cmd, uint8_t (*found)[8], int max)
+{
+    uint8_t rom[8] = {0};
+    int last_discrepancy = -1;
+    int count = 0;
+
+    while (count < max) {
+        if (!onewire_sim_reset(sim)) {
+            return 0;
+        }
+        write_byte(sim, cmd);
+        int discrepancy = -1;
+        for (int pos = 0; pos < 64; pos++) {
+            uint8_t bit = onewire_sim_read_bit(sim);
+            uint8_t cmp = onewire_sim_read_bit(sim);
+            if (bit && cmp) {
+                return count;   /* Nobody answered */
+            }
+            uint8_t dir;
+            if (bit != cmp) {
+                dir = bit;
+            } else if (pos < last_discrepancy) {
+                dir = (rom[pos / 8] >> (pos % 8)) & 1;
+            } else {
+                dir = pos == last_discrepancy;
+            }
+            if (bit == 0 && cmp == 0 && dir == 0) {
+                discrepancy = pos;
+            }
+            rom[pos / 8] = (uint8_t)((rom[pos / 8] & ~(1 << (pos % 8))) | (dir << (pos % 8)));
+            onewire_sim_write_bit(sim, dir);
+        }
+        memcpy(found[count++], rom, 8);
+        if (discrepancy < 0) {
+            break;
+        }
+        last_discrepancy = discrepancy;
+    }
+    return count;
+}
+
+/* ===== Simulated Bus Tests ===== */
+
+void test_onewire_sim_search_finds_every_device(void)
+{
+    static onewire_sim_t sim;
+    uint8_t found[ONEWIRE_SIM_MAX_DEVICES][8];
+    onewire_sim_init(&sim, 20);
+
+    TEST_ASSERT_EQUAL_INT(20, search_all(&sim, 0xF0, found, ONEWIRE_SIM_MAX_DEVICES));
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_INT(0x28, found[i][0]);
+        TEST_ASSERT_EQUAL_INT(onewire_sim_crc8(found[i], 7), found[i][7]);
+        for (int j = 0; j < i; j++) {
+            TEST_ASSERT_TRUE(memcmp(found[i], found[j], 8) != 0);
+        }
+    }
+
+    /* No presence pulse on an empty bus */
+    onewire_sim_init(&sim, 0);
+    TEST_ASSERT_FALSE(onewire_sim_reset(&sim));
+    TEST_ASSERT_EQUAL_INT(0, search_all(&sim, 0xF0, found, ONEWIRE_SIM_MAX_DEVICES));
+}
+
+void test_onewire_sim_convert_and_read_scratchpad(void)
+{
+    static onewire_sim_t sim;
+    uint8_t pad[9];
+    onewire_sim_init(&sim, 4);
+
+    /* Before any conversion: the 85 °C power-on value */
+    read_scratchpad(&sim, sim.dev[2].rom, pad);
+    TEST_ASSERT_EQUAL_INT(0x0550, pad[0] | (pad[1] << 8));
+    TEST_ASSERT_EQUAL_INT(onewire_sim_crc8(pad, 8), pad[8]);
+
+    /* Skip ROM + Convert reaches every device */
+    onewire_sim_reset(&sim);
+    write_byte(&sim, 0xCC);
+    write_byte(&sim, 0x44);
+    TEST_ASSERT_EQUAL_INT(1, onewire_sim_read_bit(&sim));   /* Done */
+    TEST_ASSERT_EQUAL_INT(1, (int)sim.conversions);
+
+    for (int i = 0; i < 4; i++) {
+        read_scratchpad(&sim, sim.dev[i].rom, pad);
+        TEST_ASSERT_EQUAL_INT(onewire_sim_crc8(pad, 8), pad[8]);
+        int raw = (int16_t)(pad[0] | (pad[1] << 8));
+        /* Within 1 °C of 20 °C + 0.5 °C per device */
+        TEST_ASSERT_TRUE(raw >= 20 * 16 + i * 8 - 16 && raw <= 20 * 16 + i * 8 + 16);
+    }
+
+    /* Match ROM addresses one device only */
+    match_rom(&sim, sim.dev[1].rom);
+    write_byte(&sim, 0x44);
+    TEST_ASSERT_EQUAL_INT(2, (int)sim.conversions);
+}
+
+void test_onewire_sim_resolution_write(void)
+{
+    static onewire_sim_t sim;
+    uint8_t pad[9];
+    onewire_sim_init(&sim, 2);
+
+    /* 9 bits: TH, TL, config 0x1F */
+    match_rom(&sim, sim.dev[0].rom);
+    write_byte(&sim, 0x4E);
+    write_byte(&sim, 0x7F);
+    write_byte(&sim, 0x80);
+    write_byte(&sim, 0x1F);
+
+    for (int n = 0; n < 8; n++) {
+        onewire_sim_reset(&sim);
+        write_byte(&sim, 0xCC);
+        write_byte(&sim, 0x44);
+        read_scratchpad(&sim, sim.dev[0].rom, pad);
+        TEST_ASSERT_EQUAL_INT(0x1F, pad[4]);
+        TEST_ASSERT_EQUAL_INT(0, pad[0] & 0x07);    /* Undefined bits read 0 */
+        TEST_ASSERT_EQUAL_INT(onewire_sim_crc8(pad, 8), pad[8]);
+    }
+
+    /* The other device kept 12 bits */
+    read_scratchpad(&sim, sim.dev[1].rom, pad);
+    TEST_ASSERT_EQUAL_INT(0x7F, pad[4]);
+}
+
+void test_onewire_sim_alarm_search(void)
+{
+    static onewire_sim_t sim;
+    uint8_t found[ONEWIRE_SIM_MAX_DEVICES][8];
+    onewire_sim_init(&sim, 6);
+
+    onewire_sim_reset(&sim);
+    write_byte(&sim, 0xCC);
+    write_byte(&sim, 0x44);
+    TEST_ASSERT_EQUAL_INT(0, search_all(&sim, 0xEC, found, ONEWIRE_SIM_MAX_DEVICES));
+
+    /* Lower TH on device 3 to 15 °C: it alarms at the next conversion */
+    match_rom(&sim, sim.dev[3].rom);
+    write_byte(&sim, 0x4E);
+    write_byte(&sim, 15);
+    write_byte(&sim, 0x80);
+    write_byte(&sim, 0x7F);
+    onewire_sim_reset(&sim);
+    write_byte(&sim, 0xCC);
+    write_byte(&sim, 0x44);
+
+    TEST_ASSERT_EQUAL_INT(1, search_all(&sim, 0xEC, found, ONEWIRE_SIM_MAX_DEVICES));
+    TEST_ASSERT_TRUE(memcmp(found[0], sim.dev[3].rom, 8) == 0);
+}
+
+void run_onewire_sim_tests(void)
+{
+    RUN_TEST(test_onewire_sim_search_finds_every_device);
+    RUN_TEST(test_onewire_sim_convert_and_read_scratchpad);
+    RUN_TEST(test_onewire_sim_resolution_write);
+    RUN_TEST(test_onewire_sim_alarm_search);
+}
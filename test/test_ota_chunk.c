@@ -0,0 +1,76 @@
+/**
+ * @file test_ota_chunk.c
+ * @brief Unit tests for resumable firmware upload bookkeeping
+ */
+
+#include "unity.h"
+#include "ota_chunk.h"
+
+/* ===== Content-Range Tests ===== */
+
+void test_ota_parse_content_range(void)
+{
+    ota_range_t r;
+
+    TEST_ASSERT_TRUE(ota_parse_content_range("bytes 0-65535/1048576", &r));
+    TEST_ASSERT_EQUAL_INT(0, r.first);
+    TEST_ASSERT_EQUAL_INT(65535, r.last);
+    TEST_ASSERT_EQUAL_INT(1048576, r.total);
+
+    TEST_ASSERT_TRUE(ota_parse_content_range("bytes 1048575-1048575/1048576", &r));
+    TEST_ASSERT_EQUAL_INT(1048575, r.first);
+
+    /* Malformed, reversed, past the end or unsatisfiable */
+    TEST_ASSERT_FALSE(ota_parse_content_range(NULL, &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("0-1/2", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes 0-1/*", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes */100", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes 10-5/100", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes 0-100/100", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes -1-5/100", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes 0-5/100x", &r));
+    TEST_ASSERT_FALSE(ota_parse_content_range("bytes 0-5/4294967296", &r));
+}
+
+/* ===== Chunk Plan Tests ===== */
+
+void test_ota_chunk_plan(void)
+{
+    ota_range_t r = { .first = 0, .last = 4095, .total = 10000 };
+    uint32_t skip = 99;
+
+    TEST_ASSERT_EQUAL_INT(OTA_CHUNK_APPEND, ota_chunk_plan(0, 10000, &r, &skip));
+    TEST_ASSERT_EQUAL_INT(0, skip);
+
+    /* Retry of a chunk that was cut off after 1000 bytes: write the rest */
+    TEST_ASSERT_EQUAL_INT(OTA_CHUNK_APPEND, ota_chunk_plan(1000, 10000, &r, &skip));
+    TEST_ASSERT_EQUAL_INT(1000, skip);
+
+    /* Retry of a chunk whose response was lost: nothing to write */
+    TEST_ASSERT_EQUAL_INT(OTA_CHUNK_DUPLICATE, ota_chunk_plan(4096, 10000, &r, &skip));
+    TEST_ASSERT_EQUAL_INT(0, skip);
+
+    /* Skipping ahead is refused */
+    r.first = 8192;
+    r.last = 9999;
+    TEST_ASSERT_EQUAL_INT(OTA_CHUNK_GAP, ota_chunk_plan(4096, 10000, &r, &skip));
+
+    /* A different image size is another upload */
+    r.total = 12000;
+    TEST_ASSERT_EQUAL_INT(OTA_CHUNK_INVALID, ota_chunk_plan(8192, 10000, &r, &skip));
+}
+
+void test_ota_resume_offset(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, ota_resume_offset(0, 4096));
+    TEST_ASSERT_EQUAL_INT(0, ota_resume_offset(4095, 4096));
+    TEST_ASSERT_EQUAL_INT(4096, ota_resume_offset(4096, 4096));
+    TEST_ASSERT_EQUAL_INT(69632, ota_resume_offset(70000, 4096));
+}
+
+void run_ota_chunk_tests(void)
+{
+    RUN_TEST(test_ota_parse_content_range);
+    RUN_TEST(test_ota_chunk_plan);
+    RUN_TEST(test_ota_resume_offset);
+}
@@ -0,0 +1,155 @@
+/**
+ * @file test_recovery_policy.c
+ * @brief Unit tests for staged acquisition recovery and MTTR tracking
+ */
+
+#include "unity.h"
+#include "recovery_policy.h"
+
+/* ===== Escalation Tests ===== */
+
+void test_recovery_escalates_in_stages(void)
+{
+    recovery_policy_t p;
+    recovery_init(&p, 2);
+
+    TEST_ASSERT_EQUAL_INT(RECOVERY_NONE, recovery_on_bad(&p, 1000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_BUS_RESET, recovery_on_bad(&p, 2000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_NONE, recovery_on_bad(&p, 3000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_BUS_RECREATE, recovery_on_bad(&p, 4000, RECOVERY_CAUSE_FAILED));
+    recovery_on_bad(&p, 5000, RECOVERY_CAUSE_FAILED);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_RESCAN, recovery_on_bad(&p, 6000, RECOVERY_CAUSE_FAILED));
+    recovery_on_bad(&p, 7000, RECOVERY_CAUSE_FAILED);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_REBOOT, recovery_on_bad(&p, 8000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(1, (int)p.stage_counts[RECOVERY_REBOOT]);
+}
+
+void test_recovery_short_glitch_is_not_an_incident(void)
+{
+    recovery_policy_t p;
+    recovery_init(&p, 3);
+
+    recovery_on_bad(&p, 1000, RECOVERY_CAUSE_OVERRUN);
+    recovery_on_bad(&p, 2000, RECOVERY_CAUSE_OVERRUN);
+    TEST_ASSERT_FALSE(recovery_on_good(&p, 3000));
+    TEST_ASSERT_EQUAL_INT(0, (int)p.recoveries);
+    TEST_ASSERT_EQUAL_INT(0, (int)recovery_retry_ms(&p));
+
+    /* The count starts over after a good cycle */
+    recovery_on_bad(&p, 4000, RECOVERY_CAUSE_FAILED);
+    recovery_on_bad(&p, 5000, RECOVERY_CAUSE_FAILED);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_BUS_RESET, recovery_on_bad(&p, 6000, RECOVERY_CAUSE_FAILED));
+}
+
+/* ===== MTTR Tests ===== */
+
+void test_recovery_records_mttr(void)
+{
+    recovery_policy_t p;
+    recovery_event_t ev;
+    recovery_init(&p, 1);
+
+    TEST_ASSERT_EQUAL_INT(0, (int)recovery_mttr_ms(&p));
+
+    recovery_on_bad(&p, 10000, RECOVERY_CAUSE_FAILED);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_RETRY_MS, (int)recovery_retry_ms(&p));
+    TEST_ASSERT_TRUE(recovery_on_good(&p, 12000));
+
+    recovery_on_bad(&p, 20000, RECOVERY_CAUSE_OVERRUN);
+    recovery_on_bad(&p, 21000, RECOVERY_CAUSE_FAILED);
+    TEST_ASSERT_TRUE(recovery_on_good(&p, 26000));
+
+    TEST_ASSERT_EQUAL_INT(2, (int)p.recoveries);
+    TEST_ASSERT_EQUAL_INT(4000, (int)recovery_mttr_ms(&p));
+
+    TEST_ASSERT_TRUE(recovery_get_event(&p, 0, &ev));
+    TEST_ASSERT_EQUAL_INT(20000, (int)ev.started_ms);
+    TEST_ASSERT_EQUAL_INT(6000, (int)ev.duration_ms);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_BUS_RECREATE, ev.stage);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_CAUSE_OVERRUN, ev.cause);
+    TEST_ASSERT_TRUE(recovery_get_event(&p, 1, &ev));
+    TEST_ASSERT_EQUAL_INT(2000, (int)ev.duration_ms);
+    TEST_ASSERT_FALSE(recovery_get_event(&p, 2, &ev));
+}
+
+void test_recovery_history_wraps(void)
+{
+    recovery_policy_t p;
+    recovery_event_t ev;
+    recovery_init(&p, 1);
+
+    for (int i = 0; i < RECOVERY_HISTORY + 3; i++) {
+        recovery_on_bad(&p, i * 10000, RECOVERY_CAUSE_FAILED);
+        recovery_on_good(&p, i * 10000 + 100 * (i + 1));
+    }
+    TEST_ASSERT_EQUAL_INT(RECOVERY_HISTORY, p.history_count);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_HISTORY + 3, (int)p.recoveries);
+    TEST_ASSERT_TRUE(recovery_get_event(&p, 0, &ev));
+    TEST_ASSERT_EQUAL_INT(100 * (RECOVERY_HISTORY + 3), (int)ev.duration_ms);
+    TEST_ASSERT_TRUE(recovery_get_event(&p, RECOVERY_HISTORY - 1, &ev));
+    TEST_ASSERT_EQUAL_INT(400, (int)ev.duration_ms);
+    TEST_ASSERT_TRUE(recovery_is_valid(&p));
+}
+
+/* ===== Reboot Tests ===== */
+
+void test_recovery_reboots_once_per_incident(void)
+{
+    recovery_policy_t p;
+    recovery_event_t ev;
+    recovery_init(&p, 1);
+
+    for (int i = 1; i <= 3; i++) {
+        recovery_on_bad(&p, i * 1000, RECOVERY_CAUSE_FAILED);
+    }
+    TEST_ASSERT_EQUAL_INT(RECOVERY_REBOOT, recovery_on_bad(&p, 4000, RECOVERY_CAUSE_FAILED));
+
+    /* Carried over the reboot, which happened at uptime 4500 */
+    recovery_rebase(&p, 4500);
+    TEST_ASSERT_EQUAL_INT(-3500, (int)p.started_ms);
+    TEST_ASSERT_EQUAL_INT(RECOVERY_RESCAN, recovery_on_bad(&p, 2000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_RESCAN, recovery_on_bad(&p, 3000, RECOVERY_CAUSE_FAILED));
+    TEST_ASSERT_EQUAL_INT(0, (int)recovery_retry_ms(&p));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_NONE, recovery_on_stall(&p, 3000));
+
+    TEST_ASSERT_TRUE(recovery_on_good(&p, 6500));
+    TEST_ASSERT_TRUE(recovery_get_event(&p, 0, &ev));
+    TEST_ASSERT_EQUAL_INT(10000, (int)ev.duration_ms);
+    TEST_ASSERT_EQUAL_INT(1, (int)p.stage_counts[RECOVERY_REBOOT]);
+
+    /* A new incident may reboot again */
+    TEST_ASSERT_EQUAL_INT(RECOVERY_REBOOT, recovery_on_stall(&p, 9000));
+    TEST_ASSERT_TRUE(recovery_on_good(&p, 20000));
+    TEST_ASSERT_TRUE(recovery_get_event(&p, 0, &ev));
+    TEST_ASSERT_EQUAL_INT(RECOVERY_CAUSE_STALL, ev.cause);
+    TEST_ASSERT_EQUAL_INT(11000, (int)ev.duration_ms);
+}
+
+void test_recovery_validates_state(void)
+{
+    recovery_policy_t p;
+    recovery_init(&p, 3);
+    TEST_ASSERT_TRUE(recovery_is_valid(&p));
+
+    p.history_count = RECOVERY_HISTORY + 1;
+    TEST_ASSERT_FALSE(recovery_is_valid(&p));
+    recovery_init(&p, 3);
+    p.stage = 0xA5;
+    TEST_ASSERT_FALSE(recovery_is_valid(&p));
+    recovery_init(&p, 0);
+    TEST_ASSERT_EQUAL_INT(1, p.threshold);
+
+    TEST_ASSERT_EQUAL_STRING("bus_recreate", recovery_stage_name(RECOVERY_BUS_RECREATE));
+    TEST_ASSERT_EQUAL_STRING("stall", recovery_cause_name(RECOVERY_CAUSE_STALL));
+    TEST_ASSERT_EQUAL_STRING("unknown", recovery_stage_name(RECOVERY_STAGE_COUNT));
+}
+
+void run_recovery_policy_tests(void)
+{
+    RUN_TEST(test_recovery_escalates_in_stages);
+    RUN_TEST(test_recovery_short_glitch_is_not_an_incident);
+    RUN_TEST(test_recovery_records_mttr);
+    RUN_TEST(test_recovery_history_wraps);
+    RUN_TEST(test_recovery_reboots_once_per_incident);
+    RUN_TEST(test_recovery_validates_state);
+}
@@ -11,6 +11,26 @@ extern void run_address_tests(void);
 extern void run_mqtt_tests(void);
 extern void run_config_tests(void);
 extern void run_nvs_tests(void);
+extern void run_auth_tests(void);
+extern void run_alert_tests(void);
+extern void run_acq_tests(void);
+extern void run_bus_queue_tests(void);
+extern void run_bus_sched_tests(void);
+extern void run_burst_ring_tests(void);
+extern void run_trend_estimator_tests(void);
+extern void run_bus_capacity_tests(void);
+extern void run_health_window_tests(void);
+extern void run_expr_engine_tests(void);
+extern void run_recovery_policy_tests(void);
+extern void run_topic_alias_tests(void);
+extern void run_sparkplug_tests(void);
+extern void run_fanout_queue_tests(void);
+extern void run_tls_metrics_tests(void);
+extern void run_time_align_tests(void);
+extern void run_onewire_sim_tests(void);
+extern void run_mqtt_payload_tests(void);
+extern void run_net_metrics_tests(void);
+extern void run_ota_chunk_tests(void);
 
 int main(void)
 {
@@ -31,6 +51,66 @@ int main(void)
     printf("\n[NVS Utilities Tests]\n");
     run_nvs_tests();
     
+    printf("\n[Auth Utilities Tests]\n");
+    run_auth_tests();
+    
+    printf("\n[Alert Rules Tests]\n");
+    run_alert_tests();
+    
+    printf("\n[Acquisition Controller Tests]\n");
+    run_acq_tests();
+    
+    printf("\n[Bus Queue Tests]\n");
+    run_bus_queue_tests();
+    
+    printf("\n[Bus Scheduler Tests]\n");
+    run_bus_sched_tests();
+    
+    printf("\n[Burst Capture Tests]\n");
+    run_burst_ring_tests();
+    
+    printf("\n[Trend Estimator Tests]\n");
+    run_trend_estimator_tests();
+    
+    printf("\n[Bus Capacity Tests]\n");
+    run_bus_capacity_tests();
+    
+    printf("\n[Health Window Tests]\n");
+    run_health_window_tests();
+    
+    printf("\n[Expression Engine Tests]\n");
+    run_expr_engine_tests();
+    
+    printf("\n[Recovery Policy Tests]\n");
+    run_recovery_policy_tests();
+    
+    printf("\n[Topic Alias Tests]\n");
+    run_topic_alias_tests();
+    
+    printf("\n[Sparkplug Tests]\n");
+    run_sparkplug_tests();
+    
+    printf("\n[Fanout Queue Tests]\n");
+    run_fanout_queue_tests();
+    
+    printf("\n[TLS Metrics Tests]\n");
+    run_tls_metrics_tests();
+    
+    printf("\n[Time Align Tests]\n");
+    run_time_align_tests();
+    
+    printf("\n[1-Wire Simulator Tests]\n");
+    run_onewire_sim_tests();
+    
+    printf("\n[MQTT Payload Tests]\n");
+    run_mqtt_payload_tests();
+    
+    printf("\n[Network Self-Test Tests]\n");
+    run_net_metrics_tests();
+    
+    printf("\n[OTA Chunk Tests]\n");
+    run_ota_chunk_tests();
+    
     UNITY_END();
     
     return unity_tests_failed > 0 ? 1 : 0;
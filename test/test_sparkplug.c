@@ -0,0 +1,145 @@
+/**
+ * @file test_sparkplug.c
+ * @brief Unit tests for Sparkplug B payload encoding and report-by-exception
+ */
+
+#include "unity.h"
+#include "sparkplug.h"
+#include <string.h>
+
+#define TS 1700000000000ULL
+
+static bool name_is(const sparkplug_metric_t *m, const char *name)
+{
+    return m->name != NULL && m->name_len == strlen(name) && memcmp(m->name, name, m->name_len) == 0;
+}
+
+/* ===== Encoding Tests ===== */
+
+void test_sparkplug_encodes_known_bytes(void)
+{
+    /* Data message: one float metric by alias */
+    static const uint8_t expected[] = {
+        0x08, 0xE8, 0x07,                   /* timestamp 1000 */
+        0x12, 0x0A,                         /* metric, 10 bytes */
+        0x10, 0x05,                         /*   alias 5 */
+        0x18, 0xE8, 0x07,                   /*   timestamp 1000 */
+        0x65, 0x00, 0x00, 0xAC, 0x41,       /*   float_value 21.5 */
+        0x18, 0x03,                         /* seq 3 */
+    };
+    sparkplug_metric_t m = { .alias = 5, .value.f = 21.5f };
+    uint8_t buf[64];
+
+    size_t len = sparkplug_encode(buf, sizeof(buf), 1000, 3, &m, 1);
+    TEST_ASSERT_EQUAL_INT(sizeof(expected), (int)len);
+    TEST_ASSERT_TRUE(memcmp(buf, expected, len) == 0);
+
+    /* Too small a buffer */
+    TEST_ASSERT_EQUAL_INT(0, (int)sparkplug_encode(buf, len - 1, 1000, 3, &m, 1));
+}
+
+void test_sparkplug_birth_round_trip(void)
+{
+    sparkplug_metric_t birth[4] = {
+        { .name = "bdSeq", .datatype = SPARKPLUG_UINT64, .value.u = 7 },
+        { .name = SPARKPLUG_REBIRTH_METRIC, .alias = 1, .datatype = SPARKPLUG_BOOLEAN, .value.b = false },
+        { .name = "Sensors/28FF641E8516035C", .alias = 100, .datatype = SPARKPLUG_FLOAT, .value.f = 21.25f },
+        { .name = "Sensors/28FF641E8516035D", .alias = 101, .datatype = SPARKPLUG_FLOAT, .is_null = true },
+    };
+    uint8_t buf[256];
+    sparkplug_metric_t out[4];
+    int seq;
+
+    size_t len = sparkplug_encode(buf, sizeof(buf), TS, 0, birth, 4);
+    TEST_ASSERT_GREATER_THAN(0, (int)len);
+    TEST_ASSERT_EQUAL_INT(4, sparkplug_decode(buf, len, &seq, out, 4));
+    TEST_ASSERT_EQUAL_INT(0, seq);
+
+    TEST_ASSERT_TRUE(name_is(&out[0], "bdSeq"));
+    TEST_ASSERT_EQUAL_INT(SPARKPLUG_UINT64, out[0].datatype);
+    TEST_ASSERT_EQUAL_INT(7, (int)out[0].value.u);
+    TEST_ASSERT_TRUE(name_is(&out[1], SPARKPLUG_REBIRTH_METRIC));
+    TEST_ASSERT_FALSE(out[1].value.b);
+    TEST_ASSERT_EQUAL_INT(100, (int)out[2].alias);
+    TEST_ASSERT_EQUAL_INT(2125, (int)(out[2].value.f * 100));
+    TEST_ASSERT_TRUE(out[3].is_null);
+
+    /* A death certificate has no sequence number; extra metrics are counted */
+    len = sparkplug_encode(buf, sizeof(buf), TS, -1, birth, 4);
+    TEST_ASSERT_EQUAL_INT(4, sparkplug_decode(buf, len, &seq, out, 1));
+    TEST_ASSERT_EQUAL_INT(-1, seq);
+
+    /* Truncated payload */
+    TEST_ASSERT_EQUAL_INT(-1, sparkplug_decode(buf, len - 1, &seq, out, 4));
+}
+
+void test_sparkplug_data_smaller_than_text(void)
+{
+    /* 20 sensors by alias in one message vs 20 text publishes of 48 bytes */
+    sparkplug_metric_t data[20];
+    uint8_t buf[512];
+    for (int i = 0; i < 20; i++) {
+        data[i] = (sparkplug_metric_t){ .alias = 100 + i, .value.f = 20.0f + i };
+    }
+    size_t len = sparkplug_encode(buf, sizeof(buf), TS, 42, data, 20);
+    TEST_ASSERT_EQUAL_INT(329, (int)len);
+    TEST_ASSERT_LESS_THAN(20 * 48 / 2, (int)len);
+}
+
+/* ===== Command Tests ===== */
+
+void test_sparkplug_detects_rebirth(void)
+{
+    uint8_t buf[64];
+    size_t len;
+
+    sparkplug_metric_t named = { .name = SPARKPLUG_REBIRTH_METRIC, .datatype = SPARKPLUG_BOOLEAN, .value.b = true };
+    len = sparkplug_encode(buf, sizeof(buf), TS, -1, &named, 1);
+    TEST_ASSERT_TRUE(sparkplug_is_rebirth(buf, len, 1));
+
+    sparkplug_metric_t aliased = { .alias = 1, .datatype = SPARKPLUG_BOOLEAN, .value.b = true };
+    len = sparkplug_encode(buf, sizeof(buf), TS, -1, &aliased, 1);
+    TEST_ASSERT_TRUE(sparkplug_is_rebirth(buf, len, 1));
+    TEST_ASSERT_FALSE(sparkplug_is_rebirth(buf, len, 2));
+
+    named.value.b = false;
+    len = sparkplug_encode(buf, sizeof(buf), TS, -1, &named, 1);
+    TEST_ASSERT_FALSE(sparkplug_is_rebirth(buf, len, 1));
+
+    sparkplug_metric_t other = { .name = "Node Control/Reboot", .datatype = SPARKPLUG_BOOLEAN, .value.b = true };
+    len = sparkplug_encode(buf, sizeof(buf), TS, -1, &other, 1);
+    TEST_ASSERT_FALSE(sparkplug_is_rebirth(buf, len, 1));
+
+    static const uint8_t garbage[] = { 0x12, 0x7F, 0x01 };
+    TEST_ASSERT_FALSE(sparkplug_is_rebirth(garbage, sizeof(garbage), 1));
+}
+
+/* ===== Report-by-Exception Tests ===== */
+
+void test_sparkplug_rbe_deadband(void)
+{
+    sparkplug_rbe_t s = { 0 };
+
+    TEST_ASSERT_TRUE(sparkplug_rbe_update(&s, true, 21.0f, 0.1f));
+    TEST_ASSERT_FALSE(sparkplug_rbe_update(&s, true, 21.05f, 0.1f));
+    TEST_ASSERT_FALSE(sparkplug_rbe_update(&s, true, 20.95f, 0.1f));
+    TEST_ASSERT_TRUE(sparkplug_rbe_update(&s, true, 21.2f, 0.1f));
+
+    /* Becoming invalid is reported once, recovering always */
+    TEST_ASSERT_TRUE(sparkplug_rbe_update(&s, false, 0.0f, 0.1f));
+    TEST_ASSERT_FALSE(sparkplug_rbe_update(&s, false, 0.0f, 0.1f));
+    TEST_ASSERT_TRUE(sparkplug_rbe_update(&s, true, 21.2f, 0.1f));
+
+    /* No deadband: any change */
+    TEST_ASSERT_TRUE(sparkplug_rbe_update(&s, true, 21.21f, 0.0f));
+    TEST_ASSERT_FALSE(sparkplug_rbe_update(&s, true, 21.21f, 0.0f));
+}
+
+void run_sparkplug_tests(void)
+{
+    RUN_TEST(test_sparkplug_encodes_known_bytes);
+    RUN_TEST(test_sparkplug_birth_round_trip);
+    RUN_TEST(test_sparkplug_data_smaller_than_text);
+    RUN_TEST(test_sparkplug_detects_rebirth);
+    RUN_TEST(test_sparkplug_rbe_deadband);
+}
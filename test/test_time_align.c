@@ -0,0 +1,121 @@
+/**
+ * @file test_time_align.c
+ * @brief Unit tests for clock sync quality and wall-clock aligned cycles
+ */
+
+#include "unity.h"
+#include "time_align.h"
+
+/* 2026-01-01T00:00:00Z */
+#define EPOCH_MS 1767225600000LL
+
+/* ===== Clock Sync Tests ===== */
+
+void test_clock_sync_measures_correction_and_drift(void)
+{
+    clock_sync_t s;
+    clock_sync_init(&s);
+
+    /* The first sync sets the clock from 1970: no correction to speak of */
+    clock_sync_record(&s, 5000000, EPOCH_MS * 1000);
+    TEST_ASSERT_EQUAL_INT(1, (int)s.count);
+    TEST_ASSERT_EQUAL_INT(0, (int)s.last_correction_us);
+
+    /* An hour later the local clock has run 36 ms fast: the sync steps it back */
+    int64_t hour_us = 3600LL * 1000000;
+    clock_sync_record(&s, 5000000 + hour_us, EPOCH_MS * 1000 + hour_us - 36000);
+    TEST_ASSERT_EQUAL_INT(-36000, (int)s.last_correction_us);
+    TEST_ASSERT_EQUAL_INT(36000, (int)s.max_correction_us);
+    TEST_ASSERT_EQUAL_INT(-10, s.drift_ppm);
+
+    /* A smaller step keeps the largest one */
+    clock_sync_record(&s, 5000000 + 2 * hour_us, EPOCH_MS * 1000 + 2 * hour_us - 36000 + 3600);
+    TEST_ASSERT_EQUAL_INT(3600, (int)s.last_correction_us);
+    TEST_ASSERT_EQUAL_INT(36000, (int)s.max_correction_us);
+    TEST_ASSERT_EQUAL_INT(1, s.drift_ppm);
+}
+
+/* ===== Phase Alignment Tests ===== */
+
+void test_phase_align_next_boundary(void)
+{
+    phase_align_t p;
+    phase_align_init(&p, 10000);
+
+    TEST_ASSERT_TRUE(phase_align_next(&p, EPOCH_MS) == EPOCH_MS);
+    TEST_ASSERT_TRUE(phase_align_next(&p, EPOCH_MS + 1) == EPOCH_MS + 10000);
+    TEST_ASSERT_TRUE(phase_align_next(&p, EPOCH_MS + 9999) == EPOCH_MS + 10000);
+}
+
+void test_phase_align_delay_keeps_cycle_on_its_boundary(void)
+{
+    phase_align_t p;
+    int64_t boundary;
+    phase_align_init(&p, 10000);
+
+    /* Last cycle started at :00 and finished 800 ms later; its sensors are
+     * due again 12 ms after :10, within the slack, so :10 is kept */
+    int64_t now = EPOCH_MS + 800;
+    uint32_t delay = phase_align_delay_ms(&p, now, 9212, 47, &boundary);
+    TEST_ASSERT_TRUE(boundary == EPOCH_MS + 10000);
+    TEST_ASSERT_EQUAL_INT(9200, (int)delay);
+
+    /* A deadline well past a boundary waits for the next one */
+    phase_align_delay_ms(&p, now, 9500, 47, &boundary);
+    TEST_ASSERT_TRUE(boundary == EPOCH_MS + 20000);
+
+    /* With a lead, wake that much earlier */
+    p.lead_ms = 6;
+    delay = phase_align_delay_ms(&p, now, 9212, 47, &boundary);
+    TEST_ASSERT_EQUAL_INT(9194, (int)delay);
+
+    /* A boundary closer than the lead cannot be made */
+    phase_align_delay_ms(&p, EPOCH_MS + 9997, 0, 47, &boundary);
+    TEST_ASSERT_TRUE(boundary == EPOCH_MS + 20000);
+}
+
+void test_phase_align_learns_lead(void)
+{
+    phase_align_t p;
+    phase_align_init(&p, 10000);
+
+    /* The convert command goes out 8 ms after wake-up */
+    for (int i = 0; i < 10; i++) {
+        int64_t boundary = EPOCH_MS + (int64_t)i * 10000;
+        int64_t wake = boundary - p.lead_ms;
+        phase_align_record(&p, boundary, wake + 8);
+    }
+    TEST_ASSERT_EQUAL_INT(10, (int)p.cycles);
+    TEST_ASSERT_TRUE(p.lead_ms >= 7 && p.lead_ms <= 8);
+    TEST_ASSERT_TRUE(p.last_error_ms >= 0 && p.last_error_ms <= 1);
+    TEST_ASSERT_EQUAL_INT(8, p.max_error_ms);
+    TEST_ASSERT_LESS_THAN(4, (int)phase_align_avg_error_ms(&p));
+}
+
+void test_phase_align_ignores_missed_cycles(void)
+{
+    phase_align_t p;
+    phase_align_init(&p, 10000);
+
+    /* Held up behind a rescan for 6 s */
+    phase_align_record(&p, EPOCH_MS, EPOCH_MS + 6000);
+    TEST_ASSERT_EQUAL_INT(1, (int)p.missed);
+    TEST_ASSERT_EQUAL_INT(0, (int)p.cycles);
+    TEST_ASSERT_EQUAL_INT(0, p.lead_ms);
+
+    /* The lead is capped */
+    phase_align_record(&p, EPOCH_MS, EPOCH_MS + 4000);
+    TEST_ASSERT_EQUAL_INT(PHASE_LEAD_MAX_MS, p.lead_ms);
+    phase_align_record(&p, EPOCH_MS, EPOCH_MS - 4000);
+    TEST_ASSERT_EQUAL_INT(0, p.lead_ms);
+    TEST_ASSERT_EQUAL_INT(0, (int)phase_align_avg_error_ms(&(phase_align_t){ .period_ms = 1 }));
+}
+
+void run_time_align_tests(void)
+{
+    RUN_TEST(test_clock_sync_measures_correction_and_drift);
+    RUN_TEST(test_phase_align_next_boundary);
+    RUN_TEST(test_phase_align_delay_keeps_cycle_on_its_boundary);
+    RUN_TEST(test_phase_align_learns_lead);
+    RUN_TEST(test_phase_align_ignores_missed_cycles);
+}
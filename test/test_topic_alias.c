@@ -0,0 +1,127 @@
+/**
+ * @file test_topic_alias.c
+ * @brief Unit tests for MQTT 5 topic aliases and PUBLISH wire size
+ */
+
+#include "unity.h"
+#include "topic_alias.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STATE_TOPIC "thermux/sensor/28FF641E8516035C/state"
+
+static topic_alias_entry_t s_entries[4];
+
+/* ===== Assignment Tests ===== */
+
+void test_topic_alias_assigned_once_per_session(void)
+{
+    topic_alias_table_t t;
+    bool send_topic;
+    topic_alias_init(&t, s_entries, 4);
+
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, STATE_TOPIC, &send_topic));
+    TEST_ASSERT_TRUE(send_topic);
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, STATE_TOPIC, &send_topic));
+    TEST_ASSERT_FALSE(send_topic);
+    TEST_ASSERT_EQUAL_INT(2, topic_alias_get(&t, "thermux/sensor/28AA/state", &send_topic));
+    TEST_ASSERT_TRUE(send_topic);
+
+    /* A new connection starts over */
+    topic_alias_reset(&t, 4);
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, "thermux/sensor/28AA/state", &send_topic));
+    TEST_ASSERT_TRUE(send_topic);
+}
+
+void test_topic_alias_respects_broker_limit(void)
+{
+    topic_alias_table_t t;
+    bool send_topic;
+    topic_alias_init(&t, s_entries, 4);
+    topic_alias_reset(&t, 2);
+
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, "a/1", &send_topic));
+    TEST_ASSERT_EQUAL_INT(2, topic_alias_get(&t, "a/2", &send_topic));
+    TEST_ASSERT_EQUAL_INT(0, topic_alias_get(&t, "a/3", &send_topic));
+    TEST_ASSERT_TRUE(send_topic);
+
+    /* Broker refused alias 2: only alias 1 stays */
+    topic_alias_limit(&t, 2);
+    TEST_ASSERT_EQUAL_INT(0, topic_alias_get(&t, "a/2", &send_topic));
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, "a/1", &send_topic));
+    TEST_ASSERT_FALSE(send_topic);
+
+    /* A broker limit above the table size is capped */
+    topic_alias_reset(&t, 1000);
+    TEST_ASSERT_EQUAL_INT(4, t.limit);
+}
+
+void test_topic_alias_resends_unsent_topic(void)
+{
+    topic_alias_table_t t;
+    bool send_topic;
+    topic_alias_init(&t, s_entries, 4);
+
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, STATE_TOPIC, &send_topic));
+    topic_alias_unsent(&t, 1);
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, STATE_TOPIC, &send_topic));
+    TEST_ASSERT_TRUE(send_topic);
+    TEST_ASSERT_EQUAL_INT(1, topic_alias_get(&t, STATE_TOPIC, &send_topic));
+    TEST_ASSERT_FALSE(send_topic);
+
+    /* Empty and over-long topics are sent as they are */
+    char long_topic[TOPIC_ALIAS_TOPIC_LEN + 1];
+    snprintf(long_topic, sizeof(long_topic), "%0*d", TOPIC_ALIAS_TOPIC_LEN, 0);
+    TEST_ASSERT_EQUAL_INT(0, topic_alias_get(&t, long_topic, &send_topic));
+    TEST_ASSERT_EQUAL_INT(0, topic_alias_get(&t, "", &send_topic));
+}
+
+/* ===== Wire Size Tests ===== */
+
+void test_topic_alias_wire_size(void)
+{
+    size_t topic_len = sizeof(STATE_TOPIC) - 1;
+
+    /* 3.1.1 QoS 1: header 2, topic 2 + 37, packet id 2, payload 5 */
+    TEST_ASSERT_EQUAL_INT(48, (int)mqtt_publish_wire_size(topic_len, 5, 1, false, 0, 0));
+    /* 5 with no properties adds the property length byte */
+    TEST_ASSERT_EQUAL_INT(49, (int)mqtt_publish_wire_size(topic_len, 5, 1, true, 0, 0));
+    /* Announcing the alias, QoS 0, with message expiry */
+    TEST_ASSERT_EQUAL_INT(55, (int)mqtt_publish_wire_size(topic_len, 5, 0, true, 1, 60));
+    /* Alias only */
+    TEST_ASSERT_EQUAL_INT(18, (int)mqtt_publish_wire_size(0, 5, 0, true, 1, 60));
+    /* Remaining length over 127 takes two bytes */
+    TEST_ASSERT_EQUAL_INT(3 + 2 + 10 + 200, (int)mqtt_publish_wire_size(10, 200, 0, false, 0, 0));
+}
+
+void test_topic_alias_session_savings(void)
+{
+    /* 20 sensors, 60 state publishes each over one connection */
+    static topic_alias_entry_t entries[20];
+    topic_alias_table_t t;
+    topic_alias_init(&t, entries, 20);
+
+    size_t v311 = 0, v5 = 0;
+    for (int round = 0; round < 60; round++) {
+        for (int s = 0; s < 20; s++) {
+            char topic[64];
+            bool send_topic;
+            snprintf(topic, sizeof(topic), "thermux/sensor/28FF641E851603%02d/state", s);
+            size_t len = strlen(topic);
+            uint16_t alias = topic_alias_get(&t, topic, &send_topic);
+            v311 += mqtt_publish_wire_size(len, 5, 1, false, 0, 0);
+            v5 += mqtt_publish_wire_size(send_topic ? len : 0, 5, 0, true, alias, 120);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(57600, (int)v311);
+    TEST_ASSERT_EQUAL_INT(22340, (int)v5);
+}
+
+void run_topic_alias_tests(void)
+{
+    RUN_TEST(test_topic_alias_assigned_once_per_session);
+    RUN_TEST(test_topic_alias_respects_broker_limit);
+    RUN_TEST(test_topic_alias_resends_unsent_topic);
+    RUN_TEST(test_topic_alias_wire_size);
+    RUN_TEST(test_topic_alias_session_savings);
+}
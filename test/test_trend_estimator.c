@@ -0,0 +1,137 @@
+/**
+ * @file test_trend_estimator.c
+ * @brief Unit tests for the sliding-window trend estimator
+ */
+
+#include "unity.h"
+#include "trend_estimator.h"
+#include <math.h>
+
+#define WINDOW_MS 120000
+
+static bool near(float a, float b, float tol)
+{
+    return fabsf(a - b) <= tol;
+}
+
+/* ===== Slope Tests ===== */
+
+void test_trend_needs_samples(void)
+{
+    trend_t tr;
+    float slope;
+
+    trend_init(&tr);
+    TEST_ASSERT_FALSE(trend_slope(&tr, &slope));
+    trend_add(&tr, 1000, 20.0f, WINDOW_MS);
+    trend_add(&tr, 3000, 20.5f, WINDOW_MS);
+    TEST_ASSERT_FALSE(trend_slope(&tr, &slope));
+    trend_add(&tr, 5000, 21.0f, WINDOW_MS);
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(near(slope, 15.0f, 0.001f));
+}
+
+void test_trend_ramp_and_prediction(void)
+{
+    trend_t tr;
+    float slope, predicted;
+
+    /* 1 °C/min sampled every 2 s */
+    trend_init(&tr);
+    for (int i = 0; i <= 40; i++) {
+        trend_add(&tr, 50000 + i * 2000, 20.0f + i * 2.0f / 60.0f, WINDOW_MS);
+    }
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(near(slope, 1.0f, 0.001f));
+    TEST_ASSERT_TRUE(trend_predict(&tr, 60000, &predicted));
+    TEST_ASSERT(near(predicted, 20.0f + 80.0f / 60.0f + 1.0f, 0.01f));
+}
+
+void test_trend_noise_rejection(void)
+{
+    trend_t tr;
+    float slope;
+
+    /* One LSB of 12-bit noise on a flat line */
+    trend_init(&tr);
+    for (int i = 0; i < 60; i++) {
+        trend_add(&tr, i * 1000, 22.0f + ((i % 2) ? 0.0625f : -0.0625f), WINDOW_MS);
+    }
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(near(slope, 0.0f, 0.05f));
+}
+
+/* ===== Window Tests ===== */
+
+void test_trend_window_expiry(void)
+{
+    trend_t tr;
+    float slope;
+
+    /* Steep rise, then flat for longer than the window */
+    trend_init(&tr);
+    int64_t t = 0;
+    for (int i = 0; i < 10; i++, t += 5000) {
+        trend_add(&tr, t, 20.0f + i, WINDOW_MS);
+    }
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(slope > 10.0f);
+    for (int i = 0; i < 30; i++, t += 5000) {
+        trend_add(&tr, t, 29.0f, WINDOW_MS);
+    }
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(near(slope, 0.0f, 0.0001f));
+    TEST_ASSERT(tr.count <= 25);
+
+    /* A gap longer than the window leaves a single sample */
+    trend_add(&tr, t + WINDOW_MS + 1000, 30.0f, WINDOW_MS);
+    TEST_ASSERT_EQUAL_INT(1, tr.count);
+    TEST_ASSERT_FALSE(trend_slope(&tr, &slope));
+}
+
+void test_trend_bounded_and_ordered(void)
+{
+    trend_t tr;
+
+    trend_init(&tr);
+    for (int i = 0; i < TREND_MAX_SAMPLES * 3; i++) {
+        trend_add(&tr, i * 100, (float)i, WINDOW_MS);
+    }
+    TEST_ASSERT_EQUAL_INT(TREND_MAX_SAMPLES, tr.count);
+    /* Older and duplicate timestamps are ignored */
+    trend_add(&tr, 100, 1000.0f, WINDOW_MS);
+    trend_add(&tr, (TREND_MAX_SAMPLES * 3 - 1) * 100, 1000.0f, WINDOW_MS);
+    float slope;
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    TEST_ASSERT(near(slope, 600.0f, 0.5f));
+}
+
+void test_trend_long_run_precision(void)
+{
+    trend_t tr;
+    float slope, predicted;
+
+    /* Two days at 1 Hz: the origin moves many times */
+    trend_init(&tr);
+    int64_t t0 = 3000000000LL;
+    float value = 0.0f;
+    for (int i = 0; i < 172800; i++) {
+        value = 25.0f + 0.5f * sinf(i / 20000.0f) + 0.25f * (i % 600) / 600.0f;
+        trend_add(&tr, t0 + (int64_t)i * 1000, value, 20000);
+    }
+    TEST_ASSERT_TRUE(trend_slope(&tr, &slope));
+    /* Sawtooth ramp of 0.25 °C per 10 min dominates the sine */
+    TEST_ASSERT(near(slope, 0.025f, 0.003f));
+    TEST_ASSERT_TRUE(trend_predict(&tr, 0, &predicted));
+    TEST_ASSERT(near(predicted, value, 0.01f));
+}
+
+void run_trend_estimator_tests(void)
+{
+    RUN_TEST(test_trend_needs_samples);
+    RUN_TEST(test_trend_ramp_and_prediction);
+    RUN_TEST(test_trend_noise_rejection);
+    RUN_TEST(test_trend_window_expiry);
+    RUN_TEST(test_trend_bounded_and_ordered);
+    RUN_TEST(test_trend_long_run_precision);
+}
@@ -0,0 +1,668 @@
+/**
+ * @file fleet_sim.c
+ * @brief Host-side fleet simulator: N Thermux nodes against one MQTT broker
+ *
+ * Each simulated node connects like the firmware does (MQTT 3.1.1, retained
+ * "offline" will on <base>/status), announces itself and its sensors with
+ * the firmware's own discovery builders (main/mqtt_payload.c), then
+ * publishes its readings every interval under one of two policies:
+ *
+ * - sensor: one QoS 1 message per reading on <base>/sensor/<id>/state,
+ *   as the Home Assistant client does;
+ * - batch: one JSON document per cycle on <base>/readings, serialized by
+ *   the fan-out batch code (main/fanout_queue.c).
+ *
+ * With a deadband, readings are reported by exception (the Sparkplug
+ * rule, main/sparkplug.c): only those that moved by at least the deadband.
+ * Nodes publish staggered across the interval, or all at once with
+ * --aligned, as wall-clock aligned sampling would make them.
+ *
+ * Reports the load the broker and Home Assistant see: messages/s and
+ * bytes/s (mean and peak second), acknowledgements, and the size of a
+ * reconnect storm when --storm-at drops every node at once.
+ */
+
+#include "mqtt_payload.h"
+#include "fanout_queue.h"
+#include "sparkplug.h"
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_VERSION         "fleet-sim"
+#define KEEPALIVE_S         120
+#define RECONNECT_DELAY_MS  1000
+#define RX_BUF_LEN          256
+#define MAX_SECONDS         86400
+
+typedef enum { POLICY_SENSOR, POLICY_BATCH } policy_t;
+
+typedef struct {
+    const char *host;
+    const char *port;
+    int nodes;
+    int sensors;
+    int interval_ms;
+    policy_t policy;
+    bool use_deadband;
+    float deadband;
+    int qos;
+    bool discovery;
+    bool aligned;
+    int duration_s;
+    int storm_at_s;
+    int report_s;
+} options_t;
+
+typedef struct {
+    char id[17];
+    float value;
+    sparkplug_rbe_t rbe;
+} sim_sensor_t;
+
+typedef struct {
+    int index;
+    char base_topic[32];
+    int fd;                     /* -1 while disconnected */
+    bool connected;             /* CONNACK received */
+    int64_t next_publish_ms;
+    int64_t next_ping_ms;
+    int64_t reconnect_ms;       /* When to retry, 0 = not waiting */
+    uint16_t packet_id;
+    uint32_t seq;
+    sim_sensor_t *sensors;
+    uint8_t rx[RX_BUF_LEN];
+    size_t rx_len;
+} sim_node_t;
+
+typedef struct {
+    uint64_t messages;
+    uint64_t bytes;
+} counter_t;
+
+static options_t s_opt;
+static int64_t s_start_ms;
+static counter_t *s_per_second;     /* Published per second of the run */
+static counter_t s_discovery;       /* Status and discovery messages */
+static uint64_t s_acks;
+static uint64_t s_connects;
+static uint64_t s_reconnects;
+static uint64_t s_send_errors;
+
+/* Reconnect storm: from dropping every node to the last CONNACK */
+static struct {
+    bool active;
+    int64_t start_ms;
+    int64_t settled_ms;
+    int pending;
+    counter_t sent;
+} s_storm;
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* ===== MQTT 3.1.1 encoding ===== */
+
+static size_t put_varint(uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+    do {
+        uint8_t byte = len % 128;
+        len /= 128;
+        buf[n++] = byte | (len > 0 ? 0x80 : 0);
+    } while (len > 0);
+    return n;
+}
+
+static size_t put_str(uint8_t *buf, const char *s, size_t len)
+{
+    buf[0] = (uint8_t)(len >> 8);
+    buf[1] = (uint8_t)(len & 0xFF);
+    memcpy(buf + 2, s, len);
+    return 2 + len;
+}
+
+/**
+ * @brief Send a whole packet; a failure drops the connection
+ */
+static bool send_packet(sim_node_t *node, const uint8_t *buf, size_t len)
+{
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(node->fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            s_send_errors++;
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+static void count(size_t bytes, bool discovery)
+{
+    int64_t second = (now_ms() - s_start_ms) / 1000;
+    if (second >= 0 && second < MAX_SECONDS) {
+        s_per_second[second].messages++;
+        s_per_second[second].bytes += bytes;
+    }
+    if (discovery) {
+        s_discovery.messages++;
+        s_discovery.bytes += bytes;
+    }
+    if (s_storm.active) {
+        s_storm.sent.messages++;
+        s_storm.sent.bytes += bytes;
+    }
+}
+
+static bool publish(sim_node_t *node, const char *topic, const char *payload, int qos, bool retain,
+                    bool discovery)
+{
+    size_t topic_len = strlen(topic);
+    size_t payload_len = strlen(payload);
+    size_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+    uint8_t *buf = malloc(5 + remaining);
+    if (buf == NULL) {
+        return false;
+    }
+
+    size_t n = 0;
+    buf[n++] = (uint8_t)(0x30 | (qos << 1) | (retain ? 1 : 0));
+    n += put_varint(buf + n, remaining);
+    n += put_str(buf + n, topic, topic_len);
+    if (qos > 0) {
+        node->packet_id = node->packet_id == 0xFFFF ? 1 : node->packet_id + 1;
+        buf[n++] = (uint8_t)(node->packet_id >> 8);
+        buf[n++] = (uint8_t)(node->packet_id & 0xFF);
+    }
+    memcpy(buf + n, payload, payload_len);
+    n += payload_len;
+
+    bool ok = send_packet(node, buf, n);
+    free(buf);
+    if (ok) {
+        count(n, discovery);
+    }
+    return ok;
+}
+
+static bool send_connect(sim_node_t *node)
+{
+    char client_id[48];
+    char will_topic[MQTT_TOPIC_LEN];
+    mqtt_node_t naming = { .base_topic = node->base_topic };
+    snprintf(client_id, sizeof(client_id), "%s-sim", node->base_topic);
+    mqtt_status_topic(will_topic, sizeof(will_topic), &naming);
+
+    uint8_t buf[256];
+    uint8_t body[240];
+    size_t b = 0;
+    b += put_str(body + b, "MQTT", 4);
+    body[b++] = 4;                              /* 3.1.1 */
+    body[b++] = 0x02 | 0x04 | (1 << 3) | 0x20;  /* Clean session, will QoS 1 retained */
+    body[b++] = KEEPALIVE_S >> 8;
+    body[b++] = KEEPALIVE_S & 0xFF;
+    b += put_str(body + b, client_id, strlen(client_id));
+    b += put_str(body + b, will_topic, strlen(will_topic));
+    b += put_str(body + b, "offline", 7);
+
+    size_t n = 0;
+    buf[n++] = 0x10;
+    n += put_varint(buf + n, b);
+    memcpy(buf + n, body, b);
+    n += b;
+    if (!send_packet(node, buf, n)) {
+        return false;
+    }
+    count(n, false);
+    return true;
+}
+
+/* ===== Node behaviour ===== */
+
+static void drop(sim_node_t *node, int64_t now)
+{
+    if (node->fd >= 0) {
+        close(node->fd);
+    }
+    node->fd = -1;
+    node->connected = false;
+    node->rx_len = 0;
+    node->reconnect_ms = now + RECONNECT_DELAY_MS;
+}
+
+static bool open_socket(sim_node_t *node)
+{
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    if (getaddrinfo(s_opt.host, s_opt.port, &hints, &res) != 0) {
+        return false;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai != NULL; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    node->fd = fd;
+    return fd >= 0;
+}
+
+static void start_connect(sim_node_t *node, int64_t now)
+{
+    node->reconnect_ms = 0;
+    if (!open_socket(node) || !send_connect(node)) {
+        drop(node, now);
+        return;
+    }
+    s_connects++;
+}
+
+/**
+ * @brief What the firmware sends once connected: status, then discovery
+ */
+static void announce(sim_node_t *node)
+{
+    mqtt_node_t naming = {
+        .discovery_prefix = "homeassistant",
+        .base_topic = node->base_topic,
+        .sw_version = SIM_VERSION,
+    };
+    char topic[MQTT_DISCOVERY_TOPIC_LEN];
+    char payload[MQTT_DISCOVERY_PAYLOAD_LEN];
+
+    mqtt_status_topic(topic, sizeof(topic), &naming);
+    publish(node, topic, "online", 1, true, true);
+    if (!s_opt.discovery) {
+        return;
+    }
+    for (int i = 0; i < s_opt.sensors; i++) {
+        mqtt_entity_t entity = {
+            .sensor_id = node->sensors[i].id,
+            .name = node->sensors[i].id,
+            .unit = "°C",
+            .device_class = "temperature",
+        };
+        mqtt_discovery_topic(topic, sizeof(topic), &naming, entity.sensor_id, NULL);
+        if (mqtt_discovery_payload(payload, sizeof(payload), &naming, &entity) > 0) {
+            publish(node, topic, payload, 1, true, true);
+        }
+    }
+}
+
+/**
+ * @brief Next reading: a slow random walk at the DS18B20's 1/16 °C step
+ */
+static float next_value(sim_sensor_t *s)
+{
+    s->value += (float)((rand() % 21) - 10) / 200.0f;
+    return roundf(s->value * 16.0f) / 16.0f;
+}
+
+static bool due_for_report(sim_sensor_t *s, float value)
+{
+    if (!s_opt.use_deadband) {
+        return true;    /* Firmware behaviour: every reading, every interval */
+    }
+    return sparkplug_rbe_update(&s->rbe, true, value, s_opt.deadband);
+}
+
+static void publish_cycle(sim_node_t *node)
+{
+    mqtt_node_t naming = { .base_topic = node->base_topic };
+    char topic[MQTT_TOPIC_LEN];
+
+    if (s_opt.policy == POLICY_SENSOR) {
+        for (int i = 0; i < s_opt.sensors; i++) {
+            float value = next_value(&node->sensors[i]);
+            if (!due_for_report(&node->sensors[i], value)) {
+                continue;
+            }
+            char payload[16];
+            mqtt_state_topic(topic, sizeof(topic), &naming, node->sensors[i].id, "state");
+            mqtt_state_payload(payload, sizeof(payload), value, 2);
+            if (!publish(node, topic, payload, s_opt.qos, false, false)) {
+                return;
+            }
+        }
+        return;
+    }
+
+    fanout_input_t *inputs = calloc((size_t)s_opt.sensors, sizeof(fanout_input_t));
+    if (inputs == NULL) {
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < s_opt.sensors; i++) {
+        float value = next_value(&node->sensors[i]);
+        if (due_for_report(&node->sensors[i], value)) {
+            inputs[n++] = (fanout_input_t){ .id = node->sensors[i].id, .value = value, .valid = true };
+        }
+    }
+    if (n > 0) {
+        fanout_batch_t *batch = fanout_batch_create(node->seq++, now_ms(), 0, inputs, n);
+        if (batch != NULL) {
+            snprintf(topic, sizeof(topic), "%s/readings", node->base_topic);
+            publish(node, topic, batch->json, s_opt.qos, false, false);
+            fanout_batch_release(batch);
+        }
+    }
+    free(inputs);
+}
+
+static void handle_packet(sim_node_t *node, uint8_t type)
+{
+    if (type == 2 && !node->connected) {         /* CONNACK */
+        node->connected = true;
+        announce(node);
+        if (s_storm.active && --s_storm.pending == 0) {
+            s_storm.settled_ms = now_ms();
+            s_storm.active = false;
+        }
+    } else if (type == 4) {                         /* PUBACK */
+        s_acks++;
+    }
+}
+
+/**
+ * @brief Read what the broker sent and frame it into packets
+ */
+static void receive(sim_node_t *node, int64_t now)
+{
+    ssize_t n = recv(node->fd, node->rx + node->rx_len, sizeof(node->rx) - node->rx_len, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        s_reconnects++;
+        drop(node, now);
+        return;
+    }
+    if (n < 0) {
+        return;
+    }
+    node->rx_len += (size_t)n;
+
+    for (;;) {
+        size_t length = 0, pos = 1;
+        int shift = 0;
+        bool complete = false;
+        while (pos < node->rx_len && pos < 5) {
+            uint8_t byte = node->rx[pos++];
+            length |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete || pos + length > node->rx_len) {
+            if (node->rx_len == sizeof(node->rx)) {
+                node->rx_len = 0;   /* Nothing this simulator expects is this large */
+            }
+            return;
+        }
+        handle_packet(node, node->rx[0] >> 4);
+        memmove(node->rx, node->rx + pos + length, node->rx_len - pos - length);
+        node->rx_len -= pos + length;
+    }
+}
+
+static void storm(sim_node_t *nodes, int64_t now)
+{
+    s_storm.active = true;
+    s_storm.start_ms = now;
+    s_storm.pending = 0;
+    for (int i = 0; i < s_opt.nodes; i++) {
+        drop(&nodes[i], now);
+        nodes[i].reconnect_ms = now;    /* All at once */
+        s_storm.pending++;
+    }
+}
+
+/* ===== Reporting ===== */
+
+static void report(int from_s, int to_s, const char *label)
+{
+    counter_t total = {0};
+    counter_t peak = {0};
+    for (int s = from_s; s < to_s && s < MAX_SECONDS; s++) {
+        total.messages += s_per_second[s].messages;
+        total.bytes += s_per_second[s].bytes;
+        if (s_per_second[s].messages > peak.messages) {
+            peak = s_per_second[s];
+        }
+    }
+    double span = to_s > from_s ? to_s - from_s : 1;
+    printf("%-8s %8.1f msg/s (peak %llu) %10.0f B/s (peak %llu)\n", label,
+           total.messages / span, (unsigned long long)peak.messages,
+           total.bytes / span, (unsigned long long)peak.bytes);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--host H] [--port P] [--nodes N] [--sensors M] [--interval-ms T]\n"
+            "          [--policy sensor|batch] [--deadband C] [--qos 0|1] [--no-discovery]\n"
+            "          [--aligned] [--duration S] [--storm-at S] [--report S]\n", prog);
+}
+
+static bool parse_args(int argc, char **argv)
+{
+    s_opt = (options_t){
+        .host = "127.0.0.1", .port = "1883", .nodes = 10, .sensors = 20,
+        .interval_ms = 30000, .policy = POLICY_SENSOR, .qos = 1, .discovery = true,
+        .duration_s = 120, .report_s = 10,
+    };
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takes_value = true;
+        if (strcmp(arg, "--no-discovery") == 0) {
+            s_opt.discovery = false;
+            takes_value = false;
+        } else if (strcmp(arg, "--aligned") == 0) {
+            s_opt.aligned = true;
+            takes_value = false;
+        } else if (val == NULL) {
+            return false;
+        } else if (strcmp(arg, "--host") == 0) {
+            s_opt.host = val;
+        } else if (strcmp(arg, "--port") == 0) {
+            s_opt.port = val;
+        } else if (strcmp(arg, "--nodes") == 0) {
+            s_opt.nodes = atoi(val);
+        } else if (strcmp(arg, "--sensors") == 0) {
+            s_opt.sensors = atoi(val);
+        } else if (strcmp(arg, "--interval-ms") == 0) {
+            s_opt.interval_ms = atoi(val);
+        } else if (strcmp(arg, "--policy") == 0) {
+            if (strcmp(val, "sensor") == 0) {
+                s_opt.policy = POLICY_SENSOR;
+            } else if (strcmp(val, "batch") == 0) {
+                s_opt.policy = POLICY_BATCH;
+            } else {
+                return false;
+            }
+        } else if (strcmp(arg, "--deadband") == 0) {
+            s_opt.use_deadband = true;
+            s_opt.deadband = (float)atof(val);
+        } else if (strcmp(arg, "--qos") == 0) {
+            s_opt.qos = atoi(val) ? 1 : 0;
+        } else if (strcmp(arg, "--duration") == 0) {
+            s_opt.duration_s = atoi(val);
+        } else if (strcmp(arg, "--storm-at") == 0) {
+            s_opt.storm_at_s = atoi(val);
+        } else if (strcmp(arg, "--report") == 0) {
+            s_opt.report_s = atoi(val);
+        } else {
+            return false;
+        }
+        if (takes_value) {
+            i++;
+        }
+    }
+    return s_opt.nodes > 0 && s_opt.sensors > 0 && s_opt.interval_ms > 0 &&
+           s_opt.duration_s > 0 && s_opt.duration_s <= MAX_SECONDS && s_opt.report_s > 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    sim_node_t *nodes = calloc((size_t)s_opt.nodes, sizeof(sim_node_t));
+    s_per_second = calloc(MAX_SECONDS, sizeof(counter_t));
+    struct pollfd *fds = calloc((size_t)s_opt.nodes, sizeof(struct pollfd));
+    if (nodes == NULL || s_per_second == NULL || fds == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    s_start_ms = now_ms();
+    for (int i = 0; i < s_opt.nodes; i++) {
+        sim_node_t *node = &nodes[i];
+        node->index = i;
+        node->fd = -1;
+        snprintf(node->base_topic, sizeof(node->base_topic), "thermux-%03d", i + 1);
+        node->sensors = calloc((size_t)s_opt.sensors, sizeof(sim_sensor_t));
+        if (node->sensors == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        for (int j = 0; j < s_opt.sensors; j++) {
+            snprintf(node->sensors[j].id, sizeof(node->sensors[j].id), "28%06X%06X5C",
+                     (unsigned)i & 0xFFFFFF, (unsigned)j & 0xFFFFFF);
+            node->sensors[j].value = 18.0f + (float)(rand() % 80) / 10.0f;
+        }
+        int64_t phase = s_opt.aligned ? 0 : (int64_t)s_opt.interval_ms * i / s_opt.nodes;
+        node->next_publish_ms = s_start_ms + phase;
+        node->next_ping_ms = s_start_ms + KEEPALIVE_S * 500;
+        start_connect(node, s_start_ms);
+    }
+
+    printf("%d nodes x %d sensors, %s policy%s, QoS %d, every %d ms (%s)\n",
+           s_opt.nodes, s_opt.sensors, s_opt.policy == POLICY_SENSOR ? "per-sensor" : "batched",
+           s_opt.use_deadband ? " with deadband" : "", s_opt.qos, s_opt.interval_ms,
+           s_opt.aligned ? "aligned" : "staggered");
+
+    int next_report_s = s_opt.report_s;
+    bool stormed = false;
+    int64_t end_ms = s_start_ms + (int64_t)s_opt.duration_s * 1000;
+
+    for (int64_t now = now_ms(); now < end_ms; now = now_ms()) {
+        if (s_opt.storm_at_s > 0 && !stormed && now - s_start_ms >= (int64_t)s_opt.storm_at_s * 1000) {
+            stormed = true;
+            storm(nodes, now);
+        }
+
+        int64_t wake = now + 100;
+        for (int i = 0; i < s_opt.nodes; i++) {
+            sim_node_t *node = &nodes[i];
+            if (node->fd < 0) {
+                if (node->reconnect_ms != 0 && now >= node->reconnect_ms) {
+                    start_connect(node, now);
+                }
+                continue;
+            }
+            if (node->connected && now >= node->next_publish_ms) {
+                publish_cycle(node);
+                while (node->next_publish_ms <= now) {
+                    node->next_publish_ms += s_opt.interval_ms;
+                }
+            }
+            if (node->connected && now >= node->next_ping_ms) {
+                const uint8_t ping[2] = {0xC0, 0x00};
+                send_packet(node, ping, sizeof(ping));
+                node->next_ping_ms = now + KEEPALIVE_S * 500;
+            }
+            if (node->next_publish_ms < wake) {
+                wake = node->next_publish_ms;
+            }
+        }
+
+        int nfds = 0;
+        for (int i = 0; i < s_opt.nodes; i++) {
+            if (nodes[i].fd >= 0) {
+                fds[nfds++] = (struct pollfd){ .fd = nodes[i].fd, .events = POLLIN };
+            }
+        }
+        int timeout = wake > now ? (int)(wake - now) : 0;
+        if (poll(fds, (nfds_t)nfds, timeout) > 0) {
+            int k = 0;
+            for (int i = 0; i < s_opt.nodes; i++) {
+                if (nodes[i].fd < 0) {
+                    continue;
+                }
+                if (fds[k++].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    receive(&nodes[i], now_ms());
+                }
+            }
+        }
+
+        int elapsed_s = (int)((now_ms() - s_start_ms) / 1000);
+        if (elapsed_s >= next_report_s) {
+            char label[16];
+            snprintf(label, sizeof(label), "%ds", next_report_s);
+            report(next_report_s - s_opt.report_s, next_report_s, label);
+            next_report_s += s_opt.report_s;
+        }
+    }
+
+    printf("\n");
+    report(0, s_opt.duration_s, "Overall");
+    printf("Discovery and status: %llu messages, %llu bytes\n",
+           (unsigned long long)s_discovery.messages, (unsigned long long)s_discovery.bytes);
+    printf("Connections: %llu (%llu dropped by the broker), %llu PUBACKs, %llu send errors\n",
+           (unsigned long long)s_connects, (unsigned long long)s_reconnects,
+           (unsigned long long)s_acks, (unsigned long long)s_send_errors);
+    if (stormed) {
+        if (s_storm.active) {
+            printf("Reconnect storm: %d of %d nodes still not reconnected at the end\n",
+                   s_storm.pending, s_opt.nodes);
+        } else {
+            printf("Reconnect storm: %d nodes, %llu messages, %llu bytes, settled in %lld ms\n",
+                   s_opt.nodes, (unsigned long long)s_storm.sent.messages,
+                   (unsigned long long)s_storm.sent.bytes,
+                   (long long)(s_storm.settled_ms - s_storm.start_ms));
+        }
+    }
+
+    for (int i = 0; i < s_opt.nodes; i++) {
+        if (nodes[i].fd >= 0) {
+            const uint8_t disconnect[2] = {0xE0, 0x00};
+            send_packet(&nodes[i], disconnect, sizeof(disconnect));
+            close(nodes[i].fd);
+        }
+        free(nodes[i].sensors);
+    }
+    free(nodes);
+    free(fds);
+    free(s_per_second);
+    return 0;
+}